@@ -1,6 +1,7 @@
 #pragma once
 
 #include <bit>
+#include <cstring>
 #include "common/defines.h"
 #include "common/types.h"
 
@@ -65,6 +66,40 @@ static constexpr ALWAYS_INLINE T bit_range(const T value) {
     return (value >> LowerBound) & mask;
 }
 
+// std::byteswap is C++23.
+template <typename T>
+static constexpr ALWAYS_INLINE T byteswap(const T value) {
+    if constexpr (sizeof(T) == 1) {
+        return value;
+    } else if constexpr (sizeof(T) == 2) {
+        return __builtin_bswap16(value);
+    } else if constexpr (sizeof(T) == 4) {
+        return __builtin_bswap32(value);
+    } else {
+        static_assert(sizeof(T) == 8);
+        return __builtin_bswap64(value);
+    }
+}
+
+// N64 memory is big-endian. These do a single unaligned host access rather than assembling the value byte by byte.
+template <typename T>
+static ALWAYS_INLINE T read_big_endian(const u8* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    if constexpr (std::endian::native == std::endian::little) {
+        value = byteswap(value);
+    }
+    return value;
+}
+
+template <typename T>
+static ALWAYS_INLINE void write_big_endian(u8* data, T value) {
+    if constexpr (std::endian::native == std::endian::little) {
+        value = byteswap(value);
+    }
+    std::memcpy(data, &value, sizeof(T));
+}
+
 static ALWAYS_INLINE f64 bit_cast_f32_to_f64(const f32 value) {
     const u64 float_bits = static_cast<u64>(std::bit_cast<u32>(value));
     return std::bit_cast<f64>(float_bits);
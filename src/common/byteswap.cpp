@@ -0,0 +1,104 @@
+#include <bit>
+#include <cstring>
+#include "common/bits.h"
+#include "common/byteswap.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BYTESWAP_X64
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Common {
+
+namespace {
+
+using CopyFunction = void (*)(u8* dst, const u8* src, std::size_t count);
+
+template <typename T>
+void copy_swapped_scalar(u8* dst, const u8* src, const std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        T value;
+        std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+        value = byteswap(value);
+        std::memcpy(dst + i * sizeof(T), &value, sizeof(T));
+    }
+}
+
+#ifdef BYTESWAP_X64
+// The byte order within each 16 bytes that reverses every element of the given size.
+template <typename T>
+TARGET_SSSE3 __m128i swap_shuffle128() {
+    if constexpr (sizeof(T) == 2) {
+        return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    } else {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+}
+
+template <typename T>
+TARGET_SSSE3 void copy_swapped_ssse3(u8* dst, const u8* src, const std::size_t count) {
+    constexpr std::size_t PerVector = sizeof(__m128i) / sizeof(T);
+    const __m128i shuffle = swap_shuffle128<T>();
+
+    std::size_t i = 0;
+    for (; i + PerVector <= count; i += PerVector) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(T)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * sizeof(T)), _mm_shuffle_epi8(value, shuffle));
+    }
+    copy_swapped_scalar<T>(dst + i * sizeof(T), src + i * sizeof(T), count - i);
+}
+
+template <typename T>
+TARGET_AVX2 void copy_swapped_avx2(u8* dst, const u8* src, const std::size_t count) {
+    // vpshufb shuffles within each 128-bit lane, so the pattern repeats. Two vectors go per iteration, which is enough
+    // to keep up with memory on large buffers.
+    constexpr std::size_t PerVector = sizeof(__m256i) / sizeof(T);
+    const __m256i shuffle = _mm256_broadcastsi128_si256(swap_shuffle128<T>());
+
+    std::size_t i = 0;
+    for (; i + PerVector * 2 <= count; i += PerVector * 2) {
+        const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * sizeof(T)));
+        const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * sizeof(T) + sizeof(__m256i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * sizeof(T)), _mm256_shuffle_epi8(first, shuffle));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * sizeof(T) + sizeof(__m256i)), _mm256_shuffle_epi8(second, shuffle));
+    }
+    copy_swapped_ssse3<T>(dst + i * sizeof(T), src + i * sizeof(T), count - i);
+}
+#endif
+
+template <typename T>
+CopyFunction best_copy_swapped() {
+#ifdef BYTESWAP_X64
+    if (__builtin_cpu_supports("avx2")) {
+        return copy_swapped_avx2<T>;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return copy_swapped_ssse3<T>;
+    }
+#endif
+    return copy_swapped_scalar<T>;
+}
+
+}
+
+void copy_swapped16(void* dst, const void* src, const std::size_t count) {
+    static const CopyFunction copy = best_copy_swapped<u16>();
+    copy(static_cast<u8*>(dst), static_cast<const u8*>(src), count);
+}
+
+void copy_swapped32(void* dst, const void* src, const std::size_t count) {
+    static const CopyFunction copy = best_copy_swapped<u32>();
+    copy(static_cast<u8*>(dst), static_cast<const u8*>(src), count);
+}
+
+void copy_from_big_endian16(void* dst, const void* src, const std::size_t count) {
+    if constexpr (std::endian::native == std::endian::big) {
+        std::memmove(dst, src, count * 2);
+    } else {
+        copy_swapped16(dst, src, count);
+    }
+}
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include "common/types.h"
+
+namespace Common {
+
+// Copies count halfwords or words, reversing the bytes of each. On x86-64, this swaps 16 or 32 bytes at a time, with
+// SSSE3 or AVX2 when the host has them. dst and src may be the same, but must not otherwise overlap.
+void copy_swapped16(void* dst, const void* src, std::size_t count);
+void copy_swapped32(void* dst, const void* src, std::size_t count);
+
+// Copies count big-endian halfwords into host order. dst and src may be the same, but must not otherwise overlap.
+void copy_from_big_endian16(void* dst, const void* src, std::size_t count);
+
+}
@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "common/mapped_file.h"
+
+namespace Common {
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    std::error_code error;
+    const std::size_t size = std::filesystem::file_size(path, error);
+    if (error || size == 0) {
+        return;
+    }
+
+#ifdef __linux__
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    // The mapping stays valid once the descriptor is closed.
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    m_data = static_cast<u8*>(data);
+    m_size = size;
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.good()) {
+        return;
+    }
+
+    m_data = static_cast<u8*>(std::malloc(size));
+    m_size = size;
+    if (!m_data || !stream.read(reinterpret_cast<char*>(m_data), size)) {
+        unmap();
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+void MappedFile::unmap() {
+    if (!m_data) {
+        return;
+    }
+
+#ifdef __linux__
+    munmap(m_data, m_size);
+#else
+    std::free(m_data);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include "common/types.h"
+
+namespace Common {
+
+// A file mapped copy-on-write (MAP_PRIVATE). Pages are read in as they are first touched, and are shared with every
+// other process mapping the same file until they are written to, which only this mapping sees. Without mmap (other
+// than Linux), the file is read into memory instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    // Leaves the mapping empty if the file cannot be opened or mapped.
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_mapped() const { return m_data != nullptr; }
+    u8* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    u8* m_data { nullptr };
+    std::size_t m_size {};
+
+    void unmap();
+};
+
+}
@@ -0,0 +1,71 @@
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "common/bits.h"
+#include "common/logging.h"
+#include "common/shared_memory.h"
+
+namespace Common {
+
+static constexpr std::size_t HostPageSize = 0x1000;
+
+SharedMemory::SharedMemory(const std::size_t size) : m_size(size) {
+    ASSERT(size % HostPageSize == 0);
+
+#ifdef __linux__
+    m_fd = memfd_create("fourixtys", MFD_CLOEXEC);
+    if (m_fd >= 0 && ftruncate(m_fd, size) == 0) {
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<u8*>(data);
+            return;
+        }
+    }
+
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    m_data = static_cast<u8*>(std::aligned_alloc(HostPageSize, size));
+    ASSERT_MSG(m_data, "Failed to allocate {} bytes of memory", size);
+    std::memset(m_data, 0, size);
+}
+
+SharedMemory::~SharedMemory() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        munmap(m_data, m_size);
+        close(m_fd);
+        return;
+    }
+#endif
+
+    std::free(m_data);
+}
+
+bool SharedMemory::map_view([[maybe_unused]] u8* address, [[maybe_unused]] const std::size_t offset, [[maybe_unused]] const std::size_t size) const {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        return mmap(address, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, offset) != MAP_FAILED;
+    }
+#endif
+
+    return false;
+}
+
+bool SharedMemory::set_view_access([[maybe_unused]] u8* address, [[maybe_unused]] const std::size_t size, [[maybe_unused]] const Access access) {
+#ifdef __linux__
+    static constexpr std::array<int, 3> PROTECTIONS = { PROT_NONE, PROT_READ, PROT_READ | PROT_WRITE };
+    return mprotect(address, size, PROTECTIONS[Common::underlying(access)]) == 0;
+#else
+    return false;
+#endif
+}
+
+}
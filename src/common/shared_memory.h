@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include "common/types.h"
+
+namespace Common {
+
+// Host memory that can be mapped at more than one address at once. This needs memfd (Linux); elsewhere it is a
+// plain allocation and views cannot be mapped.
+class SharedMemory {
+public:
+    explicit SharedMemory(std::size_t size);
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    enum class Access {
+        None,
+        Read,
+        ReadWrite,
+    };
+
+    u8* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    // Maps part of the memory at a fixed, page-aligned address, replacing whatever was mapped there.
+    bool map_view(u8* address, std::size_t offset, std::size_t size) const;
+    static bool set_view_access(u8* address, std::size_t size, Access access);
+
+private:
+    std::size_t m_size {};
+    u8* m_data { nullptr };
+    int m_fd { -1 };
+};
+
+}
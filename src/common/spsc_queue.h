@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include "common/types.h"
+
+namespace Common {
+
+// A fixed-size ring between exactly one producing and one consuming thread, without locks. Either side can block
+// until the other one makes room or brings something.
+template <typename T, std::size_t Capacity>
+class SPSCQueue {
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+public:
+    bool try_push(T value) {
+        const u64 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        m_items[tail % Capacity] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_tail.notify_one();
+        return true;
+    }
+
+    // Waits for the consumer to make room if the ring is full.
+    void push(T value) {
+        const u64 tail = m_tail.load(std::memory_order_relaxed);
+        u64 head = m_head.load(std::memory_order_acquire);
+        while (tail - head == Capacity) {
+            m_head.wait(head, std::memory_order_acquire);
+            head = m_head.load(std::memory_order_acquire);
+        }
+
+        m_items[tail % Capacity] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_tail.notify_one();
+    }
+
+    std::optional<T> try_pop() {
+        const u64 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+
+        T value = std::move(m_items[head % Capacity]);
+        m_head.store(head + 1, std::memory_order_release);
+        m_head.notify_one();
+        return value;
+    }
+
+    // Waits for the producer if the ring is empty.
+    T pop() {
+        const u64 head = m_head.load(std::memory_order_relaxed);
+        u64 tail = m_tail.load(std::memory_order_acquire);
+        while (head == tail) {
+            m_tail.wait(tail, std::memory_order_acquire);
+            tail = m_tail.load(std::memory_order_acquire);
+        }
+
+        T value = std::move(m_items[head % Capacity]);
+        m_head.store(head + 1, std::memory_order_release);
+        m_head.notify_one();
+        return value;
+    }
+
+private:
+    // Kept on separate cache lines, as each one is written by a different thread.
+    alignas(64) std::atomic<u64> m_head {};
+    alignas(64) std::atomic<u64> m_tail {};
+    alignas(64) std::array<T, Capacity> m_items {};
+};
+
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(u32 thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (u32 i = 1; i < thread_count; i++) {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_quit = true;
+    }
+    m_work_available.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(const u32 job_count, const std::function<void(u32)>& job) {
+    if (job_count == 0) {
+        return;
+    }
+
+    // Not worth waking anyone up for.
+    if (job_count == 1 || m_workers.empty()) {
+        for (u32 i = 0; i < job_count; i++) {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::scoped_lock lock(m_mutex);
+        m_job = &job;
+        m_job_count = job_count;
+        m_next_job.store(0, std::memory_order_relaxed);
+        m_busy_workers = static_cast<u32>(m_workers.size());
+        m_generation++;
+    }
+    m_work_available.notify_all();
+
+    work();
+
+    std::unique_lock lock(m_mutex);
+    m_work_done.wait(lock, [this] { return m_busy_workers == 0; });
+    m_job = nullptr;
+}
+
+void ThreadPool::worker_loop() {
+    u64 generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_work_available.wait(lock, [&] { return m_quit || m_generation != generation; });
+            if (m_quit) {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        work();
+
+        std::scoped_lock lock(m_mutex);
+        if (--m_busy_workers == 0) {
+            m_work_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work() {
+    while (true) {
+        const u32 index = m_next_job.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_job_count) {
+            return;
+        }
+        (*m_job)(index);
+    }
+}
+
+}
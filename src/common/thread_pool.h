@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/types.h"
+
+namespace Common {
+
+// Runs batches of independent jobs on a fixed set of worker threads. The calling thread works on the batch as well,
+// and only returns once every job in it is done.
+class ThreadPool {
+public:
+    // Zero picks one thread per host core. The count includes the calling thread.
+    explicit ThreadPool(u32 thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    u32 thread_count() const { return static_cast<u32>(m_workers.size()) + 1; }
+
+    // Calls job(0) to job(job_count - 1), in no particular order.
+    void run(u32 job_count, const std::function<void(u32)>& job);
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+    u64 m_generation {};
+    u32 m_busy_workers {};
+    bool m_quit {};
+
+    const std::function<void(u32)>* m_job {};
+    u32 m_job_count {};
+    std::atomic<u32> m_next_job {};
+
+    void worker_loop();
+    void work();
+};
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "common/types.h"
+
+namespace Common {
+
+// Hands the latest of a stream of values from one thread to another, without locks and without either side ever
+// waiting. The producer fills the back buffer and publishes it; the consumer picks up whichever was published last,
+// skipping any it missed. Neither side touches the buffer the other one holds.
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer side.
+    T& back() { return m_buffers[m_back]; }
+    void publish() {
+        const u8 previous = m_middle.exchange(m_back | FreshBit, std::memory_order_acq_rel);
+        m_back = previous & IndexMask;
+    }
+
+    // Consumer side. Returns whether a newer buffer came in since the last call.
+    bool update() {
+        if (!(m_middle.load(std::memory_order_relaxed) & FreshBit)) {
+            return false;
+        }
+
+        const u8 previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & IndexMask;
+        return true;
+    }
+    const T& front() const { return m_buffers[m_front]; }
+
+private:
+    static constexpr u8 IndexMask = 0b011;
+    static constexpr u8 FreshBit = 0b100;
+
+    std::array<T, 3> m_buffers {};
+    // The middle buffer changes hands through the atomic; the other two each belong to one side.
+    alignas(64) u8 m_back { 0 };
+    alignas(64) std::atomic<u8> m_middle { 1 };
+    alignas(64) u8 m_front { 2 };
+};
+
+}
@@ -1,5 +1,10 @@
 #include "common/logging.h"
 #include "cop0.h"
+#include "scheduler.h"
+
+// Writable bits of EntryLo0/EntryLo1 (PFN, C, D, V and G) and PageMask.
+static constexpr u64 ENTRY_LO_MASK = 0x3FFFFFFF;
+static constexpr u32 PAGE_MASK_MASK = 0x01FFE000;
 
 std::string_view COP0::get_reg_name(const u8 reg) {
     using namespace std::string_view_literals;
@@ -56,19 +61,21 @@ u64 COP0::get_reg(const u8 reg) const {
         case 0:
             return index;
         case 1:
-            return random;
+            return random();
         case 2:
             return entry_lo0;
         case 3:
             return entry_lo1;
         case 4:
             return context.raw;
+        case 5:
+            return page_mask;
         case 6:
             return wired;
         case 8:
             return bad_vaddr;
         case 9:
-            return count;
+            return count();
         case 10:
             return entry_hi;
         case 11:
@@ -89,6 +96,10 @@ u64 COP0::get_reg(const u8 reg) const {
             return xcontext.raw;
         case 26:
             return parity_error;
+        case 28:
+            return tag_lo;
+        case 29:
+            return tag_hi;
         case 30:
             return error_epc;
         default:
@@ -103,35 +114,34 @@ void COP0::set_reg(const u8 reg, const u64 value) {
             set_index(static_cast<u32>(value));
             return;
         case 1:
-            random = static_cast<u32>(value);
+            // Random is read only - ignore
             return;
         case 2:
-            entry_lo0 = value;
+            entry_lo0 = value & ENTRY_LO_MASK;
             return;
         case 3:
-            entry_lo1 = value;
+            entry_lo1 = value & ENTRY_LO_MASK;
             return;
         case 4:
             set_context(value);
             return;
         case 5:
-            page_mask = static_cast<u32>(value);
+            page_mask = static_cast<u32>(value) & PAGE_MASK_MASK;
             return;
         case 6:
-            wired = Common::lowest_bits(static_cast<u32>(value), 6);
+            set_wired(static_cast<u32>(value));
             return;
         case 8:
             // BadVaddr is read only - ignore
             return;
         case 9:
-            count = static_cast<u32>(value);
+            set_count(static_cast<u32>(value));
             return;
         case 10:
             entry_hi = static_cast<u32>(value);
             return;
         case 11:
-            compare = static_cast<u32>(value);
-            disable_cause_ip_bit<7>();
+            set_compare(static_cast<u32>(value));
             return;
         case 12:
             set_status(static_cast<u32>(value));
@@ -186,6 +196,19 @@ void COP0::set_context(const u64 raw) {
     context.raw &= ~Common::bit_mask_from_range<3, 0, u64>();
 }
 
+u32 COP0::random() const {
+    // Approximated with one decrement per PCycle rather than per instruction.
+    const u32 range = (wired < 32) ? (32 - wired) : 32;
+    return 31 - static_cast<u32>((m_scheduler.timestamp() - random_base_timestamp) % range);
+}
+
+void COP0::set_wired(const u32 value) {
+    wired = Common::lowest_bits(value, 6);
+
+    // Writing Wired resets Random to its upper bound.
+    random_base_timestamp = m_scheduler.timestamp();
+}
+
 void COP0::set_status(const u32 raw) {
     status.raw = raw;
 
@@ -221,11 +244,33 @@ void COP0::set_parity_error(const u32 value) {
     parity_error &= ~Common::bit_mask_from_range<31, 8, u32>();
 }
 
-void COP0::increment_cycle_count(u32 cycles) {
-    for (; cycles > 0; cycles--) {
-        count++;
-        if (count == compare) {
-            enable_cause_ip_bit<7>();
-        }
+u32 COP0::count() const {
+    return count_base + static_cast<u32>(m_scheduler.timestamp() - count_base_timestamp);
+}
+
+void COP0::set_count(const u32 value) {
+    count_base = value;
+    count_base_timestamp = m_scheduler.timestamp();
+    schedule_compare_event();
+}
+
+void COP0::set_compare(const u32 value) {
+    compare = value;
+    disable_cause_ip_bit<7>();
+    schedule_compare_event();
+}
+
+void COP0::schedule_compare_event() {
+    // Count has to wrap all the way around if it already matches Compare.
+    u64 cycles_until_match = static_cast<u32>(compare - count());
+    if (cycles_until_match == 0) {
+        cycles_until_match = 1llu << 32;
     }
+
+    m_scheduler.schedule(Scheduler::EventType::COP0Compare, cycles_until_match);
+}
+
+void COP0::handle_compare_event() {
+    enable_cause_ip_bit<7>();
+    schedule_compare_event();
 }
@@ -5,8 +5,14 @@
 #include "common/bits.h"
 #include "common/types.h"
 
+class Scheduler;
+
 class COP0 {
 public:
+    explicit COP0(Scheduler& scheduler) : m_scheduler(scheduler) {
+        schedule_compare_event();
+    }
+
     static std::string_view get_reg_name(u8 reg);
 
     template <u8 InterruptBit>
@@ -21,21 +27,29 @@ public:
 
     void set_cause_ip(u32 value) { cause.flags.ip = value; }
 
+    // Cheap check for the CPU loop: is any interrupt line both asserted and unmasked?
+    [[nodiscard]] bool has_unmasked_interrupt() const { return (status.raw & cause.raw & 0xFF00) != 0; }
     [[nodiscard]] bool should_service_interrupt() const;
 
     [[nodiscard]] u64 get_reg(u8 reg) const;
 
-    void increment_cycle_count(u32 cycles);
+    void handle_compare_event();
 
 private:
     friend class VR4300;
 
+    Scheduler& m_scheduler;
+
     void set_reg(u8 reg, u64 value);
 
     u32 index {};
     void set_index(u32 index);
 
-    u32 random {};
+    // Random is not stored either, it counts down from 31 to Wired as time passes.
+    u64 random_base_timestamp {};
+    [[nodiscard]] u32 random() const;
+    void set_wired(u32 value);
+
     u64 entry_lo0 {};
     u64 entry_lo1 {};
 
@@ -52,9 +66,17 @@ private:
     u32 page_mask {};
     u32 wired {};
     u64 bad_vaddr { -1lu };
-    u32 count {};
+    // Count is not stored directly, it is derived from the scheduler timestamp whenever it is read.
+    u32 count_base {};
+    u64 count_base_timestamp {};
+    [[nodiscard]] u32 count() const;
+    void set_count(u32 value);
+
     u64 entry_hi {};
+
     u32 compare {};
+    void set_compare(u32 value);
+    void schedule_compare_event();
 
     union {
         u32 raw;
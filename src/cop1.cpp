@@ -4,6 +4,16 @@
 
 #define LTRACE_FPU(disasm_fmt, ...) // fmt::print("trace: {:016X}: {:08X}  " disasm_fmt "\n", u64(s32(m_vr4300.pc())), instruction, ##__VA_ARGS__)
 
+// Pipeline stalls in PCycles, on top of the single cycle every instruction takes.
+static constexpr u32 AddSubStallCycles = 2;
+static constexpr u32 SingleMultiplyStallCycles = 4;
+static constexpr u32 DoubleMultiplyStallCycles = 7;
+static constexpr u32 SingleDivideStallCycles = 28;
+static constexpr u32 DoubleDivideStallCycles = 57;
+static constexpr u32 ConvertFromFloatStallCycles = 1;
+static constexpr u32 ConvertFromFixedStallCycles = 4;
+static constexpr u32 TruncateStallCycles = 4;
+
 std::string COP1::reg_name(const u32 reg) {
     if (reg <= 31) {
         return fmt::format("f{}", reg);
@@ -73,6 +83,7 @@ void COP1::add(const u32 instruction) {
     const auto fs = get_fs(instruction);
     const auto fd = get_fd(instruction);
     LTRACE_FPU("add.{} ${}, ${}, ${}", fmt_name(fmt), reg_name(fd), reg_name(fs), reg_name(ft));
+    m_vr4300.stall(AddSubStallCycles);
 
     if (fmt == Format::SingleFloating) {
         m_fprs[fd].as_f32 = m_fprs[fs].as_f32 + m_fprs[ft].as_f32;
@@ -194,6 +205,7 @@ void COP1::cvt_d(const u32 instruction) {
             break;
         }
         case Format::Word: {
+            m_vr4300.stall(ConvertFromFixedStallCycles);
             m_fprs[fd].as_f64 = static_cast<f64>(m_fprs[fs].as_u32);
             break;
         }
@@ -211,10 +223,12 @@ void COP1::cvt_s(const u32 instruction) {
 
     switch (fmt) {
         case Format::DoubleFloating: {
+            m_vr4300.stall(ConvertFromFloatStallCycles);
             m_fprs[fd].as_f32 = static_cast<f32>(m_fprs[fs].as_f64);
             break;
         }
         case Format::Word: {
+            m_vr4300.stall(ConvertFromFixedStallCycles);
             m_fprs[fd].as_f32 = static_cast<f32>(m_fprs[fs].as_u32);
             break;
         }
@@ -232,8 +246,10 @@ void COP1::div(const u32 instruction) {
     LTRACE_FPU("div.{} ${}, ${}, ${}", fmt_name(fmt), reg_name(fd), reg_name(fs), reg_name(ft));
 
     if (fmt == Format::SingleFloating) {
+        m_vr4300.stall(SingleDivideStallCycles);
         m_fprs[fd].as_f32 = m_fprs[fs].as_f32 / m_fprs[ft].as_f32;
     } else if (fmt == Format::DoubleFloating) {
+        m_vr4300.stall(DoubleDivideStallCycles);
         m_fprs[fd].as_f64 = m_fprs[fs].as_f64 / m_fprs[ft].as_f64;
     } else {
         UNREACHABLE();
@@ -257,8 +273,10 @@ void COP1::mul(const u32 instruction) {
     LTRACE_FPU("mul.{} ${}, ${}, ${}", fmt_name(fmt), reg_name(fd), reg_name(fs), reg_name(ft));
 
     if (fmt == Format::SingleFloating) {
+        m_vr4300.stall(SingleMultiplyStallCycles);
         m_fprs[fd].as_f32 = m_fprs[fs].as_f32 * m_fprs[ft].as_f32;
     } else if (fmt == Format::DoubleFloating) {
+        m_vr4300.stall(DoubleMultiplyStallCycles);
         m_fprs[fd].as_f64 = m_fprs[fs].as_f64 * m_fprs[ft].as_f64;
     } else {
         UNREACHABLE();
@@ -271,6 +289,7 @@ void COP1::sub(const u32 instruction) {
     const auto fs = get_fs(instruction);
     const auto fd = get_fd(instruction);
     LTRACE_FPU("sub.{} ${}, ${}, ${}", fmt_name(fmt), reg_name(fd), reg_name(fs), reg_name(ft));
+    m_vr4300.stall(AddSubStallCycles);
 
     if (fmt == Format::SingleFloating) {
         m_fprs[fd].as_f32 = m_fprs[fs].as_f32 - m_fprs[ft].as_f32;
@@ -286,6 +305,7 @@ void COP1::trunc_w(const u32 instruction) {
     const auto fs = get_fs(instruction);
     const auto fd = get_fd(instruction);
     LTRACE_FPU("trunc.w.{} ${}, ${}", fmt_name(fmt), reg_name(fd), reg_name(fs));
+    m_vr4300.stall(TruncateStallCycles);
 
     if (fmt == Format::SingleFloating) {
         m_fprs[fd].as_u32 = static_cast<u32>(m_fprs[fs].as_f32);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "common/types.h"
+
+// How fast the SDL frontend runs emulation, relative to real time. Uncapped runs as fast as the host allows, as does
+// holding Tab. The headless frontend always runs uncapped.
+struct EmulationSpeed {
+    f64 multiplier { 1.0 };
+    bool uncapped {};
+};
@@ -2,15 +2,8 @@
 #include "frontend/headless.h"
 #include "n64.h"
 
-void render_screen([[maybe_unused]] const N64& n64) {
-    // No-op
-}
-
-void handle_frontend_events() {
-    // No-op
-}
-
-int main_headless(std::span<std::string_view> args) {
+int main_headless(std::span<std::string_view> args, const CPUBackend cpu_backend, const CacheEmulation cache_emulation,
+                  const TaskEmulation task_emulation, const u32 rdp_thread_count) {
     PIF pif(args[0]);
     GamePak gamepak(args[1]);
 
@@ -18,10 +11,10 @@ int main_headless(std::span<std::string_view> args) {
         return 1;
     }
 
-    N64 n64(pif, gamepak);
+    N64 n64(pif, gamepak, cpu_backend, cache_emulation, task_emulation, rdp_thread_count);
 
     while (true) {
-        n64.run();
+        n64.run_for(N64::CyclesPerFrame);
     }
 
     return 0;
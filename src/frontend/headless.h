@@ -2,10 +2,11 @@
 
 #include <span>
 #include <string_view>
+#include "common/types.h"
 
-class N64;
+enum class CPUBackend;
+enum class CacheEmulation;
+enum class TaskEmulation;
 
-int main_headless(std::span<std::string_view> args);
-
-void render_screen(const N64& n64);
-void handle_frontend_events();
+int main_headless(std::span<std::string_view> args, CPUBackend cpu_backend, CacheEmulation cache_emulation,
+                  TaskEmulation task_emulation, u32 rdp_thread_count);
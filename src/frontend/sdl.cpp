@@ -1,3 +1,7 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
 #include <SDL2/SDL.h>
 #include "frontend/sdl.h"
 #include "n64.h"
@@ -11,83 +15,104 @@ SDL_Renderer* g_renderer = nullptr;
 SDL_Texture* g_texture = nullptr;
 SDL_Event g_event {};
 
-bool g_running = false;
+// The streaming texture is kept across frames, and only recreated when the mode changes.
+u32 g_texture_format = SDL_PIXELFORMAT_UNKNOWN;
+u32 g_texture_width = 0;
+u32 g_texture_height = 0;
 
-void handle_frontend_events() {
+std::atomic<bool> g_running = false;
+// Held down with Tab.
+std::atomic<bool> g_fast_forward = false;
+
+static void handle_frontend_events() {
     while (SDL_PollEvent(&g_event)) {
         switch (g_event.type) {
             case SDL_QUIT:
                 g_running = false;
                 break;
+
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                if (g_event.key.keysym.scancode == SDL_SCANCODE_TAB) {
+                    g_fast_forward = (g_event.type == SDL_KEYDOWN);
+                }
+                break;
         }
     }
 }
 
-void render_screen(const N64& n64) {
+static bool prepare_texture(const u32 format, const u32 width, const u32 height) {
+    if (g_texture && format == g_texture_format && width == g_texture_width && height == g_texture_height) {
+        return true;
+    }
+
     SDL_DestroyTexture(g_texture);
+    g_texture = SDL_CreateTexture(g_renderer, format, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (!g_texture) {
+        LERROR("Draw: failed to create SDL texture: {} (width={}, height={})", SDL_GetError(), width, height);
+        g_texture_format = SDL_PIXELFORMAT_UNKNOWN;
+        return false;
+    }
 
-    const VI& vi = n64.mmu().vi();
-
-    const auto width = Common::bit_range<11, 0>(vi.width());
-    const auto v_video = vi.vstart();
-    const auto v_start = Common::bit_range<25, 16>(v_video);
-    const auto v_end = Common::bit_range<9, 0>(v_video);
-    const auto y_scale = Common::bit_range<11, 10>(vi.yscale()); // FIXME: Handle fractional bits
-    const auto height = ((v_end - v_start) / 2) * y_scale;
-    const auto origin = Common::bit_range<23, 0>(vi.origin());
-    const auto color_format = Common::bit_range<1, 0>(vi.control());
-    // LINFO("Draw: width={}, height={}, yscale={}, origin={:08X}, color_format={}", width, height, y_scale, origin, color_format);
-
-    switch (color_format) {
-        case 0: // Blank
-            break;
-
-        case 2: {
-            g_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_RGBA5551, SDL_TEXTUREACCESS_STATIC, width, height);
-            if (!g_texture) {
-                LERROR("Draw: failed to create SDL texture: {} (color_format={}, width={}, height={})", SDL_GetError(), color_format, width, height);
-                return;
-            }
-
-            std::vector<u16> pixel_buffer(width * height);
-
-            for (std::size_t y = 0; y < height; y++) {
-                for (std::size_t x = 0; x < width; x++) {
-                    const auto pixel_buffer_offset = (y * width + x);
-                    const auto rdram_offset = origin + (pixel_buffer_offset * sizeof(u16));
-
-                    u16 color = n64.mmu().rdram().at(rdram_offset) << 8;
-                    color |= n64.mmu().rdram().at(rdram_offset + 1);
-                    pixel_buffer.at(pixel_buffer_offset) = color;
-                }
-            }
+    g_texture_format = format;
+    g_texture_width = width;
+    g_texture_height = height;
+    return true;
+}
+
+static void render_screen(N64& n64) {
+    if (const VIScanout::Frame* frame = n64.vi_scanout().take_frame()) {
+        if (!prepare_texture(SDL_PIXELFORMAT_RGBA32, frame->width, frame->height)) {
+            return;
+        }
 
-            SDL_UpdateTexture(g_texture, nullptr, pixel_buffer.data(), width * sizeof(u16));
-            SDL_RenderCopy(g_renderer, g_texture, nullptr, nullptr);
-            SDL_RenderPresent(g_renderer);
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture(g_texture, nullptr, &pixels, &pitch) < 0) {
+            LERROR("Draw: failed to lock SDL texture: {}", SDL_GetError());
+            return;
+        }
 
-            break;
+        const std::size_t line_size = frame->width * sizeof(u32);
+        for (u32 y = 0; y < frame->height; y++) {
+            std::memcpy(static_cast<u8*>(pixels) + static_cast<std::size_t>(y) * pitch, &frame->pixels[y * frame->width], line_size);
         }
+        SDL_UnlockTexture(g_texture);
+    }
+
+    // The last frame is shown again until a new one comes in. Presenting waits for vsync, which paces this thread.
+    if (g_texture) {
+        SDL_RenderCopy(g_renderer, g_texture, nullptr, nullptr);
+    }
+    SDL_RenderPresent(g_renderer);
+}
 
-        case 3:
-            g_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STATIC, width, height);
-            if (!g_texture) {
-                LERROR("Draw: failed to create SDL texture: {} (color_format={}, width={}, height={})", SDL_GetError(), color_format, width, height);
-                return;
-            }
+static void run_emulation(N64& n64, const EmulationSpeed speed) {
+    using Clock = std::chrono::steady_clock;
+    const auto frame_duration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<f64>(1.0 / 60.0 / speed.multiplier));
 
-            SDL_UpdateTexture(g_texture, nullptr, n64.mmu().rdram().data() + origin, width * sizeof(u32));
-            SDL_RenderCopy(g_renderer, g_texture, nullptr, nullptr);
-            SDL_RenderPresent(g_renderer);
+    auto next_frame = Clock::now();
+    while (g_running) {
+        n64.run_for(N64::CyclesPerFrame);
 
-            break;
+        if (speed.uncapped || g_fast_forward) {
+            next_frame = Clock::now();
+            continue;
+        }
 
-        default:
-            UNIMPLEMENTED_MSG("Draw: Unimplemented color format {}", color_format);
+        // After falling well behind, as when the host stalls, pacing picks up from now rather than rushing to catch up.
+        next_frame += frame_duration;
+        const auto now = Clock::now();
+        if (now > next_frame + frame_duration * 4) {
+            next_frame = now;
+        } else {
+            std::this_thread::sleep_until(next_frame);
+        }
     }
 }
 
-int main_SDL(std::span<std::string_view> args) {
+int main_SDL(std::span<std::string_view> args, const CPUBackend cpu_backend, const CacheEmulation cache_emulation,
+             const TaskEmulation task_emulation, const u32 rdp_thread_count, const EmulationSpeed speed) {
     PIF pif(args[0]);
     GamePak gamepak(args[1]);
 
@@ -116,13 +141,17 @@ int main_SDL(std::span<std::string_view> args) {
         return 1;
     }
 
-    N64 n64(pif, gamepak);
+    N64 n64(pif, gamepak, cpu_backend, cache_emulation, task_emulation, rdp_thread_count);
 
     g_running = true;
+    std::thread emulation_thread(run_emulation, std::ref(n64), speed);
     while (g_running) {
-        n64.run();
+        handle_frontend_events();
+        render_screen(n64);
     }
+    emulation_thread.join();
 
+    SDL_DestroyTexture(g_texture);
     SDL_DestroyRenderer(g_renderer);
     SDL_DestroyWindow(g_window);
     SDL_Quit();
@@ -2,10 +2,13 @@
 
 #include <span>
 #include <string_view>
+#include "frontend/emulation_speed.h"
 
-class N64;
+enum class CPUBackend;
+enum class CacheEmulation;
+enum class TaskEmulation;
 
-int main_SDL(std::span<std::string_view> args);
-
-void render_screen(const N64& n64);
-void handle_frontend_events();
+// Emulation runs on a thread of its own, paced by the given speed. The main thread handles events and presents
+// frames from the VI scanout as they come, at the display's refresh rate.
+int main_SDL(std::span<std::string_view> args, CPUBackend cpu_backend, CacheEmulation cache_emulation,
+             TaskEmulation task_emulation, u32 rdp_thread_count, EmulationSpeed speed);
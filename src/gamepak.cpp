@@ -1,23 +1,65 @@
-#include <bit>
 #include <fstream>
+#include <random>
+#include "common/bits.h"
+#include "common/byteswap.h"
 #include "common/logging.h"
 #include "gamepak.h"
 
 static constexpr u32 Z64_IDENTIFIER = 0x80371240;
-static constexpr u32 N64_IDENTIFIER = 0x37804012;
+// Dumps with every halfword byteswapped (v64), or every word (n64, little-endian).
+static constexpr u32 V64_IDENTIFIER = 0x37804012;
+static constexpr u32 N64_IDENTIFIER = 0x40123780;
 
-GamePak::GamePak(const std::filesystem::path& path) {
+// Converted dumps are kept next to the original, as <name>.z64.
+static std::filesystem::path sidecar_path(const std::filesystem::path& path) {
+    std::filesystem::path sidecar = path;
+    sidecar += ".z64";
+    return sidecar;
+}
+
+// A sidecar is only trusted if it is at least as new as the dump it came from, and whole.
+static bool is_sidecar_current(const std::filesystem::path& sidecar, const std::filesystem::path& path, const std::size_t size) {
+    std::error_code error;
+    const auto sidecar_time = std::filesystem::last_write_time(sidecar, error);
+    if (error) {
+        return false;
+    }
+    const auto dump_time = std::filesystem::last_write_time(path, error);
+    return !error && sidecar_time >= dump_time && std::filesystem::file_size(sidecar, error) == size && !error;
+}
+
+// Written to a file of its own first, so that instances converting the same dump at once never see a partial sidecar.
+static bool write_sidecar(const std::filesystem::path& sidecar, const std::span<const u8> rom) {
+    std::filesystem::path temporary = sidecar;
+    temporary += fmt::format(".{:08x}.tmp", std::random_device {}());
+
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream.write(reinterpret_cast<const char*>(rom.data()), rom.size())) {
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, sidecar, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+GamePak::GamePak(const std::filesystem::path& path) : m_path(path) {
     ASSERT_MSG(std::filesystem::is_regular_file(path), "Provided GamePak is not a regular file: '{}'", path);
 
     const std::size_t file_size = std::filesystem::file_size(path);
     ASSERT_MSG(file_size >= 0x40, "fatal: Provided GamePak is not big enough: '{}'", path);
     ASSERT_MSG(file_size <= 0xFBFFFFF, "fatal: Provided GamePak is too big: '{}'", path);
 
-    std::ifstream stream(path, std::ios::binary);
-    ASSERT_MSG(stream.good(), "Could not open provided GamePak: '{}'", path);
-
-    m_rom.resize(file_size);
-    stream.read(reinterpret_cast<char*>(m_rom.data()), m_rom.size());
+    m_rom = Common::MappedFile(path);
+    ASSERT_MSG(m_rom.is_mapped(), "Could not open provided GamePak: '{}'", path);
 }
 
 bool GamePak::swap_bytes_for_endianness() {
@@ -28,18 +70,47 @@ bool GamePak::swap_bytes_for_endianness() {
         return true;
     }
 
-    if (identifier == N64_IDENTIFIER) {
-        LINFO("N64 ROM format, byteswapping...");
+    const char* format;
+    void (*convert)(void* dst, const void* src, std::size_t count);
+    std::size_t word_size;
+    if (identifier == V64_IDENTIFIER) {
+        format = "V64";
+        convert = Common::copy_swapped16;
+        word_size = sizeof(u16);
+    } else if (identifier == N64_IDENTIFIER) {
+        format = "N64";
+        convert = Common::copy_swapped32;
+        word_size = sizeof(u32);
+    } else {
+        LFATAL("Unrecognized ROM format identifier {:08X}", identifier);
+        return false;
+    }
 
-        for (std::size_t i = 0; i < m_rom.size(); i += sizeof(u16)) {
-            u16* word = reinterpret_cast<u16*>(&m_rom.at(i));
-            *word = __builtin_bswap16(*word);
+    const std::filesystem::path sidecar = sidecar_path(m_path);
+    if (is_sidecar_current(sidecar, m_path, m_rom.size())) {
+        Common::MappedFile converted(sidecar);
+        if (converted.is_mapped() && Common::read_big_endian<u32>(converted.data()) == Z64_IDENTIFIER) {
+            m_rom = std::move(converted);
+            LINFO("{} ROM format, using the byteswapped copy at '{}'", format, sidecar.string());
+            return true;
         }
-
-        LINFO("done byteswapping");
-        return true;
     }
 
-    LFATAL("Unrecognized ROM format identifier {:08X}", identifier);
-    return false;
+    LINFO("{} ROM format, byteswapping...", format);
+
+    // The mapping is private, so this only touches this instance's copy.
+    convert(m_rom.data(), m_rom.data(), m_rom.size() / word_size);
+
+    LINFO("done byteswapping");
+
+    // Mapping the sidecar lets go of the private copy, and shares its pages with other instances.
+    if (write_sidecar(sidecar, rom())) {
+        Common::MappedFile converted(sidecar);
+        if (converted.is_mapped() && converted.size() == m_rom.size()) {
+            m_rom = std::move(converted);
+        }
+    } else {
+        LWARN("Could not write a byteswapped copy of the ROM to '{}', it will be byteswapped on every load", sidecar.string());
+    }
+    return true;
 }
@@ -2,35 +2,52 @@
 
 #include <fmt/core.h>
 #include <filesystem>
-#include <vector>
+#include <span>
+#include <stdexcept>
 #include "common/logging.h"
 #include "common/defines.h"
+#include "common/mapped_file.h"
 #include "common/types.h"
 
+// The cartridge ROM, mapped from its file rather than read in, so that loading is instant and instances running the
+// same game share its pages.
 class GamePak {
 public:
     explicit GamePak(const std::filesystem::path& path);
+
+    // Dumps in another byte order than the cartridge's (z64) are converted once into a sidecar file next to them,
+    // which later loads map as it is.
     bool swap_bytes_for_endianness();
 
+    std::span<const u8> rom() const { return { m_rom.data(), m_rom.size() }; }
+
     template <typename T>
     ALWAYS_INLINE T read(u32 address) const {
         if constexpr (Common::TypeIsSame<T, u8>) {
-            return m_rom.at(address);
+            return byte(address);
         } else if constexpr (Common::TypeIsSame<T, u16>) {
             // In 16bit reads from the cartridge, every other halfword is missed
             address = (address + 3) & ~3;
-            return m_rom.at(address + 0) << 8 |
-                   m_rom.at(address + 1) << 0;
+            return byte(address + 0) << 8 |
+                   byte(address + 1) << 0;
         } else if constexpr (Common::TypeIsSame<T, u32>) {
-            return m_rom.at(address + 0) << 24 |
-                   m_rom.at(address + 1) << 16 |
-                   m_rom.at(address + 2) << 8 |
-                   m_rom.at(address + 3) << 0;
+            return byte(address + 0) << 24 |
+                   byte(address + 1) << 16 |
+                   byte(address + 2) << 8 |
+                   byte(address + 3) << 0;
         } else {
             UNIMPLEMENTED_MSG("Unimplemented read{} from gamepak", Common::TypeSizeInBits<T>);
         }
     }
 
 private:
-    std::vector<u8> m_rom {};
+    std::filesystem::path m_path;
+    Common::MappedFile m_rom;
+
+    ALWAYS_INLINE u8 byte(const u32 address) const {
+        if (address >= m_rom.size()) {
+            throw std::out_of_range(fmt::format("Read from 0x{:08X}, past the end of the ROM", address));
+        }
+        return m_rom.data()[address];
+    }
 };
@@ -0,0 +1,700 @@
+#include <algorithm>
+#include <cmath>
+#include "common/logging.h"
+#include "hle/audio_list.h"
+
+namespace HLE {
+
+// Flags shared by the ABI1 commands.
+static constexpr u8 A_INIT = 0x01;
+static constexpr u8 A_LOOP = 0x02;
+static constexpr u8 A_LEFT = 0x02;
+static constexpr u8 A_VOL = 0x04;
+static constexpr u8 A_AUX = 0x08;
+
+// ABI1 buffer addresses are relative to this.
+static constexpr u16 ABI1DmemBase = 0x5C0;
+
+// naudio works on fixed buffers of 184 samples.
+static constexpr u16 NAudioCount = 0x170;
+static constexpr u16 NAudioMain = 0x4F0;
+static constexpr u16 NAudioMain2 = 0x660;
+static constexpr u16 NAudioDryLeft = 0x9D0;
+static constexpr u16 NAudioDryRight = 0xB40;
+static constexpr u16 NAudioWetLeft = 0xCB0;
+static constexpr u16 NAudioWetRight = 0xE20;
+
+static constexpr u16 align(const u32 value, const u32 alignment) {
+    return static_cast<u16>((value + alignment - 1) & ~(alignment - 1));
+}
+
+static constexpr s16 clamp_s16(const s32 value) {
+    return static_cast<s16>(std::clamp<s32>(value, -0x8000, 0x7FFF));
+}
+
+// Four-tap interpolation weights for each 1/64th of a sample, in Q15. This is a cubic approximation of the table in
+// the microcode's data.
+static const std::array<std::array<s16, 4>, 64> ResampleTable = [] {
+    std::array<std::array<s16, 4>, 64> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        const f64 t = i / 64.0;
+        const f64 weights[4] = {
+            (-0.5 * t * t * t + t * t - 0.5 * t),
+            (1.5 * t * t * t - 2.5 * t * t + 1.0),
+            (-1.5 * t * t * t + 2.0 * t * t + 0.5 * t),
+            (0.5 * t * t * t - 0.5 * t * t),
+        };
+        for (u32 tap = 0; tap < 4; tap++) {
+            table[i][tap] = static_cast<s16>(std::lround(std::clamp(weights[tap] * 32768.0, -32768.0, 32767.0)));
+        }
+    }
+    return table;
+}();
+
+void AudioList::run(const ABI abi, const u32 address, const u32 size) {
+    m_segments.fill(0);
+
+    for (u32 offset = 0; offset + 8 <= size; offset += 8) {
+        const u32 w0 = m_memory.read<u32>(address + offset);
+        const u32 w1 = m_memory.read<u32>(address + offset + 4);
+
+        switch (abi) {
+            case ABI::ABI1:
+                execute_abi1(w0, w1);
+                break;
+            case ABI::ABI2:
+                execute_abi2(w0, w1);
+                break;
+            case ABI::NAudio:
+                execute_naudio(w0, w1);
+                break;
+        }
+    }
+}
+
+u32 AudioList::segmented_address(const u32 address) const {
+    return m_segments[(address >> 24) & 0xF] + (address & 0xFFFFFF);
+}
+
+void AudioList::execute_abi1(const u32 w0, const u32 w1) {
+    const u8 flags = static_cast<u8>(w0 >> 16);
+
+    switch (w0 >> 24) {
+        case 0x00: // SPNOOP
+            return;
+
+        case 0x01: // ADPCM
+            adpcm(flags & A_INIT, flags & A_LOOP, false, m_out, m_in, align(m_count, 32), segmented_address(w1));
+            return;
+
+        case 0x02: // CLEARBUFF
+            clear(static_cast<u16>(w0 + ABI1DmemBase), align(static_cast<u16>(w1), 16));
+            return;
+
+        case 0x03: // ENVMIXER
+            envelope_mix({
+                .init = (flags & A_INIT) != 0,
+                .aux = (flags & A_AUX) != 0,
+                .dmem_dry_left = m_out,
+                .dmem_dry_right = m_dry_right,
+                .dmem_wet_left = m_wet_left,
+                .dmem_wet_right = m_wet_right,
+                .dmem_in = m_in,
+                .count = m_count,
+                .address = segmented_address(w1),
+            }, true);
+            return;
+
+        case 0x04: // LOADBUFF
+            m_memory.copy_to_dmem(m_in, segmented_address(w1), align(m_count, 8));
+            return;
+
+        case 0x05: // RESAMPLE
+            resample(flags & A_INIT, m_out, m_in, align(m_count, 16), static_cast<u16>(w0) << 1, segmented_address(w1));
+            return;
+
+        case 0x06: // SAVEBUFF
+            m_memory.copy_to_rdram(segmented_address(w1), m_out, align(m_count, 8));
+            return;
+
+        case 0x07: // SEGMENT
+            m_segments[(w1 >> 24) & 0xF] = w1 & 0xFFFFFF;
+            return;
+
+        case 0x08: // SETBUFF
+            if (flags & A_AUX) {
+                m_dry_right = static_cast<u16>(w0 + ABI1DmemBase);
+                m_wet_left = static_cast<u16>((w1 >> 16) + ABI1DmemBase);
+                m_wet_right = static_cast<u16>(w1 + ABI1DmemBase);
+            } else {
+                m_in = static_cast<u16>(w0 + ABI1DmemBase);
+                m_out = static_cast<u16>((w1 >> 16) + ABI1DmemBase);
+                m_count = static_cast<u16>(w1);
+            }
+            return;
+
+        case 0x09: { // SETVOL
+            if (flags & A_AUX) {
+                m_dry = static_cast<s16>(w0);
+                m_wet = static_cast<s16>(w1);
+                return;
+            }
+
+            const u32 side = (flags & A_LEFT) ? 0 : 1;
+            if (flags & A_VOL) {
+                m_volume[side] = static_cast<s16>(w0);
+            } else {
+                m_target[side] = static_cast<s16>(w0);
+                m_rate[side] = static_cast<s32>(w1);
+            }
+            return;
+        }
+
+        case 0x0A: // DMEMMOVE
+            move(static_cast<u16>((w1 >> 16) + ABI1DmemBase), static_cast<u16>(w0 + ABI1DmemBase), align(static_cast<u16>(w1), 16));
+            return;
+
+        case 0x0B: // LOADADPCM
+            load_adpcm_table(segmented_address(w1), static_cast<u16>(w0));
+            return;
+
+        case 0x0C: // MIXER
+            mix(static_cast<u16>(w1 + ABI1DmemBase), static_cast<u16>((w1 >> 16) + ABI1DmemBase), align(m_count, 32), static_cast<s16>(w0));
+            return;
+
+        case 0x0D: // INTERLEAVE
+            interleave(m_out, static_cast<u16>((w1 >> 16) + ABI1DmemBase), static_cast<u16>(w1 + ABI1DmemBase), m_count);
+            return;
+
+        case 0x0E: // POLEF
+            polef(flags & A_INIT, m_out, m_in, align(m_count, 16), static_cast<u16>(w0), segmented_address(w1));
+            return;
+
+        case 0x0F: // SETLOOP
+            m_loop = segmented_address(w1);
+            return;
+
+        default:
+            LWARN("Unknown ABI1 audio command {:08X} {:08X}", w0, w1);
+            return;
+    }
+}
+
+void AudioList::execute_abi2(const u32 w0, const u32 w1) {
+    const u8 flags = static_cast<u8>(w0 >> 16);
+
+    switch (w0 >> 24) {
+        case 0x00: // SPNOOP
+        case 0x10:
+        case 0x17:
+            return;
+
+        case 0x01: // ADPCM
+            adpcm(flags & 0x1, flags & 0x2, flags & 0x4, m_out, m_in, align(m_count, 32), w1 & 0xFFFFFF);
+            return;
+
+        case 0x02: // CLEARBUFF
+            clear(static_cast<u16>(w0), align(w1 & 0xFFF, 16));
+            return;
+
+        case 0x04: // ADDMIXER
+            add(static_cast<u16>(w1), static_cast<u16>(w1 >> 16), (w0 >> 12) & 0xFF0);
+            return;
+
+        case 0x05: // RESAMPLE
+            resample(flags & 0x1, m_out, m_in, align(m_count, 16), static_cast<u16>(w0) << 1, w1 & 0xFFFFFF);
+            return;
+
+        case 0x08: // SETBUFF
+            m_in = static_cast<u16>(w0);
+            m_out = static_cast<u16>(w1 >> 16);
+            m_count = static_cast<u16>(w1);
+            return;
+
+        case 0x09: // DUPLICATE
+            duplicate(static_cast<u16>(w1 >> 16), static_cast<u16>(w0), flags);
+            return;
+
+        case 0x0A: // DMEMMOVE
+            move(static_cast<u16>(w1 >> 16), static_cast<u16>(w0), align(static_cast<u16>(w1), 16));
+            return;
+
+        case 0x0B: // LOADADPCM
+            load_adpcm_table(w1 & 0xFFFFFF, static_cast<u16>(w0));
+            return;
+
+        case 0x0C: // MIXER
+            mix(static_cast<u16>(w1), static_cast<u16>(w1 >> 16), (w0 >> 12) & 0xFF0, static_cast<s16>(w0));
+            return;
+
+        case 0x0D: // INTERLEAVE
+            interleave(static_cast<u16>(w0), static_cast<u16>(w1 >> 16), static_cast<u16>(w1), (w0 >> 12) & 0xFF0);
+            return;
+
+        case 0x0E: // HILOGAIN
+            multiply_q44(static_cast<u16>(w1 >> 16), static_cast<u16>(w0), static_cast<s8>(flags));
+            return;
+
+        case 0x0F: // SETLOOP
+            m_loop = w1 & 0xFFFFFF;
+            return;
+
+        case 0x11: // INTERL
+            copy_every_other_sample(static_cast<u16>(w1), static_cast<u16>(w1 >> 16), static_cast<u16>(w0));
+            return;
+
+        case 0x12: // ENVSETUP1
+            m_envelope_values[2] = (w0 >> 8) & 0xFF00;
+            m_envelope_steps[2] = static_cast<u16>(w0);
+            m_envelope_steps[0] = static_cast<u16>(w1 >> 16);
+            m_envelope_steps[1] = static_cast<u16>(w1);
+            return;
+
+        case 0x13: // ENVMIXER
+            envelope_mix_abi2(w0, w1);
+            return;
+
+        case 0x14: // LOADBUFF
+            m_memory.copy_to_dmem(w0 & 0xFFF, w1 & 0xFFFFFF, (w0 >> 12) & 0xFFF);
+            return;
+
+        case 0x15: // SAVEBUFF
+            m_memory.copy_to_rdram(w1 & 0xFFFFFF, w0 & 0xFFF, (w0 >> 12) & 0xFFF);
+            return;
+
+        case 0x16: // ENVSETUP2
+            m_envelope_values[0] = static_cast<u16>(w1 >> 16);
+            m_envelope_values[1] = static_cast<u16>(w1);
+            return;
+
+        default:
+            // RESAMPLE_ZOH and FILTER are only used for effects, skipping them merely changes how things sound.
+            LWARN("Unknown ABI2 audio command {:08X} {:08X}", w0, w1);
+            return;
+    }
+}
+
+void AudioList::execute_naudio(const u32 w0, const u32 w1) {
+    const u8 flags = static_cast<u8>(w0 >> 16);
+
+    switch (w0 >> 24) {
+        case 0x00: // SPNOOP
+            return;
+
+        case 0x01: { // ADPCM
+            const u8 adpcm_flags = static_cast<u8>(w1 >> 28);
+            const u16 count = (w1 >> 16) & 0xFFF;
+            const u16 dmem_in = ((w1 >> 12) & 0xF) + NAudioMain;
+            const u16 dmem_out = (w1 & 0xFFF) + NAudioMain;
+            adpcm(adpcm_flags & 0x1, adpcm_flags & 0x2, false, dmem_out, dmem_in, align(count, 32), w0 & 0xFFFFFF);
+            return;
+        }
+
+        case 0x02: // CLEARBUFF
+            clear(static_cast<u16>(w0 + NAudioMain), w1 & 0xFFF);
+            return;
+
+        case 0x03: // ENVMIXER
+            m_volume[1] = static_cast<s16>(w0);
+            envelope_mix({
+                .init = (flags & 0x1) != 0,
+                .aux = true,
+                .dmem_dry_left = NAudioDryLeft,
+                .dmem_dry_right = NAudioDryRight,
+                .dmem_wet_left = NAudioWetLeft,
+                .dmem_wet_right = NAudioWetRight,
+                .dmem_in = NAudioMain,
+                .count = NAudioCount,
+                .address = w1 & 0xFFFFFF,
+            }, false);
+            return;
+
+        case 0x04: // LOADBUFF
+            m_memory.copy_to_dmem((w0 & 0xFFF) + NAudioMain, w1 & 0xFFFFFF, (w0 >> 12) & 0xFFF);
+            return;
+
+        case 0x05: { // RESAMPLE
+            const u16 pitch = static_cast<u16>(w1 >> 14);
+            const u16 dmem_in = ((w1 >> 2) & 0xFFF) + NAudioMain;
+            const u16 dmem_out = (w1 & 0x3) ? NAudioMain2 : NAudioMain;
+            resample((w1 >> 30) & 0x1, dmem_out, dmem_in, NAudioCount, pitch << 1, w0 & 0xFFFFFF);
+            return;
+        }
+
+        case 0x06: // SAVEBUFF
+            m_memory.copy_to_rdram(w1 & 0xFFFFFF, (w0 & 0xFFF) + NAudioMain, (w0 >> 12) & 0xFFF);
+            return;
+
+        case 0x09: // SETVOL
+            if (flags & 0x4) {
+                if (flags & 0x2) {
+                    m_volume[0] = static_cast<s16>(w0);
+                    m_dry = static_cast<s16>(w1 >> 16);
+                    m_wet = static_cast<s16>(w1);
+                } else {
+                    m_target[1] = static_cast<s16>(w0);
+                    m_rate[1] = static_cast<s32>(w1);
+                }
+            } else {
+                m_target[0] = static_cast<s16>(w0);
+                m_rate[0] = static_cast<s32>(w1);
+            }
+            return;
+
+        case 0x0A: // DMEMMOVE
+            move(static_cast<u16>((w1 >> 16) + NAudioMain), static_cast<u16>(w0 + NAudioMain), align(static_cast<u16>(w1), 4));
+            return;
+
+        case 0x0B: // LOADADPCM
+            load_adpcm_table(w1 & 0xFFFFFF, static_cast<u16>(w0));
+            return;
+
+        case 0x0C: // MIXER
+            mix(static_cast<u16>(w1 + NAudioMain), static_cast<u16>((w1 >> 16) + NAudioMain), NAudioCount, static_cast<s16>(w0));
+            return;
+
+        case 0x0D: // INTERLEAVE
+            interleave(NAudioMain, NAudioDryLeft, NAudioDryRight, NAudioCount);
+            return;
+
+        case 0x0E: // Patches the low half of the right volume rate.
+            m_rate[1] = static_cast<s32>((m_rate[1] & ~0xFFFF) | (w1 & 0xFFFF));
+            return;
+
+        case 0x0F: // SETLOOP
+            m_loop = w1 & 0xFFFFFF;
+            return;
+
+        default:
+            LWARN("Unknown naudio command {:08X} {:08X}", w0, w1);
+            return;
+    }
+}
+
+void AudioList::clear(const u16 dmem, const u16 count) {
+    for (u32 i = 0; i < count; i++) {
+        m_memory.write_dmem<u8>(dmem + i, 0);
+    }
+}
+
+void AudioList::move(const u16 dmem_out, const u16 dmem_in, const u16 count) {
+    for (u32 i = 0; i < count; i++) {
+        m_memory.write_dmem<u8>(dmem_out + i, m_memory.read_dmem<u8>(dmem_in + i));
+    }
+}
+
+void AudioList::load_adpcm_table(const u32 address, const u16 count) {
+    const u32 entries = std::min<u32>(align(count, 8) / 2, m_adpcm_table.size());
+    for (u32 i = 0; i < entries; i++) {
+        m_adpcm_table[i] = static_cast<s16>(m_memory.read<u16>(address + i * 2));
+    }
+}
+
+void AudioList::mix(const u16 dmem_out, const u16 dmem_in, const u16 count, const s16 gain) {
+    for (u32 i = 0; i < count; i += 2) {
+        set_sample(dmem_out + i, clamp_s16(sample(dmem_out + i) + ((sample(dmem_in + i) * gain) >> 15)));
+    }
+}
+
+void AudioList::add(const u16 dmem_out, const u16 dmem_in, const u16 count) {
+    for (u32 i = 0; i < count; i += 2) {
+        set_sample(dmem_out + i, clamp_s16(sample(dmem_out + i) + sample(dmem_in + i)));
+    }
+}
+
+void AudioList::multiply_q44(const u16 dmem, const u16 count, const s8 gain) {
+    for (u32 i = 0; i < count; i += 2) {
+        set_sample(dmem + i, clamp_s16((sample(dmem + i) * gain) >> 4));
+    }
+}
+
+void AudioList::interleave(const u16 dmem_out, const u16 dmem_left, const u16 dmem_right, const u16 count) {
+    // Each channel holds count bytes, so the output takes twice that.
+    for (u32 i = 0; i < count; i += 2) {
+        set_sample(dmem_out + i * 2, sample(dmem_left + i));
+        set_sample(dmem_out + i * 2 + 2, sample(dmem_right + i));
+    }
+}
+
+void AudioList::duplicate(const u16 dmem_out, const u16 dmem_in, const u16 count) {
+    for (u32 copy = 0; copy < count; copy++) {
+        move(static_cast<u16>(dmem_out + copy * 0x80), dmem_in, 0x80);
+    }
+}
+
+void AudioList::copy_every_other_sample(const u16 dmem_out, const u16 dmem_in, const u16 count) {
+    for (u32 i = 0; i < count; i++) {
+        set_sample(dmem_out + i * 2, sample(dmem_in + i * 4));
+    }
+}
+
+void AudioList::adpcm(const bool init, const bool loop, const bool two_bit, u16 dmem_out, u16 dmem_in, u16 count,
+                      const u32 address) {
+    // Each 9 byte (5 with two bits per sample) frame decodes to 16 samples, predicted from the two before them.
+    std::array<s16, 16> last_frame {};
+    if (!init) {
+        const u32 state_address = loop ? m_loop : address;
+        for (u32 i = 0; i < last_frame.size(); i++) {
+            last_frame[i] = static_cast<s16>(m_memory.read<u16>(state_address + i * 2));
+        }
+    }
+
+    for (u32 i = 0; i < last_frame.size(); i++, dmem_out += 2) {
+        set_sample(dmem_out, last_frame[i]);
+    }
+
+    while (count >= 32) {
+        const u8 header = m_memory.read_dmem<u8>(dmem_in++);
+        const u32 scale = header >> 4;
+        const s16* codebook = &m_adpcm_table[(header & 0xF) << 4];
+
+        std::array<s16, 16> frame {};
+        if (two_bit) {
+            const u32 right_shift = scale < 14 ? 14 - scale : 0;
+            for (u32 i = 0; i < 16; i += 4) {
+                const u8 byte = m_memory.read_dmem<u8>(dmem_in++);
+                for (u32 j = 0; j < 4; j++) {
+                    frame[i + j] = static_cast<s16>(static_cast<u16>((byte << (j * 2)) & 0xC0) << 8) >> right_shift;
+                }
+            }
+        } else {
+            const u32 right_shift = scale < 12 ? 12 - scale : 0;
+            for (u32 i = 0; i < 16; i += 2) {
+                const u8 byte = m_memory.read_dmem<u8>(dmem_in++);
+                frame[i] = static_cast<s16>(static_cast<u16>(byte & 0xF0) << 8) >> right_shift;
+                frame[i + 1] = static_cast<s16>(static_cast<u16>(byte & 0x0F) << 12) >> right_shift;
+            }
+        }
+
+        // Two halves of eight samples, each predicted from the last two samples before it.
+        for (u32 half = 0; half < 2; half++) {
+            const s16 previous1 = last_frame[half == 0 ? 14 : 6];
+            const s16 previous2 = last_frame[half == 0 ? 15 : 7];
+            const s16* residuals = &frame[half * 8];
+            for (u32 i = 0; i < 8; i++) {
+                s32 accumulator = residuals[i] << 11;
+                accumulator += codebook[i] * previous1 + codebook[8 + i] * previous2;
+                for (u32 j = 0; j < i; j++) {
+                    accumulator += codebook[8 + j] * residuals[i - 1 - j];
+                }
+                last_frame[half * 8 + i] = clamp_s16(accumulator >> 11);
+            }
+        }
+
+        for (u32 i = 0; i < last_frame.size(); i++, dmem_out += 2) {
+            set_sample(dmem_out, last_frame[i]);
+        }
+        count -= 32;
+    }
+
+    for (u32 i = 0; i < last_frame.size(); i++) {
+        m_memory.write<u16>(address + i * 2, static_cast<u16>(last_frame[i]));
+    }
+}
+
+void AudioList::resample(const bool init, u16 dmem_out, const u16 dmem_in, u16 count, const u32 pitch,
+                         const u32 address) {
+    // The four samples before the input are carried over from the previous call.
+    u16 in = dmem_in - 8;
+    u32 pitch_accumulator = 0;
+    for (u32 i = 0; i < 4; i++) {
+        set_sample(in + i * 2, init ? 0 : static_cast<s16>(m_memory.read<u16>(address + i * 2)));
+    }
+    if (!init) {
+        pitch_accumulator = m_memory.read<u16>(address + 8);
+    }
+
+    for (; count >= 2; count -= 2, dmem_out += 2) {
+        const auto& weights = ResampleTable[(pitch_accumulator & 0xFC00) >> 10];
+        s32 accumulator = 0;
+        for (u32 tap = 0; tap < 4; tap++) {
+            accumulator += sample(in + tap * 2) * weights[tap];
+        }
+        set_sample(dmem_out, clamp_s16(accumulator >> 15));
+
+        pitch_accumulator += pitch;
+        in += (pitch_accumulator >> 16) * 2;
+        pitch_accumulator &= 0xFFFF;
+    }
+
+    for (u32 i = 0; i < 4; i++) {
+        m_memory.write<u16>(address + i * 2, static_cast<u16>(sample(in + i * 2)));
+    }
+    m_memory.write<u16>(address + 8, static_cast<u16>(pitch_accumulator));
+}
+
+void AudioList::polef(const bool init, u16 dmem_out, u16 dmem_in, u16 count, const u16 gain, const u32 address) {
+    // A two-pole filter whose coefficients were loaded as an ADPCM codebook.
+    const s16* h1 = &m_adpcm_table[0];
+    std::array<s16, 8> h2 {};
+    std::array<s16, 8> h2_scaled {};
+    for (u32 i = 0; i < 8; i++) {
+        h2[i] = m_adpcm_table[8 + i];
+        h2_scaled[i] = static_cast<s16>((h2[i] * gain) >> 14);
+    }
+
+    s16 previous1 = init ? 0 : static_cast<s16>(m_memory.read<u16>(address + 4));
+    s16 previous2 = init ? 0 : static_cast<s16>(m_memory.read<u16>(address + 6));
+
+    std::array<s16, 8> output {};
+    for (; count >= 16; count -= 16) {
+        std::array<s16, 8> frame {};
+        for (u32 i = 0; i < 8; i++, dmem_in += 2) {
+            frame[i] = sample(dmem_in);
+        }
+
+        for (u32 i = 0; i < 8; i++) {
+            s32 accumulator = frame[i] * gain;
+            accumulator += h1[i] * previous1 + h2[i] * previous2;
+            for (u32 j = 0; j < i; j++) {
+                accumulator += h2_scaled[j] * frame[i - 1 - j];
+            }
+            output[i] = clamp_s16(accumulator >> 14);
+        }
+
+        previous1 = output[6];
+        previous2 = output[7];
+        for (u32 i = 0; i < 8; i++, dmem_out += 2) {
+            set_sample(dmem_out, output[i]);
+        }
+    }
+
+    for (u32 i = 0; i < 4; i++) {
+        m_memory.write<u16>(address + i * 2, static_cast<u16>(output[4 + i]));
+    }
+}
+
+void AudioList::envelope_mix(const EnvelopeMixer& mixer, const bool exponential) {
+    // Both channels' volumes ramp towards their targets in 16.16, eight samples at a time. The ramp's state is kept
+    // in RDRAM between lists.
+    struct Ramp {
+        s32 value;
+        s32 target;
+        s32 step;
+
+        s16 next() {
+            value += step;
+            const bool reached = step <= 0 ? value <= target : value >= target;
+            if (reached) {
+                value = target;
+                step = 0;
+            }
+            return static_cast<s16>(value >> 16);
+        }
+    };
+
+    std::array<Ramp, 2> ramps {};
+    std::array<s32, 2> exponential_rates {};
+    std::array<s32, 2> exponential_values {};
+    s16 dry = m_dry;
+    s16 wet = m_wet;
+
+    if (mixer.init) {
+        for (u32 side = 0; side < 2; side++) {
+            ramps[side].value = m_volume[side] << 16;
+            ramps[side].target = m_target[side] << 16;
+            ramps[side].step = exponential ? 0 : m_rate[side] / 8;
+            exponential_rates[side] = m_rate[side];
+            exponential_values[side] = m_volume[side] * m_rate[side];
+        }
+    } else {
+        const auto load32 = [&](const u32 offset) { return static_cast<s32>(m_memory.read<u32>(mixer.address + offset)); };
+        wet = static_cast<s16>(m_memory.read<u16>(mixer.address + 0));
+        dry = static_cast<s16>(m_memory.read<u16>(mixer.address + 4));
+        for (u32 side = 0; side < 2; side++) {
+            ramps[side].target = load32(8 + side * 4);
+            ramps[side].step = load32(16 + side * 4);
+            exponential_rates[side] = ramps[side].step;
+            exponential_values[side] = load32(24 + side * 4);
+            ramps[side].value = load32(32 + side * 4);
+        }
+    }
+
+    if (exponential) {
+        for (auto& ramp : ramps) {
+            ramp.step = ramp.target - ramp.value;
+        }
+    }
+
+    u16 offset = 0;
+    for (u32 frame = 0; frame < mixer.count; frame += 16) {
+        if (exponential) {
+            for (u32 side = 0; side < 2; side++) {
+                if (ramps[side].step != 0) {
+                    exponential_values[side] = static_cast<s32>((s64(exponential_values[side]) * exponential_rates[side]) >> 16);
+                    ramps[side].step = (exponential_values[side] - ramps[side].value) >> 3;
+                }
+            }
+        }
+
+        for (u32 i = 0; i < 8; i++, offset += 2) {
+            const s16 left = ramps[0].next();
+            const s16 right = ramps[1].next();
+            const s16 in = sample(mixer.dmem_in + offset);
+
+            const auto mix_into = [&](const u16 dmem, const s16 volume, const s16 amount) {
+                const s16 gain = clamp_s16((volume * amount + 0x4000) >> 15);
+                set_sample(dmem + offset, clamp_s16(sample(dmem + offset) + ((in * gain) >> 15)));
+            };
+
+            mix_into(mixer.dmem_dry_left, left, dry);
+            mix_into(mixer.dmem_dry_right, right, dry);
+            if (mixer.aux) {
+                mix_into(mixer.dmem_wet_left, left, wet);
+                mix_into(mixer.dmem_wet_right, right, wet);
+            }
+        }
+    }
+
+    m_memory.write<u16>(mixer.address + 0, static_cast<u16>(wet));
+    m_memory.write<u16>(mixer.address + 4, static_cast<u16>(dry));
+    for (u32 side = 0; side < 2; side++) {
+        m_memory.write<u32>(mixer.address + 8 + side * 4, static_cast<u32>(ramps[side].target));
+        m_memory.write<u32>(mixer.address + 16 + side * 4, static_cast<u32>(exponential ? exponential_rates[side] : ramps[side].step));
+        m_memory.write<u32>(mixer.address + 24 + side * 4, static_cast<u32>(exponential_values[side]));
+        m_memory.write<u32>(mixer.address + 32 + side * 4, static_cast<u32>(ramps[side].value));
+    }
+}
+
+void AudioList::envelope_mix_abi2(const u32 w0, const u32 w1) {
+    const u16 dmem_in = (w0 >> 12) & 0xFF0;
+    const u16 count = align((w0 >> 8) & 0xFF, 8);
+    const bool swap_wet = (w0 >> 4) & 1;
+    const u16 dmem_dry_left = (w1 >> 20) & 0xFF0;
+    const u16 dmem_dry_right = (w1 >> 12) & 0xFF0;
+    u16 dmem_wet_left = (w1 >> 4) & 0xFF0;
+    u16 dmem_wet_right = (w1 << 4) & 0xFF0;
+    if (swap_wet) {
+        std::swap(dmem_wet_left, dmem_wet_right);
+    }
+
+    // Masks for inverting the phase of each output.
+    const s16 xors[4] = {
+        static_cast<s16>(-static_cast<s16>((w0 >> 1) & 1)),
+        static_cast<s16>(-static_cast<s16>(w0 & 1)),
+        static_cast<s16>(-static_cast<s16>((w0 >> 3) & 1)),
+        static_cast<s16>(-static_cast<s16>((w0 >> 2) & 1)),
+    };
+
+    u16 offset = 0;
+    for (u32 frame = 0; frame < count; frame += 8) {
+        for (u32 i = 0; i < 8; i++, offset += 2) {
+            const s32 in = sample(dmem_in + offset);
+            const s16 left = static_cast<s16>(((in * m_envelope_values[0]) >> 16) ^ xors[0]);
+            const s16 right = static_cast<s16>(((in * m_envelope_values[1]) >> 16) ^ xors[1]);
+            const s16 wet_left = static_cast<s16>(((left * m_envelope_values[2]) >> 16) ^ xors[2]);
+            const s16 wet_right = static_cast<s16>(((right * m_envelope_values[2]) >> 16) ^ xors[3]);
+
+            set_sample(dmem_dry_left + offset, clamp_s16(sample(dmem_dry_left + offset) + left));
+            set_sample(dmem_dry_right + offset, clamp_s16(sample(dmem_dry_right + offset) + right));
+            set_sample(dmem_wet_left + offset, clamp_s16(sample(dmem_wet_left + offset) + wet_left));
+            set_sample(dmem_wet_right + offset, clamp_s16(sample(dmem_wet_right + offset) + wet_right));
+        }
+
+        for (u32 i = 0; i < 3; i++) {
+            m_envelope_values[i] += m_envelope_steps[i];
+        }
+    }
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include "common/types.h"
+#include "hle/memory.h"
+
+namespace HLE {
+
+// Runs audio command lists the way the audio microcode would, on samples in DMEM.
+//
+// Three command sets are understood: ABI1 (the original libultra audio microcode), ABI2 (the later "nead" microcode
+// with explicit buffer addresses, as used by the Zelda games) and naudio (Rare's fixed buffer layout).
+class AudioList {
+public:
+    enum class ABI {
+        ABI1,
+        ABI2,
+        NAudio,
+    };
+
+    explicit AudioList(Memory& memory) : m_memory(memory) {}
+
+    void run(ABI abi, u32 address, u32 size);
+
+private:
+    Memory& m_memory;
+
+    // State set up by earlier commands of the same list.
+    std::array<u32, 16> m_segments {};
+    u16 m_in {};
+    u16 m_out {};
+    u16 m_count {};
+    u16 m_dry_right {};
+    u16 m_wet_left {};
+    u16 m_wet_right {};
+    s16 m_dry {};
+    s16 m_wet {};
+    std::array<s16, 2> m_volume {};
+    std::array<s16, 2> m_target {};
+    std::array<s32, 2> m_rate {};
+    u32 m_loop {};
+    // ADPCM codebooks, also used as POLEF coefficients.
+    std::array<s16, 0x100> m_adpcm_table {};
+    // ABI2 envelope: left, right and wet volumes, and their per-frame steps.
+    std::array<u16, 3> m_envelope_values {};
+    std::array<u16, 3> m_envelope_steps {};
+
+    u32 segmented_address(u32 address) const;
+
+    void execute_abi1(u32 w0, u32 w1);
+    void execute_abi2(u32 w0, u32 w1);
+    void execute_naudio(u32 w0, u32 w1);
+
+    s16 sample(u32 dmem_address) const { return static_cast<s16>(m_memory.read_dmem<u16>(dmem_address)); }
+    void set_sample(u32 dmem_address, s16 value) { m_memory.write_dmem<u16>(dmem_address, static_cast<u16>(value)); }
+
+    // Building blocks shared by the ABIs. Counts are in bytes.
+    void clear(u16 dmem, u16 count);
+    void move(u16 dmem_out, u16 dmem_in, u16 count);
+    void load_adpcm_table(u32 address, u16 count);
+    void mix(u16 dmem_out, u16 dmem_in, u16 count, s16 gain);
+    void add(u16 dmem_out, u16 dmem_in, u16 count);
+    void multiply_q44(u16 dmem, u16 count, s8 gain);
+    void interleave(u16 dmem_out, u16 dmem_left, u16 dmem_right, u16 count);
+    void duplicate(u16 dmem_out, u16 dmem_in, u16 count);
+    void copy_every_other_sample(u16 dmem_out, u16 dmem_in, u16 count);
+    void adpcm(bool init, bool loop, bool two_bit, u16 dmem_out, u16 dmem_in, u16 count, u32 address);
+    void resample(bool init, u16 dmem_out, u16 dmem_in, u16 count, u32 pitch, u32 address);
+    void polef(bool init, u16 dmem_out, u16 dmem_in, u16 count, u16 gain, u32 address);
+
+    struct EnvelopeMixer {
+        bool init;
+        bool aux;
+        u16 dmem_dry_left;
+        u16 dmem_dry_right;
+        u16 dmem_wet_left;
+        u16 dmem_wet_right;
+        u16 dmem_in;
+        u16 count;
+        u32 address;
+    };
+    // ABI1 ramps the volume exponentially, naudio linearly.
+    void envelope_mix(const EnvelopeMixer& mixer, bool exponential);
+    void envelope_mix_abi2(u32 w0, u32 w1);
+};
+
+}
@@ -0,0 +1,916 @@
+#include <algorithm>
+#include <cmath>
+#include "common/logging.h"
+#include "hle/display_list.h"
+
+namespace HLE {
+
+// Lists that never end are cut off after this many commands.
+static constexpr u32 MaxCommands = 1 << 22;
+static constexpr u32 MaxDisplayListDepth = 18;
+static constexpr u32 MaxMatrixStackDepth = 32;
+
+// Vertices closer than this are clipped away.
+static constexpr f32 NearW = 1e-5f;
+// The RDP takes 12-bit integer screen coordinates, so polygons are clipped to a band that fits comfortably.
+static constexpr f32 GuardBand = 2000.0f;
+
+using Matrix = std::array<std::array<f32, 4>, 4>;
+
+static Matrix identity_matrix() {
+    Matrix matrix {};
+    for (u32 i = 0; i < 4; i++) {
+        matrix[i][i] = 1.0f;
+    }
+    return matrix;
+}
+
+static Matrix multiply(const Matrix& a, const Matrix& b) {
+    Matrix result {};
+    for (u32 i = 0; i < 4; i++) {
+        for (u32 j = 0; j < 4; j++) {
+            result[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+        }
+    }
+    return result;
+}
+
+static std::array<f32, 3> normalize(const std::array<f32, 3>& vector) {
+    const f32 length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    if (length == 0.0f) {
+        return vector;
+    }
+    return { vector[0] / length, vector[1] / length, vector[2] / length };
+}
+
+static f32 dot(const std::array<f32, 3>& a, const std::array<f32, 3>& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// s15.16, saturated.
+static s32 to_fixed(const f32 value) {
+    return static_cast<s32>(std::clamp<f64>(std::floor(static_cast<f64>(value) * 65536.0), -2147483648.0, 2147483647.0));
+}
+
+void DisplayList::run(const GBI gbi, const u32 address) {
+    m_gbi = gbi;
+    m_rdp_commands.clear();
+
+    m_segments.fill(0);
+    m_return_addresses.clear();
+    m_modelview_stack.clear();
+    m_modelview = identity_matrix();
+    m_projection = identity_matrix();
+    m_combined_dirty = true;
+    m_geometry_mode = 0;
+    m_other_mode_high = 0;
+    m_other_mode_low = 0;
+    m_light_count = 1;
+    m_lights = {};
+    m_lookat = {{ { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } }};
+    m_fog_multiplier = 0;
+    m_fog_offset = 0;
+    m_texture = {};
+
+    m_pc = address;
+    m_ended = false;
+
+    for (u32 executed = 0; !m_ended; executed++) {
+        if (executed == MaxCommands) {
+            LWARN("Display list at {:08X} did not end after {} commands", address, MaxCommands);
+            return;
+        }
+
+        const u32 w0 = m_memory.read<u32>(m_pc);
+        const u32 w1 = m_memory.read<u32>(m_pc + 4);
+        m_pc += 8;
+
+        if (m_gbi == GBI::F3DEX) {
+            execute_f3dex(w0, w1);
+        } else {
+            execute_f3dex2(w0, w1);
+        }
+    }
+}
+
+u32 DisplayList::segmented_address(const u32 address) const {
+    return (m_segments[(address >> 24) & 0xF] + (address & 0xFFFFFF)) & 0xFFFFFF;
+}
+
+Matrix DisplayList::load_matrix(const u32 address) const {
+    // s15.16 elements, with the integer halves of all of them first and the fractions after.
+    Matrix matrix {};
+    for (u32 i = 0; i < 4; i++) {
+        for (u32 j = 0; j < 4; j++) {
+            const u32 offset = (i * 4 + j) * 2;
+            const s32 integer = static_cast<s16>(m_memory.read<u16>(address + offset));
+            const u32 fraction = m_memory.read<u16>(address + 32 + offset);
+            matrix[i][j] = static_cast<f32>((integer << 16) | fraction) / 65536.0f;
+        }
+    }
+    return matrix;
+}
+
+const Matrix& DisplayList::combined_matrix() {
+    if (m_combined_dirty) {
+        m_combined = multiply(m_modelview, m_projection);
+        m_combined_dirty = false;
+    }
+    return m_combined;
+}
+
+void DisplayList::execute_f3dex(const u32 w0, const u32 w1) {
+    const auto vertex_index = [](const u32 value, const u32 shift) { return ((value >> shift) & 0xFF) / 2; };
+
+    switch (w0 >> 24) {
+        case 0x00: // G_SPNOOP
+        case 0xC0: // G_NOOP
+            return;
+
+        case 0x01: { // G_MTX
+            const u32 parameters = (w0 >> 16) & 0xFF;
+            matrix(segmented_address(w1), parameters & 0x01, parameters & 0x02, parameters & 0x04);
+            return;
+        }
+
+        case 0x03: { // G_MOVEMEM
+            const u32 index = (w0 >> 16) & 0xFF;
+            const u32 address = segmented_address(w1);
+            if (index == 0x80) {
+                set_viewport(address);
+            } else if (index == 0x82 || index == 0x84) {
+                m_lookat[index == 0x84 ? 0 : 1] = load_direction(address);
+            } else if (index >= 0x86 && index <= 0x94) {
+                set_light((index - 0x86) / 2, address);
+            }
+            return;
+        }
+
+        case 0x04: // G_VTX
+            load_vertices(segmented_address(w1), vertex_index(w0, 16), (w0 >> 10) & 0x3F);
+            return;
+
+        case 0x06: // G_DL
+            display_list(segmented_address(w1), (w0 >> 16) & 1);
+            return;
+
+        case 0xAF: // G_LOAD_UCODE
+            LWARN("Display list switched microcode, which is not supported");
+            m_ended = true;
+            return;
+
+        case 0xB0: // G_BRANCH_Z
+            branch_z((w0 & 0xFFF) / 2, w1, segmented_address(m_rdp_half_1));
+            return;
+
+        case 0xB1: // G_TRI2
+            triangle(vertex_index(w0, 16), vertex_index(w0, 8), vertex_index(w0, 0));
+            triangle(vertex_index(w1, 16), vertex_index(w1, 8), vertex_index(w1, 0));
+            return;
+
+        case 0xB2: // G_MODIFYVTX
+            modify_vertex((w0 & 0xFFFF) / 2, (w0 >> 16) & 0xFF, w1);
+            return;
+
+        case 0xB3: // G_RDPHALF_2
+            m_rdp_half_2 = w1;
+            return;
+
+        case 0xB4: // G_RDPHALF_1
+            m_rdp_half_1 = w1;
+            return;
+
+        case 0xB5: // G_QUAD
+            triangle(vertex_index(w1, 24), vertex_index(w1, 16), vertex_index(w1, 8));
+            triangle(vertex_index(w1, 24), vertex_index(w1, 8), vertex_index(w1, 0));
+            return;
+
+        case 0xB6: // G_CLEARGEOMETRYMODE
+            m_geometry_mode &= ~w1;
+            return;
+
+        case 0xB7: // G_SETGEOMETRYMODE
+            m_geometry_mode |= w1;
+            return;
+
+        case 0xB8: // G_ENDDL
+            end_display_list();
+            return;
+
+        case 0xB9: // G_SETOTHERMODE_L
+            set_other_mode(false, (w0 >> 8) & 0xFF, w0 & 0xFF, w1);
+            return;
+
+        case 0xBA: // G_SETOTHERMODE_H
+            set_other_mode(true, (w0 >> 8) & 0xFF, w0 & 0xFF, w1);
+            return;
+
+        case 0xBB: // G_TEXTURE
+            m_texture = {
+                .on = (w0 & 0xFF) != 0,
+                .tile = (w0 >> 8) & 0x7,
+                .level = (w0 >> 11) & 0x7,
+                .scale_s = static_cast<f32>(w1 >> 16),
+                .scale_t = static_cast<f32>(w1 & 0xFFFF),
+            };
+            return;
+
+        case 0xBC: // G_MOVEWORD
+            move_word(w0 & 0xFF, (w0 >> 8) & 0xFFFF, w1);
+            return;
+
+        case 0xBD: // G_POPMTX
+            pop_matrix(1);
+            return;
+
+        case 0xBE: // G_CULLDL
+            cull_display_list((w0 & 0xFFFF) / 2, (w1 & 0xFFFF) / 2);
+            return;
+
+        case 0xBF: // G_TRI1
+            triangle(vertex_index(w1, 16), vertex_index(w1, 8), vertex_index(w1, 0));
+            return;
+
+        default:
+            if ((w0 >> 24) >= 0xE4) {
+                execute_rdp(w0, w1);
+                return;
+            }
+            LWARN("Unknown F3DEX command {:08X} {:08X}", w0, w1);
+            return;
+    }
+}
+
+void DisplayList::execute_f3dex2(const u32 w0, const u32 w1) {
+    const auto vertex_index = [](const u32 value, const u32 shift) { return ((value >> shift) & 0xFF) / 2; };
+
+    switch (w0 >> 24) {
+        case 0x00: // G_NOOP
+        case 0xE0: // G_SPNOOP
+            return;
+
+        case 0x01: { // G_VTX
+            const u32 count = (w0 >> 12) & 0xFF;
+            const u32 end = (w0 >> 1) & 0x7F;
+            load_vertices(segmented_address(w1), end - count, count);
+            return;
+        }
+
+        case 0x02: // G_MODIFYVTX
+            modify_vertex((w0 & 0xFFFF) / 2, (w0 >> 16) & 0xFF, w1);
+            return;
+
+        case 0x03: // G_CULLDL
+            cull_display_list((w0 & 0xFFFF) / 2, (w1 & 0xFFFF) / 2);
+            return;
+
+        case 0x04: // G_BRANCH_Z
+            branch_z((w0 & 0xFFF) / 2, w1, segmented_address(m_rdp_half_1));
+            return;
+
+        case 0x05: // G_TRI1
+            triangle(vertex_index(w0, 16), vertex_index(w0, 8), vertex_index(w0, 0));
+            return;
+
+        case 0x06: // G_TRI2
+        case 0x07: // G_QUAD
+            triangle(vertex_index(w0, 16), vertex_index(w0, 8), vertex_index(w0, 0));
+            triangle(vertex_index(w1, 16), vertex_index(w1, 8), vertex_index(w1, 0));
+            return;
+
+        case 0xD7: // G_TEXTURE
+            m_texture = {
+                .on = ((w0 >> 1) & 0x7F) != 0,
+                .tile = (w0 >> 8) & 0x7,
+                .level = (w0 >> 11) & 0x7,
+                .scale_s = static_cast<f32>(w1 >> 16),
+                .scale_t = static_cast<f32>(w1 & 0xFFFF),
+            };
+            return;
+
+        case 0xD8: // G_POPMTX
+            pop_matrix(w1 / 64);
+            return;
+
+        case 0xD9: // G_GEOMETRYMODE
+            m_geometry_mode = (m_geometry_mode & (w0 & 0xFFFFFF)) | w1;
+            return;
+
+        case 0xDA: { // G_MTX, whose push flag is inverted
+            const u32 parameters = (w0 & 0xFF) ^ 0x01;
+            matrix(segmented_address(w1), parameters & 0x04, parameters & 0x02, parameters & 0x01);
+            return;
+        }
+
+        case 0xDB: // G_MOVEWORD
+            move_word((w0 >> 16) & 0xFF, w0 & 0xFFFF, w1);
+            return;
+
+        case 0xDC: { // G_MOVEMEM
+            const u32 index = w0 & 0xFF;
+            const u32 offset = ((w0 >> 8) & 0xFF) * 8;
+            const u32 address = segmented_address(w1);
+            if (index == 8) {
+                set_viewport(address);
+            } else if (index == 10) {
+                // The two look-at directions come first, then the lights.
+                if (offset < 48) {
+                    m_lookat[offset / 24] = load_direction(address);
+                } else {
+                    set_light((offset - 48) / 24, address);
+                }
+            }
+            return;
+        }
+
+        case 0xDD: // G_LOAD_UCODE
+            LWARN("Display list switched microcode, which is not supported");
+            m_ended = true;
+            return;
+
+        case 0xDE: // G_DL
+            display_list(segmented_address(w1), (w0 >> 16) & 1);
+            return;
+
+        case 0xDF: // G_ENDDL
+            end_display_list();
+            return;
+
+        case 0xE1: // G_RDPHALF_1
+            m_rdp_half_1 = w1;
+            return;
+
+        case 0xE2: // G_SETOTHERMODE_L
+        case 0xE3: { // G_SETOTHERMODE_H
+            const u32 length = (w0 & 0xFF) + 1;
+            const u32 shift = 32 - ((w0 >> 8) & 0xFF) - length;
+            set_other_mode((w0 >> 24) == 0xE3, shift, length, w1);
+            return;
+        }
+
+        case 0xF1: // G_RDPHALF_2
+            m_rdp_half_2 = w1;
+            return;
+
+        case 0xD3: // G_SPECIAL_3
+        case 0xD4: // G_SPECIAL_2
+        case 0xD5: // G_SPECIAL_1
+        case 0xD6: // G_DMA_IO
+            return;
+
+        default:
+            if ((w0 >> 24) >= 0xE4) {
+                execute_rdp(w0, w1);
+                return;
+            }
+            LWARN("Unknown F3DEX2 command {:08X} {:08X}", w0, w1);
+            return;
+    }
+}
+
+void DisplayList::execute_rdp(const u32 w0, u32 w1) {
+    switch (w0 >> 24) {
+        case 0xE4: // G_TEXRECT
+        case 0xE5: // G_TEXRECTFLIP
+            texture_rectangle(w0, w1);
+            return;
+
+        case 0xEF: // G_RDPSETOTHERMODE
+            m_other_mode_high = w0 & 0xFFFFFF;
+            m_other_mode_low = w1;
+            break;
+
+        case 0xFD: // G_SETTIMG
+        case 0xFE: // G_SETZIMG
+        case 0xFF: // G_SETCIMG
+            w1 = segmented_address(w1);
+            break;
+    }
+
+    m_rdp_commands.push_back((u64(w0) << 32) | w1);
+}
+
+void DisplayList::display_list(const u32 address, const bool branch) {
+    if (!branch) {
+        if (m_return_addresses.size() == MaxDisplayListDepth) {
+            LWARN("Display list nesting is too deep, skipping the call to {:08X}", address);
+            return;
+        }
+        m_return_addresses.push_back(m_pc);
+    }
+    m_pc = address;
+}
+
+void DisplayList::end_display_list() {
+    if (m_return_addresses.empty()) {
+        m_ended = true;
+        return;
+    }
+    m_pc = m_return_addresses.back();
+    m_return_addresses.pop_back();
+}
+
+void DisplayList::matrix(const u32 address, const bool projection, const bool load, const bool push) {
+    const Matrix matrix = load_matrix(address);
+
+    if (projection) {
+        m_projection = load ? matrix : multiply(matrix, m_projection);
+    } else {
+        if (push && m_modelview_stack.size() < MaxMatrixStackDepth) {
+            m_modelview_stack.push_back(m_modelview);
+        }
+        m_modelview = load ? matrix : multiply(matrix, m_modelview);
+    }
+
+    m_combined_dirty = true;
+}
+
+void DisplayList::pop_matrix(u32 count) {
+    for (; count > 0 && !m_modelview_stack.empty(); count--) {
+        m_modelview = m_modelview_stack.back();
+        m_modelview_stack.pop_back();
+    }
+    m_combined_dirty = true;
+}
+
+void DisplayList::load_vertices(const u32 address, const u32 first, const u32 count) {
+    const Matrix& combined = combined_matrix();
+    const bool lighting = m_geometry_mode & lighting_bit();
+    const bool texture_gen = m_geometry_mode & texture_gen_bit();
+    const bool fog = m_geometry_mode & fog_bit();
+
+    for (u32 i = 0; i < count && first + i < m_vertices.size(); i++) {
+        const u32 vertex_address = address + i * 16;
+        const f32 x = static_cast<s16>(m_memory.read<u16>(vertex_address + 0));
+        const f32 y = static_cast<s16>(m_memory.read<u16>(vertex_address + 2));
+        const f32 z = static_cast<s16>(m_memory.read<u16>(vertex_address + 4));
+        const f32 s = static_cast<s16>(m_memory.read<u16>(vertex_address + 8));
+        const f32 t = static_cast<s16>(m_memory.read<u16>(vertex_address + 10));
+        const std::array<u8, 4> color = {
+            m_memory.read<u8>(vertex_address + 12),
+            m_memory.read<u8>(vertex_address + 13),
+            m_memory.read<u8>(vertex_address + 14),
+            m_memory.read<u8>(vertex_address + 15),
+        };
+
+        Vertex& vertex = m_vertices[first + i];
+        vertex.x = x * combined[0][0] + y * combined[1][0] + z * combined[2][0] + combined[3][0];
+        vertex.y = x * combined[0][1] + y * combined[1][1] + z * combined[2][1] + combined[3][1];
+        vertex.z = x * combined[0][2] + y * combined[1][2] + z * combined[2][2] + combined[3][2];
+        vertex.w = x * combined[0][3] + y * combined[1][3] + z * combined[2][3] + combined[3][3];
+        vertex.r = color[0];
+        vertex.g = color[1];
+        vertex.b = color[2];
+        vertex.a = color[3];
+        vertex.s = s * m_texture.scale_s / 65536.0f;
+        vertex.t = t * m_texture.scale_t / 65536.0f;
+
+        if (lighting) {
+            // With lighting on, the color holds a normal. Lights are given in world space, so bring it there.
+            const std::array<f32, 3> model_normal = {
+                static_cast<f32>(static_cast<s8>(color[0])),
+                static_cast<f32>(static_cast<s8>(color[1])),
+                static_cast<f32>(static_cast<s8>(color[2])),
+            };
+            std::array<f32, 3> normal {};
+            for (u32 axis = 0; axis < 3; axis++) {
+                normal[axis] = model_normal[0] * m_modelview[0][axis] + model_normal[1] * m_modelview[1][axis] +
+                               model_normal[2] * m_modelview[2][axis];
+            }
+            normal = normalize(normal);
+
+            // The light after the directional ones is the ambient light.
+            std::array<f32, 3> lit = m_lights[m_light_count].color;
+            for (u32 light = 0; light < m_light_count; light++) {
+                const f32 intensity = std::max(0.0f, dot(normal, m_lights[light].direction));
+                for (u32 channel = 0; channel < 3; channel++) {
+                    lit[channel] += m_lights[light].color[channel] * intensity;
+                }
+            }
+            vertex.r = std::min(lit[0], 255.0f);
+            vertex.g = std::min(lit[1], 255.0f);
+            vertex.b = std::min(lit[2], 255.0f);
+
+            if (texture_gen) {
+                // Spherical environment mapping, spanning half the texture scale.
+                vertex.s = (dot(normal, m_lookat[0]) * 0.5f + 0.5f) * m_texture.scale_s / 2.0f;
+                vertex.t = (dot(normal, m_lookat[1]) * 0.5f + 0.5f) * m_texture.scale_t / 2.0f;
+            }
+        }
+
+        if (fog && vertex.w > 0.0f) {
+            vertex.a = std::clamp(vertex.z / vertex.w * m_fog_multiplier + m_fog_offset, 0.0f, 255.0f);
+        }
+    }
+}
+
+void DisplayList::modify_vertex(const u32 index, const u32 where, const u32 value) {
+    if (index >= m_vertices.size()) {
+        return;
+    }
+
+    Vertex& vertex = m_vertices[index];
+    switch (where) {
+        case 0x10: // G_MWO_POINT_RGBA
+            vertex.r = static_cast<f32>(value >> 24);
+            vertex.g = static_cast<f32>((value >> 16) & 0xFF);
+            vertex.b = static_cast<f32>((value >> 8) & 0xFF);
+            vertex.a = static_cast<f32>(value & 0xFF);
+            return;
+
+        case 0x14: // G_MWO_POINT_ST
+            vertex.s = static_cast<s16>(value >> 16);
+            vertex.t = static_cast<s16>(value);
+            return;
+
+        case 0x18: { // G_MWO_POINT_XYSCREEN, in quarter pixels. Undo the viewport transform.
+            const f32 screen_x = static_cast<s16>(value >> 16) / 4.0f;
+            const f32 screen_y = static_cast<s16>(value) / 4.0f;
+            if (m_viewport_scale[0] != 0.0f && m_viewport_scale[1] != 0.0f) {
+                vertex.x = (screen_x - m_viewport_translate[0]) / m_viewport_scale[0] * vertex.w;
+                vertex.y = -(screen_y - m_viewport_translate[1]) / m_viewport_scale[1] * vertex.w;
+            }
+            return;
+        }
+
+        case 0x1C: { // G_MWO_POINT_ZSCREEN
+            const f32 screen_z = static_cast<f32>(value >> 16);
+            if (m_viewport_scale[2] != 0.0f) {
+                vertex.z = (screen_z - m_viewport_translate[2]) / m_viewport_scale[2] * vertex.w;
+            }
+            return;
+        }
+    }
+}
+
+void DisplayList::cull_display_list(const u32 first, const u32 last) {
+    // The rest of the list is skipped if every vertex is outside the same side of the view volume.
+    u32 outside = 0b1111;
+    for (u32 index = first; index <= last && index < m_vertices.size(); index++) {
+        const Vertex& vertex = m_vertices[index];
+        u32 sides = 0;
+        sides |= (vertex.x < -vertex.w) << 0;
+        sides |= (vertex.x > vertex.w) << 1;
+        sides |= (vertex.y < -vertex.w) << 2;
+        sides |= (vertex.y > vertex.w) << 3;
+        outside &= sides;
+    }
+
+    if (outside != 0) {
+        end_display_list();
+    }
+}
+
+void DisplayList::branch_z(const u32 index, const u32 z, const u32 address) {
+    if (index >= m_vertices.size()) {
+        return;
+    }
+
+    const Vertex& vertex = m_vertices[index];
+    if (vertex.w <= 0.0f) {
+        return;
+    }
+
+    const f32 screen_z = vertex.z / vertex.w * m_viewport_scale[2] + m_viewport_translate[2];
+    if (screen_z <= static_cast<f32>(static_cast<s32>(z))) {
+        display_list(address, true);
+    }
+}
+
+void DisplayList::move_word(const u32 index, const u32 offset, const u32 value) {
+    switch (index) {
+        case 0x02: // G_MW_NUMLIGHT
+            if (m_gbi == GBI::F3DEX) {
+                m_light_count = std::clamp<s32>(static_cast<s32>((value & 0x7FFFFFFF) / 32) - 1, 0, 7);
+            } else {
+                m_light_count = std::min<u32>(value / 24, 7);
+            }
+            return;
+
+        case 0x06: // G_MW_SEGMENT
+            m_segments[(offset / 4) & 0xF] = value & 0xFFFFFF;
+            return;
+
+        case 0x08: // G_MW_FOG
+            m_fog_multiplier = static_cast<s16>(value >> 16);
+            m_fog_offset = static_cast<s16>(value);
+            return;
+
+        case 0x0A: { // G_MW_LIGHTCOL, where only the first copy of the color is used
+            const u32 stride = m_gbi == GBI::F3DEX ? 32 : 24;
+            if (offset % stride == 0 && offset / stride < m_lights.size()) {
+                auto& color = m_lights[offset / stride].color;
+                color = { static_cast<f32>(value >> 24), static_cast<f32>((value >> 16) & 0xFF), static_cast<f32>((value >> 8) & 0xFF) };
+            }
+            return;
+        }
+
+        default:
+            // Matrix patches, clip ratios and the perspective normalization don't affect the host transform.
+            return;
+    }
+}
+
+void DisplayList::set_viewport(const u32 address) {
+    // Scale, then translation, as four s16 each. X and Y are in quarter pixels.
+    for (u32 axis = 0; axis < 3; axis++) {
+        const f32 divisor = axis < 2 ? 4.0f : 1.0f;
+        m_viewport_scale[axis] = static_cast<s16>(m_memory.read<u16>(address + axis * 2)) / divisor;
+        m_viewport_translate[axis] = static_cast<s16>(m_memory.read<u16>(address + 8 + axis * 2)) / divisor;
+    }
+}
+
+void DisplayList::set_light(const u32 index, const u32 address) {
+    if (index >= m_lights.size()) {
+        return;
+    }
+
+    Light& light = m_lights[index];
+    for (u32 i = 0; i < 3; i++) {
+        light.color[i] = m_memory.read<u8>(address + i);
+    }
+    light.direction = load_direction(address);
+}
+
+std::array<f32, 3> DisplayList::load_direction(const u32 address) const {
+    // Lights and look-at directions keep theirs as s8 after two copies of the color.
+    std::array<f32, 3> direction {};
+    for (u32 i = 0; i < 3; i++) {
+        direction[i] = static_cast<s8>(m_memory.read<u8>(address + 8 + i));
+    }
+    return normalize(direction);
+}
+
+void DisplayList::set_other_mode(const bool high, const u32 shift, const u32 length, const u32 data) {
+    const u32 mask = static_cast<u32>(((u64(1) << length) - 1) << shift);
+    u32& mode = high ? m_other_mode_high : m_other_mode_low;
+    mode = (mode & ~mask) | (data & mask);
+    emit_other_modes();
+}
+
+void DisplayList::emit_other_modes() {
+    m_rdp_commands.push_back((u64(0xEF) << 56) | (u64(m_other_mode_high & 0xFFFFFF) << 32) | m_other_mode_low);
+}
+
+void DisplayList::texture_rectangle(const u32 w0, const u32 w1) {
+    // The texture coordinates and their steps follow in the low words of the next two commands.
+    const u32 coordinates = m_memory.read<u32>(m_pc + 4);
+    const u32 steps = m_memory.read<u32>(m_pc + 12);
+    m_pc += 16;
+
+    m_rdp_commands.push_back((u64(w0) << 32) | w1);
+    m_rdp_commands.push_back((u64(coordinates) << 32) | steps);
+}
+
+void DisplayList::triangle(const u32 v0, const u32 v1, const u32 v2) {
+    if (v0 >= m_vertices.size() || v1 >= m_vertices.size() || v2 >= m_vertices.size()) {
+        return;
+    }
+
+    // Up to one extra vertex per clipping plane.
+    std::array<Vertex, 8> clipped {};
+    std::array<Vertex, 8> input = { m_vertices[v0], m_vertices[v1], m_vertices[v2] };
+    u32 count = 3;
+
+    // Flat shading takes the color of the first vertex.
+    if (!(m_geometry_mode & smooth_shading_bit())) {
+        for (u32 i = 1; i < 3; i++) {
+            input[i].r = input[0].r;
+            input[i].g = input[0].g;
+            input[i].b = input[0].b;
+            input[i].a = input[0].a;
+        }
+    }
+
+    const auto lerp = [](const auto& a, const auto& b, const f32 t) {
+        auto result = a;
+        const f32* from = &a.x;
+        const f32* to = &b.x;
+        f32* out = &result.x;
+        for (u32 i = 0; i < sizeof(a) / sizeof(f32); i++) {
+            out[i] = from[i] + (to[i] - from[i]) * t;
+        }
+        return result;
+    };
+
+    // Clip against the near plane in clip space, where all attributes are linear.
+    u32 clipped_count = 0;
+    for (u32 i = 0; i < count; i++) {
+        const Vertex& a = input[i];
+        const Vertex& b = input[(i + 1) % count];
+        const f32 distance_a = a.w - NearW;
+        const f32 distance_b = b.w - NearW;
+        if (distance_a >= 0.0f) {
+            clipped[clipped_count++] = a;
+        }
+        if ((distance_a >= 0.0f) != (distance_b >= 0.0f)) {
+            clipped[clipped_count++] = lerp(a, b, distance_a / (distance_a - distance_b));
+        }
+    }
+    if (clipped_count < 3) {
+        return;
+    }
+
+    std::array<ScreenVertex, 8> screen {};
+    for (u32 i = 0; i < clipped_count; i++) {
+        const Vertex& vertex = clipped[i];
+        const f32 q = 1.0f / vertex.w;
+        screen[i] = {
+            .x = vertex.x * q * m_viewport_scale[0] + m_viewport_translate[0],
+            .y = -vertex.y * q * m_viewport_scale[1] + m_viewport_translate[1],
+            .z = vertex.z * q * m_viewport_scale[2] + m_viewport_translate[2],
+            .q = q,
+            .sq = vertex.s * q,
+            .tq = vertex.t * q,
+            .r = vertex.r,
+            .g = vertex.g,
+            .b = vertex.b,
+            .a = vertex.a,
+        };
+    }
+
+    // Then against the guard band on screen, where the attributes divided by w are linear.
+    std::array<ScreenVertex, 16> polygon {};
+    std::array<ScreenVertex, 16> next {};
+    std::copy_n(screen.begin(), clipped_count, polygon.begin());
+    count = clipped_count;
+    for (u32 plane = 0; plane < 4 && count >= 3; plane++) {
+        const auto distance = [plane](const ScreenVertex& vertex) {
+            switch (plane) {
+                case 0: return vertex.x + GuardBand;
+                case 1: return GuardBand - vertex.x;
+                case 2: return vertex.y + GuardBand;
+                default: return GuardBand - vertex.y;
+            }
+        };
+
+        u32 next_count = 0;
+        for (u32 i = 0; i < count && next_count + 2 <= next.size(); i++) {
+            const ScreenVertex& a = polygon[i];
+            const ScreenVertex& b = polygon[(i + 1) % count];
+            const f32 distance_a = distance(a);
+            const f32 distance_b = distance(b);
+            if (distance_a >= 0.0f) {
+                next[next_count++] = a;
+            }
+            if ((distance_a >= 0.0f) != (distance_b >= 0.0f)) {
+                next[next_count++] = lerp(a, b, distance_a / (distance_a - distance_b));
+            }
+        }
+        polygon = next;
+        count = next_count;
+    }
+    if (count < 3) {
+        return;
+    }
+
+    // Front faces wind counterclockwise with Y up, which is negative area once Y points down the screen.
+    f32 area = 0.0f;
+    for (u32 i = 0; i < count; i++) {
+        const ScreenVertex& a = polygon[i];
+        const ScreenVertex& b = polygon[(i + 1) % count];
+        area += a.x * b.y - b.x * a.y;
+    }
+    if (area == 0.0f) {
+        return;
+    }
+    if (area > 0.0f && (m_geometry_mode & cull_back_bit())) {
+        return;
+    }
+    if (area < 0.0f && (m_geometry_mode & cull_front_bit())) {
+        return;
+    }
+
+    for (u32 i = 1; i + 1 < count; i++) {
+        emit_triangle(polygon[0], polygon[i], polygon[i + 1]);
+    }
+}
+
+void DisplayList::emit_triangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c) {
+    // Sorted top to bottom: H is the highest vertex, M the middle one and L the lowest. The major edge runs from H to
+    // L, and the two minor edges through M.
+    std::array<const ScreenVertex*, 3> sorted = { &a, &b, &c };
+    std::sort(sorted.begin(), sorted.end(), [](const ScreenVertex* lhs, const ScreenVertex* rhs) { return lhs->y < rhs->y; });
+    const ScreenVertex& high = *sorted[0];
+    const ScreenVertex& middle = *sorted[1];
+    const ScreenVertex& low = *sorted[2];
+
+    // Y is in quarter pixels.
+    const f32 y_high = std::floor(high.y * 4.0f) / 4.0f;
+    const f32 y_middle = std::floor(middle.y * 4.0f) / 4.0f;
+    const f32 y_low = std::floor(low.y * 4.0f) / 4.0f;
+
+    const f32 major_dx = low.x - high.x;
+    const f32 major_dy = y_low - y_high;
+    const f32 middle_dx = middle.x - high.x;
+    const f32 middle_dy = y_middle - y_high;
+    const f32 low_dx = low.x - middle.x;
+    const f32 low_dy = y_low - y_middle;
+
+    const f32 cross = major_dx * middle_dy - major_dy * middle_dx;
+    const bool major_on_left = cross < 0.0f;
+
+    const f32 major_slope = major_dy != 0.0f ? major_dx / major_dy : 0.0f;
+    const f32 middle_slope = middle_dy != 0.0f ? middle_dx / middle_dy : 0.0f;
+    const f32 low_slope = low_dy != 0.0f ? low_dx / low_dy : 0.0f;
+
+    // XH and XM are taken at the scanline containing H, XL at M.
+    const f32 y_offset = std::floor(y_high) - y_high;
+    const f32 x_major = high.x + y_offset * major_slope;
+    const f32 x_middle = high.x + y_offset * middle_slope;
+    const f32 x_low = middle.x;
+
+    const bool shade = m_geometry_mode & shade_bit();
+    const bool texture = m_texture.on;
+    const bool zbuffer = m_geometry_mode & zbuffer_bit();
+    const u32 command = 0x08 | (shade << 2) | (texture << 1) | zbuffer;
+
+    const auto y_fixed = [](const f32 y) { return u64(static_cast<s32>(y * 4.0f) & 0x3FFF); };
+    const auto edge = [](const f32 x, const f32 slope) { return (u64(u32(to_fixed(x))) << 32) | u32(to_fixed(slope)); };
+
+    m_rdp_commands.push_back((u64(command) << 56) | (u64(major_on_left) << 55) | (u64(m_texture.level) << 51) |
+                             (u64(m_texture.tile) << 48) | (y_fixed(y_low) << 32) | (y_fixed(y_middle) << 16) |
+                             y_fixed(y_high));
+    m_rdp_commands.push_back(edge(x_low, low_slope));
+    m_rdp_commands.push_back(edge(x_major, major_slope));
+    m_rdp_commands.push_back(edge(x_middle, middle_slope));
+
+    // Attributes are given at the start of the major edge, with their change along X, along the major edge and
+    // along Y.
+    const f32 attribute_factor = cross != 0.0f ? -1.0f / cross : 0.0f;
+    struct Gradient {
+        s32 start;
+        s32 dx;
+        s32 de;
+        s32 dy;
+    };
+    const auto gradient = [&](const f32 at_high, const f32 at_middle, const f32 at_low) {
+        const f32 middle_delta = at_middle - at_high;
+        const f32 major_delta = at_low - at_high;
+        const f32 dx = (major_dy * middle_delta - middle_dy * major_delta) * attribute_factor;
+        const f32 dy = (middle_dx * major_delta - major_dx * middle_delta) * attribute_factor;
+        const f32 de = dy + dx * major_slope;
+        return Gradient { to_fixed(at_high + y_offset * de), to_fixed(dx), to_fixed(de), to_fixed(dy) };
+    };
+
+    // Four attributes are packed per block: integer halves of the values and X steps, then their fractions, then the
+    // same for the edge and Y steps.
+    const auto emit_block = [&](const std::array<Gradient, 4>& gradients) {
+        const auto pack = [&](auto field, const bool fraction) {
+            u64 word = 0;
+            for (const Gradient& g : gradients) {
+                const u32 value = static_cast<u32>(g.*field);
+                word = (word << 16) | (fraction ? (value & 0xFFFF) : (value >> 16));
+            }
+            return word;
+        };
+        m_rdp_commands.push_back(pack(&Gradient::start, false));
+        m_rdp_commands.push_back(pack(&Gradient::dx, false));
+        m_rdp_commands.push_back(pack(&Gradient::start, true));
+        m_rdp_commands.push_back(pack(&Gradient::dx, true));
+        m_rdp_commands.push_back(pack(&Gradient::de, false));
+        m_rdp_commands.push_back(pack(&Gradient::dy, false));
+        m_rdp_commands.push_back(pack(&Gradient::de, true));
+        m_rdp_commands.push_back(pack(&Gradient::dy, true));
+    };
+
+    if (shade) {
+        emit_block({
+            gradient(high.r, middle.r, low.r),
+            gradient(high.g, middle.g, low.g),
+            gradient(high.b, middle.b, low.b),
+            gradient(high.a, middle.a, low.a),
+        });
+    }
+
+    if (texture) {
+        // With perspective correction, S and T are divided by W, which is normalized so its largest value is 1.0
+        // (0x7FFF). Otherwise S and T are used as they are.
+        const bool perspective = (m_other_mode_high >> 19) & 1;
+        const auto texture_values = [&](const ScreenVertex& vertex, const f32 q_max) {
+            if (perspective) {
+                return std::array<f32, 3> { vertex.sq / q_max, vertex.tq / q_max, vertex.q / q_max * 32767.0f };
+            }
+            return std::array<f32, 3> { vertex.sq / vertex.q, vertex.tq / vertex.q, 0.0f };
+        };
+        const f32 q_max = std::max({ high.q, middle.q, low.q });
+        const auto h = texture_values(high, q_max);
+        const auto m = texture_values(middle, q_max);
+        const auto l = texture_values(low, q_max);
+        emit_block({
+            gradient(h[0], m[0], l[0]),
+            gradient(h[1], m[1], l[1]),
+            gradient(h[2], m[2], l[2]),
+            Gradient {},
+        });
+    }
+
+    if (zbuffer) {
+        // Screen Z runs from 0 to 0x3FF, the RDP's from 0 to 0x7FFF.
+        const Gradient z = gradient(high.z * 32.0f, middle.z * 32.0f, low.z * 32.0f);
+        m_rdp_commands.push_back((u64(u32(z.start)) << 32) | u32(z.dx));
+        m_rdp_commands.push_back((u64(u32(z.de)) << 32) | u32(z.dy));
+    }
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "common/types.h"
+#include "hle/memory.h"
+
+namespace HLE {
+
+// Walks F3DEX and F3DEX2 display lists, transforming, lighting and clipping vertices on the host, and produces the
+// RDP command list the microcode would have sent.
+//
+// Accuracy is traded for speed where the two diverge: vertices are transformed in floating point, and polygons are
+// clipped against the near plane and a screen-space guard band only.
+class DisplayList {
+public:
+    enum class GBI {
+        F3DEX,
+        F3DEX2,
+    };
+
+    explicit DisplayList(Memory& memory) : m_memory(memory) {}
+
+    void run(GBI gbi, u32 address);
+
+    const std::vector<u64>& rdp_commands() const { return m_rdp_commands; }
+
+private:
+    Memory& m_memory;
+    GBI m_gbi {};
+
+    std::vector<u64> m_rdp_commands {};
+
+    using Matrix = std::array<std::array<f32, 4>, 4>;
+
+    struct Vertex {
+        // Clip space.
+        f32 x, y, z, w;
+        // Texture coordinates in 10.5 texels.
+        f32 s, t;
+        f32 r, g, b, a;
+    };
+
+    struct Light {
+        std::array<f32, 3> color;
+        std::array<f32, 3> direction;
+    };
+
+    std::array<u32, 16> m_segments {};
+    std::vector<u32> m_return_addresses {};
+    u32 m_pc {};
+    bool m_ended {};
+
+    std::vector<Matrix> m_modelview_stack {};
+    Matrix m_modelview {};
+    Matrix m_projection {};
+    Matrix m_combined {};
+    bool m_combined_dirty {};
+
+    std::array<Vertex, 64> m_vertices {};
+
+    // Viewport scale and translation, in pixels.
+    std::array<f32, 3> m_viewport_scale {};
+    std::array<f32, 3> m_viewport_translate {};
+
+    u32 m_geometry_mode {};
+    u32 m_other_mode_high {};
+    u32 m_other_mode_low {};
+
+    std::array<Light, 8> m_lights {};
+    u32 m_light_count {};
+    std::array<std::array<f32, 3>, 2> m_lookat {};
+    s16 m_fog_multiplier {};
+    s16 m_fog_offset {};
+
+    struct Texture {
+        bool on;
+        u32 tile;
+        u32 level;
+        f32 scale_s;
+        f32 scale_t;
+    } m_texture {};
+
+    u32 m_rdp_half_1 {};
+    u32 m_rdp_half_2 {};
+
+    u32 segmented_address(u32 address) const;
+    Matrix load_matrix(u32 address) const;
+    const Matrix& combined_matrix();
+
+    void execute_f3dex(u32 w0, u32 w1);
+    void execute_f3dex2(u32 w0, u32 w1);
+    void execute_rdp(u32 w0, u32 w1);
+
+    // Geometry mode bits, which moved around between the two GBIs.
+    u32 zbuffer_bit() const { return 0x00000001; }
+    u32 shade_bit() const { return 0x00000004; }
+    u32 cull_front_bit() const { return m_gbi == GBI::F3DEX ? 0x00001000 : 0x00000200; }
+    u32 cull_back_bit() const { return m_gbi == GBI::F3DEX ? 0x00002000 : 0x00000400; }
+    u32 fog_bit() const { return 0x00010000; }
+    u32 lighting_bit() const { return 0x00020000; }
+    u32 texture_gen_bit() const { return 0x00040000; }
+    u32 smooth_shading_bit() const { return m_gbi == GBI::F3DEX ? 0x00000200 : 0x00200000; }
+
+    void display_list(u32 address, bool branch);
+    void end_display_list();
+    void matrix(u32 address, bool projection, bool load, bool push);
+    void pop_matrix(u32 count);
+    void load_vertices(u32 address, u32 first, u32 count);
+    void modify_vertex(u32 index, u32 where, u32 value);
+    void cull_display_list(u32 first, u32 last);
+    void branch_z(u32 index, u32 z, u32 address);
+    void move_word(u32 index, u32 offset, u32 value);
+    void set_viewport(u32 address);
+    void set_light(u32 index, u32 address);
+    std::array<f32, 3> load_direction(u32 address) const;
+    void set_other_mode(bool high, u32 shift, u32 length, u32 data);
+    void emit_other_modes();
+    void texture_rectangle(u32 w0, u32 w1);
+
+    void triangle(u32 v0, u32 v1, u32 v2);
+
+    struct ScreenVertex {
+        f32 x, y, z;
+        // 1/w, and the texture coordinates divided by w, which interpolate linearly on screen.
+        f32 q, sq, tq;
+        f32 r, g, b, a;
+    };
+    void emit_triangle(const ScreenVertex& v1, const ScreenVertex& v2, const ScreenVertex& v3);
+};
+
+}
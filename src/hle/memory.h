@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include "common/bits.h"
+#include "common/types.h"
+#include "vr4300.h"
+
+namespace HLE {
+
+// RDRAM and DMEM as seen by a task.
+//
+// Tasks often leave segment or KSEG bits in their addresses, so RDRAM addresses are masked to 24 bits. Whatever is
+// past the end of RDRAM reads as zero and ignores writes. Writes to RDRAM go through VR4300::invalidate_code(), like
+// any other DMA. Nothing here waits for the RDP, which TaskRunner::run() syncs before a task starts.
+class Memory {
+public:
+    Memory(std::array<u8, 0x400000>& rdram, std::array<u8, 0x1000>& dmem, VR4300& vr4300)
+        : m_rdram(rdram), m_dmem(dmem), m_vr4300(vr4300) {}
+
+    template <typename T>
+    T read(u32 address) const {
+        address &= 0xFFFFFF;
+        if (address + sizeof(T) > m_rdram.size()) {
+            return 0;
+        }
+        return Common::read_big_endian<T>(&m_rdram[address]);
+    }
+
+    template <typename T>
+    void write(u32 address, const T value) {
+        address &= 0xFFFFFF;
+        if (address + sizeof(T) > m_rdram.size()) {
+            return;
+        }
+        m_vr4300.invalidate_code(address);
+        Common::write_big_endian<T>(&m_rdram[address], value);
+    }
+
+    // DMEM accesses are naturally aligned and wrap around.
+    template <typename T>
+    T read_dmem(const u32 address) const {
+        return Common::read_big_endian<T>(&m_dmem[address & (0x1000 - sizeof(T))]);
+    }
+
+    template <typename T>
+    void write_dmem(const u32 address, const T value) {
+        Common::write_big_endian<T>(&m_dmem[address & (0x1000 - sizeof(T))], value);
+    }
+
+    void copy_to_dmem(const u32 dmem_address, const u32 address, const u32 length) {
+        for (u32 i = 0; i < length; i++) {
+            write_dmem<u8>(dmem_address + i, read<u8>(address + i));
+        }
+    }
+
+    void copy_to_rdram(const u32 address, const u32 dmem_address, const u32 length) {
+        for (u32 i = 0; i < length; i++) {
+            write<u8>(address + i, read_dmem<u8>(dmem_address + i));
+        }
+    }
+
+private:
+    std::array<u8, 0x400000>& m_rdram;
+    std::array<u8, 0x1000>& m_dmem;
+    VR4300& m_vr4300;
+};
+
+}
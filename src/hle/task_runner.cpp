@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include "common/logging.h"
+#include "hle/task_runner.h"
+#include "n64.h"
+
+namespace HLE {
+
+static constexpr u32 TaskAddress = 0xFC0;
+static constexpr u32 TaskTypeGfx = 1;
+static constexpr u32 TaskTypeAudio = 2;
+
+// Only the start of the microcode is hashed, which is plenty to tell versions apart.
+static constexpr u32 MaxHashedTextSize = 0x1000;
+static constexpr u32 MaxHashedDataSize = 0x800;
+
+TaskRunner::TaskRunner(N64& system)
+    : m_system(system), m_memory(system.mmu().rdram(), system.mmu().sp_dmem(), system.vr4300()) {}
+
+bool TaskRunner::run() {
+    const Task task = read_task();
+    if (task.type != TaskTypeGfx && task.type != TaskTypeAudio) {
+        return false;
+    }
+
+    // Tasks access RDRAM directly, with none of the waits of a DMA, so nothing the RDP is still drawing may be left.
+    m_system.rdp().sync();
+
+    const u64 hash = hash_microcode(task);
+    auto it = m_microcodes.find(hash);
+    if (it == m_microcodes.end()) {
+        const Microcode microcode = identify(task);
+        if (microcode == Microcode::Unknown) {
+            LWARN("Unrecognized {} microcode {:016X}, running it on the RSP", task.type == TaskTypeGfx ? "graphics" : "audio", hash);
+        }
+        it = m_microcodes.emplace(hash, microcode).first;
+    }
+
+    switch (it->second) {
+        case Microcode::Unknown:
+            return false;
+
+        case Microcode::AudioABI1:
+            m_audio_list.run(AudioList::ABI::ABI1, task.data_ptr, task.data_size);
+            return true;
+
+        case Microcode::AudioABI2:
+            m_audio_list.run(AudioList::ABI::ABI2, task.data_ptr, task.data_size);
+            return true;
+
+        case Microcode::AudioNAudio:
+            m_audio_list.run(AudioList::ABI::NAudio, task.data_ptr, task.data_size);
+            return true;
+
+        case Microcode::GfxF3DEX:
+        case Microcode::GfxF3DEX2: {
+            const auto gbi = it->second == Microcode::GfxF3DEX ? DisplayList::GBI::F3DEX : DisplayList::GBI::F3DEX2;
+            m_display_list.run(gbi, task.data_ptr);
+            m_system.rdp().run_commands(m_display_list.rdp_commands());
+            return true;
+        }
+    }
+
+    UNREACHABLE_MSG("Invalid microcode {}", static_cast<u32>(it->second));
+}
+
+TaskRunner::Task TaskRunner::read_task() const {
+    const auto field = [this](const u32 index) { return m_memory.read_dmem<u32>(TaskAddress + index * 4); };
+    return {
+        .type = field(0),
+        .flags = field(1),
+        .ucode_boot = field(2),
+        .ucode_boot_size = field(3),
+        .ucode = field(4),
+        .ucode_size = field(5),
+        .ucode_data = field(6),
+        .ucode_data_size = field(7),
+        .dram_stack = field(8),
+        .dram_stack_size = field(9),
+        .output_buff = field(10),
+        .output_buff_size = field(11),
+        .data_ptr = field(12),
+        .data_size = field(13),
+        .yield_data_ptr = field(14),
+        .yield_data_size = field(15),
+    };
+}
+
+u64 TaskRunner::hash_microcode(const Task& task) const {
+    // FNV-1a.
+    u64 hash = 0xCBF29CE484222325;
+    const auto hash_range = [&](const u32 address, const u32 size) {
+        for (u32 i = 0; i < size; i++) {
+            hash = (hash ^ m_memory.read<u8>(address + i)) * 0x100000001B3;
+        }
+    };
+
+    hash_range(task.ucode, std::min(task.ucode_size != 0 ? task.ucode_size : MaxHashedTextSize, MaxHashedTextSize));
+    hash_range(task.ucode_data, std::min(task.ucode_data_size, MaxHashedDataSize));
+    return hash;
+}
+
+TaskRunner::Microcode TaskRunner::identify(const Task& task) const {
+    return task.type == TaskTypeAudio ? identify_audio(task) : identify_gfx(task);
+}
+
+TaskRunner::Microcode TaskRunner::identify_audio(const Task& task) const {
+    // The first words of the data hold the command jump table, whose entries differ between versions.
+    const auto data_word = [&](const u32 offset) { return m_memory.read<u32>(task.ucode_data + offset); };
+
+    if (data_word(0) == 0x00000001) {
+        if (data_word(0x30) == 0xF0000F00) {
+            switch (data_word(0x28)) {
+                case 0x1E24138C: // Most games
+                case 0x1DC8138C: // Goldeneye 007
+                case 0x1E3C1390: // Blast Corps, Diddy Kong Racing
+                    return Microcode::AudioABI1;
+            }
+            return Microcode::Unknown;
+        }
+
+        // nead microcodes of the Zelda family. Others (Mario Kart 64, Star Fox 64, F-Zero X, Wave Race) rearranged
+        // their commands and run on the RSP.
+        switch (data_word(0x10)) {
+            case 0x1F08122C: // Ocarina of Time
+            case 0x1F38122C: // Ocarina of Time (GameCube)
+            case 0x1F681230: // Majora's Mask (Japan)
+            case 0x1F801250: // Majora's Mask
+            case 0x109411F8: // Pokemon Stadium
+            case 0x1EAC11B8: // Animal Forest
+                return Microcode::AudioABI2;
+        }
+        return Microcode::Unknown;
+    }
+
+    switch (data_word(0x10)) {
+        case 0x0000127C: // Banjo-Kazooie, Conker's Bad Fur Day (naudio)
+        case 0x00001280: // Banjo-Tooie, Jet Force Gemini, Perfect Dark
+            return Microcode::AudioNAudio;
+    }
+    return Microcode::Unknown;
+}
+
+TaskRunner::Microcode TaskRunner::identify_gfx(const Task& task) const {
+    // Graphics microcodes carry a version string such as "RSP Gfx ucode F3DEX       fifo 2.08  Yoshitaka Yasumoto".
+    static constexpr std::string_view Prefix = "RSP Gfx ucode ";
+
+    const u32 size = std::min(task.ucode_data_size != 0 ? task.ucode_data_size : 0x800u, 0x1000u);
+    std::string data;
+    data.reserve(size);
+    for (u32 i = 0; i < size; i++) {
+        data.push_back(static_cast<char>(m_memory.read<u8>(task.ucode_data + i)));
+    }
+
+    const auto prefix = data.find(Prefix);
+    if (prefix == std::string::npos) {
+        return Microcode::Unknown;
+    }
+
+    const std::string_view name = std::string_view(data).substr(prefix + Prefix.size());
+    if (!name.starts_with("F3DEX") && !name.starts_with("F3DZEX") && !name.starts_with("F3DLX")) {
+        return Microcode::Unknown;
+    }
+
+    // The version number decides the GBI: 0.x and 1.x are F3DEX, 2.x is F3DEX2.
+    const auto version = name.find_first_of("0123456789", name.find(' '));
+    if (version == std::string_view::npos) {
+        return Microcode::Unknown;
+    }
+    LINFO("Running {} on the host", name.substr(0, name.find_first_of(std::string_view("\n\0", 2))));
+    switch (name[version]) {
+        case '0':
+        case '1':
+            return Microcode::GfxF3DEX;
+        case '2':
+            return Microcode::GfxF3DEX2;
+    }
+    return Microcode::Unknown;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <unordered_map>
+#include "common/types.h"
+#include "hle/audio_list.h"
+#include "hle/display_list.h"
+#include "hle/memory.h"
+
+class N64;
+
+namespace HLE {
+
+// Runs the task described by the OSTask structure at the end of DMEM natively, if its microcode is one we know.
+//
+// Microcodes are told apart by their text and data, hashed once and remembered, so games that start the same
+// microcode every frame only pay for the hash.
+class TaskRunner {
+public:
+    explicit TaskRunner(N64& system);
+
+    // Returns false if the task has to run on the RSP instead.
+    bool run();
+
+private:
+    enum class Microcode {
+        Unknown,
+        AudioABI1,
+        AudioABI2,
+        AudioNAudio,
+        GfxF3DEX,
+        GfxF3DEX2,
+    };
+
+    struct Task {
+        u32 type;
+        u32 flags;
+        u32 ucode_boot;
+        u32 ucode_boot_size;
+        u32 ucode;
+        u32 ucode_size;
+        u32 ucode_data;
+        u32 ucode_data_size;
+        u32 dram_stack;
+        u32 dram_stack_size;
+        u32 output_buff;
+        u32 output_buff_size;
+        u32 data_ptr;
+        u32 data_size;
+        u32 yield_data_ptr;
+        u32 yield_data_size;
+    };
+
+    N64& m_system;
+    Memory m_memory;
+    AudioList m_audio_list { m_memory };
+    DisplayList m_display_list { m_memory };
+    std::unordered_map<u64, Microcode> m_microcodes;
+
+    Task read_task() const;
+    u64 hash_microcode(const Task& task) const;
+    Microcode identify(const Task& task) const;
+    Microcode identify_audio(const Task& task) const;
+    Microcode identify_gfx(const Task& task) const;
+};
+
+}
@@ -0,0 +1,37 @@
+#include <cstring>
+#include <sys/mman.h>
+#include "common/logging.h"
+#include "jit/code_buffer.h"
+
+namespace JIT {
+
+// Keeps every block entry point on its own cache line.
+static constexpr std::size_t CodeAlignment = 64;
+
+CodeBuffer::CodeBuffer(const std::size_t size) : m_size(size) {
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        LFATAL("Failed to allocate {} bytes of executable memory for the JIT", size);
+        std::terminate();
+    }
+
+    m_memory = static_cast<u8*>(memory);
+}
+
+CodeBuffer::~CodeBuffer() {
+    munmap(m_memory, m_size);
+}
+
+const void* CodeBuffer::add(const std::span<const u8> code) {
+    const std::size_t offset = (m_used + CodeAlignment - 1) & ~(CodeAlignment - 1);
+    if (offset + code.size() > m_size) {
+        return nullptr;
+    }
+
+    std::memcpy(m_memory + offset, code.data(), code.size());
+    m_used = offset + code.size();
+
+    return m_memory + offset;
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include "common/types.h"
+
+namespace JIT {
+
+// A fixed-size region of executable memory, handed out linearly. Space is only reclaimed by clearing everything.
+class CodeBuffer {
+public:
+    explicit CodeBuffer(std::size_t size);
+    ~CodeBuffer();
+
+    CodeBuffer(const CodeBuffer&) = delete;
+    CodeBuffer& operator=(const CodeBuffer&) = delete;
+
+    // Copies the code into the buffer and returns its executable address, or nullptr if the buffer is full.
+    const void* add(std::span<const u8> code);
+    void clear() { m_used = 0; }
+
+    std::size_t free_space() const { return m_size - m_used; }
+
+private:
+    u8* m_memory { nullptr };
+    std::size_t m_size {};
+    std::size_t m_used {};
+};
+
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#ifdef __linux__
+#include <csignal>
+#include <sys/mman.h>
+#include <ucontext.h>
+#endif
+#include "common/logging.h"
+#include "jit/fastmem.h"
+
+namespace JIT {
+
+static constexpr std::size_t ArenaSize = std::size_t(1) << 32;
+
+#ifdef __linux__
+static std::vector<FastmemArena*> s_arenas {};
+static struct sigaction s_previous_action {};
+
+static void handle_segfault(const int signal, siginfo_t* info, void* raw_context) {
+    auto* context = static_cast<ucontext_t*>(raw_context);
+    const void* instruction = reinterpret_cast<const void*>(context->uc_mcontext.gregs[REG_RIP]);
+
+    for (FastmemArena* arena : s_arenas) {
+        if (const void* slow_path = arena->handle_fault(instruction, info->si_addr)) {
+            context->uc_mcontext.gregs[REG_RIP] = reinterpret_cast<greg_t>(slow_path);
+            return;
+        }
+    }
+
+    // Not ours. Pass it on to whoever had the signal before, leaving this handler in place for the faults after it.
+    if (s_previous_action.sa_flags & SA_SIGINFO) {
+        s_previous_action.sa_sigaction(signal, info, raw_context);
+    } else if (s_previous_action.sa_handler != SIG_DFL && s_previous_action.sa_handler != SIG_IGN) {
+        s_previous_action.sa_handler(signal);
+    } else {
+        // The default action kills the process once the access is retried. An ignored fault would be retried forever,
+        // so it gets the default action too.
+        struct sigaction default_action {};
+        default_action.sa_handler = SIG_DFL;
+        sigemptyset(&default_action.sa_mask);
+        sigaction(signal, &default_action, nullptr);
+    }
+}
+
+static bool install_fault_handler() {
+    static bool installed = false;
+    if (installed) {
+        return true;
+    }
+
+    struct sigaction action {};
+    action.sa_sigaction = handle_segfault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    installed = sigaction(SIGSEGV, &action, &s_previous_action) == 0;
+    return installed;
+}
+#endif
+
+std::unique_ptr<FastmemArena> FastmemArena::create() {
+#ifdef __linux__
+    if (!install_fault_handler()) {
+        LWARN("Failed to install the fastmem fault handler");
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, ArenaSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        LWARN("Failed to reserve {} bytes for fastmem", ArenaSize);
+        return nullptr;
+    }
+
+    return std::unique_ptr<FastmemArena>(new FastmemArena(static_cast<u8*>(base)));
+#else
+    return nullptr;
+#endif
+}
+
+FastmemArena::FastmemArena(u8* base) : m_base(base) {
+#ifdef __linux__
+    s_arenas.push_back(this);
+#endif
+}
+
+FastmemArena::~FastmemArena() {
+#ifdef __linux__
+    std::erase(s_arenas, this);
+    munmap(m_base, ArenaSize);
+#endif
+}
+
+void FastmemArena::add_fault_handler(const void* instruction, u8* patch_point, const void* slow_path) {
+    m_fault_handlers[instruction] = { patch_point, slow_path };
+}
+
+const void* FastmemArena::handle_fault(const void* instruction, const void* fault_address) {
+    const u8* address = static_cast<const u8*>(fault_address);
+    if (address < m_base || address >= m_base + ArenaSize) {
+        return nullptr;
+    }
+
+    const auto it = m_fault_handlers.find(instruction);
+    if (it == m_fault_handlers.end()) {
+        return nullptr;
+    }
+
+    // jmp rel32
+    const FaultHandler& handler = it->second;
+    const s32 displacement = static_cast<s32>(static_cast<const u8*>(handler.slow_path) - (handler.patch_point + 5));
+    handler.patch_point[0] = 0xE9;
+    std::memcpy(handler.patch_point + 1, &displacement, sizeof(displacement));
+
+    return handler.slow_path;
+}
+
+}
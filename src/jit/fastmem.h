@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include "common/types.h"
+
+namespace JIT {
+
+// A 4 GiB host reservation mirroring the VR4300's 32-bit address space, so that recompiled code can access memory
+// without any checks. Only KSEG0/KSEG1 RDRAM and SP memory get mapped into it (see MMU::map_fastmem()). Accesses to
+// anything else fault, and the fault handler resumes at the slow path registered for the faulting instruction. As a
+// site that faulted once is likely to keep doing so, the handler also patches it to always take the slow path.
+class FastmemArena {
+public:
+    // Returns nullptr if the host does not support it.
+    static std::unique_ptr<FastmemArena> create();
+    ~FastmemArena();
+
+    FastmemArena(const FastmemArena&) = delete;
+    FastmemArena& operator=(const FastmemArena&) = delete;
+
+    u8* base() const { return m_base; }
+
+    // The patch point must be followed by at least 5 bytes of straight-line code leading up to the instruction.
+    void add_fault_handler(const void* instruction, u8* patch_point, const void* slow_path);
+    void clear_fault_handlers() { m_fault_handlers.clear(); }
+    // Returns nullptr if the fault was not caused by a registered instruction accessing the arena.
+    const void* handle_fault(const void* instruction, const void* fault_address);
+
+private:
+    explicit FastmemArena(u8* base);
+
+    struct FaultHandler {
+        u8* patch_point;
+        const void* slow_path;
+    };
+
+    u8* m_base { nullptr };
+    std::unordered_map<const void*, FaultHandler> m_fault_handlers {};
+};
+
+}
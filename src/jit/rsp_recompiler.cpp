@@ -0,0 +1,689 @@
+#include <cstring>
+#include "common/bits.h"
+#include "common/logging.h"
+#include "jit/rsp_recompiler.h"
+#include "n64.h"
+
+namespace JIT {
+
+// Recompiled code keeps the RSP pinned in a callee-saved register.
+static constexpr Reg State = Reg::R15;
+// Holds the branch condition or jump target while the delay slot runs.
+static constexpr Reg BranchState = Reg::R14;
+
+static constexpr std::size_t CodeBufferSize = 16 * 1024 * 1024;
+static constexpr u32 MaxBlockInstructions = 256;
+// Well above the code emitted for the longest possible block, so compiling never runs out of space.
+static constexpr std::size_t MaxBlockCodeSize = 256 * 1024;
+
+static u64 hash_imem(const std::array<u8, 0x1000>& imem) {
+    // FNV-1a, a word at a time.
+    u64 hash = 0xCBF29CE484222325;
+    for (std::size_t i = 0; i < imem.size(); i += sizeof(u64)) {
+        u64 word;
+        std::memcpy(&word, &imem[i], sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3;
+    }
+    return hash;
+}
+
+static bool is_branch(const u32 instruction) {
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000: {
+            const auto op = Common::bit_range<5, 0>(instruction);
+            return op == 0b001000 || op == 0b001001;
+        }
+        case 0b000001: {
+            const auto op = Common::bit_range<20, 16>(instruction);
+            return op == 0b00000 || op == 0b00001 || op == 0b10000 || op == 0b10001;
+        }
+        case 0b000010:
+        case 0b000011:
+        case 0b000100:
+        case 0b000101:
+        case 0b000110:
+        case 0b000111:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_break(const u32 instruction) {
+    return Common::bit_range<31, 26>(instruction) == 0b000000 && Common::bit_range<5, 0>(instruction) == 0b001101;
+}
+
+RSPRecompiler::RSPRecompiler(RSP& rsp) : m_rsp(rsp), m_code_buffer(CodeBufferSize) {
+    m_inline_vector_instructions = __builtin_cpu_supports("sse4.1");
+
+    const auto offset_of = [&rsp](const auto& member) {
+        return static_cast<s32>(reinterpret_cast<const u8*>(&member) - reinterpret_cast<const u8*>(&rsp));
+    };
+
+    const RSPVectorUnit& vu = rsp.m_vector_unit;
+    m_gprs_offset = offset_of(rsp.m_gprs);
+    m_pc_offset = offset_of(rsp.m_pc);
+    m_next_pc_offset = offset_of(rsp.m_next_pc);
+    m_vprs_offset = offset_of(vu.m_vprs);
+    m_accumulator_high_offset = offset_of(vu.m_accumulator_high);
+    m_accumulator_mid_offset = offset_of(vu.m_accumulator_mid);
+    m_accumulator_low_offset = offset_of(vu.m_accumulator_low);
+}
+
+void RSPRecompiler::load_program() {
+    const auto& imem = m_rsp.m_system.mmu().sp_imem();
+
+    std::unique_ptr<Program>& program = m_programs[hash_imem(imem)];
+    if (!program || program->imem != imem) {
+        program = std::make_unique<Program>();
+        program->imem = imem;
+    }
+
+    m_program = program.get();
+}
+
+void RSPRecompiler::clear() {
+    m_code_buffer.clear();
+    for (auto& [hash, program] : m_programs) {
+        program->blocks.fill(nullptr);
+        program->interpreted.reset();
+    }
+}
+
+RSPRecompiler::BlockFunction RSPRecompiler::block_at(const u16 pc) {
+    if (!m_program) {
+        load_program();
+    }
+
+    const u16 index = pc / 4;
+    if (m_program->blocks[index] || m_program->interpreted[index]) [[likely]] {
+        return m_program->blocks[index];
+    }
+
+    if (m_code_buffer.free_space() < MaxBlockCodeSize) {
+        clear();
+    }
+
+    m_program->blocks[index] = compile(pc);
+    m_program->interpreted[index] = !m_program->blocks[index];
+    return m_program->blocks[index];
+}
+
+u32 RSPRecompiler::instruction_at(const u16 pc) const {
+    return Common::read_big_endian<u32>(&m_program->imem[pc & 0xFFF]);
+}
+
+void RSPRecompiler::execute_instruction(RSP* rsp, const u32 instruction, const u32 pc) {
+    rsp->m_gprs[0] = 0;
+    rsp->m_pc = static_cast<u16>(pc);
+    rsp->m_next_pc = (pc + 4) & 0xFFF;
+    rsp->execute_instruction(instruction);
+}
+
+RSPRecompiler::BlockFunction RSPRecompiler::compile(const u16 pc) {
+    m_emitter = {};
+    emit_prologue();
+
+    u32 count = 0;
+    u16 address = pc;
+    while (true) {
+        const u32 instruction = instruction_at(address);
+
+        if (is_branch(instruction)) {
+            // Branches in delay slots, and breaks ending them, are left to the interpreter.
+            const u32 delay_slot = instruction_at(address + 4);
+            if (is_branch(delay_slot) || is_break(delay_slot)) {
+                if (count == 0) {
+                    return nullptr;
+                }
+
+                m_emitter.mov(Reg::RAX, address);
+                emit_set_pc();
+                emit_exit(count);
+                break;
+            }
+
+            compile_branch(instruction, address);
+            emit_exit(count + 2);
+            break;
+        }
+
+        compile_instruction(instruction, address);
+        count++;
+        address = (address + 4) & 0xFFF;
+
+        if (is_break(instruction) || count == MaxBlockInstructions || address == 0) {
+            m_emitter.mov(Reg::RAX, address);
+            emit_set_pc();
+            emit_exit(count);
+            break;
+        }
+    }
+
+    m_emitter.finalize();
+
+    const void* code = m_code_buffer.add(m_emitter.code());
+    ASSERT_MSG(code, "Out of RSP JIT code space");
+    return reinterpret_cast<BlockFunction>(const_cast<void*>(code));
+}
+
+Mem RSPRecompiler::gpr(const u32 guest) const {
+    return rsp_field(m_gprs_offset + static_cast<s32>(guest * 4));
+}
+
+Mem RSPRecompiler::vpr(const u32 guest) const {
+    return rsp_field(m_vprs_offset + static_cast<s32>(guest * 16));
+}
+
+Mem RSPRecompiler::rsp_field(const s32 offset) const {
+    return { .base = State, .disp = offset };
+}
+
+void RSPRecompiler::load_gpr(const Reg dst, const u32 guest) {
+    // The interpreter only clears r0 before each instruction, so it may hold garbage in memory.
+    if (guest == 0) {
+        m_emitter.alu32(AluOp::Xor, dst, dst);
+    } else {
+        m_emitter.mov32(dst, gpr(guest));
+    }
+}
+
+void RSPRecompiler::store_gpr(const u32 guest, const Reg src) {
+    if (guest != 0) {
+        m_emitter.mov32(gpr(guest), src);
+    }
+}
+
+void RSPRecompiler::emit_prologue() {
+    m_emitter.push(State);
+    m_emitter.push(BranchState);
+    // Keeps the stack 16-byte aligned for calls.
+    m_emitter.alu(AluOp::Sub, Reg::RSP, 8);
+
+    m_emitter.mov(State, Reg::RDI);
+}
+
+void RSPRecompiler::emit_exit(const u32 instruction_count) {
+    m_emitter.mov(Reg::RAX, instruction_count);
+    m_emitter.alu(AluOp::Add, Reg::RSP, 8);
+    m_emitter.pop(BranchState);
+    m_emitter.pop(State);
+    m_emitter.ret();
+}
+
+void RSPRecompiler::emit_set_pc() {
+    m_emitter.mov16(rsp_field(m_pc_offset), Reg::RAX);
+    m_emitter.alu32(AluOp::Add, Reg::RAX, 4);
+    m_emitter.alu32(AluOp::And, Reg::RAX, 0xFFF);
+    m_emitter.mov16(rsp_field(m_next_pc_offset), Reg::RAX);
+}
+
+void RSPRecompiler::emit_call_interpreter(const u32 instruction, const u16 pc) {
+    m_emitter.mov(Reg::RDI, State);
+    m_emitter.mov(Reg::RSI, instruction);
+    m_emitter.mov(Reg::RDX, pc);
+    m_emitter.mov(Reg::RAX, reinterpret_cast<u64>(&execute_instruction));
+    m_emitter.call(Reg::RAX);
+}
+
+void RSPRecompiler::compile_instruction(const u32 instruction, const u16 pc) {
+    const bool inline_ = Common::bit_range<31, 26>(instruction) == 0b010010 ? compile_vector(instruction) : compile_scalar(instruction);
+    if (!inline_) {
+        emit_call_interpreter(instruction, pc);
+    }
+}
+
+bool RSPRecompiler::compile_scalar(const u32 instruction) {
+    const u32 rs = m_rsp.get_rs(instruction);
+    const u32 rt = m_rsp.get_rt(instruction);
+    const u32 rd = m_rsp.get_rd(instruction);
+    const u8 sa = Common::bit_range<10, 6>(instruction);
+    const u16 imm = Common::bit_range<15, 0>(instruction);
+
+    const auto op = Common::bit_range<31, 26>(instruction);
+    if (op == 0b000000) {
+        const auto special_op = Common::bit_range<5, 0>(instruction);
+
+        const auto shift = [&](const ShiftOp shift_op) {
+            load_gpr(Reg::RAX, rt);
+            m_emitter.shift32(shift_op, Reg::RAX, sa);
+            store_gpr(rd, Reg::RAX);
+        };
+        const auto variable_shift = [&](const ShiftOp shift_op) {
+            load_gpr(Reg::RCX, rs);
+            load_gpr(Reg::RAX, rt);
+            m_emitter.shift32_cl(shift_op, Reg::RAX);
+            store_gpr(rd, Reg::RAX);
+        };
+        const auto alu = [&](const AluOp alu_op) {
+            load_gpr(Reg::RAX, rs);
+            load_gpr(Reg::RCX, rt);
+            m_emitter.alu32(alu_op, Reg::RAX, Reg::RCX);
+            store_gpr(rd, Reg::RAX);
+        };
+
+        switch (special_op) {
+            case 0b000000:
+                shift(ShiftOp::Shl);
+                return true;
+            case 0b000010:
+                shift(ShiftOp::Shr);
+                return true;
+            case 0b000011:
+                shift(ShiftOp::Sar);
+                return true;
+            case 0b000100:
+                variable_shift(ShiftOp::Shl);
+                return true;
+            case 0b000110:
+                variable_shift(ShiftOp::Shr);
+                return true;
+            case 0b000111:
+                variable_shift(ShiftOp::Sar);
+                return true;
+            case 0b100000:
+            case 0b100001:
+                alu(AluOp::Add);
+                return true;
+            case 0b100010:
+            case 0b100011:
+                alu(AluOp::Sub);
+                return true;
+            case 0b100100:
+                alu(AluOp::And);
+                return true;
+            case 0b100101:
+                alu(AluOp::Or);
+                return true;
+            case 0b100110:
+                alu(AluOp::Xor);
+                return true;
+            case 0b100111:
+                load_gpr(Reg::RAX, rs);
+                load_gpr(Reg::RCX, rt);
+                m_emitter.alu32(AluOp::Or, Reg::RAX, Reg::RCX);
+                m_emitter.not_(Reg::RAX);
+                store_gpr(rd, Reg::RAX);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    const auto alu_immediate = [&](const AluOp alu_op, const s32 value) {
+        load_gpr(Reg::RAX, rs);
+        m_emitter.alu32(alu_op, Reg::RAX, value);
+        store_gpr(rt, Reg::RAX);
+    };
+
+    switch (op) {
+        case 0b001000:
+        case 0b001001:
+            alu_immediate(AluOp::Add, static_cast<s16>(imm));
+            return true;
+        case 0b001100:
+            alu_immediate(AluOp::And, imm);
+            return true;
+        case 0b001101:
+            alu_immediate(AluOp::Or, imm);
+            return true;
+        case 0b001110:
+            alu_immediate(AluOp::Xor, imm);
+            return true;
+        case 0b001111:
+            m_emitter.mov(Reg::RAX, u32(imm) << 16);
+            store_gpr(rt, Reg::RAX);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void RSPRecompiler::compile_branch(const u32 instruction, const u16 pc) {
+    const u32 rs = m_rsp.get_rs(instruction);
+    const u32 rt = m_rsp.get_rt(instruction);
+    const u16 link = (pc + 8) & 0xFFF;
+    const u16 branch_target = (pc + 4 + (Common::bit_range<15, 0>(instruction) << 2)) & 0xFFF;
+    const u16 jump_target = (Common::bit_range<25, 0>(instruction) << 2) & 0xFFF;
+
+    // Everything the branch depends on is evaluated before the delay slot can change it.
+    const auto condition = [&](const Condition taken) {
+        load_gpr(Reg::RAX, rs);
+        if (taken == Condition::Equal || taken == Condition::NotEqual) {
+            load_gpr(Reg::RCX, rt);
+            m_emitter.alu32(AluOp::Cmp, Reg::RAX, Reg::RCX);
+        } else {
+            m_emitter.alu32(AluOp::Cmp, Reg::RAX, 0);
+        }
+        m_emitter.setcc(taken, BranchState);
+        m_emitter.movzx8(BranchState, BranchState);
+    };
+    const auto write_link = [&](const u32 guest) {
+        m_emitter.mov(Reg::RAX, link);
+        store_gpr(guest, Reg::RAX);
+    };
+
+    enum class Kind { Conditional, Jump, Register } kind = Kind::Conditional;
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000:
+            kind = Kind::Register;
+            load_gpr(BranchState, rs);
+            m_emitter.alu32(AluOp::And, BranchState, 0xFFC);
+            // JALR
+            if (Common::bit_range<5, 0>(instruction) == 0b001001) {
+                write_link(m_rsp.get_rd(instruction));
+            }
+            break;
+        case 0b000001:
+            condition(Common::is_bit_enabled<16>(instruction) ? Condition::GreaterOrEqual : Condition::Less);
+            // BLTZAL, BGEZAL
+            if (Common::is_bit_enabled<20>(instruction)) {
+                write_link(31);
+            }
+            break;
+        case 0b000010:
+            kind = Kind::Jump;
+            break;
+        case 0b000011:
+            kind = Kind::Jump;
+            write_link(31);
+            break;
+        case 0b000100:
+            condition(Condition::Equal);
+            break;
+        case 0b000101:
+            condition(Condition::NotEqual);
+            break;
+        case 0b000110:
+            condition(Condition::LessOrEqual);
+            break;
+        case 0b000111:
+            condition(Condition::Greater);
+            break;
+        default:
+            UNREACHABLE();
+    }
+
+    compile_instruction(instruction_at(pc + 4), (pc + 4) & 0xFFF);
+
+    switch (kind) {
+        case Kind::Conditional:
+            m_emitter.mov(Reg::RAX, link);
+            m_emitter.mov(Reg::RCX, branch_target);
+            m_emitter.test(BranchState, BranchState);
+            m_emitter.cmov(Condition::NotEqual, Reg::RAX, Reg::RCX);
+            break;
+        case Kind::Jump:
+            m_emitter.mov(Reg::RAX, jump_target);
+            break;
+        case Kind::Register:
+            m_emitter.mov32(Reg::RAX, BranchState);
+            break;
+    }
+    emit_set_pc();
+}
+
+bool RSPRecompiler::compile_vector(const u32 instruction) {
+    if (!m_inline_vector_instructions || !Common::is_bit_enabled<25>(instruction)) {
+        return false;
+    }
+
+    const auto op = Common::bit_range<5, 0>(instruction);
+    switch (op) {
+        // VMULF, VMULU, VMUDL, VMUDM, VMUDN, VMUDH, and their accumulating versions
+        case 0x00:
+        case 0x01:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+        case 0x08:
+        case 0x09:
+        case 0x0C:
+        case 0x0D:
+        case 0x0E:
+        case 0x0F:
+            compile_multiply(instruction);
+            return true;
+        // VAND, VNAND, VOR, VNOR, VXOR, VNXOR
+        case 0x28:
+        case 0x29:
+        case 0x2A:
+        case 0x2B:
+        case 0x2C:
+        case 0x2D:
+            compile_logical(instruction);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void RSPRecompiler::emit_load_vt(const Xmm dst, const u32 instruction) {
+    m_emitter.movdqu(dst, vpr(RSPVectorUnit::get_vt(instruction)));
+
+    const u32 element = RSPVectorUnit::get_element(instruction);
+    if (element >= 2) {
+        m_emitter.mov(Reg::RAX, reinterpret_cast<u64>(RSPVectorUnit::m_element_shuffles[element].data()));
+        m_emitter.movdqu(Xmm::XMM15, Mem { .base = Reg::RAX });
+        m_emitter.sse(SseOp::Pshufb, dst, Xmm::XMM15);
+    }
+}
+
+// Same as add_48() in the vector unit. Needs the 0x8000 constant in XMM9 and zero in XMM10, and clobbers XMM11-XMM15.
+void RSPRecompiler::emit_add_48(const Xmm high, const Xmm mid, const Xmm low, const Xmm add_high, const Xmm add_mid, const Xmm add_low) {
+    constexpr Xmm sign = Xmm::XMM9;
+    constexpr Xmm zero = Xmm::XMM10;
+    constexpr Xmm sum_low = Xmm::XMM11;
+    constexpr Xmm carry_low = Xmm::XMM12;
+    constexpr Xmm sum_mid = Xmm::XMM13;
+    constexpr Xmm carry_mid = Xmm::XMM14;
+    constexpr Xmm temp = Xmm::XMM15;
+
+    m_emitter.movdqa(sum_low, low);
+    m_emitter.sse(SseOp::Paddw, sum_low, add_low);
+
+    // Unsigned comparisons, through the signed one with both sides flipped.
+    m_emitter.movdqa(carry_low, low);
+    m_emitter.sse(SseOp::Pxor, carry_low, sign);
+    m_emitter.movdqa(temp, sum_low);
+    m_emitter.sse(SseOp::Pxor, temp, sign);
+    m_emitter.sse(SseOp::Pcmpgtw, carry_low, temp);
+
+    m_emitter.movdqa(sum_mid, mid);
+    m_emitter.sse(SseOp::Paddw, sum_mid, add_mid);
+    m_emitter.movdqa(carry_mid, mid);
+    m_emitter.sse(SseOp::Pxor, carry_mid, sign);
+    m_emitter.movdqa(temp, sum_mid);
+    m_emitter.sse(SseOp::Pxor, temp, sign);
+    m_emitter.sse(SseOp::Pcmpgtw, carry_mid, temp);
+
+    m_emitter.sse(SseOp::Psubw, sum_mid, carry_low);
+    m_emitter.movdqa(temp, sum_mid);
+    m_emitter.sse(SseOp::Pcmpeqw, temp, zero);
+    m_emitter.sse(SseOp::Pand, temp, carry_low);
+    m_emitter.sse(SseOp::Por, carry_mid, temp);
+
+    m_emitter.sse(SseOp::Paddw, high, add_high);
+    m_emitter.sse(SseOp::Psubw, high, carry_mid);
+    m_emitter.movdqa(mid, sum_mid);
+    m_emitter.movdqa(low, sum_low);
+}
+
+void RSPRecompiler::compile_multiply(const u32 instruction) {
+    using Product = RSPVectorUnit::Product;
+    using Clamp = RSPVectorUnit::Clamp;
+
+    const u32 op = Common::bit_range<5, 0>(instruction);
+    const bool accumulate = Common::is_bit_enabled<3>(op);
+    Product product;
+    Clamp clamp = Clamp::SignedMid;
+    switch (op & 7) {
+        case 0:
+            product = Product::Fraction;
+            break;
+        case 1:
+            product = Product::Fraction;
+            clamp = Clamp::UnsignedMid;
+            break;
+        case 4:
+            product = Product::Low;
+            clamp = Clamp::UnsignedLow;
+            break;
+        case 5:
+            product = Product::Mid;
+            break;
+        case 6:
+            product = Product::MidN;
+            clamp = Clamp::UnsignedLow;
+            break;
+        case 7:
+            product = Product::High;
+            break;
+        default:
+            UNREACHABLE();
+    }
+
+    constexpr Xmm s = Xmm::XMM1;
+    constexpr Xmm t = Xmm::XMM2;
+    constexpr Xmm product_high = Xmm::XMM3;
+    constexpr Xmm product_mid = Xmm::XMM4;
+    constexpr Xmm product_low = Xmm::XMM5;
+    constexpr Xmm high = Xmm::XMM6;
+    constexpr Xmm mid = Xmm::XMM7;
+    constexpr Xmm low = Xmm::XMM8;
+    constexpr Xmm sign = Xmm::XMM9;
+    constexpr Xmm zero = Xmm::XMM10;
+    constexpr Xmm temp = Xmm::XMM11;
+
+    m_emitter.movdqu(s, vpr(RSPVectorUnit::get_vs(instruction)));
+    emit_load_vt(t, instruction);
+    m_emitter.sse(SseOp::Pxor, zero, zero);
+    m_emitter.sse(SseOp::Pcmpeqw, sign, sign);
+    m_emitter.sse_shift(SseShiftOp::Psllw, sign, 15);
+
+    switch (product) {
+        case Product::Fraction:
+            m_emitter.movdqa(product_low, s);
+            m_emitter.sse(SseOp::Pmullw, product_low, t);
+            m_emitter.movdqa(product_high, s);
+            m_emitter.sse(SseOp::Pmulhw, product_high, t);
+            m_emitter.movdqa(product_mid, product_high);
+            m_emitter.sse_shift(SseShiftOp::Psllw, product_mid, 1);
+            m_emitter.movdqa(temp, product_low);
+            m_emitter.sse_shift(SseShiftOp::Psrlw, temp, 15);
+            m_emitter.sse(SseOp::Por, product_mid, temp);
+            m_emitter.sse_shift(SseShiftOp::Psllw, product_low, 1);
+            m_emitter.sse_shift(SseShiftOp::Psraw, product_high, 15);
+            break;
+        case Product::Low:
+            m_emitter.movdqa(product_low, s);
+            m_emitter.sse(SseOp::Pmulhuw, product_low, t);
+            m_emitter.movdqa(product_mid, zero);
+            m_emitter.movdqa(product_high, zero);
+            break;
+        case Product::Mid:
+        case Product::MidN:
+            m_emitter.movdqa(product_low, s);
+            m_emitter.sse(SseOp::Pmullw, product_low, t);
+            m_emitter.movdqa(product_mid, s);
+            m_emitter.sse(SseOp::Pmulhuw, product_mid, t);
+            // Corrects the unsigned high half for a negative signed operand.
+            m_emitter.movdqa(temp, product == Product::Mid ? s : t);
+            m_emitter.sse_shift(SseShiftOp::Psraw, temp, 15);
+            m_emitter.sse(SseOp::Pand, temp, product == Product::Mid ? t : s);
+            m_emitter.sse(SseOp::Psubw, product_mid, temp);
+            m_emitter.movdqa(product_high, product_mid);
+            m_emitter.sse_shift(SseShiftOp::Psraw, product_high, 15);
+            break;
+        case Product::High:
+            m_emitter.movdqa(product_mid, s);
+            m_emitter.sse(SseOp::Pmullw, product_mid, t);
+            m_emitter.movdqa(product_high, s);
+            m_emitter.sse(SseOp::Pmulhw, product_high, t);
+            m_emitter.movdqa(product_low, zero);
+            break;
+    }
+
+    if (accumulate) {
+        m_emitter.movdqu(high, rsp_field(m_accumulator_high_offset));
+        m_emitter.movdqu(mid, rsp_field(m_accumulator_mid_offset));
+        m_emitter.movdqu(low, rsp_field(m_accumulator_low_offset));
+        emit_add_48(high, mid, low, product_high, product_mid, product_low);
+    } else {
+        m_emitter.movdqa(high, product_high);
+        m_emitter.movdqa(mid, product_mid);
+        m_emitter.movdqa(low, product_low);
+        // VMULF and VMULU round.
+        if (product == Product::Fraction) {
+            emit_add_48(high, mid, low, zero, zero, sign);
+        }
+    }
+
+    m_emitter.movdqu(rsp_field(m_accumulator_high_offset), high);
+    m_emitter.movdqu(rsp_field(m_accumulator_mid_offset), mid);
+    m_emitter.movdqu(rsp_field(m_accumulator_low_offset), low);
+
+    constexpr Xmm result = Xmm::XMM1;
+    constexpr Xmm other = Xmm::XMM2;
+    switch (clamp) {
+        case Clamp::SignedMid:
+        case Clamp::UnsignedMid:
+            m_emitter.movdqa(result, mid);
+            m_emitter.sse(SseOp::Punpcklwd, result, high);
+            m_emitter.movdqa(other, mid);
+            m_emitter.sse(SseOp::Punpckhwd, other, high);
+            if (clamp == Clamp::SignedMid) {
+                m_emitter.sse(SseOp::Packssdw, result, other);
+            } else {
+                m_emitter.sse(SseOp::Packusdw, result, other);
+                m_emitter.movdqa(other, result);
+                m_emitter.sse_shift(SseShiftOp::Psraw, other, 15);
+                m_emitter.sse(SseOp::Por, result, other);
+            }
+            break;
+        case Clamp::UnsignedLow:
+            m_emitter.movdqa(Xmm::XMM0, mid);
+            m_emitter.sse_shift(SseShiftOp::Psraw, Xmm::XMM0, 15);
+            m_emitter.sse(SseOp::Pcmpeqw, Xmm::XMM0, high);
+            m_emitter.movdqa(result, high);
+            m_emitter.sse_shift(SseShiftOp::Psraw, result, 15);
+            m_emitter.sse(SseOp::Pcmpeqw, other, other);
+            m_emitter.sse(SseOp::Pxor, result, other);
+            m_emitter.sse(SseOp::Pblendvb, result, low);
+            break;
+    }
+
+    m_emitter.movdqu(vpr(RSPVectorUnit::get_vd(instruction)), result);
+}
+
+void RSPRecompiler::compile_logical(const u32 instruction) {
+    const u32 op = Common::bit_range<5, 0>(instruction);
+
+    m_emitter.movdqu(Xmm::XMM1, vpr(RSPVectorUnit::get_vs(instruction)));
+    emit_load_vt(Xmm::XMM2, instruction);
+
+    // The ops come in pairs, the second one inverting the result.
+    switch (op & ~1) {
+        case 0x28:
+            m_emitter.sse(SseOp::Pand, Xmm::XMM1, Xmm::XMM2);
+            break;
+        case 0x2A:
+            m_emitter.sse(SseOp::Por, Xmm::XMM1, Xmm::XMM2);
+            break;
+        case 0x2C:
+            m_emitter.sse(SseOp::Pxor, Xmm::XMM1, Xmm::XMM2);
+            break;
+        default:
+            UNREACHABLE();
+    }
+    if (op & 1) {
+        m_emitter.sse(SseOp::Pcmpeqw, Xmm::XMM2, Xmm::XMM2);
+        m_emitter.sse(SseOp::Pxor, Xmm::XMM1, Xmm::XMM2);
+    }
+
+    m_emitter.movdqu(rsp_field(m_accumulator_low_offset), Xmm::XMM1);
+    m_emitter.movdqu(vpr(RSPVectorUnit::get_vd(instruction)), Xmm::XMM1);
+}
+
+}
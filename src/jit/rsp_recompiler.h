@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <unordered_map>
+#include "common/types.h"
+#include "jit/code_buffer.h"
+#include "jit/x64_emitter.h"
+#include "rsp.h"
+
+namespace JIT {
+
+// Translates RSP microcode into x86-64 code (System V ABI).
+//
+// Microcode only changes between tasks, so compiled blocks are kept per IMEM image: whenever the RSP is started, IMEM
+// is hashed and the blocks compiled for an identical image are picked up again. Scalar instructions, branches and the
+// multiply and logical vector instructions are emitted inline, the rest is handed to the interpreter.
+class RSPRecompiler {
+public:
+    // Returns the number of instructions executed.
+    using BlockFunction = u32 (*)(RSP* rsp);
+
+    explicit RSPRecompiler(RSP& rsp);
+
+    RSPRecompiler(const RSPRecompiler&) = delete;
+    RSPRecompiler& operator=(const RSPRecompiler&) = delete;
+
+    // Selects the blocks compiled for the current contents of IMEM.
+    void load_program();
+    // Returns the block starting at the PC, compiling it first if needed, or nullptr if it has to be interpreted.
+    BlockFunction block_at(u16 pc);
+
+private:
+    RSP& m_rsp;
+    CodeBuffer m_code_buffer;
+    // The inline vector instructions need SSE4.1, regardless of what the interpreter was built for.
+    bool m_inline_vector_instructions {};
+
+    struct Program {
+        // A copy of IMEM, which hash collisions are checked against and blocks are compiled from.
+        std::array<u8, 0x1000> imem {};
+        // Indexed by PC / 4.
+        std::array<BlockFunction, 0x400> blocks {};
+        std::bitset<0x400> interpreted {};
+    };
+    std::unordered_map<u64, std::unique_ptr<Program>> m_programs {};
+    Program* m_program { nullptr };
+
+    // Offsets of the RSP state accessed by recompiled code, relative to the RSP object.
+    s32 m_gprs_offset {};
+    s32 m_pc_offset {};
+    s32 m_next_pc_offset {};
+    s32 m_vprs_offset {};
+    s32 m_accumulator_high_offset {};
+    s32 m_accumulator_mid_offset {};
+    s32 m_accumulator_low_offset {};
+
+    X64Emitter m_emitter {};
+
+    static void execute_instruction(RSP* rsp, u32 instruction, u32 pc);
+
+    void clear();
+    BlockFunction compile(u16 pc);
+    u32 instruction_at(u16 pc) const;
+
+    Mem gpr(u32 guest) const;
+    Mem vpr(u32 guest) const;
+    Mem rsp_field(s32 offset) const;
+    void load_gpr(Reg dst, u32 guest);
+    void store_gpr(u32 guest, Reg src);
+
+    void emit_prologue();
+    void emit_exit(u32 instruction_count);
+    // Sets the PC to RAX.
+    void emit_set_pc();
+    void emit_call_interpreter(u32 instruction, u16 pc);
+
+    void compile_instruction(u32 instruction, u16 pc);
+    // Returns whether the instruction was emitted inline.
+    bool compile_scalar(u32 instruction);
+    bool compile_vector(u32 instruction);
+    void compile_branch(u32 instruction, u16 pc);
+
+    void emit_load_vt(Xmm dst, u32 instruction);
+    void emit_add_48(Xmm high, Xmm mid, Xmm low, Xmm add_high, Xmm add_mid, Xmm add_low);
+    void compile_multiply(u32 instruction);
+    void compile_logical(u32 instruction);
+};
+
+}
@@ -0,0 +1,972 @@
+#include <algorithm>
+#include <bit>
+#include "common/logging.h"
+#include "jit/vr4300_recompiler.h"
+#include "n64.h"
+
+namespace JIT {
+
+// Recompiled code keeps its own state pinned in callee-saved registers.
+static constexpr Reg CPU = Reg::R15;
+// Either RDRAM or the fastmem arena.
+static constexpr Reg Memory = Reg::R14;
+// PCycles spent since the last time the scheduler was updated.
+static constexpr Reg Cycles = Reg::R13;
+// PCycles left until the next deadline, counted from the last time the scheduler was updated.
+static constexpr Reg Budget = Reg::R12;
+// Virtual address of the current block, all PCs within the block are relative to it.
+static constexpr Reg BlockPC = Reg::RBX;
+// PCycles spent by each instruction, including the stall for uncached fetches.
+static constexpr Reg InstructionCycles = Reg::RBP;
+
+// GPRs are cached in caller-saved registers, which are written back around every call anyway.
+static constexpr std::array AllocatableRegs = { Reg::RSI, Reg::RDI, Reg::R8, Reg::R9, Reg::R10, Reg::R11 };
+
+static constexpr std::size_t CodeBufferSize = 32 * 1024 * 1024;
+// Well above the code emitted for the longest possible block, so compiling never runs out of space.
+static constexpr std::size_t MaxBlockCodeSize = 256 * 1024;
+
+static constexpr s32 pc_offset_of(const std::size_t index) {
+    return static_cast<s32>(index * 4);
+}
+
+VR4300Recompiler::VR4300Recompiler(VR4300& cpu) : m_cpu(cpu), m_code_buffer(CodeBufferSize), m_block_entries(cpu.m_system.mmu().rdram().size() / 4) {
+    // Uncached stalls are added with a shift.
+    static_assert(std::has_single_bit(VR4300::UncachedInstructionFetchStallCycles));
+    static_assert(std::has_single_bit(VR4300::UncachedDataAccessStallCycles));
+
+    const auto offset_of = [&cpu](const auto& member) {
+        return static_cast<s32>(reinterpret_cast<const u8*>(&member) - reinterpret_cast<const u8*>(&cpu));
+    };
+
+    m_gprs_offset = offset_of(cpu.m_gprs);
+    m_hi_offset = offset_of(cpu.m_hi);
+    m_lo_offset = offset_of(cpu.m_lo);
+    m_pc_offset = offset_of(cpu.m_pc);
+    m_next_pc_offset = offset_of(cpu.m_next_pc);
+    m_in_delay_slot_offset = offset_of(cpu.m_in_delay_slot);
+    m_code_pages_offset = offset_of(cpu.m_code_pages);
+
+#ifdef FOURIXTYS_FASTMEM
+    m_fastmem = FastmemArena::create();
+    if (m_fastmem && !cpu.m_system.mmu().map_fastmem(m_fastmem->base())) {
+        LWARN("Failed to map memory into the fastmem arena, falling back to checked accesses");
+        m_fastmem.reset();
+    }
+#endif
+}
+
+VR4300Recompiler::~VR4300Recompiler() {
+    if (m_fastmem) {
+        m_cpu.m_system.mmu().unmap_fastmem();
+    }
+}
+
+bool VR4300Recompiler::needs_flush() const {
+    return m_code_buffer.free_space() < MaxBlockCodeSize;
+}
+
+void VR4300Recompiler::invalidate(const u32 physical_address) {
+    m_block_entries.at(physical_address / 4) = nullptr;
+}
+
+void VR4300Recompiler::clear() {
+    m_code_buffer.clear();
+    std::fill(m_block_entries.begin(), m_block_entries.end(), nullptr);
+    if (m_fastmem) {
+        m_fastmem->clear_fault_handlers();
+    }
+}
+
+u64 VR4300Recompiler::execute_instruction(VR4300* cpu, const VR4300::DecodedInstruction* decoded, const u64 pc, const bool in_delay_slot, const u64 pending_cycles) {
+    return cpu->execute_for_recompiler(*decoded, pc, in_delay_slot, pending_cycles);
+}
+
+VR4300::JitFunction VR4300Recompiler::compile(const u32 physical_address, const VR4300::Block& block) {
+    // The jump or branch ending the block, if any, is compiled together with its delay slot.
+    const std::size_t branch_index = block.ends_in_delay_slot ? block.instructions.size() - 2 : block.instructions.size();
+    const bool compiles_branch = block.ends_in_delay_slot && can_compile_branch(block.instructions[branch_index].instruction);
+    if (branch_index == 0 && !compiles_branch) {
+        return nullptr;
+    }
+
+    m_block = &block;
+    m_emitter = {};
+    m_exits.clear();
+    m_slow_paths.clear();
+    m_fault_sites.clear();
+    m_exit = m_emitter.new_label();
+    m_epilogue = m_emitter.new_label();
+    m_after_delay_slot = m_emitter.new_label();
+
+    allocate_registers(compiles_branch ? block.instructions.size() : branch_index);
+
+    emit_prologue();
+
+    // Other blocks jump here, with everything but the GPRs already set up.
+    const X64Emitter::Label linked_entry = m_emitter.new_label();
+    m_emitter.bind(linked_entry);
+    reload_registers();
+
+    for (std::size_t i = 0; i < branch_index; i++) {
+        compile_instruction(i, false);
+    }
+
+    if (compiles_branch) {
+        compile_branch(branch_index);
+    } else {
+        // Either the block ends without a branch, or the interpreter has to take over at the branch.
+        emit_set_pc(pc_offset_of(branch_index));
+        write_back_registers();
+        if (block.ends_in_delay_slot) {
+            m_emitter.jmp(m_epilogue);
+        } else {
+            m_emitter.bind(m_after_delay_slot);
+            m_emitter.mov(Reg::RAX, cpu_field(m_pc_offset));
+            emit_dispatch();
+        }
+    }
+
+    emit_out_of_line_code();
+    m_emitter.finalize();
+
+    const void* code = m_code_buffer.add(m_emitter.code());
+    ASSERT_MSG(code, "Out of JIT code space");
+
+    const u8* code_bytes = static_cast<const u8*>(code);
+    for (const FaultSite& site : m_fault_sites) {
+        m_fastmem->add_fault_handler(code_bytes + site.offset, const_cast<u8*>(code_bytes) + site.patch_offset, code_bytes + m_emitter.offset_of(site.slow_path));
+    }
+
+    m_block_entries.at(physical_address / 4) = code_bytes + m_emitter.offset_of(linked_entry);
+    return reinterpret_cast<VR4300::JitFunction>(const_cast<void*>(code));
+}
+
+void VR4300Recompiler::allocate_registers(const std::size_t count) {
+    std::array<u32, 32> uses {};
+    for (std::size_t i = 0; i < count; i++) {
+        const u32 instruction = m_block->instructions[i].instruction;
+        uses[VR4300::get_rs(instruction)]++;
+        uses[VR4300::get_rt(instruction)]++;
+        if (Common::bit_range<31, 26>(instruction) == 0b000000) {
+            uses[VR4300::get_rd(instruction)]++;
+        }
+    }
+    uses[0] = 0;
+
+    std::array<u8, 32> by_uses {};
+    for (u8 i = 0; i < by_uses.size(); i++) {
+        by_uses[i] = i;
+    }
+    std::stable_sort(by_uses.begin(), by_uses.end(), [&uses](const u8 a, const u8 b) {
+        return uses[a] > uses[b];
+    });
+
+    // Loading and writing back a register only pays off if it is used more than once.
+    m_host_regs.fill(std::nullopt);
+    for (std::size_t i = 0; i < AllocatableRegs.size() && uses[by_uses[i]] >= 2; i++) {
+        m_host_regs[by_uses[i]] = AllocatableRegs[i];
+    }
+}
+
+Mem VR4300Recompiler::gpr(const u8 guest) const {
+    return cpu_field(m_gprs_offset + guest * 8);
+}
+
+Mem VR4300Recompiler::cpu_field(const s32 offset) const {
+    return { .base = CPU, .disp = offset };
+}
+
+Reg VR4300Recompiler::source(const u8 guest, const Reg scratch) {
+    if (guest == 0) {
+        m_emitter.alu32(AluOp::Xor, scratch, scratch);
+        return scratch;
+    }
+
+    if (m_host_regs[guest]) {
+        return *m_host_regs[guest];
+    }
+
+    m_emitter.mov(scratch, gpr(guest));
+    return scratch;
+}
+
+void VR4300Recompiler::load(const Reg dst, const u8 guest) {
+    const Reg reg = source(guest, dst);
+    if (reg != dst) {
+        m_emitter.mov(dst, reg);
+    }
+}
+
+void VR4300Recompiler::store_result(const u8 guest, const Reg src) {
+    if (guest == 0) {
+        return;
+    }
+
+    if (m_host_regs[guest]) {
+        m_emitter.mov(*m_host_regs[guest], src);
+    } else {
+        m_emitter.mov(gpr(guest), src);
+    }
+}
+
+void VR4300Recompiler::write_back_registers() {
+    for (u8 guest = 1; guest < m_host_regs.size(); guest++) {
+        if (m_host_regs[guest]) {
+            m_emitter.mov(gpr(guest), *m_host_regs[guest]);
+        }
+    }
+}
+
+void VR4300Recompiler::reload_registers() {
+    for (u8 guest = 1; guest < m_host_regs.size(); guest++) {
+        if (m_host_regs[guest]) {
+            m_emitter.mov(*m_host_regs[guest], gpr(guest));
+        }
+    }
+}
+
+void VR4300Recompiler::emit_prologue() {
+    m_emitter.push(Reg::RBX);
+    m_emitter.push(Reg::RBP);
+    m_emitter.push(Reg::R12);
+    m_emitter.push(Reg::R13);
+    m_emitter.push(Reg::R14);
+    m_emitter.push(Reg::R15);
+    // Keeps the stack 16-byte aligned for calls.
+    m_emitter.alu(AluOp::Sub, Reg::RSP, 8);
+
+    m_emitter.mov(CPU, Reg::RDI);
+    m_emitter.mov(Budget, Reg::RSI);
+    m_emitter.alu32(AluOp::Xor, Cycles, Cycles);
+    if (m_fastmem) {
+        m_emitter.mov(Memory, reinterpret_cast<u64>(m_fastmem->base()));
+    } else {
+        m_emitter.mov(Memory, reinterpret_cast<u64>(m_cpu.m_system.mmu().rdram().data()));
+    }
+
+    m_emitter.mov(Reg::RAX, cpu_field(m_pc_offset));
+    emit_enter_block(Reg::RAX);
+}
+
+void VR4300Recompiler::emit_enter_block(const Reg pc) {
+    m_emitter.mov(BlockPC, pc);
+
+    // Only KSEG0 and KSEG1 get compiled, where bit 29 tells them apart.
+    m_emitter.mov32(InstructionCycles, pc);
+    m_emitter.shift32(ShiftOp::Shr, InstructionCycles, 29);
+    m_emitter.alu32(AluOp::And, InstructionCycles, 1);
+    m_emitter.shift32(ShiftOp::Shl, InstructionCycles, std::countr_zero(VR4300::UncachedInstructionFetchStallCycles));
+    m_emitter.alu32(AluOp::Add, InstructionCycles, 1);
+}
+
+void VR4300Recompiler::emit_dispatch() {
+    // Expects the new PC in RAX, with every GPR written back. Mirrors VR4300::lookup_block().
+    m_emitter.alu(AluOp::Cmp, Cycles, Budget);
+    m_emitter.jcc(Condition::AboveOrEqual, m_epilogue);
+
+    m_emitter.test8(Reg::RAX, 0b11);
+    m_emitter.jcc(Condition::NotEqual, m_epilogue);
+
+    m_emitter.mov32(Reg::RCX, Reg::RAX);
+    m_emitter.shift32(ShiftOp::Shr, Reg::RCX, 30);
+    m_emitter.alu32(AluOp::Cmp, Reg::RCX, 0b10);
+    m_emitter.jcc(Condition::NotEqual, m_epilogue);
+
+    m_emitter.mov32(Reg::RDX, Reg::RAX);
+    m_emitter.alu32(AluOp::And, Reg::RDX, 0x1FFFFFFF);
+    m_emitter.alu32(AluOp::Cmp, Reg::RDX, static_cast<s32>(m_cpu.m_system.mmu().rdram().size()));
+    m_emitter.jcc(Condition::AboveOrEqual, m_epilogue);
+
+    // Entries are 8 bytes for every 4 bytes of RDRAM.
+    m_emitter.alu(AluOp::Add, Reg::RDX, Reg::RDX);
+    m_emitter.mov(Reg::RCX, reinterpret_cast<u64>(m_block_entries.data()));
+    m_emitter.mov(Reg::RCX, Mem { .base = Reg::RCX, .has_index = true, .index = Reg::RDX });
+    m_emitter.test(Reg::RCX, Reg::RCX);
+    m_emitter.jcc(Condition::Equal, m_epilogue);
+
+    emit_enter_block(Reg::RAX);
+    m_emitter.jmp(Reg::RCX);
+}
+
+void VR4300Recompiler::emit_account_cycles(const u32 stall_cycles) {
+    m_emitter.alu(AluOp::Add, Cycles, InstructionCycles);
+    if (stall_cycles != 0) {
+        m_emitter.alu(AluOp::Add, Cycles, static_cast<s32>(stall_cycles));
+    }
+}
+
+void VR4300Recompiler::emit_check_budget(const std::size_t index) {
+    const X64Emitter::Label label = m_emitter.new_label();
+    m_exits.push_back({label, static_cast<u32>(pc_offset_of(index + 1))});
+
+    m_emitter.alu(AluOp::Cmp, Cycles, Budget);
+    m_emitter.jcc(Condition::AboveOrEqual, label);
+}
+
+void VR4300Recompiler::emit_set_pc(const u32 pc_offset) {
+    m_emitter.mov(Reg::RAX, BlockPC);
+    if (pc_offset != 0) {
+        m_emitter.alu(AluOp::Add, Reg::RAX, static_cast<s32>(pc_offset));
+    }
+    m_emitter.mov(cpu_field(m_pc_offset), Reg::RAX);
+    m_emitter.alu(AluOp::Add, Reg::RAX, 4);
+    m_emitter.mov(cpu_field(m_next_pc_offset), Reg::RAX);
+}
+
+void VR4300Recompiler::emit_call_interpreter(const std::size_t index, const bool in_delay_slot) {
+    write_back_registers();
+
+    m_emitter.mov(Reg::RDI, CPU);
+    m_emitter.mov(Reg::RSI, reinterpret_cast<u64>(&m_block->instructions[index]));
+    m_emitter.mov(Reg::RDX, BlockPC);
+    if (index != 0) {
+        m_emitter.alu(AluOp::Add, Reg::RDX, pc_offset_of(index));
+    }
+    m_emitter.mov(Reg::RCX, u64(in_delay_slot));
+    m_emitter.mov(Reg::R8, Cycles);
+    m_emitter.mov(Reg::RAX, reinterpret_cast<u64>(&execute_instruction));
+    m_emitter.call(Reg::RAX);
+
+    // The interpreter has taken over the pending cycles and handed back a fresh budget.
+    m_emitter.alu32(AluOp::Xor, Cycles, Cycles);
+    m_emitter.mov(Budget, Reg::RAX);
+}
+
+void VR4300Recompiler::emit_fallback(const std::size_t index, const bool in_delay_slot) {
+    emit_call_interpreter(index, in_delay_slot);
+    m_emitter.test(Reg::RAX, Reg::RAX);
+    m_emitter.jcc(Condition::Equal, m_epilogue);
+
+    // After a delay slot, the interpreter has already moved the PC to the branch destination.
+    if (in_delay_slot) {
+        m_emitter.jmp(m_after_delay_slot);
+    } else {
+        reload_registers();
+    }
+}
+
+void VR4300Recompiler::emit_out_of_line_code() {
+    for (const SlowPath& slow_path : m_slow_paths) {
+        m_emitter.bind(slow_path.label);
+        emit_fallback(slow_path.index, slow_path.in_delay_slot);
+        if (!slow_path.in_delay_slot) {
+            m_emitter.jmp(slow_path.resume);
+        }
+    }
+
+    for (const Exit& exit : m_exits) {
+        m_emitter.bind(exit.label);
+        m_emitter.mov(Reg::RAX, exit.pc_offset);
+        m_emitter.jmp(m_exit);
+    }
+
+    // Expects the PC relative to the block in RAX.
+    m_emitter.bind(m_exit);
+    m_emitter.alu(AluOp::Add, Reg::RAX, BlockPC);
+    m_emitter.mov(cpu_field(m_pc_offset), Reg::RAX);
+    m_emitter.alu(AluOp::Add, Reg::RAX, 4);
+    m_emitter.mov(cpu_field(m_next_pc_offset), Reg::RAX);
+    write_back_registers();
+
+    m_emitter.bind(m_epilogue);
+    m_emitter.mov(Reg::RAX, Cycles);
+    m_emitter.alu(AluOp::Add, Reg::RSP, 8);
+    m_emitter.pop(Reg::R15);
+    m_emitter.pop(Reg::R14);
+    m_emitter.pop(Reg::R13);
+    m_emitter.pop(Reg::R12);
+    m_emitter.pop(Reg::RBP);
+    m_emitter.pop(Reg::RBX);
+    m_emitter.ret();
+}
+
+bool VR4300Recompiler::compile_instruction(const std::size_t index, const bool in_delay_slot) {
+    if (compile_memory_access(index, in_delay_slot)) {
+        return true;
+    }
+
+    if (const auto stall_cycles = compile_computational(m_block->instructions[index].instruction)) {
+        emit_account_cycles(*stall_cycles);
+        // A delay slot is followed by the budget check of the branch destination.
+        if (!in_delay_slot) {
+            emit_check_budget(index);
+        }
+        return true;
+    }
+
+    emit_fallback(index, in_delay_slot);
+    return false;
+}
+
+std::optional<u32> VR4300Recompiler::compile_computational(const u32 instruction) {
+    const u8 rs = VR4300::get_rs(instruction);
+    const u8 rt = VR4300::get_rt(instruction);
+    const u8 rd = VR4300::get_rd(instruction);
+    const u8 sa = Common::bit_range<10, 6>(instruction);
+    const u16 imm = Common::bit_range<15, 0>(instruction);
+
+    // The operations below mirror their interpreter counterparts, including the width of every intermediate result.
+    const auto three_operand = [&](const AluOp op, const bool word) -> std::optional<u32> {
+        if (rd != 0) {
+            load(Reg::RAX, rs);
+            const Reg operand = source(rt, Reg::RCX);
+            if (word) {
+                m_emitter.alu32(op, Reg::RAX, operand);
+                m_emitter.movsxd(Reg::RAX, Reg::RAX);
+            } else {
+                m_emitter.alu(op, Reg::RAX, operand);
+            }
+            store_result(rd, Reg::RAX);
+        }
+        return 0;
+    };
+
+    const auto set_on_comparison = [&](const u8 dst, const Condition condition, const std::optional<s32> immediate) -> std::optional<u32> {
+        if (dst != 0) {
+            const Reg lhs = source(rs, Reg::RAX);
+            if (immediate) {
+                m_emitter.alu(AluOp::Cmp, lhs, *immediate);
+            } else {
+                m_emitter.alu(AluOp::Cmp, lhs, source(rt, Reg::RCX));
+            }
+            m_emitter.setcc(condition, Reg::RAX);
+            m_emitter.movzx8(Reg::RAX, Reg::RAX);
+            store_result(dst, Reg::RAX);
+        }
+        return 0;
+    };
+
+    // Word shifts keep the interpreter's behaviour of shifting the whole doubleword where it does so.
+    const auto shift = [&](const ShiftOp op, const u8 amount, const bool word, const bool shift_doubleword) -> std::optional<u32> {
+        if (rd != 0) {
+            load(Reg::RAX, rt);
+            if (word && !shift_doubleword) {
+                m_emitter.shift32(op, Reg::RAX, amount);
+            } else {
+                m_emitter.shift(op, Reg::RAX, amount);
+            }
+            if (word) {
+                m_emitter.movsxd(Reg::RAX, Reg::RAX);
+            }
+            store_result(rd, Reg::RAX);
+        }
+        return 0;
+    };
+
+    const auto variable_shift = [&](const ShiftOp op, const bool word, const bool shift_doubleword) -> std::optional<u32> {
+        if (rd != 0) {
+            load(Reg::RCX, rs);
+            load(Reg::RAX, rt);
+            if (word && !shift_doubleword) {
+                m_emitter.shift32_cl(op, Reg::RAX);
+            } else {
+                if (word) {
+                    m_emitter.alu32(AluOp::And, Reg::RCX, 0b11111);
+                }
+                m_emitter.shift_cl(op, Reg::RAX);
+            }
+            if (word) {
+                m_emitter.movsxd(Reg::RAX, Reg::RAX);
+            }
+            store_result(rd, Reg::RAX);
+        }
+        return 0;
+    };
+
+    const auto multiply = [&](const bool doubleword, const bool is_signed) -> std::optional<u32> {
+        load(Reg::RAX, rs);
+        const Reg operand = source(rt, Reg::RCX);
+        if (doubleword) {
+            if (is_signed) {
+                m_emitter.imul128(operand);
+            } else {
+                m_emitter.mul128(operand);
+            }
+            m_emitter.mov(cpu_field(m_hi_offset), Reg::RDX);
+            m_emitter.mov(cpu_field(m_lo_offset), Reg::RAX);
+            return VR4300::DoublewordMultiplyStallCycles;
+        }
+
+        // Only the low 64 bits of the product are kept, which are the same for signed and unsigned operands.
+        m_emitter.imul(Reg::RAX, operand);
+        m_emitter.mov(Reg::RCX, Reg::RAX);
+        m_emitter.shift(ShiftOp::Shr, Reg::RCX, 32);
+        m_emitter.movsxd(Reg::RCX, Reg::RCX);
+        m_emitter.mov(cpu_field(m_hi_offset), Reg::RCX);
+        m_emitter.movsxd(Reg::RAX, Reg::RAX);
+        m_emitter.mov(cpu_field(m_lo_offset), Reg::RAX);
+        return VR4300::MultiplyStallCycles;
+    };
+
+    const auto immediate = [&](const AluOp op, const bool sign_extend_immediate, const bool word) -> std::optional<u32> {
+        if (rt != 0) {
+            load(Reg::RAX, rs);
+            const s32 operand = sign_extend_immediate ? s32(s16(imm)) : s32(imm);
+            if (word) {
+                m_emitter.alu32(op, Reg::RAX, operand);
+                m_emitter.movsxd(Reg::RAX, Reg::RAX);
+            } else {
+                m_emitter.alu(op, Reg::RAX, operand);
+            }
+            store_result(rt, Reg::RAX);
+        }
+        return 0;
+    };
+
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000:
+            switch (Common::bit_range<5, 0>(instruction)) {
+                case 0b000000: return shift(ShiftOp::Shl, sa, true, false);
+                case 0b000010: return shift(ShiftOp::Shr, sa, true, false);
+                case 0b000011: return shift(ShiftOp::Shr, sa, true, true);
+                case 0b000100: return variable_shift(ShiftOp::Shl, true, false);
+                case 0b000110: return variable_shift(ShiftOp::Shr, true, false);
+                case 0b000111: return variable_shift(ShiftOp::Shr, true, true);
+                case 0b001111: return 0;
+
+                case 0b010000:
+                case 0b010010:
+                    if (rd != 0) {
+                        m_emitter.mov(Reg::RAX, cpu_field(Common::is_bit_enabled<1>(instruction) ? m_lo_offset : m_hi_offset));
+                        store_result(rd, Reg::RAX);
+                    }
+                    return 0;
+
+                // The interpreter takes the source of MTHI and MTLO from the rd field.
+                case 0b010001:
+                case 0b010011:
+                    load(Reg::RAX, rd);
+                    m_emitter.mov(cpu_field(Common::is_bit_enabled<1>(instruction) ? m_lo_offset : m_hi_offset), Reg::RAX);
+                    return 0;
+
+                case 0b010100: return variable_shift(ShiftOp::Shl, false, false);
+                case 0b010110: return variable_shift(ShiftOp::Shr, false, false);
+                case 0b010111: return variable_shift(ShiftOp::Sar, false, false);
+                case 0b011000: return multiply(false, true);
+                case 0b011001: return multiply(false, false);
+                case 0b011100: return multiply(true, true);
+                case 0b011101: return multiply(true, false);
+                case 0b100001: return three_operand(AluOp::Add, true);
+                case 0b100011: return three_operand(AluOp::Sub, true);
+                case 0b100100: return three_operand(AluOp::And, false);
+                case 0b100101: return three_operand(AluOp::Or, false);
+                case 0b100110: return three_operand(AluOp::Xor, false);
+
+                case 0b100111:
+                    if (rd != 0) {
+                        load(Reg::RAX, rs);
+                        m_emitter.alu(AluOp::Or, Reg::RAX, source(rt, Reg::RCX));
+                        m_emitter.not_(Reg::RAX);
+                        store_result(rd, Reg::RAX);
+                    }
+                    return 0;
+
+                case 0b101010: return set_on_comparison(rd, Condition::Less, std::nullopt);
+                case 0b101011: return set_on_comparison(rd, Condition::Below, std::nullopt);
+                case 0b101101: return three_operand(AluOp::Add, false);
+                case 0b101111: return three_operand(AluOp::Sub, false);
+                case 0b111000: return shift(ShiftOp::Shl, sa, false, false);
+                case 0b111010: return shift(ShiftOp::Shr, sa, false, false);
+                case 0b111011: return shift(ShiftOp::Sar, sa, false, false);
+                case 0b111100: return shift(ShiftOp::Shl, 32 + sa, false, false);
+                case 0b111110: return shift(ShiftOp::Shr, 32 + sa, false, false);
+                case 0b111111: return shift(ShiftOp::Sar, 32 + sa, false, false);
+                default: return std::nullopt;
+            }
+
+        case 0b001001: return immediate(AluOp::Add, true, true);
+        case 0b001010: return set_on_comparison(rt, Condition::Less, s16(imm));
+        case 0b001011: return set_on_comparison(rt, Condition::Below, s16(imm));
+        case 0b001100: return immediate(AluOp::And, false, false);
+        case 0b001101: return immediate(AluOp::Or, false, false);
+        case 0b001110: return immediate(AluOp::Xor, false, false);
+
+        case 0b001111:
+            if (rt != 0) {
+                m_emitter.mov(Reg::RAX, u64(s64(s32(u32(imm) << 16))));
+                store_result(rt, Reg::RAX);
+            }
+            return 0;
+
+        case 0b011001: return immediate(AluOp::Add, true, false);
+        default: return std::nullopt;
+    }
+}
+
+bool VR4300Recompiler::compile_memory_access(const std::size_t index, const bool in_delay_slot) {
+    enum class Extension { Zero, Sign };
+    struct Access {
+        u8 size;
+        bool is_store;
+        Extension extension;
+    };
+
+    const u32 instruction = m_block->instructions[index].instruction;
+    Access access {};
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b100000: access = { 1, false, Extension::Sign }; break;
+        case 0b100001: access = { 2, false, Extension::Sign }; break;
+        case 0b100011: access = { 4, false, Extension::Sign }; break;
+        case 0b100100: access = { 1, false, Extension::Zero }; break;
+        case 0b100101: access = { 2, false, Extension::Zero }; break;
+        case 0b100111: access = { 4, false, Extension::Zero }; break;
+        case 0b110111: access = { 8, false, Extension::Zero }; break;
+        case 0b101000: access = { 1, true, Extension::Zero }; break;
+        case 0b101001: access = { 2, true, Extension::Zero }; break;
+        case 0b101011: access = { 4, true, Extension::Zero }; break;
+        case 0b111111: access = { 8, true, Extension::Zero }; break;
+        default: return false;
+    }
+
+    const u8 base = Common::bit_range<25, 21>(instruction);
+    const u8 rt = VR4300::get_rt(instruction);
+    const s16 offset = Common::bit_range<15, 0>(instruction);
+
+    // Anything that does not hit KSEG0/KSEG1 memory directly, or would throw an exception, goes to the interpreter.
+    const X64Emitter::Label slow_path = m_emitter.new_label();
+    const X64Emitter::Label resume = m_emitter.new_label();
+    m_slow_paths.push_back({slow_path, resume, index, in_delay_slot});
+
+    load(Reg::RAX, base);
+    if (offset != 0) {
+        m_emitter.alu(AluOp::Add, Reg::RAX, offset);
+    }
+
+    // Only LW and SW check for sign-extended addresses, the others use the low word as is.
+    if (access.size == 4 && (access.is_store || access.extension == Extension::Sign)) {
+        m_emitter.movsxd(Reg::RCX, Reg::RAX);
+        m_emitter.alu(AluOp::Cmp, Reg::RCX, Reg::RAX);
+        m_emitter.jcc(Condition::NotEqual, slow_path);
+    }
+
+    if (access.size > 1) {
+        m_emitter.test8(Reg::RAX, access.size - 1);
+        m_emitter.jcc(Condition::NotEqual, slow_path);
+    }
+
+    // Faulting fastmem accesses get patched into a jump to their slow path from here on.
+    const std::size_t patch_offset = m_emitter.code().size();
+    m_emitter.mov32(Reg::RDX, Reg::RAX);
+    if (!m_fastmem) {
+        // Folds KSEG1 onto KSEG0, then leaves the physical address if it is within RDRAM.
+        m_emitter.alu32(AluOp::And, Reg::RDX, static_cast<s32>(0xDFFFFFFF));
+        m_emitter.alu32(AluOp::Sub, Reg::RDX, static_cast<s32>(0x80000000));
+        m_emitter.alu32(AluOp::Cmp, Reg::RDX, static_cast<s32>(m_cpu.m_system.mmu().rdram().size()));
+        m_emitter.jcc(Condition::AboveOrEqual, slow_path);
+
+        // Writes to pages holding compiled code have to invalidate them.
+        if (access.is_store) {
+            m_emitter.mov32(Reg::RCX, Reg::RDX);
+            m_emitter.shift32(ShiftOp::Shr, Reg::RCX, VR4300::CodePageShift);
+            m_emitter.cmp8(Mem { .base = CPU, .disp = m_code_pages_offset, .has_index = true, .index = Reg::RCX }, 0);
+            m_emitter.jcc(Condition::NotEqual, slow_path);
+        }
+    }
+
+    // The stall is only added once the access has gone through, as a faulting access restarts on the slow path.
+    m_emitter.mov32(Reg::RCX, Reg::RAX);
+    m_emitter.shift32(ShiftOp::Shr, Reg::RCX, 29);
+    m_emitter.alu32(AluOp::And, Reg::RCX, 1);
+    m_emitter.shift32(ShiftOp::Shl, Reg::RCX, std::countr_zero(VR4300::UncachedDataAccessStallCycles));
+
+    // With fastmem, unmapped memory (MMIO, TLB-mapped segments) and write-protected code pages fault instead.
+    const auto add_fault_site = [&] {
+        if (m_fastmem) {
+            m_fault_sites.push_back({m_emitter.code().size(), patch_offset, slow_path});
+        }
+    };
+
+    // Memory is stored big-endian.
+    const Mem memory { .base = Memory, .has_index = true, .index = Reg::RDX };
+    if (access.is_store) {
+        load(Reg::RAX, rt);
+        switch (access.size) {
+            case 1:
+                add_fault_site();
+                m_emitter.mov8(memory, Reg::RAX);
+                break;
+            case 2:
+                m_emitter.shift16(ShiftOp::Ror, Reg::RAX, 8);
+                add_fault_site();
+                m_emitter.mov16(memory, Reg::RAX);
+                break;
+            case 4:
+                m_emitter.bswap32(Reg::RAX);
+                add_fault_site();
+                m_emitter.mov32(memory, Reg::RAX);
+                break;
+            case 8:
+                m_emitter.bswap(Reg::RAX);
+                add_fault_site();
+                m_emitter.mov(memory, Reg::RAX);
+                break;
+            default:
+                UNREACHABLE();
+        }
+    } else {
+        const bool sign_extend = access.extension == Extension::Sign;
+        switch (access.size) {
+            case 1:
+                add_fault_site();
+                if (sign_extend) {
+                    m_emitter.movsx8(Reg::RAX, memory);
+                } else {
+                    m_emitter.movzx8(Reg::RAX, memory);
+                }
+                break;
+            case 2:
+                add_fault_site();
+                m_emitter.movzx16(Reg::RAX, memory);
+                m_emitter.shift16(ShiftOp::Ror, Reg::RAX, 8);
+                if (sign_extend) {
+                    m_emitter.movsx16(Reg::RAX, Reg::RAX);
+                } else {
+                    m_emitter.movzx16(Reg::RAX, Reg::RAX);
+                }
+                break;
+            case 4:
+                add_fault_site();
+                m_emitter.mov32(Reg::RAX, memory);
+                m_emitter.bswap32(Reg::RAX);
+                if (sign_extend) {
+                    m_emitter.movsxd(Reg::RAX, Reg::RAX);
+                }
+                break;
+            case 8:
+                add_fault_site();
+                m_emitter.mov(Reg::RAX, memory);
+                m_emitter.bswap(Reg::RAX);
+                break;
+            default:
+                UNREACHABLE();
+        }
+        store_result(rt, Reg::RAX);
+    }
+
+    emit_account_cycles(0);
+    m_emitter.alu(AluOp::Add, Cycles, Reg::RCX);
+
+    if (!in_delay_slot) {
+        emit_check_budget(index);
+    }
+    m_emitter.bind(resume);
+
+    return true;
+}
+
+bool VR4300Recompiler::can_compile_branch(const u32 instruction) const {
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000: {
+            const auto op = Common::bit_range<5, 0>(instruction);
+            return op == 0b001000 || op == 0b001001;
+        }
+
+        case 0b000001:
+            switch (VR4300::get_rt(instruction)) {
+                case 0b00000:
+                case 0b00001:
+                case 0b00010:
+                case 0b00011:
+                case 0b10001:
+                    return true;
+                default:
+                    return false;
+            }
+
+        case 0b000010:
+        case 0b000011:
+        case 0b000100:
+        case 0b000101:
+        case 0b000110:
+        case 0b000111:
+        case 0b010100:
+        case 0b010101:
+        case 0b010111:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void VR4300Recompiler::compile_branch(const std::size_t index) {
+    const u32 instruction = m_block->instructions[index].instruction;
+    const u8 rs = VR4300::get_rs(instruction);
+    const u8 rt = VR4300::get_rt(instruction);
+    const s32 link_offset = pc_offset_of(index + 2);
+    const s32 target_offset = pc_offset_of(index + 1) + (s32(s16(Common::bit_range<15, 0>(instruction))) * 4);
+
+    const X64Emitter::Label branch_exit = m_emitter.new_label();
+    std::optional<X64Emitter::Label> likely_not_taken {};
+    std::optional<X64Emitter::Label> interpreted_branch {};
+
+    const auto link = [&](const u8 guest) {
+        m_emitter.mov(Reg::RCX, BlockPC);
+        m_emitter.alu(AluOp::Add, Reg::RCX, link_offset);
+        store_result(guest, Reg::RCX);
+    };
+
+    // Expects the flags to be set by a comparison. Stores where execution continues after the delay slot in m_next_pc.
+    const auto conditional = [&](const Condition taken, const bool likely, const bool links) {
+        m_emitter.setcc(taken, Reg::RAX);
+        if (links) {
+            link(31);
+        }
+        emit_account_cycles(0);
+
+        if (likely) {
+            likely_not_taken = m_emitter.new_label();
+            m_emitter.test8(Reg::RAX, 1);
+            m_emitter.jcc(Condition::Equal, *likely_not_taken);
+            m_emitter.mov(Reg::RDX, BlockPC);
+            m_emitter.alu(AluOp::Add, Reg::RDX, target_offset);
+        } else {
+            m_emitter.mov(Reg::RDX, BlockPC);
+            m_emitter.alu(AluOp::Add, Reg::RDX, link_offset);
+            m_emitter.mov(Reg::RCX, BlockPC);
+            m_emitter.alu(AluOp::Add, Reg::RCX, target_offset);
+            m_emitter.test8(Reg::RAX, 1);
+            m_emitter.cmov(Condition::NotEqual, Reg::RDX, Reg::RCX);
+        }
+        m_emitter.mov(cpu_field(m_next_pc_offset), Reg::RDX);
+    };
+
+    const auto compare = [&] {
+        const Reg lhs = source(rs, Reg::RAX);
+        m_emitter.alu(AluOp::Cmp, lhs, source(rt, Reg::RCX));
+    };
+
+    const auto test_sign = [&] {
+        const Reg reg = source(rs, Reg::RAX);
+        m_emitter.test(reg, reg);
+    };
+
+    // J and JAL keep the upper bits of the PC's low word, and leave the upper word zeroed.
+    const auto jump = [&] {
+        emit_account_cycles(0);
+        m_emitter.mov32(Reg::RAX, BlockPC);
+        m_emitter.alu32(AluOp::And, Reg::RAX, static_cast<s32>(0xF0000000));
+        m_emitter.alu32(AluOp::Or, Reg::RAX, static_cast<s32>(Common::bit_range<25, 0>(instruction) << 2));
+        m_emitter.mov(cpu_field(m_next_pc_offset), Reg::RAX);
+    };
+
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000: {
+            const Reg target = source(rs, Reg::RAX);
+            if (Common::bit_range<5, 0>(instruction) == 0b001000) {
+                // Misaligned JR targets throw an address error.
+                interpreted_branch = m_emitter.new_label();
+                m_emitter.test8(target, 0b11);
+                m_emitter.jcc(Condition::NotEqual, *interpreted_branch);
+                emit_account_cycles(0);
+                m_emitter.mov(cpu_field(m_next_pc_offset), target);
+            } else {
+                emit_account_cycles(0);
+                m_emitter.mov(cpu_field(m_next_pc_offset), target);
+                link(VR4300::get_rd(instruction));
+            }
+            break;
+        }
+
+        case 0b000001:
+            test_sign();
+            switch (rt) {
+                case 0b00000: conditional(Condition::Sign, false, false); break;
+                case 0b00001: conditional(Condition::NotSign, false, false); break;
+                case 0b00010: conditional(Condition::Sign, true, false); break;
+                case 0b00011: conditional(Condition::NotSign, true, false); break;
+                case 0b10001: conditional(Condition::NotSign, false, true); break;
+                default: UNREACHABLE();
+            }
+            break;
+
+        case 0b000010:
+            jump();
+            break;
+
+        case 0b000011:
+            jump();
+            link(31);
+            break;
+
+        case 0b000100:
+            compare();
+            conditional(Condition::Equal, false, false);
+            break;
+
+        case 0b000101:
+            compare();
+            conditional(Condition::NotEqual, false, false);
+            break;
+
+        case 0b000110:
+            test_sign();
+            conditional(Condition::LessOrEqual, false, false);
+            break;
+
+        case 0b000111:
+            test_sign();
+            conditional(Condition::Greater, false, false);
+            break;
+
+        case 0b010100:
+            compare();
+            conditional(Condition::Equal, true, false);
+            break;
+
+        case 0b010101:
+            compare();
+            conditional(Condition::NotEqual, true, false);
+            break;
+
+        case 0b010111:
+            test_sign();
+            conditional(Condition::Greater, true, false);
+            break;
+
+        default:
+            UNREACHABLE();
+    }
+
+    // The interpreter can run out of cycles between a branch and its delay slot, and so can we.
+    m_emitter.alu(AluOp::Cmp, Cycles, Budget);
+    m_emitter.jcc(Condition::AboveOrEqual, branch_exit);
+
+    if (compile_instruction(index + 1, true)) {
+        m_emitter.mov(Reg::RAX, cpu_field(m_next_pc_offset));
+        m_emitter.mov(cpu_field(m_pc_offset), Reg::RAX);
+        m_emitter.alu(AluOp::Add, Reg::RAX, 4);
+        m_emitter.mov(cpu_field(m_next_pc_offset), Reg::RAX);
+        write_back_registers();
+    }
+
+    m_emitter.bind(m_after_delay_slot);
+    m_emitter.mov(Reg::RAX, cpu_field(m_pc_offset));
+    emit_dispatch();
+
+    // Not taken branch-likely instructions skip their delay slot.
+    if (likely_not_taken) {
+        m_emitter.bind(*likely_not_taken);
+        emit_set_pc(link_offset);
+        write_back_registers();
+        m_emitter.jmp(m_after_delay_slot);
+    }
+
+    m_emitter.bind(branch_exit);
+    m_emitter.mov(Reg::RAX, BlockPC);
+    m_emitter.alu(AluOp::Add, Reg::RAX, pc_offset_of(index + 1));
+    m_emitter.mov(cpu_field(m_pc_offset), Reg::RAX);
+    m_emitter.mov(Reg::RCX, 1);
+    m_emitter.mov8(cpu_field(m_in_delay_slot_offset), Reg::RCX);
+    write_back_registers();
+    m_emitter.jmp(m_epilogue);
+
+    if (interpreted_branch) {
+        m_emitter.bind(*interpreted_branch);
+        emit_call_interpreter(index, false);
+        m_emitter.jmp(m_epilogue);
+    }
+}
+
+}
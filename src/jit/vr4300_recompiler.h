@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "common/types.h"
+#include "jit/code_buffer.h"
+#include "jit/fastmem.h"
+#include "jit/x64_emitter.h"
+#include "vr4300.h"
+
+namespace JIT {
+
+// Translates VR4300 blocks into x86-64 code (System V ABI).
+//
+// Common integer instructions, branches and RDRAM loads/stores are emitted inline, with the most used GPRs of each
+// block cached in host registers. Everything else, as well as accesses outside of KSEG0/KSEG1 RDRAM, is handed to the
+// interpreter one instruction at a time. Blocks jump straight into each other through a table of entry points,
+// indexed by physical address, so the dispatcher in VR4300::run() is only returned to when the budget runs out or
+// the interpreter has to take over. Where fastmem is available, loads and stores skip their address checks and rely on
+// faults instead.
+class VR4300Recompiler {
+public:
+    explicit VR4300Recompiler(VR4300& cpu);
+    ~VR4300Recompiler();
+
+    VR4300Recompiler(const VR4300Recompiler&) = delete;
+    VR4300Recompiler& operator=(const VR4300Recompiler&) = delete;
+
+    // Returns nullptr if nothing in the block can be recompiled.
+    VR4300::JitFunction compile(u32 physical_address, const VR4300::Block& block);
+
+    // Without fastmem, RDRAM loads index RDRAM directly and do not see protected pages.
+    bool uses_fastmem() const { return m_fastmem != nullptr; }
+
+    // Whether the code buffer may not fit another block, in which case every block has to be dropped first.
+    bool needs_flush() const;
+    // Stops other blocks from jumping into the block at this address.
+    void invalidate(u32 physical_address);
+    void clear();
+
+private:
+    VR4300& m_cpu;
+    CodeBuffer m_code_buffer;
+    std::unique_ptr<FastmemArena> m_fastmem;
+    // Entry points that skip the prologue, indexed by physical address / 4.
+    std::vector<const void*> m_block_entries;
+
+    // Offsets of the VR4300 state accessed by recompiled code, relative to the VR4300 object.
+    s32 m_gprs_offset {};
+    s32 m_hi_offset {};
+    s32 m_lo_offset {};
+    s32 m_pc_offset {};
+    s32 m_next_pc_offset {};
+    s32 m_in_delay_slot_offset {};
+    s32 m_code_pages_offset {};
+
+    // State of the block being compiled.
+    const VR4300::Block* m_block { nullptr };
+    X64Emitter m_emitter {};
+    std::array<std::optional<Reg>, 32> m_host_regs {};
+
+    struct Exit {
+        X64Emitter::Label label;
+        // The PC to exit with, relative to the block's first instruction.
+        u32 pc_offset;
+    };
+    std::vector<Exit> m_exits {};
+
+    struct SlowPath {
+        X64Emitter::Label label;
+        X64Emitter::Label resume;
+        std::size_t index;
+        bool in_delay_slot;
+    };
+    std::vector<SlowPath> m_slow_paths {};
+
+    // Fastmem accesses, which resume at their slow path when they fault.
+    struct FaultSite {
+        std::size_t offset;
+        std::size_t patch_offset;
+        X64Emitter::Label slow_path;
+    };
+    std::vector<FaultSite> m_fault_sites {};
+
+    X64Emitter::Label m_exit {};
+    X64Emitter::Label m_epilogue {};
+    X64Emitter::Label m_after_delay_slot {};
+
+    static u64 execute_instruction(VR4300* cpu, const VR4300::DecodedInstruction* decoded, u64 pc, bool in_delay_slot, u64 pending_cycles);
+
+    void allocate_registers(std::size_t count);
+    Mem gpr(u8 guest) const;
+    Mem cpu_field(s32 offset) const;
+    // Returns a host register holding the guest register, which is only loaded into the scratch register if it is not cached.
+    Reg source(u8 guest, Reg scratch);
+    void load(Reg dst, u8 guest);
+    void store_result(u8 guest, Reg src);
+    void write_back_registers();
+    void reload_registers();
+
+    void emit_prologue();
+    void emit_enter_block(Reg pc);
+    void emit_dispatch();
+    void emit_account_cycles(u32 stall_cycles);
+    void emit_check_budget(std::size_t index);
+    void emit_set_pc(u32 pc_offset);
+    void emit_call_interpreter(std::size_t index, bool in_delay_slot);
+    void emit_fallback(std::size_t index, bool in_delay_slot);
+    void emit_out_of_line_code();
+
+    // Returns whether the instruction was emitted inline rather than handed to the interpreter.
+    bool compile_instruction(std::size_t index, bool in_delay_slot);
+    // Returns the stall PCycles of the instruction, or nothing if it has to be interpreted.
+    std::optional<u32> compile_computational(u32 instruction);
+    bool compile_memory_access(std::size_t index, bool in_delay_slot);
+    bool can_compile_branch(u32 instruction) const;
+    void compile_branch(std::size_t index);
+};
+
+}
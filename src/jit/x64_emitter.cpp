@@ -0,0 +1,413 @@
+#include "common/logging.h"
+#include "jit/x64_emitter.h"
+
+namespace JIT {
+
+static constexpr u8 index_of(const Reg reg) {
+    return Common::underlying(reg);
+}
+
+static constexpr u8 index_of(const Xmm reg) {
+    return Common::underlying(reg);
+}
+
+X64Emitter::Label X64Emitter::new_label() {
+    m_label_offsets.push_back(~std::size_t(0));
+    return m_label_offsets.size() - 1;
+}
+
+void X64Emitter::bind(const Label label) {
+    m_label_offsets.at(label) = m_code.size();
+}
+
+void X64Emitter::finalize() {
+    for (const Fixup& fixup : m_fixups) {
+        const std::size_t target = m_label_offsets.at(fixup.label);
+        ASSERT_MSG(target != ~std::size_t(0), "Jump to unbound label {}", fixup.label);
+
+        // Displacements are relative to the end of the 4-byte immediate.
+        const u32 displacement = static_cast<u32>(target - (fixup.offset + 4));
+        for (int i = 0; i < 4; i++) {
+            m_code[fixup.offset + i] = static_cast<u8>(displacement >> (i * 8));
+        }
+    }
+
+    m_fixups.clear();
+}
+
+void X64Emitter::emit32(const u32 value) {
+    for (int i = 0; i < 4; i++) {
+        emit8(static_cast<u8>(value >> (i * 8)));
+    }
+}
+
+void X64Emitter::emit64(const u64 value) {
+    emit32(static_cast<u32>(value));
+    emit32(static_cast<u32>(value >> 32));
+}
+
+void X64Emitter::rex(const bool w, const u8 reg, const u8 index, const u8 base, const bool force) {
+    const u8 prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+    if (prefix != 0x40 || force) {
+        emit8(prefix);
+    }
+}
+
+void X64Emitter::rex(const bool w, const Reg reg, const Mem& mem, const bool force) {
+    rex(w, index_of(reg), mem.has_index ? index_of(mem.index) : 0, index_of(mem.base), force);
+}
+
+void X64Emitter::modrm_reg(const u8 reg, const u8 rm) {
+    emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void X64Emitter::modrm_mem(const u8 reg, const Mem& mem) {
+    // Always use a 32-bit displacement, which sidesteps the RBP/R13 special cases.
+    const u8 base = index_of(mem.base) & 7;
+    if (mem.has_index || base == index_of(Reg::RSP)) {
+        ASSERT(!mem.has_index || mem.index != Reg::RSP);
+        const u8 index = mem.has_index ? (index_of(mem.index) & 7) : 0b100;
+        emit8(0x80 | ((reg & 7) << 3) | 0b100);
+        emit8((index << 3) | base);
+    } else {
+        emit8(0x80 | ((reg & 7) << 3) | base);
+    }
+
+    emit32(static_cast<u32>(mem.disp));
+}
+
+void X64Emitter::push(const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0x50 | (index_of(reg) & 7));
+}
+
+void X64Emitter::pop(const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0x58 | (index_of(reg) & 7));
+}
+
+void X64Emitter::ret() {
+    emit8(0xC3);
+}
+
+void X64Emitter::call(const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0xFF);
+    modrm_reg(2, index_of(reg));
+}
+
+void X64Emitter::jmp(const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0xFF);
+    modrm_reg(4, index_of(reg));
+}
+
+void X64Emitter::jmp(const Label label) {
+    emit8(0xE9);
+    m_fixups.push_back({m_code.size(), label});
+    emit32(0);
+}
+
+void X64Emitter::jcc(const Condition condition, const Label label) {
+    emit8(0x0F);
+    emit8(0x80 | Common::underlying(condition));
+    m_fixups.push_back({m_code.size(), label});
+    emit32(0);
+}
+
+void X64Emitter::mov(const Reg dst, const Reg src) {
+    rex(true, index_of(src), 0, index_of(dst));
+    emit8(0x89);
+    modrm_reg(index_of(src), index_of(dst));
+}
+
+void X64Emitter::mov32(const Reg dst, const Reg src) {
+    rex(false, index_of(src), 0, index_of(dst));
+    emit8(0x89);
+    modrm_reg(index_of(src), index_of(dst));
+}
+
+void X64Emitter::mov(const Reg dst, const u64 imm) {
+    if (imm <= 0xFFFFFFFF) {
+        // Writes to 32-bit registers zero the upper half.
+        rex(false, 0, 0, index_of(dst));
+        emit8(0xB8 | (index_of(dst) & 7));
+        emit32(static_cast<u32>(imm));
+        return;
+    }
+
+    rex(true, 0, 0, index_of(dst));
+    emit8(0xB8 | (index_of(dst) & 7));
+    emit64(imm);
+}
+
+void X64Emitter::mov(const Reg dst, const Mem& src) {
+    rex(true, dst, src);
+    emit8(0x8B);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::mov32(const Reg dst, const Mem& src) {
+    rex(false, dst, src);
+    emit8(0x8B);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::mov(const Mem& dst, const Reg src) {
+    rex(true, src, dst);
+    emit8(0x89);
+    modrm_mem(index_of(src), dst);
+}
+
+void X64Emitter::mov(const Mem& dst, const s32 imm) {
+    rex(true, Reg::RAX, dst);
+    emit8(0xC7);
+    modrm_mem(0, dst);
+    emit32(static_cast<u32>(imm));
+}
+
+void X64Emitter::mov8(const Mem& dst, const Reg src) {
+    // Without a REX prefix, registers 4-7 would encode AH/CH/DH/BH instead of SPL/BPL/SIL/DIL.
+    rex(false, src, dst, index_of(src) >= 4);
+    emit8(0x88);
+    modrm_mem(index_of(src), dst);
+}
+
+void X64Emitter::mov16(const Mem& dst, const Reg src) {
+    emit8(0x66);
+    rex(false, src, dst);
+    emit8(0x89);
+    modrm_mem(index_of(src), dst);
+}
+
+void X64Emitter::mov32(const Mem& dst, const Reg src) {
+    rex(false, src, dst);
+    emit8(0x89);
+    modrm_mem(index_of(src), dst);
+}
+
+void X64Emitter::movsx8(const Reg dst, const Mem& src) {
+    rex(true, dst, src);
+    emit8(0x0F);
+    emit8(0xBE);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::movzx8(const Reg dst, const Mem& src) {
+    rex(false, dst, src);
+    emit8(0x0F);
+    emit8(0xB6);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::movsx16(const Reg dst, const Reg src) {
+    rex(true, index_of(dst), 0, index_of(src));
+    emit8(0x0F);
+    emit8(0xBF);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::movzx16(const Reg dst, const Reg src) {
+    rex(false, index_of(dst), 0, index_of(src));
+    emit8(0x0F);
+    emit8(0xB7);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::movzx16(const Reg dst, const Mem& src) {
+    rex(false, dst, src);
+    emit8(0x0F);
+    emit8(0xB7);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::movsxd(const Reg dst, const Reg src) {
+    rex(true, index_of(dst), 0, index_of(src));
+    emit8(0x63);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::movzx8(const Reg dst, const Reg src) {
+    rex(false, index_of(dst), 0, index_of(src), index_of(src) >= 4);
+    emit8(0x0F);
+    emit8(0xB6);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::alu(const AluOp op, const Reg dst, const Reg src) {
+    rex(true, index_of(src), 0, index_of(dst));
+    emit8((Common::underlying(op) << 3) | 0x01);
+    modrm_reg(index_of(src), index_of(dst));
+}
+
+void X64Emitter::alu32(const AluOp op, const Reg dst, const Reg src) {
+    rex(false, index_of(src), 0, index_of(dst));
+    emit8((Common::underlying(op) << 3) | 0x01);
+    modrm_reg(index_of(src), index_of(dst));
+}
+
+void X64Emitter::alu(const AluOp op, const Reg dst, const s32 imm) {
+    rex(true, 0, 0, index_of(dst));
+    emit8(0x81);
+    modrm_reg(Common::underlying(op), index_of(dst));
+    emit32(static_cast<u32>(imm));
+}
+
+void X64Emitter::alu32(const AluOp op, const Reg dst, const s32 imm) {
+    rex(false, 0, 0, index_of(dst));
+    emit8(0x81);
+    modrm_reg(Common::underlying(op), index_of(dst));
+    emit32(static_cast<u32>(imm));
+}
+
+void X64Emitter::cmp8(const Mem& dst, const u8 imm) {
+    rex(false, Reg::RAX, dst);
+    emit8(0x80);
+    modrm_mem(Common::underlying(AluOp::Cmp), dst);
+    emit8(imm);
+}
+
+void X64Emitter::test8(const Reg reg, const u8 imm) {
+    rex(false, 0, 0, index_of(reg), index_of(reg) >= 4);
+    emit8(0xF6);
+    modrm_reg(0, index_of(reg));
+    emit8(imm);
+}
+
+void X64Emitter::test(const Reg a, const Reg b) {
+    rex(true, index_of(b), 0, index_of(a));
+    emit8(0x85);
+    modrm_reg(index_of(b), index_of(a));
+}
+
+void X64Emitter::not_(const Reg reg) {
+    rex(true, 0, 0, index_of(reg));
+    emit8(0xF7);
+    modrm_reg(2, index_of(reg));
+}
+
+void X64Emitter::imul(const Reg dst, const Reg src) {
+    rex(true, index_of(dst), 0, index_of(src));
+    emit8(0x0F);
+    emit8(0xAF);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::mul128(const Reg src) {
+    rex(true, 0, 0, index_of(src));
+    emit8(0xF7);
+    modrm_reg(4, index_of(src));
+}
+
+void X64Emitter::imul128(const Reg src) {
+    rex(true, 0, 0, index_of(src));
+    emit8(0xF7);
+    modrm_reg(5, index_of(src));
+}
+
+void X64Emitter::shift(const ShiftOp op, const Reg reg, const u8 amount) {
+    rex(true, 0, 0, index_of(reg));
+    emit8(0xC1);
+    modrm_reg(Common::underlying(op), index_of(reg));
+    emit8(amount);
+}
+
+void X64Emitter::shift32(const ShiftOp op, const Reg reg, const u8 amount) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0xC1);
+    modrm_reg(Common::underlying(op), index_of(reg));
+    emit8(amount);
+}
+
+void X64Emitter::shift16(const ShiftOp op, const Reg reg, const u8 amount) {
+    emit8(0x66);
+    rex(false, 0, 0, index_of(reg));
+    emit8(0xC1);
+    modrm_reg(Common::underlying(op), index_of(reg));
+    emit8(amount);
+}
+
+void X64Emitter::shift_cl(const ShiftOp op, const Reg reg) {
+    rex(true, 0, 0, index_of(reg));
+    emit8(0xD3);
+    modrm_reg(Common::underlying(op), index_of(reg));
+}
+
+void X64Emitter::shift32_cl(const ShiftOp op, const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0xD3);
+    modrm_reg(Common::underlying(op), index_of(reg));
+}
+
+void X64Emitter::bswap(const Reg reg) {
+    rex(true, 0, 0, index_of(reg));
+    emit8(0x0F);
+    emit8(0xC8 | (index_of(reg) & 7));
+}
+
+void X64Emitter::bswap32(const Reg reg) {
+    rex(false, 0, 0, index_of(reg));
+    emit8(0x0F);
+    emit8(0xC8 | (index_of(reg) & 7));
+}
+
+void X64Emitter::setcc(const Condition condition, const Reg reg) {
+    rex(false, 0, 0, index_of(reg), index_of(reg) >= 4);
+    emit8(0x0F);
+    emit8(0x90 | Common::underlying(condition));
+    modrm_reg(0, index_of(reg));
+}
+
+void X64Emitter::cmov(const Condition condition, const Reg dst, const Reg src) {
+    rex(true, index_of(dst), 0, index_of(src));
+    emit8(0x0F);
+    emit8(0x40 | Common::underlying(condition));
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::movdqu(const Xmm dst, const Mem& src) {
+    emit8(0xF3);
+    rex(false, index_of(dst), src.has_index ? index_of(src.index) : 0, index_of(src.base));
+    emit8(0x0F);
+    emit8(0x6F);
+    modrm_mem(index_of(dst), src);
+}
+
+void X64Emitter::movdqu(const Mem& dst, const Xmm src) {
+    emit8(0xF3);
+    rex(false, index_of(src), dst.has_index ? index_of(dst.index) : 0, index_of(dst.base));
+    emit8(0x0F);
+    emit8(0x7F);
+    modrm_mem(index_of(src), dst);
+}
+
+void X64Emitter::movdqa(const Xmm dst, const Xmm src) {
+    emit8(0x66);
+    rex(false, index_of(dst), 0, index_of(src));
+    emit8(0x0F);
+    emit8(0x6F);
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::sse(const SseOp op, const Xmm dst, const Xmm src) {
+    const u32 opcode = Common::underlying(op);
+    emit8(0x66);
+    rex(false, index_of(dst), 0, index_of(src));
+    if (opcode > 0xFFFF) {
+        emit8(static_cast<u8>(opcode >> 16));
+    }
+    emit8(static_cast<u8>(opcode >> 8));
+    emit8(static_cast<u8>(opcode));
+    modrm_reg(index_of(dst), index_of(src));
+}
+
+void X64Emitter::sse_shift(const SseShiftOp op, const Xmm reg, const u8 amount) {
+    emit8(0x66);
+    rex(false, 0, 0, index_of(reg));
+    emit8(0x0F);
+    emit8(0x71);
+    modrm_reg(Common::underlying(op), index_of(reg));
+    emit8(amount);
+}
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vector>
+#include "common/types.h"
+
+namespace JIT {
+
+enum class Reg : u8 {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+enum class Xmm : u8 {
+    XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+};
+
+// [base + index + disp]
+struct Mem {
+    Reg base;
+    s32 disp { 0 };
+    bool has_index { false };
+    Reg index { Reg::RAX };
+};
+
+enum class Condition : u8 {
+    Below = 0x2,
+    AboveOrEqual = 0x3,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    Sign = 0x8,
+    NotSign = 0x9,
+    Less = 0xC,
+    GreaterOrEqual = 0xD,
+    LessOrEqual = 0xE,
+    Greater = 0xF,
+};
+
+enum class AluOp : u8 {
+    Add = 0,
+    Or = 1,
+    And = 4,
+    Sub = 5,
+    Xor = 6,
+    Cmp = 7,
+};
+
+enum class ShiftOp : u8 {
+    Ror = 1,
+    Shl = 4,
+    Shr = 5,
+    Sar = 7,
+};
+
+// Packed integer SSE instructions, as their opcode bytes following the 0x66 prefix.
+enum class SseOp : u32 {
+    Punpcklwd = 0x0F61,
+    Pcmpgtw = 0x0F65,
+    Punpckhwd = 0x0F69,
+    Packssdw = 0x0F6B,
+    Pcmpeqw = 0x0F75,
+    Pmullw = 0x0FD5,
+    Pand = 0x0FDB,
+    Pandn = 0x0FDF,
+    Pmulhuw = 0x0FE4,
+    Pmulhw = 0x0FE5,
+    Por = 0x0FEB,
+    Pxor = 0x0FEF,
+    Psubw = 0x0FF9,
+    Paddw = 0x0FFD,
+    Pshufb = 0x0F3800,
+    Psignw = 0x0F3809,
+    // Takes its mask from XMM0.
+    Pblendvb = 0x0F3810,
+    Packusdw = 0x0F382B,
+    Pmaxuw = 0x0F383E,
+};
+
+enum class SseShiftOp : u8 {
+    Psrlw = 2,
+    Psraw = 4,
+    Psllw = 6,
+};
+
+// Minimal x86-64 encoder, covering only what the recompilers emit.
+class X64Emitter {
+public:
+    using Label = std::size_t;
+
+    const std::vector<u8>& code() const { return m_code; }
+
+    Label new_label();
+    void bind(Label label);
+    std::size_t offset_of(Label label) const { return m_label_offsets.at(label); }
+    // Resolves all jumps to their labels. Must be called once every label is bound.
+    void finalize();
+
+    void push(Reg reg);
+    void pop(Reg reg);
+    void ret();
+    void call(Reg reg);
+    void jmp(Reg reg);
+    void jmp(Label label);
+    void jcc(Condition condition, Label label);
+
+    void mov(Reg dst, Reg src);
+    void mov32(Reg dst, Reg src);
+    void mov(Reg dst, u64 imm);
+    void mov(Reg dst, const Mem& src);
+    void mov32(Reg dst, const Mem& src);
+    void mov(const Mem& dst, Reg src);
+    void mov(const Mem& dst, s32 imm);
+    void mov8(const Mem& dst, Reg src);
+    void mov16(const Mem& dst, Reg src);
+    void mov32(const Mem& dst, Reg src);
+
+    void movsx8(Reg dst, const Mem& src);
+    void movzx8(Reg dst, const Mem& src);
+    void movsx16(Reg dst, Reg src);
+    void movzx16(Reg dst, Reg src);
+    void movzx16(Reg dst, const Mem& src);
+    void movsxd(Reg dst, Reg src);
+    void movzx8(Reg dst, Reg src);
+
+    void alu(AluOp op, Reg dst, Reg src);
+    void alu32(AluOp op, Reg dst, Reg src);
+    void alu(AluOp op, Reg dst, s32 imm);
+    void alu32(AluOp op, Reg dst, s32 imm);
+    void cmp8(const Mem& dst, u8 imm);
+    void test8(Reg reg, u8 imm);
+    void test(Reg a, Reg b);
+    void not_(Reg reg);
+    void imul(Reg dst, Reg src);
+    // RDX:RAX = RAX * src
+    void mul128(Reg src);
+    void imul128(Reg src);
+
+    void shift(ShiftOp op, Reg reg, u8 amount);
+    void shift32(ShiftOp op, Reg reg, u8 amount);
+    void shift16(ShiftOp op, Reg reg, u8 amount);
+    void shift_cl(ShiftOp op, Reg reg);
+    void shift32_cl(ShiftOp op, Reg reg);
+
+    void bswap(Reg reg);
+    void bswap32(Reg reg);
+    void setcc(Condition condition, Reg reg);
+    void cmov(Condition condition, Reg dst, Reg src);
+
+    void movdqu(Xmm dst, const Mem& src);
+    void movdqu(const Mem& dst, Xmm src);
+    void movdqa(Xmm dst, Xmm src);
+    // dst = dst op src
+    void sse(SseOp op, Xmm dst, Xmm src);
+    void sse_shift(SseShiftOp op, Xmm reg, u8 amount);
+
+private:
+    std::vector<u8> m_code {};
+    std::vector<std::size_t> m_label_offsets {};
+
+    struct Fixup {
+        std::size_t offset;
+        Label label;
+    };
+    std::vector<Fixup> m_fixups {};
+
+    void emit8(u8 value) { m_code.push_back(value); }
+    void emit32(u32 value);
+    void emit64(u64 value);
+
+    void rex(bool w, u8 reg, u8 index, u8 base, bool force = false);
+    void rex(bool w, Reg reg, const Mem& mem, bool force = false);
+    void modrm_reg(u8 reg, u8 rm);
+    void modrm_mem(u8 reg, const Mem& mem);
+};
+
+}
@@ -1,21 +1,63 @@
+#include <charconv>
 #include <fmt/core.h>
 #include <vector>
+#include "frontend/emulation_speed.h"
 #include "frontend/frontend.h"
+#include "rsp.h"
+#include "vr4300.h"
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        fmt::print("usage: {} <pif> <gamepak>\n", argv[0]);
-        return 1;
-    }
-
     std::vector<std::string_view> args {};
+    CPUBackend cpu_backend = CPUBackend::Interpreter;
+    CacheEmulation cache_emulation = CacheEmulation::Disabled;
+    TaskEmulation task_emulation = TaskEmulation::LowLevel;
+    u32 rdp_thread_count = 0;
+    EmulationSpeed speed {};
+    bool speed_given = false;
+    bool valid_args = true;
+
     for (int i = 1; i < argc; i++) {
-        args.push_back(argv[i]);
+        const std::string_view arg = argv[i];
+        if (arg == "--cpu=interpreter") {
+            cpu_backend = CPUBackend::Interpreter;
+        } else if (arg == "--cpu=jit") {
+            cpu_backend = CPUBackend::JIT;
+        } else if (arg == "--emulate-caches") {
+            cache_emulation = CacheEmulation::Enabled;
+        } else if (arg == "--hle") {
+            task_emulation = TaskEmulation::HighLevel;
+        } else if (arg.starts_with("--rdp-threads=")) {
+            const std::string_view value = arg.substr(14);
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), rdp_thread_count);
+            valid_args &= (error == std::errc() && end == value.data() + value.size() && rdp_thread_count > 0);
+        } else if (arg.starts_with("--speed=")) {
+            const std::string_view value = arg.substr(8);
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), speed.multiplier);
+            valid_args &= (error == std::errc() && end == value.data() + value.size() && speed.multiplier > 0.0);
+            speed_given = true;
+        } else if (arg == "--uncapped") {
+            speed.uncapped = true;
+            speed_given = true;
+        } else if (arg.starts_with("--")) {
+            valid_args = false;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (!valid_args || args.size() != 2) {
+        fmt::print("usage: {} [--cpu=interpreter|jit] [--emulate-caches] [--hle] [--rdp-threads=<count>] "
+                   "[--speed=<multiplier>] [--uncapped] <pif> <gamepak>\n",
+                   argv[0]);
+        return 1;
     }
 
 #ifdef FOURIXTYS_FRONTEND_SDL
-    return main_SDL(args);
+    return main_SDL(args, cpu_backend, cache_emulation, task_emulation, rdp_thread_count, speed);
 #else
-    return main_headless(args);
+    if (speed_given) {
+        fmt::print("warning: the headless frontend always runs uncapped, ignoring --speed and --uncapped\n");
+    }
+    return main_headless(args, cpu_backend, cache_emulation, task_emulation, rdp_thread_count);
 #endif
 }
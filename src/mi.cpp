@@ -43,9 +43,6 @@ void MI::set_interrupt_mask_impl(const u32 value) {
 
     if constexpr (I % 2 == 0) {
         Common::disable_bits<I / 2>(m_interrupt_mask);
-        if constexpr (I == 6) {
-            m_vr4300.cop0().disable_cause_ip_bit<2>();
-        }
     } else {
         Common::enable_bits<I / 2>(m_interrupt_mask);
     }
@@ -72,4 +69,14 @@ void MI::set_interrupt_mask(const u32 value) {
     [this, value]<std::size_t... I>(std::index_sequence<I...>) {
         (set_interrupt_mask_impl<I>(value), ...);
     }(std::make_index_sequence<Iterations>{});
+
+    update_cause_ip();
+}
+
+void MI::update_cause_ip() {
+    if ((m_interrupt & m_interrupt_mask) != 0) {
+        m_vr4300.cop0().enable_cause_ip_bit<2>();
+    } else {
+        m_vr4300.cop0().disable_cause_ip_bit<2>();
+    }
 }
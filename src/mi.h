@@ -17,8 +17,15 @@ public:
         DP,
     };
 
-    void cancel_interrupt(const InterruptFlags flags) { m_interrupt &= ~(1 << Common::underlying(flags)); }
-    void request_interrupt(const InterruptFlags flags) { m_interrupt |= (1 << Common::underlying(flags)); }
+    void cancel_interrupt(const InterruptFlags flags) {
+        m_interrupt &= ~(1 << Common::underlying(flags));
+        update_cause_ip();
+    }
+
+    void request_interrupt(const InterruptFlags flags) {
+        m_interrupt |= (1 << Common::underlying(flags));
+        update_cause_ip();
+    }
 
     [[nodiscard]] u32 mode() const { return m_mode.raw; }
     void set_mode(u32 value);
@@ -35,6 +42,9 @@ private:
     template <std::size_t I>
     void set_interrupt_mask_impl(u32 value);
 
+    // Keeps the VR4300's IP2 line in sync with the pending, unmasked MI interrupts.
+    void update_cause_ip();
+
     union {
         u32 raw {};
         struct {
@@ -1,3 +1,4 @@
+#include <new>
 #include "common/bits.h"
 #include "common/logging.h"
 #include "mmu.h"
@@ -37,6 +38,14 @@ static constexpr u32 SP_REG_PC                 = 0x04080000;
 static constexpr u32 SP_REGISTERS_END          = 0x040FFFFF;
 
 static constexpr u32 DP_COMMAND_REGISTERS_BASE = 0x04100000;
+static constexpr u32 DP_REG_START              = 0x04100000;
+static constexpr u32 DP_REG_END                = 0x04100004;
+static constexpr u32 DP_REG_CURRENT            = 0x04100008;
+static constexpr u32 DP_REG_STATUS             = 0x0410000C;
+static constexpr u32 DP_REG_CLOCK              = 0x04100010;
+static constexpr u32 DP_REG_BUFBUSY            = 0x04100014;
+static constexpr u32 DP_REG_PIPEBUSY           = 0x04100018;
+static constexpr u32 DP_REG_TMEM               = 0x0410001C;
 static constexpr u32 DP_COMMAND_REGISTERS_END  = 0x041FFFFF;
 
 static constexpr u32 DP_SPAN_REGISTERS_BASE    = 0x04200000;
@@ -75,6 +84,8 @@ static constexpr u32 PI_REG_DMA_CART_ADDRESS   = 0x04600004;
 static constexpr u32 PI_REG_DMA_READ_LENGTH    = 0x04600008;
 static constexpr u32 PI_REG_DMA_WRITE_LENGTH   = 0x0460000C;
 static constexpr u32 PI_REG_STATUS             = 0x04600010;
+static constexpr u32 PI_REG_BSD_DOM1_LAT       = 0x04600014;
+static constexpr u32 PI_REG_BSD_DOM2_RLS       = 0x04600030;
 static constexpr u32 PI_REGISTERS_END          = 0x046FFFFF;
 
 static constexpr u32 RI_REGISTERS_BASE         = 0x04700000;
@@ -99,7 +110,125 @@ static constexpr u32 PIF_BOOTROM_END           = 0x1FC007BF;
 static constexpr u32 PIF_RAM_BASE              = 0x1FC007C0;
 static constexpr u32 PIF_RAM_END               = 0x1FC007FF;
 
-MMU::MMU(N64& system) : m_system(system), m_pi(*this), m_mi(system.vr4300()), m_si(*this) {}
+// Layout of RDRAM and the SP memories within MMU::m_memory.
+static constexpr u32 RDRAM_MEMORY_OFFSET       = 0x00000000;
+static constexpr u32 SP_DMEM_MEMORY_OFFSET     = 0x00400000;
+static constexpr u32 SP_IMEM_MEMORY_OFFSET     = 0x00401000;
+static constexpr u32 MEMORY_SIZE               = 0x00402000;
+
+MMU::MMU(N64& system) : m_system(system), m_pi(system), m_mi(system.vr4300()), m_si(*this, system.scheduler()),
+                        m_memory(MEMORY_SIZE),
+                        m_rdram(*new (m_memory.data() + RDRAM_MEMORY_OFFSET) std::array<u8, 0x400000> {}),
+                        m_sp_dmem(*new (m_memory.data() + SP_DMEM_MEMORY_OFFSET) std::array<u8, 0x1000> {}),
+                        m_sp_imem(*new (m_memory.data() + SP_IMEM_MEMORY_OFFSET) std::array<u8, 0x1000> {}),
+                        m_read_pages(PageCount), m_write_pages(PageCount) {
+    map_pages(RDRAM_BUILTIN_BASE, m_rdram.size(), m_rdram.data(), m_rdram.data());
+    map_pages(SP_DMEM_BASE, m_sp_dmem.size(), m_sp_dmem.data(), m_sp_dmem.data());
+    map_pages(SP_IMEM_BASE, m_sp_imem.size(), m_sp_imem.data(), m_sp_imem.data());
+
+    // A partial last page is left to the slow path, so that reads never run past the end of the ROM.
+    const std::span<const u8> rom = m_system.gamepak().rom();
+    m_rom_begin = rom.data();
+    m_rom_end = rom.data() + rom.size();
+    map_pages(0x10000000, rom.size() & ~PageMask, rom.data(), nullptr);
+}
+
+void MMU::map_pages(const u32 physical_address, const u32 size, const u8* read_memory, u8* write_memory) {
+    for (u32 offset = 0; offset < size; offset += PageSize) {
+        const u32 page = page_index(physical_address + offset);
+        m_read_pages[page] = read_memory + offset;
+        m_write_pages[page] = write_memory ? (write_memory + offset) : nullptr;
+    }
+}
+
+void MMU::set_rdram_page_write_protected(const u32 physical_address, const bool write_protected) {
+    const u32 page_address = physical_address & ~PageMask;
+    if (m_code_protected_rdram_pages[page_address >> PageShift] == write_protected) {
+        return;
+    }
+
+    m_code_protected_rdram_pages[page_address >> PageShift] = write_protected;
+    update_rdram_page(page_address);
+    update_fastmem_rdram_protection(page_address, PageSize);
+}
+
+void MMU::unprotect_rdram() {
+    m_code_protected_rdram_pages.fill(false);
+    for (u32 page_address = 0; page_address < m_rdram.size(); page_address += PageSize) {
+        update_rdram_page(page_address);
+    }
+
+    update_fastmem_rdram_protection(RDRAM_BUILTIN_BASE, m_rdram.size());
+}
+
+void MMU::set_rdram_rdp_protected(const u32 begin, const u32 end, const bool rdp_protected) {
+    const u32 first_page = begin & ~PageMask;
+    const u32 last_end = std::min<u32>(end, m_rdram.size());
+    if (first_page >= last_end) {
+        return;
+    }
+
+    for (u32 page_address = first_page; page_address < last_end; page_address += PageSize) {
+        m_rdp_protected_rdram_pages[page_address >> PageShift] = rdp_protected;
+        update_rdram_page(page_address);
+    }
+
+    update_fastmem_rdram_protection(first_page, last_end - first_page);
+}
+
+void MMU::update_rdram_page(const u32 page_address) {
+    const u32 page = page_address >> PageShift;
+    const bool readable = !m_rdp_protected_rdram_pages[page];
+    const bool writable = readable && !m_code_protected_rdram_pages[page];
+    m_read_pages[page_index(RDRAM_BUILTIN_BASE + page_address)] = readable ? &m_rdram[page_address] : nullptr;
+    m_write_pages[page_index(RDRAM_BUILTIN_BASE + page_address)] = writable ? &m_rdram[page_address] : nullptr;
+}
+
+bool MMU::map_fastmem(u8* arena) {
+    for (const u32 segment_base : { KSEG0_BASE, KSEG1_BASE }) {
+        if (!m_memory.map_view(arena + segment_base + RDRAM_BUILTIN_BASE, RDRAM_MEMORY_OFFSET, m_rdram.size()) ||
+            !m_memory.map_view(arena + segment_base + SP_DMEM_BASE, SP_DMEM_MEMORY_OFFSET, m_sp_dmem.size()) ||
+            !m_memory.map_view(arena + segment_base + SP_IMEM_BASE, SP_IMEM_MEMORY_OFFSET, m_sp_imem.size())) {
+            return false;
+        }
+    }
+
+    m_fastmem_arena = arena;
+    update_fastmem_rdram_protection(RDRAM_BUILTIN_BASE, m_rdram.size());
+    return true;
+}
+
+void MMU::update_fastmem_rdram_protection(const u32 physical_address, const u32 size) {
+    if (!m_fastmem_arena) {
+        return;
+    }
+
+    using Access = Common::SharedMemory::Access;
+    const auto page_access = [&](const u32 page_address) {
+        const u32 page = page_index(RDRAM_BUILTIN_BASE + page_address);
+        if (!m_read_pages[page]) {
+            return Access::None;
+        }
+        return m_write_pages[page] ? Access::ReadWrite : Access::Read;
+    };
+
+    // Runs of pages with the same access are changed at once.
+    const u32 end = ((physical_address + size + PageMask) & ~PageMask);
+    u32 run_begin = physical_address & ~PageMask;
+    while (run_begin < end) {
+        const Access access = page_access(run_begin);
+        u32 run_end = run_begin + PageSize;
+        while (run_end < end && page_access(run_end) == access) {
+            run_end += PageSize;
+        }
+
+        for (const u32 segment_base : { KSEG0_BASE, KSEG1_BASE }) {
+            const bool success = Common::SharedMemory::set_view_access(m_fastmem_arena + segment_base + run_begin, run_end - run_begin, access);
+            ASSERT_MSG(success, "Failed to change the protection of fastmem RDRAM at 0x{:08X}", run_begin);
+        }
+        run_begin = run_end;
+    }
+}
 
 constexpr MMU::AddressRanges MMU::address_range(const u32 virtual_address) {
     if (virtual_address < KSEG0_BASE) {
@@ -124,50 +253,27 @@ constexpr MMU::AddressRanges MMU::address_range(const u32 virtual_address) {
 constexpr u32 MMU::virtual_address_to_physical_address(const u32 virtual_address) {
     const AddressRanges range = address_range(virtual_address);
     switch (range) {
-        case AddressRanges::User:
-            return virtual_address - KUSEG_BASE;
         case AddressRanges::Kernel0:
             return virtual_address - KSEG0_BASE;
         case AddressRanges::Kernel1:
             return virtual_address - KSEG1_BASE;
+        case AddressRanges::User:
         case AddressRanges::KernelSupervisor:
-            return virtual_address - KSSEG_BASE;
         case AddressRanges::Kernel3:
-            return virtual_address - KSEG3_BASE;
+            UNREACHABLE_MSG("TLB-mapped address 0x{:08X} reached the MMU", virtual_address);
         default:
             UNREACHABLE_MSG("Unreachable address range {}", Common::underlying(range));
     }
 }
 
 template <typename T>
-T MMU::read(const u32 address) {
+T MMU::read_slow(const u32 address) {
     switch (address) {
-        case RDRAM_BUILTIN_BASE ... RDRAM_BUILTIN_END:
-            if constexpr (Common::TypeIsSame<T, u8>) {
-                return m_rdram.at(address - RDRAM_BUILTIN_BASE);
-            } else if constexpr (Common::TypeIsSame<T, u16>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                return m_rdram.at(idx + 0) << 8 |
-                       m_rdram.at(idx + 1) << 0;
-            } else if constexpr (Common::TypeIsSame<T, u32>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                return m_rdram.at(idx + 0) << 24 |
-                       m_rdram.at(idx + 1) << 16 |
-                       m_rdram.at(idx + 2) << 8  |
-                       m_rdram.at(idx + 3) << 0;
-            } else if constexpr (Common::TypeIsSame<T, u64>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                return u64(m_rdram.at(idx + 0)) << 56 |
-                       u64(m_rdram.at(idx + 1)) << 48 |
-                       u64(m_rdram.at(idx + 2)) << 40 |
-                       u64(m_rdram.at(idx + 3)) << 32 |
-                       u64(m_rdram.at(idx + 4)) << 24 |
-                       u64(m_rdram.at(idx + 5)) << 16 |
-                       u64(m_rdram.at(idx + 6)) << 8  |
-                       u64(m_rdram.at(idx + 7)) << 0;
-            } else {
-                UNIMPLEMENTED_MSG("Unrecognized read{} from rdram builtin", Common::TypeSizeInBits<T>);
-            }
+        // Accesses that would run past the end of RDRAM fall outside the case range, so it is the only bounds check.
+        case RDRAM_BUILTIN_BASE ... RDRAM_BUILTIN_END + 1 - sizeof(T):
+            // Pages the RDP is still drawing to are read-protected, and come through here.
+            m_system.rdp().wait_for_writes(address - RDRAM_BUILTIN_BASE, address - RDRAM_BUILTIN_BASE + sizeof(T));
+            return Common::read_big_endian<T>(&m_rdram[address - RDRAM_BUILTIN_BASE]);
 
         case SP_DMEM_BASE ... SP_DMEM_END:
             if constexpr (Common::TypeIsSame<T, u32>) {
@@ -215,6 +321,10 @@ T MMU::read(const u32 address) {
 
         case SP_REGISTERS_BASE ... SP_REGISTERS_END:
             switch (address) {
+                case SP_REG_SPADDR:
+                    return m_system.rsp().dma_sp_address();
+                case SP_REG_RAMADDR:
+                    return m_system.rsp().dma_dram_address();
                 case SP_REG_STATUS:
                     return m_system.rsp().status();
                 case SP_REG_DMA_FULL:
@@ -230,6 +340,27 @@ T MMU::read(const u32 address) {
                     return T(-1);
             }
 
+        case DP_COMMAND_REGISTERS_BASE ... DP_COMMAND_REGISTERS_END:
+            switch (address) {
+                case DP_REG_START:
+                    return m_system.rdp().start();
+                case DP_REG_END:
+                    return m_system.rdp().end();
+                case DP_REG_CURRENT:
+                    return m_system.rdp().current();
+                case DP_REG_STATUS:
+                    return m_system.rdp().status();
+                case DP_REG_CLOCK:
+                case DP_REG_BUFBUSY:
+                case DP_REG_PIPEBUSY:
+                case DP_REG_TMEM:
+                    // The RDP finishes everything immediately, so its counters never run.
+                    return 0;
+                default:
+                    LERROR("Unrecognized read{} from DP register 0x{:08X}", Common::TypeSizeInBits<T>, address);
+                    return T(-1);
+            }
+
         case PI_REGISTERS_BASE ... PI_REGISTERS_END:
             switch (address) {
                 case PI_REG_DRAM_ADDRESS:
@@ -242,6 +373,8 @@ T MMU::read(const u32 address) {
                     return 0x7F;
                 case PI_REG_STATUS:
                     return m_pi.status();
+                case PI_REG_BSD_DOM1_LAT ... PI_REG_BSD_DOM2_RLS + 3:
+                    return m_pi.domain_register(address - PI_REG_BSD_DOM1_LAT);
                 default:
                     LERROR("Unrecognized read{} from PI register 0x{:08X}", Common::TypeSizeInBits<T>, address);
                     return T(-1);
@@ -276,7 +409,7 @@ T MMU::read(const u32 address) {
                 UNIMPLEMENTED_MSG("Unrecognized read{} from PIF RAM", Common::TypeSizeInBits<T>);
             }
 
-        case 0x80000000 ... 0xFFFFFFFF:
+        case KSEG0_BASE ... KSSEG_BASE - 1:
             return read<T>(virtual_address_to_physical_address(address));
 
         default:
@@ -286,38 +419,15 @@ T MMU::read(const u32 address) {
 }
 
 template <typename T>
-void MMU::write(const u32 address, const T value) {
+void MMU::write_slow(const u32 address, const T value) {
     switch (address) {
-        case RDRAM_BUILTIN_BASE ... RDRAM_BUILTIN_END:
-            if constexpr (Common::TypeIsSame<T, u8>) {
-                m_rdram.at(address - RDRAM_BUILTIN_BASE) = value;
-                return;
-            } else if constexpr (Common::TypeIsSame<T, u16>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                m_rdram.at(idx + 0) = static_cast<u8>(Common::bit_range<15, 8>(value));
-                m_rdram.at(idx + 1) = static_cast<u8>(Common::bit_range<7, 0>(value));
-                return;
-            } else if constexpr (Common::TypeIsSame<T, u32>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                m_rdram.at(idx + 0) = static_cast<u8>(Common::bit_range<31, 24>(value));
-                m_rdram.at(idx + 1) = static_cast<u8>(Common::bit_range<23, 16>(value));
-                m_rdram.at(idx + 2) = static_cast<u8>(Common::bit_range<15, 8>(value));
-                m_rdram.at(idx + 3) = static_cast<u8>(Common::bit_range<7, 0>(value));
-                return;
-            } else if constexpr (Common::TypeIsSame<T, u64>) {
-                const u32 idx = address - RDRAM_BUILTIN_BASE;
-                m_rdram.at(idx + 0) = static_cast<u8>(Common::bit_range<63, 56>(value));
-                m_rdram.at(idx + 1) = static_cast<u8>(Common::bit_range<55, 48>(value));
-                m_rdram.at(idx + 2) = static_cast<u8>(Common::bit_range<47, 40>(value));
-                m_rdram.at(idx + 3) = static_cast<u8>(Common::bit_range<39, 32>(value));
-                m_rdram.at(idx + 4) = static_cast<u8>(Common::bit_range<31, 24>(value));
-                m_rdram.at(idx + 5) = static_cast<u8>(Common::bit_range<23, 16>(value));
-                m_rdram.at(idx + 6) = static_cast<u8>(Common::bit_range<15, 8>(value));
-                m_rdram.at(idx + 7) = static_cast<u8>(Common::bit_range<7, 0>(value));
-                return;
-            } else {
-                UNIMPLEMENTED_MSG("Unimplemented write{} 0x{:08X} to rdram builtin", Common::TypeSizeInBits<T>, value);
-            }
+        case RDRAM_BUILTIN_BASE ... RDRAM_BUILTIN_END + 1 - sizeof(T):
+            // Pages the RDP is still drawing to are protected against writes as well, so that the store lands after
+            // the RDP's and never races it.
+            m_system.rdp().wait_for_writes(address - RDRAM_BUILTIN_BASE, address - RDRAM_BUILTIN_BASE + sizeof(T));
+            m_system.vr4300().invalidate_code(address);
+            Common::write_big_endian<T>(&m_rdram[address - RDRAM_BUILTIN_BASE], value);
+            return;
 
         case SP_DMEM_BASE ... SP_DMEM_END:
             if constexpr (Common::TypeIsSame<T, u8>) {
@@ -348,6 +458,18 @@ void MMU::write(const u32 address, const T value) {
 
         case SP_REGISTERS_BASE ... SP_REGISTERS_END:
             switch (address) {
+                case SP_REG_SPADDR:
+                    m_system.rsp().set_dma_sp_address(value);
+                    return;
+                case SP_REG_RAMADDR:
+                    m_system.rsp().set_dma_dram_address(value);
+                    return;
+                case SP_REG_RDLEN:
+                    m_system.rsp().set_dma_read_length(value);
+                    return;
+                case SP_REG_WRLEN:
+                    m_system.rsp().set_dma_write_length(value);
+                    return;
                 case SP_REG_STATUS:
                     m_system.rsp().set_status(value);
                     return;
@@ -359,6 +481,22 @@ void MMU::write(const u32 address, const T value) {
                     return;
             }
 
+        case DP_COMMAND_REGISTERS_BASE ... DP_COMMAND_REGISTERS_END:
+            switch (address) {
+                case DP_REG_START:
+                    m_system.rdp().set_start(value);
+                    return;
+                case DP_REG_END:
+                    m_system.rdp().set_end(value);
+                    return;
+                case DP_REG_STATUS:
+                    m_system.rdp().set_status(value);
+                    return;
+                default:
+                    LERROR("Unrecognized write{} 0x{:08X} to DP register 0x{:08X}", Common::TypeSizeInBits<T>, value, address);
+                    return;
+            }
+
         case MI_REGISTERS_BASE ... MI_REGISTERS_END:
             switch (address) {
                 case MI_REG_MODE:
@@ -388,7 +526,9 @@ void MMU::write(const u32 address, const T value) {
                     return;
                 case VI_REG_V_CURRENT:
                     m_mi.cancel_interrupt(MI::InterruptFlags::VI);
-                    m_system.vr4300().cop0().set_cause_ip(m_mi.interrupt() & m_mi.interrupt_mask());
+                    return;
+                case VI_REG_H_START:
+                    m_vi.set_hstart(static_cast<u32>(value));
                     return;
                 case VI_REG_V_START:
                     m_vi.set_vstart(static_cast<u32>(value));
@@ -412,6 +552,9 @@ void MMU::write(const u32 address, const T value) {
                 case PI_REG_DMA_CART_ADDRESS:
                     m_pi.set_dma_cart_address(value);
                     return;
+                case PI_REG_DMA_READ_LENGTH:
+                    m_pi.set_dma_read_length(value);
+                    return;
                 case PI_REG_DMA_WRITE_LENGTH:
                     m_pi.set_dma_write_length(value);
                     return;
@@ -423,6 +566,9 @@ void MMU::write(const u32 address, const T value) {
                         m_pi.reset();
                     }
                     return;
+                case PI_REG_BSD_DOM1_LAT ... PI_REG_BSD_DOM2_RLS + 3:
+                    m_pi.set_domain_register(address - PI_REG_BSD_DOM1_LAT, value);
+                    return;
                 default:
                     LERROR("Unrecognized write{} 0x{:08X} to PI register 0x{:08X}", Common::TypeSizeInBits<T>, value, address);
                     return;
@@ -482,7 +628,7 @@ void MMU::write(const u32 address, const T value) {
                 return;
             }
 
-        case 0x80000000 ... 0xFFFFFFFF:
+        case KSEG0_BASE ... KSSEG_BASE - 1:
             write<T>(virtual_address_to_physical_address(address), value);
             return;
 
@@ -492,34 +638,11 @@ void MMU::write(const u32 address, const T value) {
     }
 }
 
-u8 MMU::read8(const u32 address) {
-    return read<u8>(address);
-}
-
-void MMU::write8(const u32 address, const u8 value) {
-    write<u8>(address, value);
-}
-
-u16 MMU::read16(const u32 address) {
-    return read<u16>(address);
-}
-
-void MMU::write16(const u32 address, const u16 value) {
-    write<u16>(address, value);
-}
-
-u32 MMU::read32(const u32 address) {
-    return read<u32>(address);
-}
-
-void MMU::write32(const u32 address, const u32 value) {
-    write<u32>(address, value);
-}
-
-u64 MMU::read64(const u32 address) {
-    return read<u64>(address);
-}
-
-void MMU::write64(const u32 address, const u64 value) {
-    write<u64>(address, value);
-}
+template u8 MMU::read_slow<u8>(u32 address);
+template u16 MMU::read_slow<u16>(u32 address);
+template u32 MMU::read_slow<u32>(u32 address);
+template u64 MMU::read_slow<u64>(u32 address);
+template void MMU::write_slow<u8>(u32 address, u8 value);
+template void MMU::write_slow<u16>(u32 address, u16 value);
+template void MMU::write_slow<u32>(u32 address, u32 value);
+template void MMU::write_slow<u64>(u32 address, u64 value);
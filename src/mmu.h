@@ -1,6 +1,10 @@
 #pragma once
 
 #include <array>
+#include <vector>
+#include "common/bits.h"
+#include "common/defines.h"
+#include "common/shared_memory.h"
 #include "common/types.h"
 #include "mi.h"
 #include "pi.h"
@@ -24,26 +28,73 @@ public:
     static constexpr AddressRanges address_range(u32 address);
     static constexpr u32 virtual_address_to_physical_address(u32 address);
 
-    u8 read8(u32 address);
-    void write8(u32 address, u8 value);
-    u16 read16(u32 address);
-    void write16(u32 address, u16 value);
-    u32 read32(u32 address);
-    void write32(u32 address, u32 value);
-    u64 read64(u32 address);
-    void write64(u32 address, u64 value);
+    // Accesses take physical addresses, or KSEG0/KSEG1 addresses. The VR4300 translates the other segments itself.
+    u8 read8(const u32 address) { return read<u8>(address); }
+    void write8(const u32 address, const u8 value) { write<u8>(address, value); }
+    u16 read16(const u32 address) { return read<u16>(address); }
+    void write16(const u32 address, const u16 value) { write<u16>(address, value); }
+    u32 read32(const u32 address) { return read<u32>(address); }
+    void write32(const u32 address, const u32 value) { write<u32>(address, value); }
+    u64 read64(const u32 address) { return read<u64>(address); }
+    void write64(const u32 address, const u64 value) { write<u64>(address, value); }
 
     template <typename T>
-    T read(u32 address);
+    ALWAYS_INLINE T read(const u32 address) {
+        const u8* page = is_paged_segment(address) ? m_read_pages[page_index(address)] : nullptr;
+        const u32 offset = address & PageMask;
+        if (page && offset <= PageSize - sizeof(T)) [[likely]] {
+            // 16-bit cartridge reads have a quirk of their own, see GamePak::read().
+            if constexpr (sizeof(T) == 2) {
+                if (page >= m_rom_begin && page < m_rom_end) {
+                    return read_slow<T>(address);
+                }
+            }
+
+            return Common::read_big_endian<T>(page + offset);
+        }
+
+        return read_slow<T>(address);
+    }
+
     template <typename T>
-    void write(u32 address, T value);
+    ALWAYS_INLINE void write(const u32 address, const T value) {
+        u8* page = is_paged_segment(address) ? m_write_pages[page_index(address)] : nullptr;
+        const u32 offset = address & PageMask;
+        if (page && offset <= PageSize - sizeof(T)) [[likely]] {
+            Common::write_big_endian<T>(page + offset, value);
+            return;
+        }
+
+        write_slow<T>(address, value);
+    }
+
+    // RDRAM pages holding code are write-protected, so that writes to them reach VR4300::invalidate_code().
+    void set_rdram_page_write_protected(u32 physical_address, bool write_protected);
+    // Only lifts write protection.
+    void unprotect_rdram();
+    // RDRAM the RDP is still drawing to is read- and write-protected, so that accesses to it reach
+    // RDP::wait_for_writes().
+    void set_rdram_rdp_protected(u32 begin, u32 end, bool rdp_protected);
+
+    // Mirrors RDRAM and the SP memories at their KSEG0 and KSEG1 addresses within a 4 GiB host reservation, keeping
+    // protected pages protected there as well. Returns false if the host cannot map memory twice.
+    bool map_fastmem(u8* arena);
+    void unmap_fastmem() { m_fastmem_arena = nullptr; }
 
+    PI& pi() { return m_pi; }
+    const PI& pi() const { return m_pi; }
     MI& mi() { return m_mi; }
     const MI& mi() const { return m_mi; }
     VI& vi() { return m_vi; }
     const VI& vi() const { return m_vi; }
+    SI& si() { return m_si; }
+    const SI& si() const { return m_si; }
 
+    auto& rdram() { return m_rdram; }
     const auto& rdram() const { return m_rdram; }
+    auto& sp_dmem() { return m_sp_dmem; }
+    auto& sp_imem() { return m_sp_imem; }
+    const auto& sp_imem() const { return m_sp_imem; }
     auto& pif_ram() { return m_pif_ram; }
 
 private:
@@ -53,9 +104,45 @@ private:
     VI m_vi;
     SI m_si;
 
-    std::array<u8, 0x400000> m_rdram {};
-    std::array<u8, 0x1000> m_sp_dmem {};
-    std::array<u8, 0x1000> m_sp_imem {};
+    // RDRAM and the SP memories live in shared memory, so that they can be mirrored into a fastmem arena.
+    Common::SharedMemory m_memory;
+    std::array<u8, 0x400000>& m_rdram;
+    std::array<u8, 0x1000>& m_sp_dmem;
+    std::array<u8, 0x1000>& m_sp_imem;
+    u8* m_fastmem_arena { nullptr };
+
     std::array<u8, 0x200> m_isviewer_buffer {};
     std::array<u8, 0x40> m_pif_ram {};
+
+    // Memory without side effects is mapped straight into these tables, indexed by physical page. Physical addresses
+    // and KSEG0/KSEG1 share them, as all three see the same 512 MiB, and other segments always take the slow path.
+    // Everything else (MMIO, PIF RAM, partial ROM pages, protected RDRAM pages) has a null entry and goes through
+    // the slow path.
+    static constexpr u32 PageShift = 12;
+    static constexpr u32 PageSize = 1 << PageShift;
+    static constexpr u32 PageMask = PageSize - 1;
+    static constexpr u32 PhysicalMask = 0x1FFFFFFF;
+    static constexpr std::size_t PageCount = std::size_t(PhysicalMask + 1) >> PageShift;
+    // One bit per 512 MiB segment: physical addresses below 0x20000000, KSEG0 and KSEG1.
+    static constexpr u32 PagedSegments = 0b00110001;
+    static ALWAYS_INLINE bool is_paged_segment(const u32 address) { return (PagedSegments >> (address >> 29)) & 1; }
+    static ALWAYS_INLINE u32 page_index(const u32 address) { return (address & PhysicalMask) >> PageShift; }
+    std::vector<const u8*> m_read_pages;
+    std::vector<u8*> m_write_pages;
+    // Why each RDRAM page is left to the slow path, if it is.
+    std::array<bool, 0x400000 / PageSize> m_code_protected_rdram_pages {};
+    std::array<bool, 0x400000 / PageSize> m_rdp_protected_rdram_pages {};
+    const u8* m_rom_begin { nullptr };
+    const u8* m_rom_end { nullptr };
+
+    void map_pages(u32 physical_address, u32 size, const u8* read_memory, u8* write_memory);
+    // Maps or unmaps an RDRAM page according to its protection.
+    void update_rdram_page(u32 page_address);
+    // Brings the protection of fastmem RDRAM in line with the page tables.
+    void update_fastmem_rdram_protection(u32 physical_address, u32 size);
+
+    template <typename T>
+    T read_slow(u32 address);
+    template <typename T>
+    void write_slow(u32 address, T value);
 };
@@ -1,42 +1,82 @@
-#include "frontend/frontend.h"
 #include "n64.h"
 
-static constexpr u32 CyclesPerSecond = 93'750'000;
-static constexpr u32 CyclesPerFrame = CyclesPerSecond / 60;
-static constexpr u32 CyclesPerHalfline = CyclesPerFrame / 512 / 2;
+static constexpr u32 CyclesPerHalfline = N64::CyclesPerFrame / 512 / 2;
 
-void N64::run() {
-    if (m_vr4300.cop0().should_service_interrupt()) {
-        m_vr4300.throw_exception(VR4300::ExceptionCodes::Interrupt);
-    }
+// The RSP is clocked at 62.5MHz, two thirds of the VR4300's 93.75MHz.
+static constexpr u32 RSPCyclesPerCPUCycleNumerator = 2;
+static constexpr u32 RSPCyclesPerCPUCycleDenominator = 3;
 
-    m_vr4300.step();
-    if (!m_rsp.halted()) {
-        m_rsp.step();
-    }
+N64::N64(PIF& pif, GamePak& gamepak, const CPUBackend cpu_backend, const CacheEmulation cache_emulation,
+         const TaskEmulation task_emulation, const u32 rdp_thread_count)
+    : m_pif(pif), m_gamepak(gamepak), m_mmu(*this), m_rsp(*this, cpu_backend, task_emulation), m_rdp(*this, rdp_thread_count),
+      m_vr4300(*this, cpu_backend, cache_emulation) {
+    m_scheduler.schedule(Scheduler::EventType::VIHalfline, CyclesPerHalfline);
+    m_scheduler.schedule(Scheduler::EventType::Frame, CyclesPerFrame);
+}
 
-    // FIXME: Get the number of cycles spent from VR4300
-    static constexpr u32 CyclesStub = 3;
-    m_scanline_cycles += CyclesStub;
-    m_frame_cycles += CyclesStub;
-    m_vr4300.cop0().increment_cycle_count(CyclesStub);
+void N64::run_for(const u64 cycles) {
+    const u64 end_timestamp = m_scheduler.timestamp() + cycles;
 
-    if (m_scanline_cycles >= CyclesPerHalfline) {
-        m_scanline_cycles -= CyclesPerHalfline;
-        m_mmu.vi().bump_current_line();
-    }
+    // The CPU runs in slices bounded by the next scheduled event, the RSP catches up after each slice.
+    while (m_scheduler.timestamp() < end_timestamp) {
+        const u64 cpu_cycles = m_vr4300.run(end_timestamp - m_scheduler.timestamp());
+        run_rsp(cpu_cycles);
 
-    if (const auto& mi = m_mmu.mi(); (mi.interrupt() & mi.interrupt_mask()) != 0) {
-        m_vr4300.cop0().enable_cause_ip_bit<2>();
+        while (const auto event = m_scheduler.pop_pending_event()) {
+            handle_event(*event);
+        }
     }
+}
 
-    if (const auto& vi = m_mmu.vi(); vi.current_line() == vi.interrupt_line()) {
-        m_mmu.mi().request_interrupt(MI::InterruptFlags::VI);
+void N64::run_rsp(const u64 cpu_cycles) {
+    if (m_rsp.halted()) {
+        m_rsp_cycle_remainder = 0;
+        return;
     }
 
-    if (m_frame_cycles >= CyclesPerFrame) {
-        m_frame_cycles -= CyclesPerFrame;
-        render_screen(*this);
-        handle_frontend_events();
+    const u64 thirds = m_rsp_cycle_remainder + cpu_cycles * RSPCyclesPerCPUCycleNumerator;
+    m_rsp_cycle_remainder = thirds % RSPCyclesPerCPUCycleDenominator;
+    m_rsp.run(thirds / RSPCyclesPerCPUCycleDenominator);
+}
+
+void N64::handle_event(const Scheduler::Event& event) {
+    switch (event.type) {
+        case Scheduler::EventType::VIHalfline: {
+            auto& vi = m_mmu.vi();
+            vi.bump_current_line();
+            if (vi.current_line() == vi.interrupt_line()) {
+                m_mmu.mi().request_interrupt(MI::InterruptFlags::VI);
+            }
+
+            m_scheduler.schedule_at(Scheduler::EventType::VIHalfline, event.timestamp + CyclesPerHalfline);
+            return;
+        }
+
+        case Scheduler::EventType::Frame:
+            // Scanout reads whatever the VI origin points at.
+            m_rdp.sync();
+            m_vi_scanout.capture(m_mmu.vi(), m_mmu.rdram());
+
+            m_scheduler.schedule_at(Scheduler::EventType::Frame, event.timestamp + CyclesPerFrame);
+            return;
+
+        case Scheduler::EventType::PIDMAComplete:
+            m_mmu.pi().finish_dma_transfer();
+            return;
+
+        case Scheduler::EventType::SIDMAComplete:
+            m_mmu.si().finish_dma_transfer();
+            return;
+
+        case Scheduler::EventType::COP0Compare:
+            m_vr4300.cop0().handle_compare_event();
+            return;
+
+        case Scheduler::EventType::RDPSyncFull:
+            m_rdp.finish_sync_full();
+            return;
+
+        default:
+            UNREACHABLE_MSG("Unhandled scheduler event {}", Common::underlying(event.type));
     }
 }
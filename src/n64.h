@@ -3,33 +3,53 @@
 #include "gamepak.h"
 #include "mmu.h"
 #include "pif.h"
+#include "rdp.h"
 #include "rsp.h"
+#include "scheduler.h"
+#include "vi_scanout.h"
 #include "vr4300.h"
 
 class N64 {
 public:
-    N64(PIF& pif, GamePak& gamepak) : m_pif(pif), m_gamepak(gamepak), m_mmu(*this), m_rsp(*this), m_vr4300(*this) {}
+    // An RDP thread count of zero picks one per host core.
+    N64(PIF& pif, GamePak& gamepak, CPUBackend cpu_backend, CacheEmulation cache_emulation, TaskEmulation task_emulation,
+        u32 rdp_thread_count);
 
-    void run();
+    static constexpr u32 CyclesPerSecond = 93'750'000;
+    static constexpr u32 CyclesPerFrame = CyclesPerSecond / 60;
+
+    // Runs the whole system for the given number of VR4300 cycles, dispatching events as they come due.
+    void run_for(u64 cycles);
 
     PIF& pif() { return m_pif; }
     const PIF& pif() const { return m_pif; }
     GamePak& gamepak() { return m_gamepak; }
     const GamePak& gamepak() const { return m_gamepak; }
+    Scheduler& scheduler() { return m_scheduler; }
+    const Scheduler& scheduler() const { return m_scheduler; }
     MMU& mmu() { return m_mmu; }
     const MMU& mmu() const { return m_mmu; }
     RSP& rsp() { return m_rsp; }
     const RSP& rsp() const { return m_rsp; }
+    RDP& rdp() { return m_rdp; }
+    const RDP& rdp() const { return m_rdp; }
     VR4300& vr4300() { return m_vr4300; }
     const VR4300& vr4300() const { return m_vr4300; }
+    VIScanout& vi_scanout() { return m_vi_scanout; }
 
 private:
     PIF& m_pif;
     GamePak& m_gamepak;
+    Scheduler m_scheduler;
     MMU m_mmu;
     RSP m_rsp;
+    RDP m_rdp;
     VR4300 m_vr4300;
+    VIScanout m_vi_scanout;
+
+    // Cycles owed to the RSP from previous CPU steps, in thirds of an RSP cycle
+    u32 m_rsp_cycle_remainder {};
 
-    u32 m_scanline_cycles {};
-    u32 m_frame_cycles {};
+    void run_rsp(u64 cpu_cycles);
+    void handle_event(const Scheduler::Event& event);
 };
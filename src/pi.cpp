@@ -1,22 +1,138 @@
+#include <algorithm>
+#include <cstring>
 #include "common/bits.h"
 #include "common/logging.h"
-#include "mmu.h"
+#include "n64.h"
 #include "pi.h"
 
+static constexpr u32 CART_DOM2_ADDR2_BASE = 0x08000000;
+static constexpr u32 CART_DOM2_ADDR2_END  = 0x0FFFFFFF;
+static constexpr u32 CART_DOM1_ADDR2_BASE = 0x10000000;
+static constexpr u32 CART_DOM1_ADDR2_END  = 0x1FBFFFFF;
+
 void PI::run_dma_transfer_to_rdram() {
-    LINFO("PI DMA: writing {:08X} bytes from {:08X} to {:08X}", m_dma_write_length, m_dma_cart_address, m_dram_address);
-    for (u32 i = 0; i < m_dma_write_length; i++) {
-        try {
-            m_mmu.write8(m_dram_address + i, m_mmu.read8(m_dma_cart_address + i));
-        } catch (...) {
-            LERROR("Read outside ROM bounds during PI DMA transfer, copied {}/{} bytes", i, m_dma_write_length);
+    const u32 cart_address = m_dma_cart_address;
+    const u32 length = m_dma_length;
+    LINFO("PI DMA: writing {:08X} bytes from {:08X} to {:08X}", length, cart_address, m_dram_address);
+
+    auto& rdram = m_system.mmu().rdram();
+    const u32 dram_address = std::min<u32>(m_dram_address, rdram.size());
+    const u32 dram_length = std::min<u32>(length, rdram.size() - dram_address);
+
+    // Whatever the RDP is still drawing there has to land first, or it would land over the transfer.
+    m_system.rdp().wait_for_writes(dram_address, dram_address + dram_length);
+
+    switch (cart_address) {
+        case CART_DOM1_ADDR2_BASE ... CART_DOM1_ADDR2_END: {
+            const std::span<const u8> rom = m_system.gamepak().rom();
+            const u32 rom_offset = std::min<u32>(cart_address - CART_DOM1_ADDR2_BASE, rom.size());
+            const u32 copied = std::min<u32>(dram_length, rom.size() - rom_offset);
+            std::memcpy(rdram.data() + dram_address, rom.data() + rom_offset, copied);
+            if (copied < length) {
+                LERROR("Read outside ROM bounds during PI DMA transfer, copied {}/{} bytes", copied, length);
+            }
             break;
         }
+
+        case CART_DOM2_ADDR2_BASE ... CART_DOM2_ADDR2_END:
+            LWARN("PI DMA from SRAM/FlashRAM at {:08X} is not supported, RDRAM left as is", cart_address);
+            break;
+
+        default:
+            LERROR("PI DMA from unmapped cartridge address {:08X}", cart_address);
+            break;
     }
 
-    m_dma_cart_address += (m_dma_write_length + 1) & ~1;
-    m_dram_address += (m_dma_write_length + 7) & ~7;
+    if (dram_length != 0) {
+        m_system.vr4300().invalidate_code(dram_address, dram_address + dram_length);
+    }
+
+    finish_dma_setup(cart_address, length);
+}
+
+void PI::run_dma_transfer_to_cart() {
+    const u32 cart_address = m_dma_cart_address;
+    const u32 length = m_dma_length;
+    LINFO("PI DMA: writing {:08X} bytes from {:08X} to {:08X}", length, m_dram_address, cart_address);
+
+    auto& rdram = m_system.mmu().rdram();
+    const u32 dram_address = std::min<u32>(m_dram_address, rdram.size());
+    m_system.rdp().wait_for_writes(dram_address, dram_address + std::min<u32>(length, rdram.size() - dram_address));
+
+    // There is no save memory behind the cartridge yet, and the ROM is read-only.
+    LWARN("PI DMA to cartridge address {:08X} is not supported, {} bytes dropped", cart_address, length);
+
+    finish_dma_setup(cart_address, length);
+}
+
+void PI::finish_dma_setup(const u32 cart_address, const u32 length) {
+    m_dma_cart_address += (length + 1) & ~1;
+    m_dram_address = (m_dram_address + ((length + 7) & ~7)) & 0x00FFFFFF;
+
+    // The data has already moved, but the status and interrupt only change once the bus would be done with it.
+    Common::enable_bits<0>(m_status);
+    m_system.scheduler().schedule(Scheduler::EventType::PIDMAComplete, transfer_cycles(cart_address, length));
+}
+
+u64 PI::transfer_cycles(const u32 cart_address, const u32 length) const {
+    const bool is_domain2 = (cart_address >= 0x05000000 && cart_address < 0x06000000) ||
+                            (cart_address >= CART_DOM2_ADDR2_BASE && cart_address <= CART_DOM2_ADDR2_END);
+    const Domain& domain = m_domains[is_domain2 ? 1 : 0];
+
+    // Every page the transfer touches costs a fixed setup time and the domain's latency, and every halfword its pulse
+    // width and release time.
+    const u32 page_shift = domain.page_size + 2;
+    const u64 pages = ((u64(cart_address) + length - 1) >> page_shift) - (cart_address >> page_shift) + 1;
+    const u64 halfwords = (u64(length) + 1) / 2;
+    const u64 rcp_cycles = pages * (14 + domain.latency + 1) + halfwords * (domain.pulse_width + 1 + domain.release + 1);
+
+    // The RCP runs at two thirds of the VR4300's clock.
+    return rcp_cycles * 3 / 2;
+}
+
+u32 PI::domain_register(const u32 offset) const {
+    const Domain& domain = m_domains[(offset >> 4) & 1];
+    switch ((offset >> 2) & 0b11) {
+        case 0:
+            return domain.latency;
+        case 1:
+            return domain.pulse_width;
+        case 2:
+            return domain.page_size;
+        default:
+            return domain.release;
+    }
+}
+
+void PI::set_domain_register(const u32 offset, const u32 value) {
+    Domain& domain = m_domains[(offset >> 4) & 1];
+    switch ((offset >> 2) & 0b11) {
+        case 0:
+            domain.latency = Common::bit_range<7, 0>(value);
+            return;
+        case 1:
+            domain.pulse_width = Common::bit_range<7, 0>(value);
+            return;
+        case 2:
+            domain.page_size = Common::bit_range<3, 0>(value);
+            return;
+        default:
+            domain.release = Common::bit_range<1, 0>(value);
+            return;
+    }
+}
+
+void PI::reset() {
+    // Abandons a transfer in progress, but leaves the domain timings alone.
+    m_dram_address = 0;
+    m_dma_cart_address = 0;
+    m_dma_length = 0;
+    m_status = 0;
+    m_system.scheduler().cancel(Scheduler::EventType::PIDMAComplete);
+}
 
+void PI::finish_dma_transfer() {
+    Common::disable_bits<0>(m_status);
     Common::enable_bits<3>(m_status);
-    m_mmu.mi().request_interrupt(MI::InterruptFlags::PI);
+    m_system.mmu().mi().request_interrupt(MI::InterruptFlags::PI);
 }
@@ -1,12 +1,13 @@
 #pragma once
 
+#include <array>
 #include "common/types.h"
 
-class MMU;
+class N64;
 
 class PI {
 public:
-    explicit PI(MMU& mmu) : m_mmu(mmu) {}
+    explicit PI(N64& system) : m_system(system) {}
 
     u32 dram_address() const { return m_dram_address; }
     void set_dram_address(u32 address) { m_dram_address = (address & ~0b1) & 0x00FFFFFF; }
@@ -14,27 +15,46 @@ public:
     u32 dma_cart_address() const { return m_dma_cart_address; }
     void set_dma_cart_address(u32 address) { m_dma_cart_address = address & ~0b1; }
 
+    void set_dma_read_length(u32 value) {
+        m_dma_length = (value & 0x00FFFFFF) + 1;
+        run_dma_transfer_to_cart();
+    }
+
     void set_dma_write_length(u32 value) {
-        m_dma_write_length = value + 1;
+        m_dma_length = (value & 0x00FFFFFF) + 1;
         run_dma_transfer_to_rdram();
     }
 
     [[nodiscard]] u32 status() const { return m_status; }
 
-    void reset() {
-        m_dram_address = 0;
-        m_dma_cart_address = 0;
-        m_dma_write_length = 0;
-        m_status = 0;
-    }
+    // The BSD_DOMx_LAT/PWD/PGS/RLS registers, by offset from BSD_DOM1_LAT.
+    [[nodiscard]] u32 domain_register(u32 offset) const;
+    void set_domain_register(u32 offset, u32 value);
+
+    void reset();
+
+    void finish_dma_transfer();
 
 private:
-    MMU& m_mmu;
+    // Bus timings of one cartridge domain, in RCP cycles. Domain 1 holds the ROM, domain 2 SRAM and FlashRAM.
+    struct Domain {
+        u8 latency {};
+        u8 pulse_width {};
+        // Pages are 2^(page_size + 2) bytes.
+        u8 page_size {};
+        u8 release {};
+    };
+
+    N64& m_system;
 
     u32 m_dram_address {};
     u32 m_dma_cart_address {};
-    u32 m_dma_write_length {};
+    u32 m_dma_length {};
     u32 m_status {};
+    std::array<Domain, 2> m_domains {};
 
     void run_dma_transfer_to_rdram();
+    void run_dma_transfer_to_cart();
+    void finish_dma_setup(u32 cart_address, u32 length);
+    u64 transfer_cycles(u32 cart_address, u32 length) const;
 };
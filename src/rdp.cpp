@@ -0,0 +1,695 @@
+#include <algorithm>
+#include "common/bits.h"
+#include "common/logging.h"
+#include "n64.h"
+#include "rdp.h"
+
+using CycleType = RDPRasterizer::CycleType;
+using ImageFormat = RDPRasterizer::ImageFormat;
+using ImageSize = RDPRasterizer::ImageSize;
+
+// From a SyncFull to its interrupt, in CPU cycles.
+static constexpr u64 SyncFullLatency = N64::CyclesPerFrame / 32;
+
+// In 64-bit words.
+static u32 command_length(const u32 command) {
+    if (command >= 0x08 && command <= 0x0F) {
+        // Edge coefficients, then optionally shade, texture and depth coefficients.
+        return 4 + ((command & 0b100) ? 8 : 0) + ((command & 0b010) ? 8 : 0) + ((command & 0b001) ? 2 : 0);
+    }
+    if (command == 0x24 || command == 0x25) {
+        return 2;
+    }
+    return 1;
+}
+
+static std::array<u8, 4> unpack_color(const u64 word) {
+    return { static_cast<u8>(word >> 24), static_cast<u8>(word >> 16), static_cast<u8>(word >> 8), static_cast<u8>(word) };
+}
+
+static u32 bits_per_texel(const ImageSize size) {
+    return 4 << Common::underlying(size);
+}
+
+RDP::RDP(N64& system, const u32 thread_count) : m_system(system), m_rasterizer(system.mmu().rdram(), thread_count) {
+    m_status.flags.command_buffer_ready = true;
+}
+
+void RDP::set_start(const u32 address) {
+    if (!m_status.flags.start_valid) {
+        m_start = address & 0xFFFFF8;
+        m_status.flags.start_valid = true;
+    }
+}
+
+void RDP::set_end(const u32 address) {
+    m_end = address & 0xFFFFF8;
+
+    // A new buffer starts where DPC_START points, otherwise the current one is extended.
+    if (m_status.flags.start_valid) {
+        m_current = m_start;
+        m_status.flags.start_valid = false;
+    }
+
+    run_command_buffer();
+}
+
+void RDP::set_status(const u32 status) {
+    if (Common::is_bit_enabled<0>(status)) {
+        m_status.flags.xbus_dmem_dma = false;
+    }
+    if (Common::is_bit_enabled<1>(status)) {
+        m_status.flags.xbus_dmem_dma = true;
+    }
+    if (Common::is_bit_enabled<2>(status)) {
+        m_status.flags.freeze = false;
+    }
+    if (Common::is_bit_enabled<3>(status)) {
+        m_status.flags.freeze = true;
+    }
+    if (Common::is_bit_enabled<4>(status)) {
+        m_status.flags.flush = false;
+    }
+    if (Common::is_bit_enabled<5>(status)) {
+        m_status.flags.flush = true;
+    }
+
+    // Commands that came in while frozen run once thawed.
+    if (Common::is_bit_enabled<2>(status)) {
+        run_command_buffer();
+    }
+}
+
+void RDP::run_commands(const std::span<const u64> commands) {
+    m_command_words.insert(m_command_words.end(), commands.begin(), commands.end());
+    const std::size_t executed = execute(m_command_words);
+    m_command_words.erase(m_command_words.begin(), m_command_words.begin() + executed);
+    flush();
+}
+
+void RDP::run_command_buffer() {
+    if (m_status.flags.freeze || m_current >= m_end) {
+        return;
+    }
+
+    auto& mmu = m_system.mmu();
+    for (; m_current < m_end; m_current += 8) {
+        if (m_status.flags.xbus_dmem_dma) {
+            m_command_words.push_back(Common::read_big_endian<u64>(&mmu.sp_dmem()[m_current & 0xFF8]));
+        } else if (m_current + 8 <= mmu.rdram().size()) {
+            m_command_words.push_back(Common::read_big_endian<u64>(&mmu.rdram()[m_current]));
+        } else {
+            m_command_words.push_back(0);
+        }
+    }
+
+    const std::size_t executed = execute(m_command_words);
+    m_command_words.erase(m_command_words.begin(), m_command_words.begin() + executed);
+
+    // The CPU may look at anything drawn as soon as the buffer is done.
+    flush();
+}
+
+std::size_t RDP::execute(const std::span<const u64> words) {
+    std::size_t index = 0;
+    while (index < words.size()) {
+        const u64 word = words[index];
+        const u32 command = (word >> 56) & 0x3F;
+        const u32 length = command_length(command);
+        if (index + length > words.size()) {
+            break;
+        }
+
+        switch (command) {
+            case 0x00: // No Op
+            case 0x26: // Sync Load
+            case 0x27: // Sync Pipe
+            case 0x28: // Sync Tile
+            case 0x2A: // Set Key GB
+            case 0x2B: // Set Key R
+            case 0x2C: // Set Convert
+                break;
+
+            case 0x08 ... 0x0F:
+                triangle(words.subspan(index, length));
+                break;
+
+            case 0x24: // Texture Rectangle
+            case 0x25: // Texture Rectangle Flip
+                rectangle(word, words[index + 1], true, command == 0x25);
+                break;
+
+            case 0x29: // Sync Full
+                sync_full();
+                break;
+
+            case 0x2D: // Set Scissor
+                set_scissor(word);
+                break;
+
+            case 0x2E: // Set Prim Depth
+                m_state.primitive_z = static_cast<u16>(word >> 16);
+                m_state.primitive_delta_z = static_cast<u16>(word);
+                m_state_dirty = true;
+                break;
+
+            case 0x2F: // Set Other Modes
+                set_other_modes(word);
+                break;
+
+            case 0x30: // Load TLUT
+                load_tlut(word);
+                break;
+
+            case 0x32: // Set Tile Size
+                set_tile_size(word);
+                break;
+
+            case 0x33: // Load Block
+                load_block(word);
+                break;
+
+            case 0x34: // Load Tile
+                load_tile(word);
+                break;
+
+            case 0x35: // Set Tile
+                set_tile(word);
+                break;
+
+            case 0x36: // Fill Rectangle
+                rectangle(word, 0, false, false);
+                break;
+
+            case 0x37: // Set Fill Color
+                m_state.fill_color = static_cast<u32>(word);
+                m_state_dirty = true;
+                break;
+
+            case 0x38: // Set Fog Color
+                m_state.fog_color = unpack_color(word);
+                m_state_dirty = true;
+                break;
+
+            case 0x39: // Set Blend Color
+                m_state.blend_color = unpack_color(word);
+                m_state_dirty = true;
+                break;
+
+            case 0x3A: // Set Prim Color
+                m_state.primitive_color = unpack_color(word);
+                m_state.primitive_lod_fraction = static_cast<u8>(word >> 32);
+                m_state_dirty = true;
+                break;
+
+            case 0x3B: // Set Env Color
+                m_state.environment_color = unpack_color(word);
+                m_state_dirty = true;
+                break;
+
+            case 0x3C: // Set Combine
+                m_state.combine = word & 0x00FFFFFFFFFFFFFF;
+                m_state_dirty = true;
+                break;
+
+            case 0x3D: // Set Texture Image
+            case 0x3E: // Set Z Image
+            case 0x3F: // Set Color Image
+                set_image(word);
+                break;
+
+            default:
+                LWARN("Unknown RDP command {:02X} ({:016X})", command, word);
+                break;
+        }
+
+        index += length;
+    }
+
+    return index;
+}
+
+const RDPRasterizer::State* RDP::captured_state() {
+    if (m_tmem_dirty) {
+        m_captured_tmem = m_rasterizer.capture_tmem(m_tmem);
+        m_tmem_dirty = false;
+        m_state_dirty = true;
+    }
+
+    if (m_state_dirty) {
+        m_state.tmem = m_captured_tmem;
+        m_captured_state = m_rasterizer.capture_state(m_state);
+        m_state_dirty = false;
+    }
+
+    return m_captured_state;
+}
+
+void RDP::queue(RDPRasterizer::Primitive& primitive) {
+    primitive.state = captured_state();
+
+    // Remember which lines of the color and depth images this may write, for loads from them and code invalidation.
+    const s32 first_line = std::max(primitive.y_high >> 2, static_cast<s32>(m_state.scissor_yh >> 2));
+    const s32 last_line = std::min((primitive.y_low - 1) >> 2, static_cast<s32>((m_state.scissor_yl - 1) >> 2));
+    if (first_line > last_line || last_line < 0) {
+        return;
+    }
+
+    const auto add_pending_write = [&](const u32 image_address, const u32 bytes_per_pixel) {
+        const u32 pitch = m_state.color_image_width * bytes_per_pixel;
+        const u32 begin = image_address + static_cast<u32>(std::max(first_line, 0)) * pitch;
+        const u32 end = image_address + static_cast<u32>(last_line + 1) * pitch;
+        for (auto& [pending_begin, pending_end] : m_pending_writes) {
+            if (begin <= pending_end && end >= pending_begin) {
+                pending_begin = std::min(pending_begin, begin);
+                pending_end = std::max(pending_end, end);
+                return;
+            }
+        }
+        m_pending_writes.emplace_back(begin, end);
+    };
+
+    const u32 bytes_per_pixel = std::max(bits_per_texel(m_state.color_image_size) / 8, 1u);
+    add_pending_write(m_state.color_image_address, bytes_per_pixel);
+    if (primitive.zbuffer && m_state.z_update() && m_state.cycle_type() != CycleType::Fill && m_state.cycle_type() != CycleType::Copy) {
+        add_pending_write(m_state.z_image_address, 2);
+    }
+
+    m_rasterizer.queue(primitive);
+}
+
+void RDP::flush() {
+    if (!m_rasterizer.has_queued_primitives()) {
+        return;
+    }
+
+    const u64 batch = m_rasterizer.submit();
+
+    // Snapshots of the state and TMEM went away with the batch.
+    m_state_dirty = true;
+    m_tmem_dirty = true;
+
+    auto& mmu = m_system.mmu();
+    for (const auto& [begin, end] : m_pending_writes) {
+        const u32 rdram_end = std::min<u32>(end, mmu.rdram().size());
+        if (begin < rdram_end) {
+            m_in_flight_writes.push_back({ begin, rdram_end, batch });
+            mmu.set_rdram_rdp_protected(begin, rdram_end, true);
+        }
+    }
+    m_pending_writes.clear();
+
+    // Without the protection, the CPU could see the batch half drawn, or store under it.
+    if (!m_system.vr4300().sees_rdram_rdp_protection()) {
+        m_rasterizer.wait(batch);
+    }
+
+    retire_writes();
+}
+
+void RDP::retire_writes() {
+    const u64 completed = m_rasterizer.completed();
+    if (m_in_flight_writes.empty() || m_in_flight_writes.front().batch > completed) {
+        return;
+    }
+
+    // Writes are kept in submission order.
+    const auto retired_end = std::find_if(m_in_flight_writes.begin(), m_in_flight_writes.end(),
+                                          [&](const InFlightWrite& write) { return write.batch > completed; });
+
+    auto& mmu = m_system.mmu();
+    auto& vr4300 = m_system.vr4300();
+    for (auto retired = m_in_flight_writes.begin(); retired != retired_end; ++retired) {
+        for (u32 address = retired->begin & ~0xFFF; address < retired->end; address += 0x1000) {
+            vr4300.invalidate_code(address);
+        }
+        mmu.set_rdram_rdp_protected(retired->begin, retired->end, false);
+    }
+
+    // Pages shared with writes still in flight stay protected.
+    for (auto remaining = retired_end; remaining != m_in_flight_writes.end(); ++remaining) {
+        const bool shares_pages = std::any_of(m_in_flight_writes.begin(), retired_end, [&](const InFlightWrite& retired) {
+            return (remaining->begin >> 12) <= ((retired.end - 1) >> 12) && (retired.begin >> 12) <= ((remaining->end - 1) >> 12);
+        });
+        if (shares_pages) {
+            mmu.set_rdram_rdp_protected(remaining->begin, remaining->end, true);
+        }
+    }
+
+    m_in_flight_writes.erase(m_in_flight_writes.begin(), retired_end);
+}
+
+void RDP::wait_for_writes(const u32 begin, const u32 end) {
+    const auto overlaps = [&](const u32 write_begin, const u32 write_end) { return begin < write_end && end > write_begin; };
+
+    for (const auto& [pending_begin, pending_end] : m_pending_writes) {
+        if (overlaps(pending_begin, pending_end)) {
+            flush();
+            break;
+        }
+    }
+
+    u64 batch = 0;
+    for (const InFlightWrite& write : m_in_flight_writes) {
+        if (overlaps(write.begin, write.end)) {
+            batch = std::max(batch, write.batch);
+        }
+    }
+
+    if (batch != 0) {
+        m_rasterizer.wait(batch);
+    }
+    retire_writes();
+}
+
+void RDP::sync() {
+    flush();
+    m_rasterizer.wait_idle();
+    retire_writes();
+}
+
+void RDP::triangle(const std::span<const u64> words) {
+    const u64 w0 = words[0];
+    const u32 command = (w0 >> 56) & 0x3F;
+
+    // Y coordinates are s11.2, X coordinates and all coefficients s15.16.
+    const auto y_coordinate = [](const u64 value) { return static_cast<s32>(static_cast<u32>(value) << 18) >> 18; };
+    const auto fixed_high = [](const u64 word) { return static_cast<s32>(word >> 32) / 65536.0f; };
+    const auto fixed_low = [](const u64 word) { return static_cast<s32>(word) / 65536.0f; };
+
+    RDPRasterizer::Primitive primitive {};
+    primitive.y_low = y_coordinate(w0 >> 32);
+    primitive.y_middle = y_coordinate(w0 >> 16);
+    primitive.y_high = y_coordinate(w0);
+    primitive.y_base = static_cast<f32>(primitive.y_high & ~3) / 4.0f;
+    primitive.major_on_left = (w0 >> 55) & 1;
+    primitive.tile = (w0 >> 48) & 0x7;
+    primitive.x_low = fixed_high(words[1]);
+    primitive.slope_low = fixed_low(words[1]);
+    primitive.x_high = fixed_high(words[2]);
+    primitive.slope_high = fixed_low(words[2]);
+    primitive.x_middle = fixed_high(words[3]);
+    primitive.slope_middle = fixed_low(words[3]);
+    primitive.base_x = primitive.x_high;
+
+    primitive.shade = command & 0b100;
+    primitive.texture = command & 0b010;
+    primitive.zbuffer = command & 0b001;
+    primitive.perspective = m_state.perspective_correction();
+
+    // Coefficients change per pixel along X, and per line along the major edge (E). Turn the latter into changes
+    // along Y.
+    const auto attribute = [&](const f32 value, const f32 dx, const f32 de) {
+        return RDPRasterizer::Attribute { value, dx, de - dx * primitive.slope_high };
+    };
+
+    // Blocks of four coefficients hold integer and fraction parts in separate words.
+    const auto block_attribute = [&](const std::span<const u64> block, const u32 channel) {
+        const u32 shift = 48 - channel * 16;
+        const auto value = [&](const u64 integer_word, const u64 fraction_word) {
+            const u32 integer = (integer_word >> shift) & 0xFFFF;
+            const u32 fraction = (fraction_word >> shift) & 0xFFFF;
+            return static_cast<s32>((integer << 16) | fraction) / 65536.0f;
+        };
+        return attribute(value(block[0], block[2]), value(block[1], block[3]), value(block[4], block[6]));
+    };
+
+    std::size_t index = 4;
+    if (primitive.shade) {
+        const auto block = words.subspan(index, 8);
+        primitive.r = block_attribute(block, 0);
+        primitive.g = block_attribute(block, 1);
+        primitive.b = block_attribute(block, 2);
+        primitive.a = block_attribute(block, 3);
+        index += 8;
+    }
+    if (primitive.texture) {
+        const auto block = words.subspan(index, 8);
+        primitive.s = block_attribute(block, 0);
+        primitive.t = block_attribute(block, 1);
+        primitive.w = block_attribute(block, 2);
+        index += 8;
+    }
+    if (primitive.zbuffer) {
+        primitive.z = attribute(fixed_high(words[index]), fixed_low(words[index]), fixed_high(words[index + 1]));
+    }
+
+    queue(primitive);
+}
+
+void RDP::rectangle(const u64 w0, const u64 w1, const bool textured, const bool flip) {
+    // Coordinates are 10.2, lower right first.
+    const u32 xl = (w0 >> 44) & 0xFFF;
+    const u32 yl = (w0 >> 32) & 0xFFF;
+    const u32 xh = (w0 >> 12) & 0xFFF;
+    const u32 yh = w0 & 0xFFF;
+
+    RDPRasterizer::Primitive primitive {};
+
+    // Fill and copy mode include the lower right edges.
+    const CycleType cycle_type = m_state.cycle_type();
+    const bool inclusive = cycle_type == CycleType::Fill || cycle_type == CycleType::Copy;
+    if (inclusive) {
+        primitive.y_high = static_cast<s32>(yh & ~3);
+        primitive.y_low = static_cast<s32>((yl & ~3) + 4);
+        primitive.x_high = static_cast<f32>(xh >> 2);
+        primitive.x_middle = static_cast<f32>((xl >> 2) + 1);
+    } else {
+        primitive.y_high = static_cast<s32>(yh);
+        primitive.y_low = static_cast<s32>(yl);
+        primitive.x_high = static_cast<f32>(xh) / 4.0f;
+        primitive.x_middle = static_cast<f32>(xl) / 4.0f;
+    }
+    primitive.y_middle = primitive.y_low;
+    primitive.x_low = primitive.x_middle;
+    primitive.y_base = static_cast<f32>(yh >> 2);
+    primitive.base_x = static_cast<f32>(xh >> 2);
+    primitive.major_on_left = true;
+
+    // Rectangles only test depth against the primitive depth.
+    primitive.zbuffer = !inclusive && m_state.primitive_depth();
+
+    if (textured) {
+        primitive.texture = true;
+        primitive.tile = (w0 >> 24) & 0x7;
+
+        // S and T are s10.5, their steps s5.10. Copy mode steps four texels at a time.
+        const f32 s = static_cast<s16>(w1 >> 48);
+        const f32 t = static_cast<s16>(w1 >> 32);
+        const f32 s_step = static_cast<s16>(w1 >> 16) / 32.0f / (cycle_type == CycleType::Copy ? 4.0f : 1.0f);
+        const f32 t_step = static_cast<s16>(w1) / 32.0f;
+        if (flip) {
+            primitive.s = { s, 0.0f, s_step };
+            primitive.t = { t, t_step, 0.0f };
+        } else {
+            primitive.s = { s, s_step, 0.0f };
+            primitive.t = { t, 0.0f, t_step };
+        }
+    }
+
+    queue(primitive);
+}
+
+void RDP::set_scissor(const u64 word) {
+    m_state.scissor_xh = (word >> 44) & 0xFFF;
+    m_state.scissor_yh = (word >> 32) & 0xFFF;
+    m_state.scissor_xl = (word >> 12) & 0xFFF;
+    m_state.scissor_yl = word & 0xFFF;
+    m_state_dirty = true;
+}
+
+void RDP::set_other_modes(const u64 word) {
+    m_state.other_modes_high = (word >> 32) & 0xFFFFFF;
+    m_state.other_modes_low = static_cast<u32>(word);
+    m_state_dirty = true;
+}
+
+void RDP::set_tile(const u64 word) {
+    RDPRasterizer::Tile& tile = m_state.tiles[(word >> 24) & 0x7];
+    tile.format = static_cast<ImageFormat>(std::min<u32>((word >> 53) & 0x7, Common::underlying(ImageFormat::Intensity)));
+    tile.size = static_cast<ImageSize>((word >> 51) & 0x3);
+    tile.line = (word >> 41) & 0x1FF;
+    tile.tmem_address = (word >> 32) & 0x1FF;
+    tile.palette = (word >> 20) & 0xF;
+    tile.clamp_t = (word >> 19) & 1;
+    tile.mirror_t = (word >> 18) & 1;
+    tile.mask_t = std::min<u32>((word >> 14) & 0xF, 10);
+    tile.shift_t = (word >> 10) & 0xF;
+    tile.clamp_s = (word >> 9) & 1;
+    tile.mirror_s = (word >> 8) & 1;
+    tile.mask_s = std::min<u32>((word >> 4) & 0xF, 10);
+    tile.shift_s = word & 0xF;
+    m_state_dirty = true;
+}
+
+void RDP::set_tile_size(const u64 word) {
+    RDPRasterizer::Tile& tile = m_state.tiles[(word >> 24) & 0x7];
+    tile.sl = (word >> 44) & 0xFFF;
+    tile.tl = (word >> 32) & 0xFFF;
+    tile.sh = (word >> 12) & 0xFFF;
+    tile.th = word & 0xFFF;
+    m_state_dirty = true;
+}
+
+void RDP::load_tile(const u64 word) {
+    set_tile_size(word);
+    const RDPRasterizer::Tile& tile = m_state.tiles[(word >> 24) & 0x7];
+
+    const u32 sl = tile.sl >> 2;
+    const u32 tl = tile.tl >> 2;
+    const u32 sh = tile.sh >> 2;
+    const u32 th = tile.th >> 2;
+    if (sh < sl || th < tl) {
+        return;
+    }
+
+    const u32 bits = bits_per_texel(m_texture_image.size);
+    const u32 texels_per_row = sh - sl + 1;
+    const u32 pitch = m_texture_image.width * bits / 8;
+    wait_for_writes(m_texture_image.address + tl * pitch, m_texture_image.address + (th + 1) * pitch);
+
+    const auto& rdram = m_system.mmu().rdram();
+    const auto read_rdram = [&](const u32 address) -> u8 { return address < rdram.size() ? rdram[address] : 0; };
+
+    for (u32 t = tl; t <= th; t++) {
+        const u32 row = t - tl;
+        const u32 source = m_texture_image.address + (t * m_texture_image.width + sl) * bits / 8;
+        const u32 destination = tile.tmem_address * 8 + row * tile.line * 8;
+        const u32 swap = (row & 1) ? 4 : 0;
+
+        if (m_texture_image.size == ImageSize::Bits32) {
+            // Split into red and green in the lower half of TMEM, blue and alpha in the upper half.
+            for (u32 i = 0; i < texels_per_row; i++) {
+                const u32 address = ((destination + i * 2) ^ swap) & 0x7FE;
+                m_tmem[address + 0] = read_rdram(source + i * 4 + 0);
+                m_tmem[address + 1] = read_rdram(source + i * 4 + 1);
+                m_tmem[address + 0x800] = read_rdram(source + i * 4 + 2);
+                m_tmem[address + 0x801] = read_rdram(source + i * 4 + 3);
+            }
+            continue;
+        }
+
+        const u32 row_bytes = (texels_per_row * bits + 7) / 8;
+        for (u32 i = 0; i < row_bytes; i++) {
+            m_tmem[((destination + i) ^ swap) & 0xFFF] = read_rdram(source + i);
+        }
+    }
+
+    m_tmem_dirty = true;
+}
+
+void RDP::load_block(const u64 word) {
+    RDPRasterizer::Tile& tile = m_state.tiles[(word >> 24) & 0x7];
+    tile.sl = (word >> 44) & 0xFFF;
+    tile.tl = (word >> 32) & 0xFFF;
+    tile.sh = (word >> 12) & 0xFFF;
+    tile.th = word & 0xFFF;
+    m_state_dirty = true;
+
+    // Here SH is the index of the last texel, and DXT how far T advances per 64-bit word, as 1.11. Odd lines get
+    // their words swapped as they are written.
+    const u32 sl = tile.sl;
+    const u32 tl = tile.tl;
+    const u32 sh = tile.sh;
+    const u32 dxt = tile.th;
+    if (sh < sl) {
+        return;
+    }
+
+    const u32 bits = bits_per_texel(m_texture_image.size);
+    const u32 texel_count = sh - sl + 1;
+    const u32 source = m_texture_image.address + (tl * m_texture_image.width + sl) * bits / 8;
+    const u32 byte_count = (texel_count * bits + 7) / 8;
+    wait_for_writes(source, source + byte_count);
+
+    const auto& rdram = m_system.mmu().rdram();
+    const auto read_rdram = [&](const u32 address) -> u8 { return address < rdram.size() ? rdram[address] : 0; };
+    const u32 destination = tile.tmem_address * 8;
+
+    if (m_texture_image.size == ImageSize::Bits32) {
+        for (u32 i = 0; i < texel_count; i++) {
+            const u32 swap = (((i / 2) * dxt) >> 11) & 1 ? 4 : 0;
+            const u32 address = ((destination + i * 2) ^ swap) & 0x7FE;
+            m_tmem[address + 0] = read_rdram(source + i * 4 + 0);
+            m_tmem[address + 1] = read_rdram(source + i * 4 + 1);
+            m_tmem[address + 0x800] = read_rdram(source + i * 4 + 2);
+            m_tmem[address + 0x801] = read_rdram(source + i * 4 + 3);
+        }
+    } else {
+        for (u32 i = 0; i < byte_count; i++) {
+            const u32 swap = (((i / 8) * dxt) >> 11) & 1 ? 4 : 0;
+            m_tmem[((destination + i) ^ swap) & 0xFFF] = read_rdram(source + i);
+        }
+    }
+
+    m_tmem_dirty = true;
+}
+
+void RDP::load_tlut(const u64 word) {
+    const RDPRasterizer::Tile& tile = m_state.tiles[(word >> 24) & 0x7];
+    const u32 sl = ((word >> 44) & 0xFFF) >> 2;
+    const u32 tl = ((word >> 32) & 0xFFF) >> 2;
+    const u32 sh = ((word >> 12) & 0xFFF) >> 2;
+    if (sh < sl) {
+        return;
+    }
+
+    // Palette entries are 16 bits, and each is written four times.
+    const u32 count = sh - sl + 1;
+    const u32 source = m_texture_image.address + (tl * m_texture_image.width + sl) * 2;
+    wait_for_writes(source, source + count * 2);
+
+    const auto& rdram = m_system.mmu().rdram();
+    for (u32 i = 0; i < count; i++) {
+        const u32 address = source + i * 2;
+        const u8 high = address + 1 < rdram.size() ? rdram[address] : 0;
+        const u8 low = address + 1 < rdram.size() ? rdram[address + 1] : 0;
+        for (u32 copy = 0; copy < 4; copy++) {
+            const u32 destination = (tile.tmem_address * 8 + i * 8 + copy * 2) & 0xFFE;
+            m_tmem[destination] = high;
+            m_tmem[destination + 1] = low;
+        }
+    }
+
+    m_tmem_dirty = true;
+}
+
+void RDP::set_image(const u64 word) {
+    const u32 address = word & 0xFFFFFF;
+    const auto format = static_cast<ImageFormat>(std::min<u32>((word >> 53) & 0x7, Common::underlying(ImageFormat::Intensity)));
+    const auto size = static_cast<ImageSize>((word >> 51) & 0x3);
+    const u32 width = ((word >> 32) & 0x3FF) + 1;
+
+    switch ((word >> 56) & 0x3F) {
+        case 0x3D:
+            m_texture_image = { address, format, size, width };
+            return;
+
+        case 0x3E:
+            m_state.z_image_address = address;
+            m_state_dirty = true;
+            return;
+
+        case 0x3F:
+            m_state.color_image_address = address;
+            m_state.color_image_size = size;
+            m_state.color_image_width = width;
+            m_state_dirty = true;
+            return;
+    }
+}
+
+void RDP::sync_full() {
+    flush();
+
+    // The interrupt comes a little later, which is how long the rasterizer gets to finish while emulation goes on.
+    auto& scheduler = m_system.scheduler();
+    if (!scheduler.is_scheduled(Scheduler::EventType::RDPSyncFull)) {
+        scheduler.schedule(Scheduler::EventType::RDPSyncFull, SyncFullLatency);
+    }
+}
+
+void RDP::finish_sync_full() {
+    sync();
+    m_system.mmu().mi().request_interrupt(MI::InterruptFlags::DP);
+}
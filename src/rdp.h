@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+#include "common/types.h"
+#include "rdp_rasterizer.h"
+
+class N64;
+
+// The RDP's command processor. Commands are fetched from RDRAM (or DMEM, through the XBUS) between DPC_START and
+// DPC_END, set up the render state and TMEM, and turn primitives over to the RDPRasterizer.
+//
+// The rasterizer draws on a thread of its own, so emulation only waits for it where it has to: when something accesses
+// RDRAM it is still writing (the CPU through protected pages, DMAs, the RDP itself by texture loads), when a task
+// starts under high-level emulation, when the frame is scanned out, and when a SyncFull is acknowledged.
+class RDP {
+public:
+    RDP(N64& system, u32 thread_count);
+
+    u32 start() const { return m_start; }
+    void set_start(u32 address);
+    u32 end() const { return m_end; }
+    void set_end(u32 address);
+    u32 current() const { return m_current; }
+
+    u32 status() const { return m_status.raw; }
+    void set_status(u32 status);
+
+    // Runs a command list that was built without going through the command registers, as by high-level emulated
+    // graphics tasks.
+    void run_commands(std::span<const u64> commands);
+
+    // Waits for everything queued or being drawn that writes to RDRAM within [begin, end).
+    void wait_for_writes(u32 begin, u32 end);
+    // Waits for everything queued or being drawn.
+    void sync();
+    // Raises the interrupt for a SyncFull, once the RDP is done.
+    void finish_sync_full();
+
+private:
+    N64& m_system;
+    RDPRasterizer m_rasterizer;
+
+    u32 m_start {};
+    u32 m_end {};
+    u32 m_current {};
+
+    union {
+        u32 raw {};
+        struct {
+            bool xbus_dmem_dma : 1;
+            bool freeze : 1;
+            bool flush : 1;
+            bool start_gclk : 1;
+            bool tmem_busy : 1;
+            bool pipe_busy : 1;
+            bool command_busy : 1;
+            bool command_buffer_ready : 1;
+            bool dma_busy : 1;
+            bool end_valid : 1;
+            bool start_valid : 1;
+            u32 : 21;
+        } flags;
+    } m_status;
+
+    // Words fetched but not executed yet, as commands may be split across buffers.
+    std::vector<u64> m_command_words;
+
+    RDPRasterizer::State m_state {};
+    std::array<u8, 0x1000> m_tmem {};
+    bool m_state_dirty { true };
+    bool m_tmem_dirty { true };
+    const RDPRasterizer::State* m_captured_state {};
+    const std::array<u8, 0x1000>* m_captured_tmem {};
+
+    struct TextureImage {
+        u32 address;
+        RDPRasterizer::ImageFormat format;
+        RDPRasterizer::ImageSize size;
+        u32 width;
+    } m_texture_image {};
+
+    // RDRAM written by queued primitives, as [begin, end) pairs.
+    std::vector<std::pair<u32, u32>> m_pending_writes;
+
+    // RDRAM written by submitted batches that may not be drawn yet. Read-protected until then.
+    struct InFlightWrite {
+        u32 begin;
+        u32 end;
+        u64 batch;
+    };
+    std::vector<InFlightWrite> m_in_flight_writes;
+
+    void run_command_buffer();
+    // Executes as many complete commands as there are, and returns the number of words they took up.
+    std::size_t execute(std::span<const u64> words);
+
+    const RDPRasterizer::State* captured_state();
+    void queue(RDPRasterizer::Primitive& primitive);
+    // Hands the queued primitives to the rasterizer, without waiting for them.
+    void flush();
+    // Lets go of the writes of batches the rasterizer is done with.
+    void retire_writes();
+
+    void triangle(std::span<const u64> words);
+    void rectangle(u64 w0, u64 w1, bool textured, bool flip);
+    void set_scissor(u64 word);
+    void set_other_modes(u64 word);
+    void set_tile(u64 word);
+    void set_tile_size(u64 word);
+    void load_tile(u64 word);
+    void load_block(u64 word);
+    void load_tlut(u64 word);
+    void set_image(u64 word);
+    void sync_full();
+};
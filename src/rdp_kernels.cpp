@@ -0,0 +1,698 @@
+#include <algorithm>
+#include "common/defines.h"
+#include "rdp_kernels.h"
+
+#if defined(__x86_64__) && !defined(FOURIXTYS_RDP_SCALAR_KERNELS)
+#include <immintrin.h>
+#define RDP_KERNELS_X64
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+using ImageFormat = RDPRasterizer::ImageFormat;
+using ImageSize = RDPRasterizer::ImageSize;
+using State = RDPRasterizer::State;
+using Tile = RDPRasterizer::Tile;
+using ColorBatch = RDPKernels::ColorBatch;
+using CoordinateBatch = RDPKernels::CoordinateBatch;
+using CombineOperands = RDPKernels::CombineOperands;
+using BlendOperands = RDPKernels::BlendOperands;
+using TMEM = std::array<u8, 0x1000>;
+
+// How a coordinate is brought into a tile. Coordinates are clamped to [0, max] when the tile clamps, or has no mask
+// to wrap with, and are then masked to the low bits, every other repeat mirrored.
+struct Wrap {
+    u32 mask;
+    bool mirror;
+    bool clamp;
+    s32 max;
+};
+
+Wrap wrap_s(const Tile& tile) {
+    return { tile.mask_s, tile.mirror_s, tile.clamp_s || tile.mask_s == 0,
+             std::max(static_cast<s32>((tile.sh >> 2) - (tile.sl >> 2)), 0) };
+}
+
+Wrap wrap_t(const Tile& tile) {
+    return { tile.mask_t, tile.mirror_t, tile.clamp_t || tile.mask_t == 0,
+             std::max(static_cast<s32>((tile.th >> 2) - (tile.tl >> 2)), 0) };
+}
+
+// Scalar reference kernels.
+
+ALWAYS_INLINE s32 clamp_channel(const s32 value) {
+    return std::clamp(value, 0, 255);
+}
+
+ALWAYS_INLINE void set_color(ColorBatch& batch, const u32 lane, const s32 r, const s32 g, const s32 b, const s32 a) {
+    batch.r[lane] = r;
+    batch.g[lane] = g;
+    batch.b[lane] = b;
+    batch.a[lane] = a;
+}
+
+ALWAYS_INLINE void set_rgba16(ColorBatch& batch, const u32 lane, const u16 value) {
+    const s32 r = (value >> 11) & 0x1F;
+    const s32 g = (value >> 6) & 0x1F;
+    const s32 b = (value >> 1) & 0x1F;
+    set_color(batch, lane, (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (value & 1) ? 0xFF : 0x00);
+}
+
+ALWAYS_INLINE u16 read_tmem16(const TMEM& tmem, const u32 address) {
+    return static_cast<u16>((tmem[address & 0xFFE] << 8) | tmem[(address & 0xFFE) + 1]);
+}
+
+ALWAYS_INLINE u32 wrap_coordinate(s32 coordinate, const Wrap& wrap) {
+    if (wrap.clamp) {
+        coordinate = std::clamp(coordinate, 0, wrap.max);
+    }
+    if (wrap.mask != 0) {
+        if (wrap.mirror && ((coordinate >> wrap.mask) & 1)) {
+            coordinate = ~coordinate;
+        }
+        coordinate &= (1 << wrap.mask) - 1;
+    }
+    return static_cast<u32>(coordinate);
+}
+
+void set_palette_entry(const State& state, ColorBatch& batch, const u32 lane, const u32 index) {
+    // The palette lives in the upper half of TMEM, each entry repeated four times.
+    const u16 entry = read_tmem16(*state.tmem, 0x800 + (index & 0xFF) * 8);
+    if (state.tlut_intensity_alpha()) {
+        set_color(batch, lane, entry >> 8, entry >> 8, entry >> 8, entry & 0xFF);
+    } else {
+        set_rgba16(batch, lane, entry);
+    }
+}
+
+void fetch_texel(const State& state, const Tile& tile, const u32 s, const u32 t, ColorBatch& batch, const u32 lane) {
+    const TMEM& tmem = *state.tmem;
+    const u32 row = tile.tmem_address * 8 + t * tile.line * 8;
+    // Odd rows have their 32-bit words swapped, so that both rows of a bilinear fetch come from different banks.
+    const u32 swap = (t & 1) ? 4 : 0;
+
+    switch (tile.size) {
+        case ImageSize::Bits4: {
+            const u8 byte = tmem[((row + s / 2) ^ swap) & 0xFFF];
+            const u8 value = (s & 1) ? (byte & 0xF) : (byte >> 4);
+            if (state.tlut_enabled()) {
+                set_palette_entry(state, batch, lane, (tile.palette << 4) | value);
+            } else if (tile.format == ImageFormat::IntensityAlpha) {
+                const s32 intensity = ((value >> 1) << 5) | ((value >> 1) << 2) | ((value >> 1) >> 1);
+                set_color(batch, lane, intensity, intensity, intensity, (value & 1) ? 0xFF : 0x00);
+            } else {
+                const s32 intensity = value * 0x11;
+                set_color(batch, lane, intensity, intensity, intensity, intensity);
+            }
+            break;
+        }
+
+        case ImageSize::Bits8: {
+            const u8 value = tmem[((row + s) ^ swap) & 0xFFF];
+            if (state.tlut_enabled()) {
+                set_palette_entry(state, batch, lane, value);
+            } else if (tile.format == ImageFormat::IntensityAlpha) {
+                const s32 intensity = (value >> 4) * 0x11;
+                set_color(batch, lane, intensity, intensity, intensity, (value & 0xF) * 0x11);
+            } else {
+                set_color(batch, lane, value, value, value, value);
+            }
+            break;
+        }
+
+        case ImageSize::Bits16: {
+            const u16 value = read_tmem16(tmem, (row + s * 2) ^ swap);
+            if (tile.format == ImageFormat::IntensityAlpha) {
+                set_color(batch, lane, value >> 8, value >> 8, value >> 8, value & 0xFF);
+            } else {
+                set_rgba16(batch, lane, value);
+            }
+            break;
+        }
+
+        case ImageSize::Bits32: {
+            // Red and green are in the lower half of TMEM, blue and alpha at the same place in the upper half.
+            const u32 address = ((row + s * 2) ^ swap) & 0x7FF;
+            const u16 red_green = read_tmem16(tmem, address);
+            const u16 blue_alpha = read_tmem16(tmem, address | 0x800);
+            set_color(batch, lane, red_green >> 8, red_green & 0xFF, blue_alpha >> 8, blue_alpha & 0xFF);
+            break;
+        }
+    }
+}
+
+void fetch_texels_scalar(const State& state, const Tile& tile, const CoordinateBatch& coordinates, ColorBatch& texels,
+                         const u32 count) {
+    const Wrap s_wrap = wrap_s(tile);
+    const Wrap t_wrap = wrap_t(tile);
+    for (u32 lane = 0; lane < count; lane++) {
+        fetch_texel(state, tile, wrap_coordinate(coordinates.s[lane], s_wrap), wrap_coordinate(coordinates.t[lane], t_wrap), texels, lane);
+    }
+}
+
+ALWAYS_INLINE s32 filter_channel(const s32 base, const s32 along_s, const s32 along_t, const s32 weight_s, const s32 weight_t) {
+    return clamp_channel(base + (((along_s - base) * weight_s + (along_t - base) * weight_t + 0x10) >> 5));
+}
+
+void filter_texels_scalar(const ColorBatch& t00, const ColorBatch& t10, const ColorBatch& t01, const ColorBatch& t11,
+                          const CoordinateBatch& fractions, ColorBatch& filtered, const u32 count) {
+    for (u32 lane = 0; lane < count; lane++) {
+        const s32 fraction_s = fractions.s[lane];
+        const s32 fraction_t = fractions.t[lane];
+
+        // The RDP filters between three texels, picking the triangle of the quad the sample falls into.
+        if (fraction_s + fraction_t >= 0x20) {
+            const s32 weight_s = 0x20 - fraction_s;
+            const s32 weight_t = 0x20 - fraction_t;
+            set_color(filtered, lane, filter_channel(t11.r[lane], t01.r[lane], t10.r[lane], weight_s, weight_t),
+                      filter_channel(t11.g[lane], t01.g[lane], t10.g[lane], weight_s, weight_t),
+                      filter_channel(t11.b[lane], t01.b[lane], t10.b[lane], weight_s, weight_t),
+                      filter_channel(t11.a[lane], t01.a[lane], t10.a[lane], weight_s, weight_t));
+        } else {
+            set_color(filtered, lane, filter_channel(t00.r[lane], t10.r[lane], t01.r[lane], fraction_s, fraction_t),
+                      filter_channel(t00.g[lane], t10.g[lane], t01.g[lane], fraction_s, fraction_t),
+                      filter_channel(t00.b[lane], t10.b[lane], t01.b[lane], fraction_s, fraction_t),
+                      filter_channel(t00.a[lane], t10.a[lane], t01.a[lane], fraction_s, fraction_t));
+        }
+    }
+}
+
+ALWAYS_INLINE s32 combine_channel(const s32 a, const s32 b, const s32 c, const s32 d) {
+    return clamp_channel((((a - b) * c) + (d << 8) + 0x80) >> 8);
+}
+
+void combine_scalar(const CombineOperands& operands, ColorBatch& combined, const u32 count) {
+    const auto& [a, b, c, d] = operands;
+    for (u32 lane = 0; lane < count; lane++) {
+        set_color(combined, lane, combine_channel(a.r[lane], b.r[lane], c.r[lane], d.r[lane]),
+                  combine_channel(a.g[lane], b.g[lane], c.g[lane], d.g[lane]),
+                  combine_channel(a.b[lane], b.b[lane], c.b[lane], d.b[lane]),
+                  combine_channel(a.a[lane], b.a[lane], c.a[lane], d.a[lane]));
+    }
+}
+
+void blend_scalar(const BlendOperands& operands, ColorBatch& blended, const u32 count) {
+    const auto& [p, m, a, b] = operands;
+    for (u32 lane = 0; lane < count; lane++) {
+        const auto channel = [&](const s32 from_p, const s32 from_m) {
+            return clamp_channel((from_p * a[lane] + from_m * b[lane] + 0x7F) / 0xFF);
+        };
+        blended.r[lane] = channel(p.r[lane], m.r[lane]);
+        blended.g[lane] = channel(p.g[lane], m.g[lane]);
+        blended.b[lane] = channel(p.b[lane], m.b[lane]);
+    }
+}
+
+constexpr RDPKernels ScalarKernels = {
+    .fetch_texels = fetch_texels_scalar,
+    .filter_texels = filter_texels_scalar,
+    .combine = combine_scalar,
+    .blend = blend_scalar,
+};
+
+#ifdef RDP_KERNELS_X64
+// The vector kernels below follow the scalar ones step for step. Blending divides by 255 with a multiply-free
+// approximation, which is exact for every value the blender can produce once the result is clamped.
+
+// SSE4.1 kernels, four pixels per step. There is no gather, so TMEM reads go through the scalar units.
+
+TARGET_SSE41 ALWAYS_INLINE __m128i load_sse41(const s32* lanes) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+}
+
+TARGET_SSE41 ALWAYS_INLINE void store_sse41(s32* lanes, const __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), value);
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i clamp_channel_sse41(const __m128i value) {
+    return _mm_min_epi32(_mm_max_epi32(value, _mm_setzero_si128()), _mm_set1_epi32(0xFF));
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i expand_5_to_8_sse41(const __m128i value) {
+    return _mm_or_si128(_mm_slli_epi32(value, 3), _mm_srli_epi32(value, 2));
+}
+
+TARGET_SSE41 ALWAYS_INLINE void store_color_sse41(ColorBatch& batch, const u32 lane, const __m128i r, const __m128i g,
+                                                  const __m128i b, const __m128i a) {
+    store_sse41(&batch.r[lane], r);
+    store_sse41(&batch.g[lane], g);
+    store_sse41(&batch.b[lane], b);
+    store_sse41(&batch.a[lane], a);
+}
+
+TARGET_SSE41 ALWAYS_INLINE void store_rgba16_sse41(ColorBatch& batch, const u32 lane, const __m128i value) {
+    const __m128i mask = _mm_set1_epi32(0x1F);
+    store_color_sse41(batch, lane, expand_5_to_8_sse41(_mm_and_si128(_mm_srli_epi32(value, 11), mask)),
+                      expand_5_to_8_sse41(_mm_and_si128(_mm_srli_epi32(value, 6), mask)),
+                      expand_5_to_8_sse41(_mm_and_si128(_mm_srli_epi32(value, 1), mask)),
+                      _mm_and_si128(_mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi32(1))), _mm_set1_epi32(0xFF)));
+}
+
+TARGET_SSE41 ALWAYS_INLINE void store_intensity_alpha_sse41(ColorBatch& batch, const u32 lane, const __m128i intensity,
+                                                            const __m128i alpha) {
+    store_color_sse41(batch, lane, intensity, intensity, intensity, alpha);
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i gather_tmem8_sse41(const TMEM& tmem, const __m128i address) {
+    alignas(16) std::array<u32, 4> addresses;
+    _mm_store_si128(reinterpret_cast<__m128i*>(addresses.data()), address);
+    return _mm_setr_epi32(tmem[addresses[0] & 0xFFF], tmem[addresses[1] & 0xFFF], tmem[addresses[2] & 0xFFF],
+                          tmem[addresses[3] & 0xFFF]);
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i gather_tmem16_sse41(const TMEM& tmem, const __m128i address) {
+    alignas(16) std::array<u32, 4> addresses;
+    _mm_store_si128(reinterpret_cast<__m128i*>(addresses.data()), address);
+    return _mm_setr_epi32(read_tmem16(tmem, addresses[0]), read_tmem16(tmem, addresses[1]), read_tmem16(tmem, addresses[2]),
+                          read_tmem16(tmem, addresses[3]));
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i wrap_coordinate_sse41(__m128i coordinate, const Wrap& wrap) {
+    if (wrap.clamp) {
+        coordinate = _mm_min_epi32(_mm_max_epi32(coordinate, _mm_setzero_si128()), _mm_set1_epi32(wrap.max));
+    }
+    if (wrap.mask != 0) {
+        if (wrap.mirror) {
+            // All ones where the bit above the mask is set.
+            const __m128i mirrored = _mm_srai_epi32(_mm_sll_epi32(coordinate, _mm_cvtsi32_si128(31 - static_cast<s32>(wrap.mask))), 31);
+            coordinate = _mm_xor_si128(coordinate, mirrored);
+        }
+        coordinate = _mm_and_si128(coordinate, _mm_set1_epi32((1 << wrap.mask) - 1));
+    }
+    return coordinate;
+}
+
+TARGET_SSE41 ALWAYS_INLINE void store_palette_entries_sse41(const State& state, ColorBatch& batch, const u32 lane, const __m128i index) {
+    const __m128i address = _mm_add_epi32(_mm_set1_epi32(0x800), _mm_slli_epi32(_mm_and_si128(index, _mm_set1_epi32(0xFF)), 3));
+    const __m128i entry = gather_tmem16_sse41(*state.tmem, address);
+    if (state.tlut_intensity_alpha()) {
+        store_intensity_alpha_sse41(batch, lane, _mm_srli_epi32(entry, 8), _mm_and_si128(entry, _mm_set1_epi32(0xFF)));
+    } else {
+        store_rgba16_sse41(batch, lane, entry);
+    }
+}
+
+TARGET_SSE41 void fetch_texels_sse41(const State& state, const Tile& tile, const CoordinateBatch& coordinates, ColorBatch& texels,
+                                     const u32 count) {
+    const TMEM& tmem = *state.tmem;
+    const Wrap s_wrap = wrap_s(tile);
+    const Wrap t_wrap = wrap_t(tile);
+    const __m128i base = _mm_set1_epi32(static_cast<s32>(tile.tmem_address * 8));
+    const __m128i stride = _mm_set1_epi32(static_cast<s32>(tile.line * 8));
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i low_nibble = _mm_set1_epi32(0xF);
+    const __m128i low_byte = _mm_set1_epi32(0xFF);
+
+    for (u32 lane = 0; lane < count; lane += 4) {
+        const __m128i s = wrap_coordinate_sse41(load_sse41(&coordinates.s[lane]), s_wrap);
+        const __m128i t = wrap_coordinate_sse41(load_sse41(&coordinates.t[lane]), t_wrap);
+        const __m128i row = _mm_add_epi32(base, _mm_mullo_epi32(t, stride));
+        const __m128i swap = _mm_slli_epi32(_mm_and_si128(t, one), 2);
+
+        switch (tile.size) {
+            case ImageSize::Bits4: {
+                const __m128i byte = gather_tmem8_sse41(tmem, _mm_xor_si128(_mm_add_epi32(row, _mm_srli_epi32(s, 1)), swap));
+                const __m128i odd = _mm_cmpeq_epi32(_mm_and_si128(s, one), one);
+                const __m128i value = _mm_blendv_epi8(_mm_srli_epi32(byte, 4), _mm_and_si128(byte, low_nibble), odd);
+                if (state.tlut_enabled()) {
+                    store_palette_entries_sse41(state, texels, lane, _mm_or_si128(_mm_set1_epi32(static_cast<s32>(tile.palette << 4)), value));
+                } else if (tile.format == ImageFormat::IntensityAlpha) {
+                    const __m128i i = _mm_srli_epi32(value, 1);
+                    const __m128i intensity = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(i, 5), _mm_slli_epi32(i, 2)), _mm_srli_epi32(i, 1));
+                    store_intensity_alpha_sse41(texels, lane, intensity, _mm_and_si128(_mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)), low_byte));
+                } else {
+                    const __m128i intensity = _mm_or_si128(_mm_slli_epi32(value, 4), value);
+                    store_intensity_alpha_sse41(texels, lane, intensity, intensity);
+                }
+                break;
+            }
+
+            case ImageSize::Bits8: {
+                const __m128i value = gather_tmem8_sse41(tmem, _mm_xor_si128(_mm_add_epi32(row, s), swap));
+                if (state.tlut_enabled()) {
+                    store_palette_entries_sse41(state, texels, lane, value);
+                } else if (tile.format == ImageFormat::IntensityAlpha) {
+                    const __m128i high = _mm_srli_epi32(value, 4);
+                    const __m128i low = _mm_and_si128(value, low_nibble);
+                    store_intensity_alpha_sse41(texels, lane, _mm_or_si128(_mm_slli_epi32(high, 4), high), _mm_or_si128(_mm_slli_epi32(low, 4), low));
+                } else {
+                    store_intensity_alpha_sse41(texels, lane, value, value);
+                }
+                break;
+            }
+
+            case ImageSize::Bits16: {
+                const __m128i value = gather_tmem16_sse41(tmem, _mm_xor_si128(_mm_add_epi32(row, _mm_slli_epi32(s, 1)), swap));
+                if (tile.format == ImageFormat::IntensityAlpha) {
+                    store_intensity_alpha_sse41(texels, lane, _mm_srli_epi32(value, 8), _mm_and_si128(value, low_byte));
+                } else {
+                    store_rgba16_sse41(texels, lane, value);
+                }
+                break;
+            }
+
+            case ImageSize::Bits32: {
+                const __m128i address = _mm_and_si128(_mm_xor_si128(_mm_add_epi32(row, _mm_slli_epi32(s, 1)), swap), _mm_set1_epi32(0x7FF));
+                const __m128i red_green = gather_tmem16_sse41(tmem, address);
+                const __m128i blue_alpha = gather_tmem16_sse41(tmem, _mm_or_si128(address, _mm_set1_epi32(0x800)));
+                store_color_sse41(texels, lane, _mm_srli_epi32(red_green, 8), _mm_and_si128(red_green, low_byte),
+                                  _mm_srli_epi32(blue_alpha, 8), _mm_and_si128(blue_alpha, low_byte));
+                break;
+            }
+        }
+    }
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i filter_channel_sse41(const __m128i upper, const s32* t00, const s32* t10, const s32* t01,
+                                                        const s32* t11, const __m128i weight_s, const __m128i weight_t) {
+    const __m128i base = _mm_blendv_epi8(load_sse41(t00), load_sse41(t11), upper);
+    const __m128i along_s = _mm_blendv_epi8(load_sse41(t10), load_sse41(t01), upper);
+    const __m128i along_t = _mm_blendv_epi8(load_sse41(t01), load_sse41(t10), upper);
+    const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(along_s, base), weight_s),
+                                                    _mm_mullo_epi32(_mm_sub_epi32(along_t, base), weight_t)),
+                                      _mm_set1_epi32(0x10));
+    return clamp_channel_sse41(_mm_add_epi32(base, _mm_srai_epi32(sum, 5)));
+}
+
+TARGET_SSE41 void filter_texels_sse41(const ColorBatch& t00, const ColorBatch& t10, const ColorBatch& t01, const ColorBatch& t11,
+                                      const CoordinateBatch& fractions, ColorBatch& filtered, const u32 count) {
+    const __m128i full = _mm_set1_epi32(0x20);
+    for (u32 lane = 0; lane < count; lane += 4) {
+        const __m128i fraction_s = load_sse41(&fractions.s[lane]);
+        const __m128i fraction_t = load_sse41(&fractions.t[lane]);
+        const __m128i upper = _mm_cmpgt_epi32(_mm_add_epi32(fraction_s, fraction_t), _mm_set1_epi32(0x1F));
+        const __m128i weight_s = _mm_blendv_epi8(fraction_s, _mm_sub_epi32(full, fraction_s), upper);
+        const __m128i weight_t = _mm_blendv_epi8(fraction_t, _mm_sub_epi32(full, fraction_t), upper);
+        store_color_sse41(filtered, lane,
+                          filter_channel_sse41(upper, &t00.r[lane], &t10.r[lane], &t01.r[lane], &t11.r[lane], weight_s, weight_t),
+                          filter_channel_sse41(upper, &t00.g[lane], &t10.g[lane], &t01.g[lane], &t11.g[lane], weight_s, weight_t),
+                          filter_channel_sse41(upper, &t00.b[lane], &t10.b[lane], &t01.b[lane], &t11.b[lane], weight_s, weight_t),
+                          filter_channel_sse41(upper, &t00.a[lane], &t10.a[lane], &t01.a[lane], &t11.a[lane], weight_s, weight_t));
+    }
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i combine_channel_sse41(const s32* a, const s32* b, const s32* c, const s32* d) {
+    const __m128i product = _mm_mullo_epi32(_mm_sub_epi32(load_sse41(a), load_sse41(b)), load_sse41(c));
+    const __m128i sum = _mm_add_epi32(_mm_add_epi32(product, _mm_slli_epi32(load_sse41(d), 8)), _mm_set1_epi32(0x80));
+    return clamp_channel_sse41(_mm_srai_epi32(sum, 8));
+}
+
+TARGET_SSE41 void combine_sse41(const CombineOperands& operands, ColorBatch& combined, const u32 count) {
+    const auto& [a, b, c, d] = operands;
+    for (u32 lane = 0; lane < count; lane += 4) {
+        store_color_sse41(combined, lane, combine_channel_sse41(a.r + lane, b.r + lane, c.r + lane, d.r + lane),
+                          combine_channel_sse41(a.g + lane, b.g + lane, c.g + lane, d.g + lane),
+                          combine_channel_sse41(a.b + lane, b.b + lane, c.b + lane, d.b + lane),
+                          combine_channel_sse41(a.a + lane, b.a + lane, c.a + lane, d.a + lane));
+    }
+}
+
+TARGET_SSE41 ALWAYS_INLINE __m128i blend_channel_sse41(const s32* p, const s32* m, const __m128i a, const __m128i b) {
+    const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(load_sse41(p), a), _mm_mullo_epi32(load_sse41(m), b)),
+                                      _mm_set1_epi32(0x7F));
+    const __m128i quotient = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1)), _mm_srli_epi32(sum, 8)), 8);
+    return _mm_min_epi32(quotient, _mm_set1_epi32(0xFF));
+}
+
+TARGET_SSE41 void blend_sse41(const BlendOperands& operands, ColorBatch& blended, const u32 count) {
+    const auto& [p, m, a, b] = operands;
+    for (u32 lane = 0; lane < count; lane += 4) {
+        const __m128i alpha_a = load_sse41(a + lane);
+        const __m128i alpha_b = load_sse41(b + lane);
+        store_sse41(&blended.r[lane], blend_channel_sse41(p.r + lane, m.r + lane, alpha_a, alpha_b));
+        store_sse41(&blended.g[lane], blend_channel_sse41(p.g + lane, m.g + lane, alpha_a, alpha_b));
+        store_sse41(&blended.b[lane], blend_channel_sse41(p.b + lane, m.b + lane, alpha_a, alpha_b));
+    }
+}
+
+constexpr RDPKernels SSE41Kernels = {
+    .fetch_texels = fetch_texels_sse41,
+    .filter_texels = filter_texels_sse41,
+    .combine = combine_sse41,
+    .blend = blend_sse41,
+};
+
+// AVX2 kernels, eight pixels per step. TMEM is read with gathers of the aligned words holding each texel, so that no
+// read goes past its end.
+
+TARGET_AVX2 ALWAYS_INLINE __m256i load_avx2(const s32* lanes) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+}
+
+TARGET_AVX2 ALWAYS_INLINE void store_avx2(s32* lanes, const __m256i value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), value);
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i clamp_channel_avx2(const __m256i value) {
+    return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(0xFF));
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i expand_5_to_8_avx2(const __m256i value) {
+    return _mm256_or_si256(_mm256_slli_epi32(value, 3), _mm256_srli_epi32(value, 2));
+}
+
+TARGET_AVX2 ALWAYS_INLINE void store_color_avx2(ColorBatch& batch, const u32 lane, const __m256i r, const __m256i g,
+                                                const __m256i b, const __m256i a) {
+    store_avx2(&batch.r[lane], r);
+    store_avx2(&batch.g[lane], g);
+    store_avx2(&batch.b[lane], b);
+    store_avx2(&batch.a[lane], a);
+}
+
+TARGET_AVX2 ALWAYS_INLINE void store_rgba16_avx2(ColorBatch& batch, const u32 lane, const __m256i value) {
+    const __m256i mask = _mm256_set1_epi32(0x1F);
+    store_color_avx2(batch, lane, expand_5_to_8_avx2(_mm256_and_si256(_mm256_srli_epi32(value, 11), mask)),
+                     expand_5_to_8_avx2(_mm256_and_si256(_mm256_srli_epi32(value, 6), mask)),
+                     expand_5_to_8_avx2(_mm256_and_si256(_mm256_srli_epi32(value, 1), mask)),
+                     _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(value, _mm256_set1_epi32(1))),
+                                      _mm256_set1_epi32(0xFF)));
+}
+
+TARGET_AVX2 ALWAYS_INLINE void store_intensity_alpha_avx2(ColorBatch& batch, const u32 lane, const __m256i intensity,
+                                                          const __m256i alpha) {
+    store_color_avx2(batch, lane, intensity, intensity, intensity, alpha);
+}
+
+// The word holding each address, shifted so that the byte at the address is in the low bits.
+TARGET_AVX2 ALWAYS_INLINE __m256i gather_tmem_word_avx2(const TMEM& tmem, const __m256i address) {
+    const __m256i word_address = _mm256_and_si256(address, _mm256_set1_epi32(0xFFC));
+    const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(tmem.data()), word_address, 1);
+    return _mm256_srlv_epi32(words, _mm256_slli_epi32(_mm256_and_si256(address, _mm256_set1_epi32(3)), 3));
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i gather_tmem8_avx2(const TMEM& tmem, const __m256i address) {
+    return _mm256_and_si256(gather_tmem_word_avx2(tmem, address), _mm256_set1_epi32(0xFF));
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i gather_tmem16_avx2(const TMEM& tmem, const __m256i address) {
+    // TMEM is big endian, so the two bytes come out swapped.
+    const __m256i bytes = gather_tmem_word_avx2(tmem, _mm256_and_si256(address, _mm256_set1_epi32(0xFFE)));
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    return _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bytes, low_byte), 8), _mm256_and_si256(_mm256_srli_epi32(bytes, 8), low_byte));
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i wrap_coordinate_avx2(__m256i coordinate, const Wrap& wrap) {
+    if (wrap.clamp) {
+        coordinate = _mm256_min_epi32(_mm256_max_epi32(coordinate, _mm256_setzero_si256()), _mm256_set1_epi32(wrap.max));
+    }
+    if (wrap.mask != 0) {
+        if (wrap.mirror) {
+            const __m256i mirrored = _mm256_srai_epi32(_mm256_sll_epi32(coordinate, _mm_cvtsi32_si128(31 - static_cast<s32>(wrap.mask))), 31);
+            coordinate = _mm256_xor_si256(coordinate, mirrored);
+        }
+        coordinate = _mm256_and_si256(coordinate, _mm256_set1_epi32((1 << wrap.mask) - 1));
+    }
+    return coordinate;
+}
+
+TARGET_AVX2 ALWAYS_INLINE void store_palette_entries_avx2(const State& state, ColorBatch& batch, const u32 lane, const __m256i index) {
+    const __m256i address = _mm256_add_epi32(_mm256_set1_epi32(0x800), _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(0xFF)), 3));
+    const __m256i entry = gather_tmem16_avx2(*state.tmem, address);
+    if (state.tlut_intensity_alpha()) {
+        store_intensity_alpha_avx2(batch, lane, _mm256_srli_epi32(entry, 8), _mm256_and_si256(entry, _mm256_set1_epi32(0xFF)));
+    } else {
+        store_rgba16_avx2(batch, lane, entry);
+    }
+}
+
+TARGET_AVX2 void fetch_texels_avx2(const State& state, const Tile& tile, const CoordinateBatch& coordinates, ColorBatch& texels,
+                                   const u32 count) {
+    const TMEM& tmem = *state.tmem;
+    const Wrap s_wrap = wrap_s(tile);
+    const Wrap t_wrap = wrap_t(tile);
+    const __m256i base = _mm256_set1_epi32(static_cast<s32>(tile.tmem_address * 8));
+    const __m256i stride = _mm256_set1_epi32(static_cast<s32>(tile.line * 8));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i low_nibble = _mm256_set1_epi32(0xF);
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+
+    for (u32 lane = 0; lane < count; lane += 8) {
+        const __m256i s = wrap_coordinate_avx2(load_avx2(&coordinates.s[lane]), s_wrap);
+        const __m256i t = wrap_coordinate_avx2(load_avx2(&coordinates.t[lane]), t_wrap);
+        const __m256i row = _mm256_add_epi32(base, _mm256_mullo_epi32(t, stride));
+        const __m256i swap = _mm256_slli_epi32(_mm256_and_si256(t, one), 2);
+
+        switch (tile.size) {
+            case ImageSize::Bits4: {
+                const __m256i byte = gather_tmem8_avx2(tmem, _mm256_xor_si256(_mm256_add_epi32(row, _mm256_srli_epi32(s, 1)), swap));
+                // Even texels are in the high nibble.
+                const __m256i shift = _mm256_xor_si256(_mm256_slli_epi32(_mm256_and_si256(s, one), 2), _mm256_set1_epi32(4));
+                const __m256i value = _mm256_and_si256(_mm256_srlv_epi32(byte, shift), low_nibble);
+                if (state.tlut_enabled()) {
+                    store_palette_entries_avx2(state, texels, lane, _mm256_or_si256(_mm256_set1_epi32(static_cast<s32>(tile.palette << 4)), value));
+                } else if (tile.format == ImageFormat::IntensityAlpha) {
+                    const __m256i i = _mm256_srli_epi32(value, 1);
+                    const __m256i intensity = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(i, 5), _mm256_slli_epi32(i, 2)), _mm256_srli_epi32(i, 1));
+                    store_intensity_alpha_avx2(texels, lane, intensity,
+                                               _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(value, one)), low_byte));
+                } else {
+                    const __m256i intensity = _mm256_or_si256(_mm256_slli_epi32(value, 4), value);
+                    store_intensity_alpha_avx2(texels, lane, intensity, intensity);
+                }
+                break;
+            }
+
+            case ImageSize::Bits8: {
+                const __m256i value = gather_tmem8_avx2(tmem, _mm256_xor_si256(_mm256_add_epi32(row, s), swap));
+                if (state.tlut_enabled()) {
+                    store_palette_entries_avx2(state, texels, lane, value);
+                } else if (tile.format == ImageFormat::IntensityAlpha) {
+                    const __m256i high = _mm256_srli_epi32(value, 4);
+                    const __m256i low = _mm256_and_si256(value, low_nibble);
+                    store_intensity_alpha_avx2(texels, lane, _mm256_or_si256(_mm256_slli_epi32(high, 4), high),
+                                               _mm256_or_si256(_mm256_slli_epi32(low, 4), low));
+                } else {
+                    store_intensity_alpha_avx2(texels, lane, value, value);
+                }
+                break;
+            }
+
+            case ImageSize::Bits16: {
+                const __m256i value = gather_tmem16_avx2(tmem, _mm256_xor_si256(_mm256_add_epi32(row, _mm256_slli_epi32(s, 1)), swap));
+                if (tile.format == ImageFormat::IntensityAlpha) {
+                    store_intensity_alpha_avx2(texels, lane, _mm256_srli_epi32(value, 8), _mm256_and_si256(value, low_byte));
+                } else {
+                    store_rgba16_avx2(texels, lane, value);
+                }
+                break;
+            }
+
+            case ImageSize::Bits32: {
+                const __m256i address = _mm256_and_si256(_mm256_xor_si256(_mm256_add_epi32(row, _mm256_slli_epi32(s, 1)), swap),
+                                                         _mm256_set1_epi32(0x7FF));
+                const __m256i red_green = gather_tmem16_avx2(tmem, address);
+                const __m256i blue_alpha = gather_tmem16_avx2(tmem, _mm256_or_si256(address, _mm256_set1_epi32(0x800)));
+                store_color_avx2(texels, lane, _mm256_srli_epi32(red_green, 8), _mm256_and_si256(red_green, low_byte),
+                                 _mm256_srli_epi32(blue_alpha, 8), _mm256_and_si256(blue_alpha, low_byte));
+                break;
+            }
+        }
+    }
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i filter_channel_avx2(const __m256i upper, const s32* t00, const s32* t10, const s32* t01,
+                                                      const s32* t11, const __m256i weight_s, const __m256i weight_t) {
+    const __m256i base = _mm256_blendv_epi8(load_avx2(t00), load_avx2(t11), upper);
+    const __m256i along_s = _mm256_blendv_epi8(load_avx2(t10), load_avx2(t01), upper);
+    const __m256i along_t = _mm256_blendv_epi8(load_avx2(t01), load_avx2(t10), upper);
+    const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(along_s, base), weight_s),
+                                                          _mm256_mullo_epi32(_mm256_sub_epi32(along_t, base), weight_t)),
+                                         _mm256_set1_epi32(0x10));
+    return clamp_channel_avx2(_mm256_add_epi32(base, _mm256_srai_epi32(sum, 5)));
+}
+
+TARGET_AVX2 void filter_texels_avx2(const ColorBatch& t00, const ColorBatch& t10, const ColorBatch& t01, const ColorBatch& t11,
+                                    const CoordinateBatch& fractions, ColorBatch& filtered, const u32 count) {
+    const __m256i full = _mm256_set1_epi32(0x20);
+    for (u32 lane = 0; lane < count; lane += 8) {
+        const __m256i fraction_s = load_avx2(&fractions.s[lane]);
+        const __m256i fraction_t = load_avx2(&fractions.t[lane]);
+        const __m256i upper = _mm256_cmpgt_epi32(_mm256_add_epi32(fraction_s, fraction_t), _mm256_set1_epi32(0x1F));
+        const __m256i weight_s = _mm256_blendv_epi8(fraction_s, _mm256_sub_epi32(full, fraction_s), upper);
+        const __m256i weight_t = _mm256_blendv_epi8(fraction_t, _mm256_sub_epi32(full, fraction_t), upper);
+        store_color_avx2(filtered, lane,
+                         filter_channel_avx2(upper, &t00.r[lane], &t10.r[lane], &t01.r[lane], &t11.r[lane], weight_s, weight_t),
+                         filter_channel_avx2(upper, &t00.g[lane], &t10.g[lane], &t01.g[lane], &t11.g[lane], weight_s, weight_t),
+                         filter_channel_avx2(upper, &t00.b[lane], &t10.b[lane], &t01.b[lane], &t11.b[lane], weight_s, weight_t),
+                         filter_channel_avx2(upper, &t00.a[lane], &t10.a[lane], &t01.a[lane], &t11.a[lane], weight_s, weight_t));
+    }
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i combine_channel_avx2(const s32* a, const s32* b, const s32* c, const s32* d) {
+    const __m256i product = _mm256_mullo_epi32(_mm256_sub_epi32(load_avx2(a), load_avx2(b)), load_avx2(c));
+    const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(product, _mm256_slli_epi32(load_avx2(d), 8)), _mm256_set1_epi32(0x80));
+    return clamp_channel_avx2(_mm256_srai_epi32(sum, 8));
+}
+
+TARGET_AVX2 void combine_avx2(const CombineOperands& operands, ColorBatch& combined, const u32 count) {
+    const auto& [a, b, c, d] = operands;
+    for (u32 lane = 0; lane < count; lane += 8) {
+        store_color_avx2(combined, lane, combine_channel_avx2(a.r + lane, b.r + lane, c.r + lane, d.r + lane),
+                         combine_channel_avx2(a.g + lane, b.g + lane, c.g + lane, d.g + lane),
+                         combine_channel_avx2(a.b + lane, b.b + lane, c.b + lane, d.b + lane),
+                         combine_channel_avx2(a.a + lane, b.a + lane, c.a + lane, d.a + lane));
+    }
+}
+
+TARGET_AVX2 ALWAYS_INLINE __m256i blend_channel_avx2(const s32* p, const s32* m, const __m256i a, const __m256i b) {
+    const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(load_avx2(p), a), _mm256_mullo_epi32(load_avx2(m), b)),
+                                         _mm256_set1_epi32(0x7F));
+    const __m256i quotient = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(1)), _mm256_srli_epi32(sum, 8)), 8);
+    return _mm256_min_epi32(quotient, _mm256_set1_epi32(0xFF));
+}
+
+TARGET_AVX2 void blend_avx2(const BlendOperands& operands, ColorBatch& blended, const u32 count) {
+    const auto& [p, m, a, b] = operands;
+    for (u32 lane = 0; lane < count; lane += 8) {
+        const __m256i alpha_a = load_avx2(a + lane);
+        const __m256i alpha_b = load_avx2(b + lane);
+        store_avx2(&blended.r[lane], blend_channel_avx2(p.r + lane, m.r + lane, alpha_a, alpha_b));
+        store_avx2(&blended.g[lane], blend_channel_avx2(p.g + lane, m.g + lane, alpha_a, alpha_b));
+        store_avx2(&blended.b[lane], blend_channel_avx2(p.b + lane, m.b + lane, alpha_a, alpha_b));
+    }
+}
+
+constexpr RDPKernels AVX2Kernels = {
+    .fetch_texels = fetch_texels_avx2,
+    .filter_texels = filter_texels_avx2,
+    .combine = combine_avx2,
+    .blend = blend_avx2,
+};
+#endif
+
+}
+
+const RDPKernels& RDPKernels::scalar() {
+    return ScalarKernels;
+}
+
+const RDPKernels* RDPKernels::sse41() {
+#ifdef RDP_KERNELS_X64
+    return __builtin_cpu_supports("sse4.1") ? &SSE41Kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const RDPKernels* RDPKernels::avx2() {
+#ifdef RDP_KERNELS_X64
+    return __builtin_cpu_supports("avx2") ? &AVX2Kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const RDPKernels& RDPKernels::best() {
+    static const RDPKernels& kernels = []() -> const RDPKernels& {
+        if (const RDPKernels* set = avx2()) {
+            return *set;
+        }
+        if (const RDPKernels* set = sse41()) {
+            return *set;
+        }
+        return ScalarKernels;
+    }();
+    return kernels;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include "common/types.h"
+#include "rdp_rasterizer.h"
+
+// The per-pixel stages of the RDP pipeline, run on batches of pixels from a span.
+//
+// Every stage has a scalar version, which is the reference, and SSE4.1 and AVX2 versions that work on four and eight
+// pixels per step. The fastest set the host supports is picked once, at startup. The scalar set can be forced with
+// FOURIXTYS_RDP_SCALAR_KERNELS; tests/rdp_kernels_test.cpp checks that every set gives the same results bit for bit.
+struct RDPKernels {
+    static constexpr u32 BatchSize = 16;
+
+    // One value per pixel of the batch. Lanes past the pixel count are computed too and must be ignored.
+    using Lanes = std::array<s32, BatchSize>;
+
+    // Channels are kept apart, so that a vector holds the same channel of consecutive pixels.
+    struct alignas(32) ColorBatch {
+        Lanes r, g, b, a;
+    };
+
+    struct alignas(32) CoordinateBatch {
+        Lanes s, t;
+    };
+
+    // Where each channel of a combiner or blender input comes from. Constant inputs point to broadcast lanes.
+    struct Operand {
+        const s32* r;
+        const s32* g;
+        const s32* b;
+        const s32* a;
+    };
+
+    struct CombineOperands {
+        Operand sub_a, sub_b, multiply, add;
+    };
+
+    // Only the color channels of P and M are used.
+    struct BlendOperands {
+        Operand p, m;
+        const s32* a;
+        const s32* b;
+    };
+
+    // Wraps the texel coordinates of a tile, in whole texels, then reads and decodes the texels from TMEM.
+    void (*fetch_texels)(const RDPRasterizer::State& state, const RDPRasterizer::Tile& tile,
+                         const CoordinateBatch& coordinates, ColorBatch& texels, u32 count);
+
+    // Filters between the texels around each sample, picking three of them by the fractions, in 1/32 texels.
+    void (*filter_texels)(const ColorBatch& t00, const ColorBatch& t10, const ColorBatch& t01, const ColorBatch& t11,
+                          const CoordinateBatch& fractions, ColorBatch& filtered, u32 count);
+
+    // (A - B) * C + D, on every channel.
+    void (*combine)(const CombineOperands& operands, ColorBatch& combined, u32 count);
+
+    // (P * A + M * B) / 255 on the color channels. Alpha is left alone.
+    void (*blend)(const BlendOperands& operands, ColorBatch& blended, u32 count);
+
+    static const RDPKernels& scalar();
+    // Null where the host, or the build, cannot run them.
+    static const RDPKernels* sse41();
+    static const RDPKernels* avx2();
+    // The kernels used for drawing.
+    static const RDPKernels& best();
+};
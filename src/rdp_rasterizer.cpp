@@ -0,0 +1,848 @@
+#include <algorithm>
+#include <cmath>
+#include "common/bits.h"
+#include "rdp_kernels.h"
+#include "rdp_rasterizer.h"
+
+namespace {
+
+using Lanes = RDPKernels::Lanes;
+using ColorBatch = RDPKernels::ColorBatch;
+using CoordinateBatch = RDPKernels::CoordinateBatch;
+using Operand = RDPKernels::Operand;
+
+struct Color {
+    s32 r, g, b, a;
+};
+
+ALWAYS_INLINE s32 clamp_channel(const f32 value) {
+    return static_cast<s32>(std::clamp(value, 0.0f, 255.0f));
+}
+
+ALWAYS_INLINE Color color_from_rgba16(const u16 value) {
+    const s32 r = (value >> 11) & 0x1F;
+    const s32 g = (value >> 6) & 0x1F;
+    const s32 b = (value >> 1) & 0x1F;
+    return { (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (value & 1) ? 0xFF : 0x00 };
+}
+
+ALWAYS_INLINE u16 color_to_rgba16(const Color& color) {
+    return static_cast<u16>(((color.r >> 3) << 11) | ((color.g >> 3) << 6) | ((color.b >> 3) << 1) | (color.a >> 7));
+}
+
+ALWAYS_INLINE Color color_from_rgba32(const u32 value) {
+    return { static_cast<s32>(value >> 24), static_cast<s32>((value >> 16) & 0xFF), static_cast<s32>((value >> 8) & 0xFF),
+             static_cast<s32>(value & 0xFF) };
+}
+
+ALWAYS_INLINE Color get_color(const ColorBatch& batch, const u32 lane) {
+    return { batch.r[lane], batch.g[lane], batch.b[lane], batch.a[lane] };
+}
+
+ALWAYS_INLINE void set_color(ColorBatch& batch, const u32 lane, const Color& color) {
+    batch.r[lane] = color.r;
+    batch.g[lane] = color.g;
+    batch.b[lane] = color.b;
+    batch.a[lane] = color.a;
+}
+
+Lanes broadcast(const s32 value) {
+    Lanes lanes;
+    lanes.fill(value);
+    return lanes;
+}
+
+ColorBatch broadcast(const std::array<u8, 4>& color) {
+    return { broadcast(color[0]), broadcast(color[1]), broadcast(color[2]), broadcast(color[3]) };
+}
+
+ALWAYS_INLINE Operand operand(const ColorBatch& batch) {
+    return { batch.r.data(), batch.g.data(), batch.b.data(), batch.a.data() };
+}
+
+ALWAYS_INLINE Operand splat(const Lanes& lanes) {
+    return { lanes.data(), lanes.data(), lanes.data(), lanes.data() };
+}
+
+ALWAYS_INLINE s32 shift_coordinate(const s32 coordinate, const u32 shift) {
+    if (shift == 0) {
+        return coordinate;
+    }
+    // 1 to 10 shift right, 11 to 15 shift left by 16 minus the value.
+    return shift < 11 ? coordinate >> shift : coordinate << (16 - shift);
+}
+
+// Texture coordinates come in as 10.5 texels.
+void sample_texture(const RDPKernels& kernels, const RDPRasterizer::State& state, const u32 tile_index,
+                    const CoordinateBatch& coordinates, const bool filter, ColorBatch& texels, const u32 count) {
+    const RDPRasterizer::Tile& tile = state.tiles[tile_index & 7];
+
+    CoordinateBatch whole {};
+    CoordinateBatch fractions {};
+    for (u32 lane = 0; lane < count; lane++) {
+        const s32 tile_s = shift_coordinate(coordinates.s[lane], tile.shift_s) - static_cast<s32>(tile.sl << 3);
+        const s32 tile_t = shift_coordinate(coordinates.t[lane], tile.shift_t) - static_cast<s32>(tile.tl << 3);
+        whole.s[lane] = tile_s >> 5;
+        whole.t[lane] = tile_t >> 5;
+        fractions.s[lane] = tile_s & 0x1F;
+        fractions.t[lane] = tile_t & 0x1F;
+    }
+
+    if (!filter) {
+        kernels.fetch_texels(state, tile, whole, texels, count);
+        return;
+    }
+
+    ColorBatch t00, t10, t01, t11;
+    kernels.fetch_texels(state, tile, whole, t00, count);
+    CoordinateBatch neighbor = whole;
+    for (u32 lane = 0; lane < count; lane++) {
+        neighbor.s[lane]++;
+    }
+    kernels.fetch_texels(state, tile, neighbor, t10, count);
+    for (u32 lane = 0; lane < count; lane++) {
+        neighbor.t[lane]++;
+    }
+    kernels.fetch_texels(state, tile, neighbor, t11, count);
+    for (u32 lane = 0; lane < count; lane++) {
+        neighbor.s[lane]--;
+    }
+    kernels.fetch_texels(state, tile, neighbor, t01, count);
+    kernels.filter_texels(t00, t10, t01, t11, fractions, texels, count);
+}
+
+// The color combiner computes (A - B) * C + D, on color and alpha separately, once or twice per pixel.
+struct Combiner {
+    struct Cycle {
+        u32 sub_a_rgb, sub_b_rgb, multiply_rgb, add_rgb;
+        u32 sub_a_alpha, sub_b_alpha, multiply_alpha, add_alpha;
+    };
+    std::array<Cycle, 2> cycles;
+
+    explicit Combiner(const u64 combine) {
+        cycles[0] = {
+            static_cast<u32>((combine >> 52) & 0xF), static_cast<u32>((combine >> 28) & 0xF),
+            static_cast<u32>((combine >> 47) & 0x1F), static_cast<u32>((combine >> 15) & 0x7),
+            static_cast<u32>((combine >> 44) & 0x7), static_cast<u32>((combine >> 12) & 0x7),
+            static_cast<u32>((combine >> 41) & 0x7), static_cast<u32>((combine >> 9) & 0x7),
+        };
+        cycles[1] = {
+            static_cast<u32>((combine >> 37) & 0xF), static_cast<u32>((combine >> 24) & 0xF),
+            static_cast<u32>((combine >> 32) & 0x1F), static_cast<u32>((combine >> 6) & 0x7),
+            static_cast<u32>((combine >> 21) & 0x7), static_cast<u32>((combine >> 3) & 0x7),
+            static_cast<u32>((combine >> 18) & 0x7), static_cast<u32>((combine >> 0) & 0x7),
+        };
+    }
+};
+
+struct CombinerInputs {
+    const ColorBatch& combined;
+    const ColorBatch& texel0;
+    const ColorBatch& texel1;
+    const ColorBatch& primitive;
+    const ColorBatch& shade;
+    const ColorBatch& environment;
+    const Lanes& noise;
+    const Lanes& lod_fraction;
+    const Lanes& primitive_lod_fraction;
+    const Lanes& one;
+    const Lanes& zero;
+};
+
+// The first six inputs are the same for every slot, what comes after differs.
+ALWAYS_INLINE const ColorBatch* common_input(const CombinerInputs& in, const u32 select) {
+    switch (select) {
+        case 0: return &in.combined;
+        case 1: return &in.texel0;
+        case 2: return &in.texel1;
+        case 3: return &in.primitive;
+        case 4: return &in.shade;
+        case 5: return &in.environment;
+        default: return nullptr;
+    }
+}
+
+ALWAYS_INLINE Operand rgb_input(const CombinerInputs& in, const u32 select) {
+    if (const ColorBatch* batch = common_input(in, select)) {
+        return operand(*batch);
+    }
+    return splat(select == 6 ? in.one : in.zero);
+}
+
+ALWAYS_INLINE const s32* alpha_input(const CombinerInputs& in, const u32 select) {
+    if (const ColorBatch* batch = common_input(in, select)) {
+        return batch->a.data();
+    }
+    return select == 6 ? in.one.data() : in.zero.data();
+}
+
+RDPKernels::CombineOperands combiner_operands(const Combiner::Cycle& cycle, const CombinerInputs& in) {
+    Operand a;
+    if (cycle.sub_a_rgb == 7) {
+        a = splat(in.noise);
+    } else {
+        a = cycle.sub_a_rgb < 7 ? rgb_input(in, cycle.sub_a_rgb) : splat(in.zero);
+    }
+
+    // Key center and K4 are not emulated.
+    Operand b = cycle.sub_b_rgb < 6 ? rgb_input(in, cycle.sub_b_rgb) : splat(in.zero);
+
+    Operand c;
+    switch (cycle.multiply_rgb) {
+        case 7: c = splat(in.combined.a); break;
+        case 8: c = splat(in.texel0.a); break;
+        case 9: c = splat(in.texel1.a); break;
+        case 10: c = splat(in.primitive.a); break;
+        case 11: c = splat(in.shade.a); break;
+        case 12: c = splat(in.environment.a); break;
+        case 13: c = splat(in.lod_fraction); break;
+        case 14: c = splat(in.primitive_lod_fraction); break;
+        default: c = cycle.multiply_rgb < 6 ? rgb_input(in, cycle.multiply_rgb) : splat(in.zero); break;
+    }
+
+    Operand d = rgb_input(in, cycle.add_rgb);
+
+    a.a = alpha_input(in, cycle.sub_a_alpha);
+    b.a = alpha_input(in, cycle.sub_b_alpha);
+    switch (cycle.multiply_alpha) {
+        case 0: c.a = in.lod_fraction.data(); break;
+        case 6: c.a = in.primitive_lod_fraction.data(); break;
+        case 7: c.a = in.zero.data(); break;
+        default: c.a = alpha_input(in, cycle.multiply_alpha); break;
+    }
+    d.a = alpha_input(in, cycle.add_alpha);
+
+    return { a, b, c, d };
+}
+
+// The blender computes (P * A + M * B) / (A + B) between the combiner output and what is in memory.
+struct Blender {
+    struct Cycle {
+        u32 p, a, m, b;
+    };
+    std::array<Cycle, 2> cycles;
+
+    explicit Blender(const u32 other_modes_low) {
+        for (u32 i = 0; i < 2; i++) {
+            cycles[i] = {
+                (other_modes_low >> (30 - i * 2)) & 0b11,
+                (other_modes_low >> (26 - i * 2)) & 0b11,
+                (other_modes_low >> (22 - i * 2)) & 0b11,
+                (other_modes_low >> (18 - i * 2)) & 0b11,
+            };
+        }
+    }
+};
+
+struct BlenderInputs {
+    const ColorBatch& pixel;
+    const ColorBatch& memory;
+    const ColorBatch& blend_color;
+    const ColorBatch& fog_color;
+    const ColorBatch& shade;
+    const Lanes& one;
+    const Lanes& zero;
+    // Where 1 - A is worked out, when B asks for it.
+    const Lanes& inverse_alpha;
+};
+
+ALWAYS_INLINE const ColorBatch& blender_color_input(const BlenderInputs& in, const u32 select) {
+    switch (select) {
+        case 0: return in.pixel;
+        case 1: return in.memory;
+        case 2: return in.blend_color;
+        default: return in.fog_color;
+    }
+}
+
+RDPKernels::BlendOperands blender_operands(const Blender::Cycle& cycle, const BlenderInputs& in) {
+    const s32* a;
+    switch (cycle.a) {
+        case 0: a = in.pixel.a.data(); break;
+        case 1: a = in.fog_color.a.data(); break;
+        case 2: a = in.shade.a.data(); break;
+        default: a = in.zero.data(); break;
+    }
+
+    const s32* b;
+    switch (cycle.b) {
+        case 0: b = in.inverse_alpha.data(); break;
+        case 1: b = in.memory.a.data(); break;
+        case 2: b = in.one.data(); break;
+        default: b = in.zero.data(); break;
+    }
+
+    return { operand(blender_color_input(in, cycle.p)), operand(blender_color_input(in, cycle.m)), a, b };
+}
+
+void blend(const RDPKernels& kernels, const RDPKernels::BlendOperands& operands, Lanes& inverse_alpha, ColorBatch& blended,
+           const u32 count) {
+    if (operands.b == inverse_alpha.data()) {
+        for (u32 lane = 0; lane < count; lane++) {
+            inverse_alpha[lane] = 0xFF - operands.a[lane];
+        }
+    }
+    kernels.blend(operands, blended, count);
+}
+
+// Depth is stored as a 14-bit float: a 3-bit exponent counting the leading ones of the 18-bit value, and an 11-bit
+// mantissa.
+ALWAYS_INLINE u16 compress_z(const u32 z) {
+    const u32 exponent = std::min<u32>(std::countl_one(static_cast<u32>(z << 14)), 7);
+    const u32 shift = exponent >= 6 ? 0 : 6 - exponent;
+    return static_cast<u16>((exponent << 11) | ((z >> shift) & 0x7FF));
+}
+
+ALWAYS_INLINE u32 decompress_z(const u16 compressed) {
+    static constexpr std::array<u32, 8> Bases = { 0x00000, 0x20000, 0x30000, 0x38000, 0x3C000, 0x3E000, 0x3F000, 0x3F800 };
+    static constexpr std::array<u32, 8> Shifts = { 6, 5, 4, 3, 2, 1, 0, 0 };
+    const u32 exponent = (compressed >> 11) & 0x7;
+    return Bases[exponent] | ((compressed & 0x7FF) << Shifts[exponent]);
+}
+
+ALWAYS_INLINE s32 noise(const s32 x, const s32 y) {
+    u32 hash = static_cast<u32>(x) * 0x9E3779B1 ^ static_cast<u32>(y) * 0x85EBCA77;
+    hash ^= hash >> 15;
+    return static_cast<s32>(hash & 0xFF);
+}
+
+// The mode bits the one and two cycle span loops are specialized on, packed into a key. The texture format is left
+// out: fetch_texels switches on it once per batch instead of per pixel, and in two cycle mode the two tiles can differ.
+namespace SpanMode {
+enum : u32 {
+    TwoCycle = 1 << 0,
+    Texture = 1 << 1,
+    Filter = 1 << 2,
+    ZCompare = 1 << 3,
+    ZUpdate = 1 << 4,
+    Color32 = 1 << 5,
+    AlphaCompare = 1 << 6,
+    ForceBlend = 1 << 7,
+
+    Count = 1 << 8,
+};
+}
+
+u32 span_mode(const RDPRasterizer::Primitive& primitive) {
+    const RDPRasterizer::State& state = *primitive.state;
+    u32 mode = 0;
+    if (state.cycle_type() == RDPRasterizer::CycleType::TwoCycle) {
+        mode |= SpanMode::TwoCycle;
+    }
+    if (primitive.texture) {
+        mode |= SpanMode::Texture;
+        if (state.bilinear_filtering()) {
+            mode |= SpanMode::Filter;
+        }
+    }
+    if (primitive.zbuffer && state.z_compare()) {
+        mode |= SpanMode::ZCompare;
+    }
+    if (primitive.zbuffer && state.z_update()) {
+        mode |= SpanMode::ZUpdate;
+    }
+    if (state.color_image_size == RDPRasterizer::ImageSize::Bits32) {
+        mode |= SpanMode::Color32;
+    }
+    if (state.alpha_compare()) {
+        mode |= SpanMode::AlphaCompare;
+    }
+    if (state.force_blend()) {
+        mode |= SpanMode::ForceBlend;
+    }
+    return mode;
+}
+
+// The modes games draw most with get a span loop of their own. 32-bit color images and depth updates without the
+// compare are rare enough to be left to the generic loop, as are modes that can't happen.
+constexpr bool is_specialized_span_mode(const u32 mode) {
+    if (mode & SpanMode::Color32) {
+        return false;
+    }
+    if ((mode & SpanMode::ZUpdate) && !(mode & SpanMode::ZCompare)) {
+        return false;
+    }
+    if ((mode & SpanMode::Filter) && !(mode & SpanMode::Texture)) {
+        return false;
+    }
+    return true;
+}
+
+// A mode fixed at compile time, which folds away every test on it.
+template <u32 Mode>
+struct FixedSpanMode {
+    explicit FixedSpanMode(const RDPRasterizer::Primitive&) {}
+    static constexpr bool has(const u32 bits) { return (Mode & bits) != 0; }
+};
+
+// The mode of the primitive, tested as the span is drawn.
+struct GenericSpanMode {
+    explicit GenericSpanMode(const RDPRasterizer::Primitive& primitive) : mode(span_mode(primitive)) {}
+    bool has(const u32 bits) const { return (mode & bits) != 0; }
+
+    u32 mode;
+};
+
+}
+
+RDPRasterizer::RDPRasterizer(std::array<u8, 0x400000>& rdram, const u32 thread_count)
+    : m_rdram(rdram), m_kernels(RDPKernels::best()), m_thread_pool(thread_count), m_batch(m_batch_storage.emplace_back(std::make_unique<Batch>()).get()),
+      m_worker(&RDPRasterizer::worker_loop, this) {}
+
+RDPRasterizer::~RDPRasterizer() {
+    submit();
+    m_submitted_batches.push(nullptr);
+    m_worker.join();
+}
+
+const RDPRasterizer::State* RDPRasterizer::capture_state(const State& state) {
+    return &m_batch->states.emplace_back(state);
+}
+
+const std::array<u8, 0x1000>* RDPRasterizer::capture_tmem(const std::array<u8, 0x1000>& tmem) {
+    return &m_batch->tmem_snapshots.emplace_back(tmem);
+}
+
+void RDPRasterizer::queue(const Primitive& primitive) {
+    const State& state = *primitive.state;
+
+    // Only lines that are both covered and inside the scissor box are binned.
+    const s32 first_line = std::max(primitive.y_high >> 2, static_cast<s32>(state.scissor_yh >> 2));
+    const s32 last_line = std::min((primitive.y_low - 1) >> 2, static_cast<s32>((state.scissor_yl - 1) >> 2));
+    if (first_line > last_line || last_line < 0) {
+        return;
+    }
+
+    const u32 index = static_cast<u32>(m_batch->primitives.size());
+    m_batch->primitives.push_back(primitive);
+
+    const u32 first_band = static_cast<u32>(std::max(first_line, 0)) / BandHeight;
+    const u32 last_band = std::min(static_cast<u32>(last_line) / BandHeight, BandCount - 1);
+    for (u32 band = first_band; band <= last_band; band++) {
+        m_batch->bands[band].push_back(index);
+    }
+}
+
+u64 RDPRasterizer::submit() {
+    // States captured without drawing anything are only dropped.
+    if (m_batch->primitives.empty()) {
+        m_batch->states.clear();
+        m_batch->tmem_snapshots.clear();
+        return m_submitted;
+    }
+
+    m_submitted_batches.push(m_batch);
+    m_submitted++;
+
+    if (const std::optional<Batch*> batch = m_free_batches.try_pop()) {
+        m_batch = *batch;
+    } else {
+        m_batch = m_batch_storage.emplace_back(std::make_unique<Batch>()).get();
+    }
+
+    return m_submitted;
+}
+
+void RDPRasterizer::wait(const u64 sequence) const {
+    u64 completed = m_completed.load(std::memory_order_acquire);
+    while (completed < sequence) {
+        m_completed.wait(completed, std::memory_order_acquire);
+        completed = m_completed.load(std::memory_order_acquire);
+    }
+}
+
+void RDPRasterizer::worker_loop() {
+    while (Batch* batch = m_submitted_batches.pop()) {
+        draw_batch(*batch);
+        m_free_batches.push(batch);
+
+        m_completed.fetch_add(1, std::memory_order_release);
+        m_completed.notify_all();
+    }
+}
+
+void RDPRasterizer::draw_batch(Batch& batch) {
+    std::array<u32, BandCount> busy_bands {};
+    u32 busy_band_count = 0;
+    for (u32 band = 0; band < BandCount; band++) {
+        if (!batch.bands[band].empty()) {
+            busy_bands[busy_band_count++] = band;
+        }
+    }
+
+    m_thread_pool.run(busy_band_count, [&](const u32 job) { draw_band(batch, busy_bands[job]); });
+
+    for (auto& band : batch.bands) {
+        band.clear();
+    }
+    batch.primitives.clear();
+    batch.states.clear();
+    batch.tmem_snapshots.clear();
+}
+
+void RDPRasterizer::draw_band(const Batch& batch, const u32 band) {
+    const s32 first_line = static_cast<s32>(band * BandHeight);
+    const s32 last_line = first_line + BandHeight - 1;
+    for (const u32 index : batch.bands[band]) {
+        draw_primitive_lines(batch.primitives[index], first_line, last_line);
+    }
+}
+
+void RDPRasterizer::draw_primitive_lines(const Primitive& primitive, const s32 first_line, const s32 last_line) {
+    const State& state = *primitive.state;
+
+    const s32 scissor_left = static_cast<s32>((state.scissor_xh + 3) >> 2);
+    const s32 scissor_right = std::min(static_cast<s32>((state.scissor_xl + 3) >> 2), static_cast<s32>(state.color_image_width));
+    const SpanFunction draw_span = span_function(primitive);
+
+    for (s32 y = first_line; y <= last_line; y++) {
+        // Lines are sampled through their middle, and only drawn if that falls within the primitive and scissor box.
+        const s32 subscanline = y * 4 + 2;
+        if (subscanline < primitive.y_high || subscanline >= primitive.y_low) {
+            continue;
+        }
+        if (y * 4 < static_cast<s32>(state.scissor_yh) || y * 4 >= static_cast<s32>(state.scissor_yl)) {
+            continue;
+        }
+
+        const f32 line_y = static_cast<f32>(y) + 0.5f;
+        const f32 major = primitive.x_high + primitive.slope_high * (line_y - primitive.y_base);
+        f32 minor;
+        if (subscanline < primitive.y_middle) {
+            minor = primitive.x_middle + primitive.slope_middle * (line_y - primitive.y_base);
+        } else {
+            minor = primitive.x_low + primitive.slope_low * (line_y - primitive.y_middle / 4.0f);
+        }
+
+        const f32 left = primitive.major_on_left ? major : minor;
+        const f32 right = primitive.major_on_left ? minor : major;
+
+        // Pixels are covered if their center is, with the left edge inclusive.
+        const s32 x_begin = std::max(static_cast<s32>(std::ceil(left - 0.5f)), scissor_left);
+        const s32 x_end = std::min(static_cast<s32>(std::ceil(right - 0.5f)), scissor_right);
+        if (x_begin < x_end) {
+            (this->*draw_span)(primitive, y, x_begin, x_end);
+        }
+    }
+}
+
+template <u32 Mode>
+constexpr RDPRasterizer::SpanFunction RDPRasterizer::pipeline_span_function() {
+    if constexpr (is_specialized_span_mode(Mode)) {
+        return &RDPRasterizer::draw_pipeline_span<FixedSpanMode<Mode>>;
+    } else {
+        return &RDPRasterizer::draw_pipeline_span<GenericSpanMode>;
+    }
+}
+
+template <u32... Modes>
+constexpr std::array<RDPRasterizer::SpanFunction, sizeof...(Modes)> RDPRasterizer::pipeline_span_functions(std::integer_sequence<u32, Modes...>) {
+    return { pipeline_span_function<Modes>()... };
+}
+
+RDPRasterizer::SpanFunction RDPRasterizer::span_function(const Primitive& primitive) {
+    switch (primitive.state->cycle_type()) {
+        case CycleType::Fill:
+            return &RDPRasterizer::draw_fill_span;
+        case CycleType::Copy:
+            return &RDPRasterizer::draw_copy_span;
+        default: {
+            static constexpr auto PipelineSpanFunctions = pipeline_span_functions(std::make_integer_sequence<u32, SpanMode::Count>());
+            return PipelineSpanFunctions[span_mode(primitive)];
+        }
+    }
+}
+
+void RDPRasterizer::draw_fill_span(const Primitive& primitive, const s32 y, const s32 x_begin, const s32 x_end) {
+    const State& state = *primitive.state;
+
+    const u32 bytes_per_pixel = state.color_image_size == ImageSize::Bits32 ? 4 : state.color_image_size == ImageSize::Bits16 ? 2 : 1;
+    const u32 line_address = state.color_image_address + static_cast<u32>(y) * state.color_image_width * bytes_per_pixel;
+    const auto pixel_address = [&](const s32 x) -> u8* {
+        const u32 address = line_address + static_cast<u32>(x) * bytes_per_pixel;
+        if (address + bytes_per_pixel > m_rdram.size()) {
+            return nullptr;
+        }
+        return &m_rdram[address];
+    };
+
+    for (s32 x = x_begin; x < x_end; x++) {
+        u8* pixel = pixel_address(x);
+        if (!pixel) {
+            continue;
+        }
+        switch (state.color_image_size) {
+            case ImageSize::Bits32:
+                Common::write_big_endian<u32>(pixel, state.fill_color);
+                break;
+            case ImageSize::Bits16:
+                Common::write_big_endian<u16>(pixel, static_cast<u16>((x & 1) ? state.fill_color : state.fill_color >> 16));
+                break;
+            default:
+                *pixel = static_cast<u8>(state.fill_color >> ((3 - (x & 3)) * 8));
+                break;
+        }
+    }
+}
+
+void RDPRasterizer::draw_copy_span(const Primitive& primitive, const s32 y, const s32 x_begin, const s32 x_end) {
+    static constexpr u32 BatchSize = RDPKernels::BatchSize;
+
+    const State& state = *primitive.state;
+
+    const u32 bytes_per_pixel = state.color_image_size == ImageSize::Bits32 ? 4 : state.color_image_size == ImageSize::Bits16 ? 2 : 1;
+    const u32 line_address = state.color_image_address + static_cast<u32>(y) * state.color_image_width * bytes_per_pixel;
+    const auto pixel_address = [&](const s32 x) -> u8* {
+        const u32 address = line_address + static_cast<u32>(x) * bytes_per_pixel;
+        if (address + bytes_per_pixel > m_rdram.size()) {
+            return nullptr;
+        }
+        return &m_rdram[address];
+    };
+
+    // Attributes at the start of the span.
+    const f32 offset_x = static_cast<f32>(x_begin) - primitive.base_x;
+    const f32 offset_y = static_cast<f32>(y) - primitive.y_base;
+    const auto start = [&](const Attribute& attribute) {
+        return attribute.value + attribute.dx * offset_x + attribute.dy * offset_y;
+    };
+    f32 s = start(primitive.s), t = start(primitive.t), w = start(primitive.w);
+
+    const auto set_texture_coordinates = [&](CoordinateBatch& coordinates, const u32 lane) {
+        f32 texture_s = s;
+        f32 texture_t = t;
+        if (primitive.perspective) {
+            const f32 scale = 32768.0f / std::max(w, 1.0f);
+            texture_s *= scale;
+            texture_t *= scale;
+        }
+        coordinates.s[lane] = static_cast<s32>(std::clamp(std::floor(texture_s), -1048576.0f, 1048575.0f));
+        coordinates.t[lane] = static_cast<s32>(std::clamp(std::floor(texture_t), -1048576.0f, 1048575.0f));
+    };
+
+    CoordinateBatch coordinates {};
+    ColorBatch texels {};
+
+    for (s32 batch_x = x_begin; batch_x < x_end; batch_x += BatchSize) {
+        const u32 count = std::min<u32>(BatchSize, static_cast<u32>(x_end - batch_x));
+        for (u32 lane = 0; lane < count; lane++, s += primitive.s.dx, t += primitive.t.dx, w += primitive.w.dx) {
+            set_texture_coordinates(coordinates, lane);
+        }
+        sample_texture(m_kernels, state, primitive.tile, coordinates, false, texels, count);
+
+        for (u32 lane = 0; lane < count; lane++) {
+            const Color texel = get_color(texels, lane);
+            if (state.alpha_compare() && texel.a == 0) {
+                continue;
+            }
+
+            u8* pixel = pixel_address(batch_x + static_cast<s32>(lane));
+            if (!pixel) {
+                continue;
+            }
+            if (state.color_image_size == ImageSize::Bits32) {
+                Common::write_big_endian<u32>(pixel, static_cast<u32>((texel.r << 24) | (texel.g << 16) | (texel.b << 8) | texel.a));
+            } else {
+                Common::write_big_endian<u16>(pixel, color_to_rgba16(texel));
+            }
+        }
+    }
+}
+
+template <typename Mode>
+void RDPRasterizer::draw_pipeline_span(const Primitive& primitive, const s32 y, const s32 x_begin, const s32 x_end) {
+    static constexpr u32 BatchSize = RDPKernels::BatchSize;
+
+    const State& state = *primitive.state;
+    const Mode mode(primitive);
+
+    const u32 bytes_per_pixel = state.color_image_size == ImageSize::Bits32 ? 4 : state.color_image_size == ImageSize::Bits16 ? 2 : 1;
+    const u32 line_address = state.color_image_address + static_cast<u32>(y) * state.color_image_width * bytes_per_pixel;
+    const auto pixel_address = [&](const s32 x) -> u8* {
+        const u32 address = line_address + static_cast<u32>(x) * bytes_per_pixel;
+        if (address + bytes_per_pixel > m_rdram.size()) {
+            return nullptr;
+        }
+        return &m_rdram[address];
+    };
+
+    // Attributes at the start of the span.
+    const f32 offset_x = static_cast<f32>(x_begin) - primitive.base_x;
+    const f32 offset_y = static_cast<f32>(y) - primitive.y_base;
+    const auto start = [&](const Attribute& attribute) {
+        return attribute.value + attribute.dx * offset_x + attribute.dy * offset_y;
+    };
+    f32 r = start(primitive.r), g = start(primitive.g), b = start(primitive.b), a = start(primitive.a);
+    f32 s = start(primitive.s), t = start(primitive.t), w = start(primitive.w);
+    f32 z = start(primitive.z);
+
+    const auto set_texture_coordinates = [&](CoordinateBatch& coordinates, const u32 lane) {
+        f32 texture_s = s;
+        f32 texture_t = t;
+        if (primitive.perspective) {
+            const f32 scale = 32768.0f / std::max(w, 1.0f);
+            texture_s *= scale;
+            texture_t *= scale;
+        }
+        coordinates.s[lane] = static_cast<s32>(std::clamp(std::floor(texture_s), -1048576.0f, 1048575.0f));
+        coordinates.t[lane] = static_cast<s32>(std::clamp(std::floor(texture_t), -1048576.0f, 1048575.0f));
+    };
+
+    // Pixels go through the pipeline a batch at a time: the attributes are stepped and the tests run per pixel, the
+    // texturing, combiner and blender stages on the whole batch.
+    CoordinateBatch coordinates {};
+    ColorBatch texel0 {};
+
+    const Combiner combiner(state.combine);
+    const Blender blender(state.other_modes_low);
+    const bool two_cycle = mode.has(SpanMode::TwoCycle);
+    const f32 delta_z = (std::abs(primitive.z.dx) + std::abs(primitive.z.dy)) * 8.0f;
+
+    const ColorBatch primitive_color = broadcast(state.primitive_color);
+    const ColorBatch environment_color = broadcast(state.environment_color);
+    const ColorBatch blend_color = broadcast(state.blend_color);
+    const ColorBatch fog_color = broadcast(state.fog_color);
+    const Lanes one = broadcast(0xFF);
+    const Lanes zero = broadcast(0);
+    const Lanes primitive_lod_fraction = broadcast(state.primitive_lod_fraction);
+    const ColorBatch no_color {};
+
+    ColorBatch texel1 {}, shade {}, first_combined {}, combined {}, memory {}, first_blended {}, blended {};
+    Lanes noise_lanes {};
+    Lanes first_inverse_alpha {}, inverse_alpha {};
+
+    // One-cycle mode uses the second set of combiner settings. The combined input of the first cycle reads as zero.
+    const RDPKernels::CombineOperands first_combine = combiner_operands(
+        combiner.cycles[0], { no_color, texel0, texel1, primitive_color, shade, environment_color, noise_lanes, zero,
+                              primitive_lod_fraction, one, zero });
+    const RDPKernels::CombineOperands second_combine = combiner_operands(
+        combiner.cycles[1], { two_cycle ? first_combined : no_color, texel0, texel1, primitive_color, shade, environment_color,
+                              noise_lanes, zero, primitive_lod_fraction, one, zero });
+
+    const Blender::Cycle& final_blender_cycle = blender.cycles[two_cycle ? 1 : 0];
+    const RDPKernels::BlendOperands first_blend = blender_operands(
+        blender.cycles[0], { combined, memory, blend_color, fog_color, shade, one, zero, first_inverse_alpha });
+    const RDPKernels::BlendOperands final_blend = blender_operands(
+        final_blender_cycle, { two_cycle ? first_blended : combined, memory, blend_color, fog_color, shade, one, zero, inverse_alpha });
+
+    // What survives the per-pixel tests, and where it goes.
+    std::array<u8*, BatchSize> pixels {};
+    std::array<u8*, BatchSize> depth_pixels {};
+    std::array<u32, BatchSize> pixel_zs {};
+    std::array<f32, BatchSize> zs {};
+
+    for (s32 batch_x = x_begin; batch_x < x_end; batch_x += BatchSize) {
+        const u32 count = std::min<u32>(BatchSize, static_cast<u32>(x_end - batch_x));
+
+        for (u32 lane = 0; lane < count; lane++, r += primitive.r.dx, g += primitive.g.dx, b += primitive.b.dx, a += primitive.a.dx,
+                 s += primitive.s.dx, t += primitive.t.dx, w += primitive.w.dx, z += primitive.z.dx) {
+            set_color(shade, lane, { clamp_channel(r), clamp_channel(g), clamp_channel(b), clamp_channel(a) });
+            if (mode.has(SpanMode::Texture)) {
+                set_texture_coordinates(coordinates, lane);
+            }
+            noise_lanes[lane] = noise(batch_x + static_cast<s32>(lane), y);
+            zs[lane] = z;
+        }
+
+        if (mode.has(SpanMode::Texture)) {
+            const bool filter = mode.has(SpanMode::Filter);
+            sample_texture(m_kernels, state, primitive.tile, coordinates, filter, texel0, count);
+            if (two_cycle) {
+                sample_texture(m_kernels, state, primitive.tile + 1, coordinates, filter, texel1, count);
+            }
+        }
+
+        if (two_cycle) {
+            m_kernels.combine(first_combine, first_combined, count);
+        }
+        m_kernels.combine(second_combine, combined, count);
+
+        bool any_covered = false;
+        for (u32 lane = 0; lane < count; lane++) {
+            const s32 x = batch_x + static_cast<s32>(lane);
+            pixels[lane] = nullptr;
+
+            u8* pixel = pixel_address(x);
+            if (!pixel) {
+                continue;
+            }
+
+            if (mode.has(SpanMode::AlphaCompare) && combined.a[lane] < state.blend_color[3]) {
+                continue;
+            }
+
+            depth_pixels[lane] = nullptr;
+            if (mode.has(SpanMode::ZCompare | SpanMode::ZUpdate)) {
+                const u32 depth_address = state.z_image_address + (line_address - state.color_image_address) / bytes_per_pixel * 2 +
+                                          static_cast<u32>(x) * 2;
+                if (depth_address + 2 <= m_rdram.size()) {
+                    u8* depth_pixel = &m_rdram[depth_address];
+                    const u32 pixel_z = state.primitive_depth() ? (state.primitive_z & 0x7FFF) << 3
+                                                                : static_cast<u32>(std::clamp(zs[lane] * 8.0f, 0.0f, 262143.0f));
+
+                    if (mode.has(SpanMode::ZCompare)) {
+                        const u32 memory_z = decompress_z(Common::read_big_endian<u16>(depth_pixel) >> 2);
+                        const bool pass = state.z_mode() == 3 ? std::abs(static_cast<f32>(pixel_z) - static_cast<f32>(memory_z)) <= std::max(delta_z, 64.0f)
+                                                              : pixel_z <= memory_z;
+                        if (!pass) {
+                            continue;
+                        }
+                    }
+
+                    depth_pixels[lane] = depth_pixel;
+                    pixel_zs[lane] = pixel_z;
+                }
+            }
+
+            if (mode.has(SpanMode::Color32)) {
+                set_color(memory, lane, color_from_rgba32(Common::read_big_endian<u32>(pixel)));
+            } else {
+                set_color(memory, lane, color_from_rgba16(Common::read_big_endian<u16>(pixel)));
+            }
+
+            pixels[lane] = pixel;
+            any_covered = true;
+        }
+
+        if (!any_covered) {
+            continue;
+        }
+
+        // The first of two cycles always blends. The last one only blends when forced, as coverage isn't emulated.
+        const ColorBatch* output = &combined;
+        if (two_cycle) {
+            blend(m_kernels, first_blend, first_inverse_alpha, first_blended, count);
+            first_blended.a = combined.a;
+            output = &first_blended;
+        }
+        if (mode.has(SpanMode::ForceBlend)) {
+            blend(m_kernels, final_blend, inverse_alpha, blended, count);
+            output = &blended;
+        } else if (final_blender_cycle.p == 1) {
+            output = &memory;
+        } else if (final_blender_cycle.p == 2) {
+            output = &blend_color;
+        } else if (final_blender_cycle.p == 3) {
+            output = &fog_color;
+        }
+
+        for (u32 lane = 0; lane < count; lane++) {
+            u8* pixel = pixels[lane];
+            if (!pixel) {
+                continue;
+            }
+
+            // Written with full coverage.
+            const Color color = get_color(*output, lane);
+            if (mode.has(SpanMode::Color32)) {
+                Common::write_big_endian<u32>(pixel, static_cast<u32>((color.r << 24) | (color.g << 16) | (color.b << 8) | 0xE0));
+            } else {
+                Common::write_big_endian<u16>(pixel, color_to_rgba16({ color.r, color.g, color.b, 0xFF }));
+            }
+
+            if (mode.has(SpanMode::ZUpdate) && depth_pixels[lane]) {
+                Common::write_big_endian<u16>(depth_pixels[lane], static_cast<u16>(compress_z(pixel_zs[lane]) << 2));
+            }
+        }
+    }
+}
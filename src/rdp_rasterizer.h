@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common/spsc_queue.h"
+#include "common/thread_pool.h"
+#include "common/types.h"
+
+struct RDPKernels;
+
+// Draws what the RDP queues up into RDRAM, in software.
+//
+// Primitives are binned into bands of scanlines as they come in. When submitted, the batch is handed to a worker
+// thread, so that emulation goes on while it is drawn; the worker draws the bands in parallel on a thread pool, each
+// one going through its primitives in submission order, so that blending and depth testing within a band see the
+// same results as drawing everything in order. Within a span, pixels are textured, combined and blended in batches,
+// by the kernels in rdp_kernels.h.
+class RDPRasterizer {
+public:
+    enum class CycleType {
+        OneCycle,
+        TwoCycle,
+        Copy,
+        Fill,
+    };
+
+    enum class ImageSize {
+        Bits4,
+        Bits8,
+        Bits16,
+        Bits32,
+    };
+
+    enum class ImageFormat {
+        RGBA,
+        YUV,
+        ColorIndex,
+        IntensityAlpha,
+        Intensity,
+    };
+
+    struct Tile {
+        ImageFormat format;
+        ImageSize size;
+        // In 64-bit words.
+        u32 line;
+        u32 tmem_address;
+        u32 palette;
+        bool clamp_s, mirror_s, clamp_t, mirror_t;
+        u32 mask_s, shift_s, mask_t, shift_t;
+        // Texture coordinates of the tile, in 10.2 texels.
+        u32 sl, tl, sh, th;
+    };
+
+    // Everything a primitive needs to be drawn, as it was when the primitive was queued.
+    struct State {
+        u32 other_modes_high;
+        u32 other_modes_low;
+        u64 combine;
+
+        u32 fill_color;
+        std::array<u8, 4> fog_color;
+        std::array<u8, 4> blend_color;
+        std::array<u8, 4> primitive_color;
+        std::array<u8, 4> environment_color;
+        u8 primitive_lod_fraction;
+        u16 primitive_z;
+        u16 primitive_delta_z;
+
+        u32 color_image_address;
+        ImageSize color_image_size;
+        u32 color_image_width;
+        u32 z_image_address;
+
+        // In 10.2 pixels.
+        u32 scissor_xh, scissor_yh, scissor_xl, scissor_yl;
+
+        std::array<Tile, 8> tiles;
+        const std::array<u8, 0x1000>* tmem;
+
+        CycleType cycle_type() const { return static_cast<CycleType>((other_modes_high >> 20) & 0b11); }
+        bool perspective_correction() const { return (other_modes_high >> 19) & 1; }
+        bool tlut_enabled() const { return (other_modes_high >> 15) & 1; }
+        bool tlut_intensity_alpha() const { return (other_modes_high >> 14) & 1; }
+        bool bilinear_filtering() const { return (other_modes_high >> 13) & 1; }
+        bool force_blend() const { return (other_modes_low >> 14) & 1; }
+        u32 z_mode() const { return (other_modes_low >> 10) & 0b11; }
+        bool z_update() const { return (other_modes_low >> 5) & 1; }
+        bool z_compare() const { return (other_modes_low >> 4) & 1; }
+        bool primitive_depth() const { return (other_modes_low >> 2) & 1; }
+        bool alpha_compare() const { return other_modes_low & 1; }
+    };
+
+    // A value interpolated across a primitive: its value at (base_x, base_y), and how it changes per pixel.
+    struct Attribute {
+        f32 value;
+        f32 dx;
+        f32 dy;
+    };
+
+    // Triangles and rectangles alike, described the way the RDP walks them.
+    struct Primitive {
+        const State* state;
+
+        // In quarter pixels. Only subscanlines in [y_high, y_low) are covered, and the minor edge switches from M to
+        // L at y_middle.
+        s32 y_high, y_middle, y_low;
+        // The major (H) and first minor (M) edges go through x_high and x_middle at y_base, in pixels, the second
+        // minor (L) edge through x_low at y_middle. Slopes are in pixels per line.
+        f32 y_base;
+        f32 x_high, x_middle, x_low;
+        f32 slope_high, slope_middle, slope_low;
+        bool major_on_left;
+
+        bool shade;
+        bool texture;
+        bool zbuffer;
+        // Rectangles take their texture coordinates as they are.
+        bool perspective;
+        u32 tile;
+
+        f32 base_x;
+        Attribute r, g, b, a;
+        Attribute s, t, w;
+        Attribute z;
+    };
+
+    // The thread count includes the worker, which draws bands as well. Zero picks one thread per host core.
+    RDPRasterizer(std::array<u8, 0x400000>& rdram, u32 thread_count);
+    // Finishes what was submitted before stopping the worker.
+    ~RDPRasterizer();
+
+    RDPRasterizer(const RDPRasterizer&) = delete;
+    RDPRasterizer& operator=(const RDPRasterizer&) = delete;
+
+    // Copies the state away, for the primitives queued until the next submission.
+    const State* capture_state(const State& state);
+    // Copies TMEM away, for states captured until the next submission.
+    const std::array<u8, 0x1000>* capture_tmem(const std::array<u8, 0x1000>& tmem);
+
+    void queue(const Primitive& primitive);
+    bool has_queued_primitives() const { return !m_batch->primitives.empty(); }
+
+    // Hands everything queued so far to the worker, and returns the sequence number of the batch. Sequence numbers
+    // start at one and go up by one per batch with primitives in it.
+    u64 submit();
+    // The sequence number of the last batch that is fully drawn.
+    u64 completed() const { return m_completed.load(std::memory_order_acquire); }
+    // Waits until the batch with the given sequence number, and every one before it, is drawn.
+    void wait(u64 sequence) const;
+    void wait_idle() const { wait(m_submitted); }
+
+private:
+    static constexpr u32 BandHeight = 16;
+    static constexpr u32 BandCount = 1024 / BandHeight;
+    // Submissions in flight at once, before submit() waits for the worker.
+    static constexpr std::size_t MaxPendingBatches = 8;
+
+    struct Batch {
+        std::vector<Primitive> primitives;
+        std::array<std::vector<u32>, BandCount> bands {};
+        std::deque<State> states;
+        std::deque<std::array<u8, 0x1000>> tmem_snapshots;
+    };
+
+    std::array<u8, 0x400000>& m_rdram;
+    const RDPKernels& m_kernels;
+    Common::ThreadPool m_thread_pool;
+
+    // Batches go to the worker through one ring and come back, drawn and cleared, through the other. A null batch
+    // stops the worker.
+    std::vector<std::unique_ptr<Batch>> m_batch_storage;
+    Batch* m_batch;
+    Common::SPSCQueue<Batch*, MaxPendingBatches> m_submitted_batches;
+    Common::SPSCQueue<Batch*, MaxPendingBatches * 2> m_free_batches;
+    u64 m_submitted {};
+    std::atomic<u64> m_completed {};
+    std::thread m_worker;
+
+    void worker_loop();
+    void draw_batch(Batch& batch);
+    void draw_band(const Batch& batch, u32 band);
+    void draw_primitive_lines(const Primitive& primitive, s32 first_line, s32 last_line);
+
+    // Spans are drawn by a loop picked once per primitive. The one and two cycle pipelines have a loop specialized on
+    // each of the common modes, and a generic one for the rest.
+    using SpanFunction = void (RDPRasterizer::*)(const Primitive& primitive, s32 y, s32 x_begin, s32 x_end);
+    static SpanFunction span_function(const Primitive& primitive);
+    template <u32 Mode>
+    static constexpr SpanFunction pipeline_span_function();
+    template <u32... Modes>
+    static constexpr std::array<SpanFunction, sizeof...(Modes)>
+    pipeline_span_functions(std::integer_sequence<u32, Modes...>);
+
+    void draw_fill_span(const Primitive& primitive, s32 y, s32 x_begin, s32 x_end);
+    void draw_copy_span(const Primitive& primitive, s32 y, s32 x_begin, s32 x_end);
+    template <typename Mode>
+    void draw_pipeline_span(const Primitive& primitive, s32 y, s32 x_begin, s32 x_end);
+};
@@ -1,21 +1,53 @@
+#include <algorithm>
 #include "common/bits.h"
 #include "common/logging.h"
+#include "hle/task_runner.h"
+#include "jit/rsp_recompiler.h"
 #include "n64.h"
 #include "rsp.h"
 
 #define LTRACE_RSP(disasm_fmt, ...) // fmt::print("trace:  [RSP] {:03X}: {:08X}  " disasm_fmt "\n", m_pc, instruction, ##__VA_ARGS__)
 
-RSP::RSP(N64& system) : m_system(system) {
+RSP::RSP(N64& system, const CPUBackend backend, const TaskEmulation task_emulation) : m_system(system) {
     m_status.flags.halted = true;
 
     m_pc = 0;
     m_next_pc = m_pc + 4;
+
+    if (backend == CPUBackend::JIT) {
+#ifdef FOURIXTYS_JIT_X64
+        m_recompiler = std::make_unique<JIT::RSPRecompiler>(*this);
+#else
+        UNIMPLEMENTED_MSG("The JIT backend is not available on this platform");
+#endif
+    }
+
+    if (task_emulation == TaskEmulation::HighLevel) {
+        m_task_runner = std::make_unique<HLE::TaskRunner>(system);
+    }
 }
 
+RSP::~RSP() = default;
+
 u32 RSP::get_current_instruction() const {
     return m_system.mmu().read32(0x04001000 | m_pc);
 }
 
+void RSP::run(u64 cycles) {
+    while (cycles > 0 && !halted()) {
+        // Recompiled blocks never start or end inside a delay slot.
+        if (m_recompiler && !m_in_delay_slot) {
+            if (const auto block = m_recompiler->block_at(m_pc)) {
+                cycles -= std::min<u64>(cycles, block(this));
+                continue;
+            }
+        }
+
+        step();
+        cycles--;
+    }
+}
+
 void RSP::step() {
     m_gprs[0] = 0;
 
@@ -44,15 +76,110 @@ void RSP::step() {
 
 void RSP::set_status(const u32 status) {
     // LINFO("Setting RSP status {:08X} {:08X}", status, m_system.vr4300().pc());
-    if (Common::is_bit_enabled<0>(status)) {
-        m_status.flags.halted = false;
-    }
     if (Common::is_bit_enabled<1>(status)) {
         m_status.flags.halted = true;
     }
     if (Common::is_bit_enabled<2>(status)) {
         m_status.flags.broke = false;
     }
+    if (Common::is_bit_enabled<3>(status)) {
+        m_system.mmu().mi().cancel_interrupt(MI::InterruptFlags::SP);
+    }
+    if (Common::is_bit_enabled<4>(status)) {
+        m_system.mmu().mi().request_interrupt(MI::InterruptFlags::SP);
+    }
+    if (Common::is_bit_enabled<5>(status)) {
+        m_status.flags.sstep = false;
+    }
+    if (Common::is_bit_enabled<6>(status)) {
+        m_status.flags.sstep = true;
+    }
+    if (Common::is_bit_enabled<7>(status)) {
+        m_status.flags.intbreak = false;
+    }
+    if (Common::is_bit_enabled<8>(status)) {
+        m_status.flags.intbreak = true;
+    }
+
+    // Bits 9 and up clear and set the eight signals in pairs.
+    for (u32 signal = 0; signal < 8; signal++) {
+        if ((status >> (9 + signal * 2)) & 1) {
+            m_status.flags.sig &= ~(1 << signal);
+        }
+        if ((status >> (10 + signal * 2)) & 1) {
+            m_status.flags.sig |= 1 << signal;
+        }
+    }
+
+    // Starting goes last, as the writes that start a task usually set up the interrupt on break as well.
+    if (Common::is_bit_enabled<0>(status) && m_status.flags.halted) {
+        start();
+    }
+}
+
+void RSP::start() {
+    if (m_task_runner && m_task_runner->run()) {
+        // The task already ran to completion. Like the microcode, signal that through SIG2 and break.
+        m_status.flags.sig |= 0b100;
+        enter_break();
+        return;
+    }
+
+    // A new task may have been loaded into IMEM while the RSP was halted.
+    if (m_recompiler) {
+        m_recompiler->load_program();
+    }
+    m_status.flags.halted = false;
+}
+
+void RSP::enter_break() {
+    m_status.flags.halted = true;
+    m_status.flags.broke = true;
+
+    if (m_status.flags.intbreak) {
+        m_system.mmu().mi().request_interrupt(MI::InterruptFlags::SP);
+    }
+}
+
+void RSP::run_dma(const u32 length_register, const bool to_rdram) {
+    // Transfers move count rows of length bytes, skipping over some RDRAM after each row.
+    const u32 length = (Common::bit_range<11, 0>(length_register) | 0b111) + 1;
+    const u32 count = Common::bit_range<19, 12>(length_register) + 1;
+    const u32 skip = Common::bit_range<31, 20>(length_register);
+
+    auto& mmu = m_system.mmu();
+    auto& sp_memory = Common::is_bit_enabled<12>(m_dma_sp_address) ? mmu.sp_imem() : mmu.sp_dmem();
+    auto& rdram = mmu.rdram();
+
+    // Both ways, the transfer has to come after whatever the RDP is still drawing there.
+    m_system.rdp().wait_for_writes(m_dma_dram_address, m_dma_dram_address + count * (length + skip));
+
+    for (u32 row = 0; row < count; row++) {
+        for (u32 i = 0; i < length; i++) {
+            const u32 sp_offset = (m_dma_sp_address + i) & 0xFFF;
+            const u32 rdram_offset = m_dma_dram_address + i;
+            if (rdram_offset >= rdram.size()) {
+                continue;
+            }
+
+            if (to_rdram) {
+                if ((rdram_offset & 0b111) == 0) {
+                    m_system.vr4300().invalidate_code(rdram_offset);
+                }
+                rdram[rdram_offset] = sp_memory[sp_offset];
+            } else {
+                sp_memory[sp_offset] = rdram[rdram_offset];
+            }
+        }
+
+        m_dma_sp_address = (m_dma_sp_address & 0x1000) | ((m_dma_sp_address + length) & 0xFFF);
+        m_dma_dram_address = (m_dma_dram_address + length + skip) & 0xFFFFF8;
+    }
+
+    // Code loaded into IMEM while the RSP runs (overlays) has to replace the blocks compiled from what was there.
+    if (!to_rdram && Common::is_bit_enabled<12>(m_dma_sp_address) && m_recompiler) {
+        m_recompiler->load_program();
+    }
 }
 
 void RSP::execute_instruction(const u32 instruction) {
@@ -115,10 +242,22 @@ void RSP::execute_instruction(const u32 instruction) {
             lui(instruction);
             return;
 
+        case 0b010010:
+            m_vector_unit.execute_instruction(instruction);
+            return;
+
         case 0b101011:
             sw(instruction);
             return;
 
+        case 0b110010:
+            m_vector_unit.lwc2(instruction);
+            return;
+
+        case 0b111010:
+            m_vector_unit.swc2(instruction);
+            return;
+
         default:
             UNIMPLEMENTED_MSG("Unrecognized RSP op {:06b} (instr={:08X}, pc={:03X})", op, instruction, m_pc);
     }
@@ -401,8 +540,7 @@ void RSP::bne(const u32 instruction) {
 void RSP::break_(const u32 instruction) {
     LTRACE_RSP("break");
 
-    m_status.flags.halted = true;
-    m_status.flags.broke = true;
+    enter_break();
 
     m_about_to_branch = false;
     m_entering_delay_slot = false;
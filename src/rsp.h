@@ -1,19 +1,39 @@
 #pragma once
 
 #include <array>
+#include <memory>
 #include <string_view>
 #include "common/bits.h"
 #include "common/types.h"
+#include "rsp_vector_unit.h"
 
 using namespace std::string_view_literals;
 
 class N64;
+enum class CPUBackend;
+
+namespace HLE {
+class TaskRunner;
+}
+
+namespace JIT {
+class RSPRecompiler;
+}
+
+// Whether tasks whose microcode is recognized run natively on the host (see HLE::TaskRunner) rather than on the RSP.
+enum class TaskEmulation {
+    LowLevel,
+    HighLevel,
+};
 
 class RSP {
 public:
-    RSP(N64& system);
+    RSP(N64& system, CPUBackend backend, TaskEmulation task_emulation);
+    ~RSP();
 
     void step();
+    // Executes up to the given number of cycles, stopping early if the RSP halts itself.
+    void run(u64 cycles);
 
     u16 pc() const { return m_pc; }
     void set_pc(u16 pc) {
@@ -26,8 +46,24 @@ public:
     u32 status() const { return m_status.raw; }
     void set_status(u32 status);
 
+    u32 dma_sp_address() const { return m_dma_sp_address; }
+    void set_dma_sp_address(u32 address) { m_dma_sp_address = address & 0x1FF8; }
+    u32 dma_dram_address() const { return m_dma_dram_address; }
+    void set_dma_dram_address(u32 address) { m_dma_dram_address = address & 0xFFFFF8; }
+    // DMA transfers complete immediately.
+    void set_dma_read_length(u32 value) { run_dma(value, false); }
+    void set_dma_write_length(u32 value) { run_dma(value, true); }
+
 private:
+    friend class RSPVectorUnit;
+    friend class JIT::RSPRecompiler;
+
     N64& m_system;
+    RSPVectorUnit m_vector_unit { *this };
+    // Only present when running on the JIT backend.
+    std::unique_ptr<JIT::RSPRecompiler> m_recompiler;
+    // Only present with high-level task emulation.
+    std::unique_ptr<HLE::TaskRunner> m_task_runner;
 
     u16 m_pc;
     u16 m_next_pc;
@@ -51,6 +87,10 @@ private:
         } flags;
     } m_status;
 
+    // Bit 12 selects IMEM over DMEM.
+    u32 m_dma_sp_address {};
+    u32 m_dma_dram_address {};
+
     static constexpr std::array m_reg_names = {
         "r0"sv,
         "at"sv,
@@ -84,6 +124,11 @@ private:
 
     u32 get_current_instruction() const;
 
+    void start();
+    // Halts on a BREAK, interrupting the CPU if it asked for it.
+    void enter_break();
+    void run_dma(u32 length_register, bool to_rdram);
+
     void execute_instruction(u32 instruction);
     void execute_special_instruction(u32 instruction);
     void execute_regimm_instruction(u32 instruction);
@@ -0,0 +1,1402 @@
+#include <algorithm>
+#include <bit>
+#include "common/bits.h"
+#include "common/logging.h"
+#include "n64.h"
+#include "rsp.h"
+#include "rsp_vector_unit.h"
+
+#if defined(__SSE4_1__) && !defined(FOURIXTYS_RSP_SCALAR_VU)
+#include <smmintrin.h>
+#define RSP_VU_SSE41
+#endif
+
+// The lane of VT that feeds each lane for a given element selector: the whole vector, pairs (0q/1q), quarters
+// (0h-3h) or a single element broadcast to every lane.
+static constexpr u32 source_lane(const u32 element, const u32 lane) {
+    if (element < 2) {
+        return lane;
+    }
+    if (element < 4) {
+        return (lane & ~1) | (element & 1);
+    }
+    if (element < 8) {
+        return (lane & ~3) | (element & 3);
+    }
+    return element & 7;
+}
+
+static constexpr s16 clamp_s16(const s32 value) {
+    return static_cast<s16>(std::clamp<s32>(value, -32768, 32767));
+}
+
+const std::array<u16, 512> RSPVectorUnit::m_reciprocals = [] {
+    std::array<u16, 512> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        const u64 divisor = i + 512;
+        table[i] = static_cast<u16>((((u64(1) << 34) / divisor) + 1) >> 8);
+    }
+    return table;
+}();
+
+const std::array<u16, 512> RSPVectorUnit::m_inverse_square_roots = [] {
+    std::array<u16, 512> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        // Odd indices hold the roots for odd exponents.
+        const u64 a = (i + 512) >> (i & 1);
+        // The largest b where b < 1 / sqrt(a), in fixed point.
+        u64 b = u64(1) << 17;
+        while (a * (b + 1) * (b + 1) < (u64(1) << 44)) {
+            b++;
+        }
+        table[i] = static_cast<u16>(b >> 1);
+    }
+    return table;
+}();
+
+alignas(16) const std::array<std::array<u8, 16>, 16> RSPVectorUnit::m_element_shuffles = [] {
+    std::array<std::array<u8, 16>, 16> shuffles {};
+    for (u32 element = 0; element < 16; element++) {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const u32 source = source_lane(element, lane);
+            shuffles[element][lane * 2 + 0] = static_cast<u8>(source * 2 + 0);
+            shuffles[element][lane * 2 + 1] = static_cast<u8>(source * 2 + 1);
+        }
+    }
+    return shuffles;
+}();
+
+#ifdef RSP_VU_SSE41
+static ALWAYS_INLINE __m128i load(const std::array<u16, 8>& elements) {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(elements.data()));
+}
+
+static ALWAYS_INLINE void store(std::array<u16, 8>& elements, const __m128i value) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(elements.data()), value);
+}
+
+static ALWAYS_INLINE __m128i all_ones() {
+    return _mm_set1_epi32(-1);
+}
+
+static ALWAYS_INLINE __m128i not_(const __m128i value) {
+    return _mm_xor_si128(value, all_ones());
+}
+
+// 0xFFFF in every lane where a + b carried out, given sum = a + b.
+static ALWAYS_INLINE __m128i carry_out(const __m128i a, const __m128i sum) {
+    const __m128i sign = _mm_set1_epi16(static_cast<s16>(0x8000));
+    return _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(sum, sign));
+}
+
+// Adds a 48-bit value, split into three 16-bit vectors, to the accumulator.
+static ALWAYS_INLINE void add_48(__m128i& high, __m128i& mid, __m128i& low, const __m128i add_high, const __m128i add_mid, const __m128i add_low) {
+    const __m128i sum_low = _mm_add_epi16(low, add_low);
+    const __m128i carry_low = carry_out(low, sum_low);
+
+    const __m128i partial_mid = _mm_add_epi16(mid, add_mid);
+    const __m128i sum_mid = _mm_sub_epi16(partial_mid, carry_low);
+    // The carry from the low bits can only carry out again if it wrapped the middle bits to zero.
+    const __m128i carry_mid = _mm_or_si128(carry_out(mid, partial_mid), _mm_and_si128(carry_low, _mm_cmpeq_epi16(sum_mid, _mm_setzero_si128())));
+
+    high = _mm_sub_epi16(_mm_add_epi16(high, add_high), carry_mid);
+    mid = sum_mid;
+    low = sum_low;
+}
+#endif
+
+#ifdef RSP_VU_SSE41
+static constexpr bool HasSSE41 = true;
+#else
+static constexpr bool HasSSE41 = false;
+#endif
+
+RSPVectorUnit::RSPVectorUnit(RSP& rsp) : m_rsp(rsp), m_sse41(HasSSE41) {}
+
+RSPVectorUnit::Vector RSPVectorUnit::selected_vt(const u32 instruction) const {
+    const Vector& vt = m_vprs[get_vt(instruction)];
+    const u32 element = get_element(instruction);
+
+    Vector result;
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(m_element_shuffles[element].data()));
+        store(result.elements, _mm_shuffle_epi8(load(vt.elements), shuffle));
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            result.elements[lane] = vt.elements[source_lane(element, lane)];
+        }
+    }
+    return result;
+}
+
+u8 RSPVectorUnit::read_dmem(const u32 address) const {
+    return m_rsp.m_system.mmu().sp_dmem()[address & 0xFFF];
+}
+
+void RSPVectorUnit::write_dmem(const u32 address, const u8 value) {
+    m_rsp.m_system.mmu().sp_dmem()[address & 0xFFF] = value;
+}
+
+s64 RSPVectorUnit::accumulator(const u32 lane) const {
+    const u64 value = (u64(m_accumulator_high.elements[lane]) << 32) | (u64(m_accumulator_mid.elements[lane]) << 16) | m_accumulator_low.elements[lane];
+    return static_cast<s64>(value << 16) >> 16;
+}
+
+void RSPVectorUnit::set_accumulator(const u32 lane, const s64 value) {
+    m_accumulator_high.elements[lane] = static_cast<u16>(value >> 32);
+    m_accumulator_mid.elements[lane] = static_cast<u16>(value >> 16);
+    m_accumulator_low.elements[lane] = static_cast<u16>(value);
+}
+
+u16 RSPVectorUnit::clamp_accumulator(const u32 lane, const Clamp clamp) const {
+    const s32 high_mid = static_cast<s32>((u32(m_accumulator_high.elements[lane]) << 16) | m_accumulator_mid.elements[lane]);
+    switch (clamp) {
+        case Clamp::SignedMid:
+            return clamp_s16(high_mid);
+        case Clamp::UnsignedMid:
+            if (high_mid < 0) {
+                return 0;
+            }
+            return high_mid > 0x7FFF ? 0xFFFF : static_cast<u16>(high_mid);
+        case Clamp::UnsignedLow:
+            if (high_mid < -32768) {
+                return 0;
+            }
+            return high_mid > 32767 ? 0xFFFF : m_accumulator_low.elements[lane];
+    }
+
+    UNREACHABLE();
+}
+
+u16 RSPVectorUnit::pack_flags(const Vector& low, const Vector& high) const {
+    u16 value = 0;
+    for (u32 lane = 0; lane < 8; lane++) {
+        value |= (low.elements[lane] & 1) << lane;
+        value |= (high.elements[lane] & 1) << (lane + 8);
+    }
+    return value;
+}
+
+void RSPVectorUnit::unpack_flags(const u16 value, Vector& low, Vector& high) {
+    for (u32 lane = 0; lane < 8; lane++) {
+        low.elements[lane] = ((value >> lane) & 1) ? 0xFFFF : 0;
+        high.elements[lane] = ((value >> (lane + 8)) & 1) ? 0xFFFF : 0;
+    }
+}
+
+void RSPVectorUnit::execute_instruction(const u32 instruction) {
+    if (!Common::is_bit_enabled<25>(instruction)) {
+        const auto op = Common::bit_range<25, 21>(instruction);
+        switch (op) {
+            case 0b00000:
+                mfc2(instruction);
+                return;
+
+            case 0b00010:
+                cfc2(instruction);
+                return;
+
+            case 0b00100:
+                mtc2(instruction);
+                return;
+
+            case 0b00110:
+                ctc2(instruction);
+                return;
+
+            default:
+                UNIMPLEMENTED_MSG("Unrecognized RSP COP2 op {:05b} (instr={:08X}, pc={:03X})", op, instruction, m_rsp.pc());
+        }
+    }
+
+    const auto op = Common::bit_range<5, 0>(instruction);
+    switch (op) {
+        case 0x00:
+            multiply<Product::Fraction, false, true, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x01:
+            multiply<Product::Fraction, false, true, Clamp::UnsignedMid>(instruction);
+            return;
+
+        case 0x02:
+            vrnd(instruction, true);
+            return;
+
+        case 0x03:
+            vmulq(instruction);
+            return;
+
+        case 0x04:
+            multiply<Product::Low, false, false, Clamp::UnsignedLow>(instruction);
+            return;
+
+        case 0x05:
+            multiply<Product::Mid, false, false, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x06:
+            multiply<Product::MidN, false, false, Clamp::UnsignedLow>(instruction);
+            return;
+
+        case 0x07:
+            multiply<Product::High, false, false, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x08:
+            multiply<Product::Fraction, true, false, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x09:
+            multiply<Product::Fraction, true, false, Clamp::UnsignedMid>(instruction);
+            return;
+
+        case 0x0A:
+            vrnd(instruction, false);
+            return;
+
+        case 0x0B:
+            vmacq(instruction);
+            return;
+
+        case 0x0C:
+            multiply<Product::Low, true, false, Clamp::UnsignedLow>(instruction);
+            return;
+
+        case 0x0D:
+            multiply<Product::Mid, true, false, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x0E:
+            multiply<Product::MidN, true, false, Clamp::UnsignedLow>(instruction);
+            return;
+
+        case 0x0F:
+            multiply<Product::High, true, false, Clamp::SignedMid>(instruction);
+            return;
+
+        case 0x10:
+            vadd(instruction);
+            return;
+
+        case 0x11:
+            vsub(instruction);
+            return;
+
+        case 0x13:
+            vabs(instruction);
+            return;
+
+        case 0x14:
+            vaddc(instruction);
+            return;
+
+        case 0x15:
+            vsubc(instruction);
+            return;
+
+        case 0x1D:
+            vsar(instruction);
+            return;
+
+        case 0x20:
+            compare<Comparison::LessThan>(instruction);
+            return;
+
+        case 0x21:
+            compare<Comparison::Equal>(instruction);
+            return;
+
+        case 0x22:
+            compare<Comparison::NotEqual>(instruction);
+            return;
+
+        case 0x23:
+            compare<Comparison::GreaterOrEqual>(instruction);
+            return;
+
+        case 0x24:
+            vcl(instruction);
+            return;
+
+        case 0x25:
+            vch(instruction);
+            return;
+
+        case 0x26:
+            vcr(instruction);
+            return;
+
+        case 0x27:
+            vmrg(instruction);
+            return;
+
+        case 0x28:
+            logical<Logical::And>(instruction);
+            return;
+
+        case 0x29:
+            logical<Logical::Nand>(instruction);
+            return;
+
+        case 0x2A:
+            logical<Logical::Or>(instruction);
+            return;
+
+        case 0x2B:
+            logical<Logical::Nor>(instruction);
+            return;
+
+        case 0x2C:
+            logical<Logical::Xor>(instruction);
+            return;
+
+        case 0x2D:
+            logical<Logical::Nxor>(instruction);
+            return;
+
+        case 0x30:
+            reciprocal(instruction, false, false);
+            return;
+
+        case 0x31:
+            reciprocal(instruction, false, true);
+            return;
+
+        case 0x32:
+            reciprocal_high(instruction);
+            return;
+
+        case 0x33:
+            vmov(instruction);
+            return;
+
+        case 0x34:
+            reciprocal(instruction, true, false);
+            return;
+
+        case 0x35:
+            reciprocal(instruction, true, true);
+            return;
+
+        case 0x36:
+            reciprocal_high(instruction);
+            return;
+
+        // VNOP, VNULL
+        case 0x37:
+        case 0x3F:
+            return;
+
+        default:
+            UNIMPLEMENTED_MSG("Unrecognized RSP vector op {:06b} (instr={:08X}, pc={:03X})", op, instruction, m_rsp.pc());
+    }
+}
+
+void RSPVectorUnit::mfc2(const u32 instruction) {
+    const auto rt = m_rsp.get_rt(instruction);
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const u32 element = Common::bit_range<10, 7>(instruction);
+
+    const u16 value = (vs.byte(element) << 8) | vs.byte(element + 1);
+    m_rsp.m_gprs[rt] = static_cast<s16>(value);
+}
+
+void RSPVectorUnit::mtc2(const u32 instruction) {
+    const auto rt = m_rsp.get_rt(instruction);
+    Vector& vs = m_vprs[get_vs(instruction)];
+    const u32 element = Common::bit_range<10, 7>(instruction);
+
+    vs.set_byte(element, static_cast<u8>(m_rsp.m_gprs[rt] >> 8));
+    if (element != 15) {
+        vs.set_byte(element + 1, static_cast<u8>(m_rsp.m_gprs[rt]));
+    }
+}
+
+void RSPVectorUnit::cfc2(const u32 instruction) {
+    const auto rt = m_rsp.get_rt(instruction);
+    u16 value;
+    switch (m_rsp.get_rd(instruction) & 3) {
+        case 0:
+            value = pack_flags(m_vco_carry, m_vco_not_equal);
+            break;
+        case 1:
+            value = pack_flags(m_vcc_compare, m_vcc_clip);
+            break;
+        default:
+            value = pack_flags(m_vce, {}) & 0xFF;
+            break;
+    }
+
+    m_rsp.m_gprs[rt] = static_cast<s16>(value);
+}
+
+void RSPVectorUnit::ctc2(const u32 instruction) {
+    const auto rt = m_rsp.get_rt(instruction);
+    const u16 value = static_cast<u16>(m_rsp.m_gprs[rt]);
+    switch (m_rsp.get_rd(instruction) & 3) {
+        case 0:
+            unpack_flags(value, m_vco_carry, m_vco_not_equal);
+            break;
+        case 1:
+            unpack_flags(value, m_vcc_compare, m_vcc_clip);
+            break;
+        default: {
+            Vector unused;
+            unpack_flags(value & 0xFF, m_vce, unused);
+            break;
+        }
+    }
+}
+
+void RSPVectorUnit::lwc2(const u32 instruction) {
+    const auto base = m_rsp.get_rs(instruction);
+    const u32 vt_index = get_vt(instruction);
+    Vector& vt = m_vprs[vt_index];
+    const auto op = Common::bit_range<15, 11>(instruction);
+    const u32 element = Common::bit_range<10, 7>(instruction);
+    const s32 offset = static_cast<s32>(instruction << 25) >> 25;
+
+    switch (op) {
+        // LBV, LSV, LLV, LDV
+        case 0b00000:
+        case 0b00001:
+        case 0b00010:
+        case 0b00011: {
+            const u32 size = 1 << op;
+            u32 address = m_rsp.m_gprs[base] + offset * size;
+            for (u32 i = element; i < std::min(element + size, 16u); i++) {
+                vt.set_byte(i, read_dmem(address++));
+            }
+            return;
+        }
+
+        // LQV
+        case 0b00100: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 end = std::min(16 + element - (address & 15), 16u);
+            for (u32 i = element; i < end; i++) {
+                vt.set_byte(i, read_dmem(address++));
+            }
+            return;
+        }
+
+        // LRV
+        case 0b00101: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 start = element + (16 - (address & 15));
+            address &= ~15;
+            for (u32 i = start; i < 16; i++) {
+                vt.set_byte(i, read_dmem(address++));
+            }
+            return;
+        }
+
+        // LPV, LUV
+        case 0b00110:
+        case 0b00111: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 8;
+            const u32 index = (address & 7) - element;
+            const u32 shift = op == 0b00110 ? 8 : 7;
+            for (u32 lane = 0; lane < 8; lane++) {
+                vt.elements[lane] = static_cast<u16>(read_dmem((address & ~7) + ((index + lane) & 15)) << shift);
+            }
+            return;
+        }
+
+        // LHV
+        case 0b01000: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 index = (address & 7) - element;
+            for (u32 lane = 0; lane < 8; lane++) {
+                vt.elements[lane] = static_cast<u16>(read_dmem((address & ~7) + ((index + lane * 2) & 15)) << 7);
+            }
+            return;
+        }
+
+        // LFV
+        case 0b01001: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 index = (address & 7) - element;
+            Vector temp;
+            for (u32 i = 0; i < 4; i++) {
+                temp.elements[i + 0] = static_cast<u16>(read_dmem((address & ~7) + ((index + i * 4 + 0) & 15)) << 7);
+                temp.elements[i + 4] = static_cast<u16>(read_dmem((address & ~7) + ((index + i * 4 + 8) & 15)) << 7);
+            }
+            for (u32 i = element; i < std::min(element + 8, 16u); i++) {
+                vt.set_byte(i, temp.byte(i));
+            }
+            return;
+        }
+
+        // LWV
+        case 0b01010: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            for (u32 i = 16 - element; i < element + 16; i++) {
+                vt.set_byte(i, read_dmem(address));
+                address += 4;
+            }
+            return;
+        }
+
+        // LTV: one element into each register of a group of eight, rotated by the element.
+        case 0b01011: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 begin = address & ~7;
+            address = begin + ((element + (address & 8)) & 15);
+            const u32 group = vt_index & ~7;
+            u32 register_offset = element >> 1;
+            for (u32 i = 0; i < 8; i++) {
+                Vector& target = m_vprs[group + register_offset];
+                for (u32 j = 0; j < 2; j++) {
+                    target.set_byte(i * 2 + j, read_dmem(address++));
+                    if (address == begin + 16) {
+                        address = begin;
+                    }
+                }
+                register_offset = (register_offset + 1) & 7;
+            }
+            return;
+        }
+
+        default:
+            UNIMPLEMENTED_MSG("Unrecognized RSP LWC2 op {:05b} (instr={:08X}, pc={:03X})", op, instruction, m_rsp.pc());
+    }
+}
+
+void RSPVectorUnit::swc2(const u32 instruction) {
+    const auto base = m_rsp.get_rs(instruction);
+    const u32 vt_index = get_vt(instruction);
+    const Vector& vt = m_vprs[vt_index];
+    const auto op = Common::bit_range<15, 11>(instruction);
+    const u32 element = Common::bit_range<10, 7>(instruction);
+    const s32 offset = static_cast<s32>(instruction << 25) >> 25;
+
+    switch (op) {
+        // SBV, SSV, SLV, SDV
+        case 0b00000:
+        case 0b00001:
+        case 0b00010:
+        case 0b00011: {
+            const u32 size = 1 << op;
+            u32 address = m_rsp.m_gprs[base] + offset * size;
+            for (u32 i = element; i < element + size; i++) {
+                write_dmem(address++, vt.byte(i));
+            }
+            return;
+        }
+
+        // SQV
+        case 0b00100: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 end = element + (16 - (address & 15));
+            for (u32 i = element; i < end; i++) {
+                write_dmem(address++, vt.byte(i));
+            }
+            return;
+        }
+
+        // SRV
+        case 0b00101: {
+            u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 end = element + (address & 15);
+            const u32 rotation = 16 - (address & 15);
+            address &= ~15;
+            for (u32 i = element; i < end; i++) {
+                write_dmem(address++, vt.byte(i + rotation));
+            }
+            return;
+        }
+
+        // SPV, SUV
+        case 0b00110:
+        case 0b00111: {
+            u32 address = m_rsp.m_gprs[base] + offset * 8;
+            for (u32 i = element; i < element + 8; i++) {
+                const bool packed = ((i & 15) < 8) == (op == 0b00110);
+                if (packed) {
+                    write_dmem(address++, vt.byte((i & 7) << 1));
+                } else {
+                    write_dmem(address++, static_cast<u8>(vt.elements[i & 7] >> 7));
+                }
+            }
+            return;
+        }
+
+        // SHV
+        case 0b01000: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 index = address & 7;
+            for (u32 i = 0; i < 8; i++) {
+                const u32 byte = element + i * 2;
+                const u8 value = static_cast<u8>((vt.byte(byte) << 1) | (vt.byte(byte + 1) >> 7));
+                write_dmem((address & ~7) + ((index + i * 2) & 15), value);
+            }
+            return;
+        }
+
+        // SFV
+        case 0b01001: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 index = address & 7;
+            static constexpr std::array<std::array<u8, 4>, 16> lanes = {{
+                { 0, 1, 2, 3 }, { 6, 7, 4, 5 }, {}, {},
+                { 1, 2, 3, 0 }, { 7, 4, 5, 6 }, {}, {},
+                { 4, 5, 6, 7 }, {}, {}, { 3, 0, 1, 2 },
+                { 5, 6, 7, 4 }, {}, {}, { 0, 1, 2, 3 },
+            }};
+            static constexpr u16 valid_elements = 0b1001'1001'0011'0011;
+            for (u32 i = 0; i < 4; i++) {
+                u8 value = 0;
+                if ((valid_elements >> element) & 1) {
+                    value = static_cast<u8>(vt.elements[lanes[element][i]] >> 7);
+                }
+                write_dmem((address & ~7) + ((index + (i << 2)) & 15), value);
+            }
+            return;
+        }
+
+        // SWV
+        case 0b01010: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            u32 index = address & 7;
+            for (u32 i = element; i < element + 16; i++) {
+                write_dmem((address & ~7) + (index++ & 15), vt.byte(i));
+            }
+            return;
+        }
+
+        // STV: one element from each register of a group of eight.
+        case 0b01011: {
+            const u32 address = m_rsp.m_gprs[base] + offset * 16;
+            const u32 group = vt_index & ~7;
+            u32 byte = 16 - (element & ~1);
+            u32 index = (address & 7) - (element & ~1);
+            for (u32 i = group; i < group + 8; i++) {
+                for (u32 j = 0; j < 2; j++) {
+                    write_dmem((address & ~7) + (index++ & 15), m_vprs[i].byte(byte++));
+                }
+            }
+            return;
+        }
+
+        default:
+            UNIMPLEMENTED_MSG("Unrecognized RSP SWC2 op {:05b} (instr={:08X}, pc={:03X})", op, instruction, m_rsp.pc());
+    }
+}
+
+template <RSPVectorUnit::Product product, bool accumulate, bool round, RSPVectorUnit::Clamp clamp>
+void RSPVectorUnit::multiply(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i product_high = zero;
+        __m128i product_mid = zero;
+        __m128i product_low = zero;
+        if constexpr (product == Product::Fraction) {
+            const __m128i low = _mm_mullo_epi16(s, t);
+            const __m128i high = _mm_mulhi_epi16(s, t);
+            product_low = _mm_slli_epi16(low, 1);
+            product_mid = _mm_or_si128(_mm_slli_epi16(high, 1), _mm_srli_epi16(low, 15));
+            product_high = _mm_srai_epi16(high, 15);
+        } else if constexpr (product == Product::Low) {
+            product_low = _mm_mulhi_epu16(s, t);
+        } else if constexpr (product == Product::Mid || product == Product::MidN) {
+            // The high half of a signed x unsigned product is the unsigned one, less the unsigned operand when the
+            // signed one is negative.
+            const __m128i signed_operand = product == Product::Mid ? s : t;
+            const __m128i unsigned_operand = product == Product::Mid ? t : s;
+            product_low = _mm_mullo_epi16(s, t);
+            product_mid = _mm_sub_epi16(_mm_mulhi_epu16(s, t), _mm_and_si128(_mm_srai_epi16(signed_operand, 15), unsigned_operand));
+            product_high = _mm_srai_epi16(product_mid, 15);
+        } else {
+            product_mid = _mm_mullo_epi16(s, t);
+            product_high = _mm_mulhi_epi16(s, t);
+        }
+
+        __m128i high = zero;
+        __m128i mid = zero;
+        __m128i low = zero;
+        if constexpr (accumulate) {
+            high = load(m_accumulator_high.elements);
+            mid = load(m_accumulator_mid.elements);
+            low = load(m_accumulator_low.elements);
+        }
+        add_48(high, mid, low, product_high, product_mid, product_low);
+        if constexpr (round) {
+            add_48(high, mid, low, zero, zero, _mm_set1_epi16(static_cast<s16>(0x8000)));
+        }
+
+        store(m_accumulator_high.elements, high);
+        store(m_accumulator_mid.elements, mid);
+        store(m_accumulator_low.elements, low);
+
+        const __m128i high_mid_0 = _mm_unpacklo_epi16(mid, high);
+        const __m128i high_mid_1 = _mm_unpackhi_epi16(mid, high);
+        if constexpr (clamp == Clamp::SignedMid) {
+            store(vd.elements, _mm_packs_epi32(high_mid_0, high_mid_1));
+        } else if constexpr (clamp == Clamp::UnsignedMid) {
+            const __m128i result = _mm_packus_epi32(high_mid_0, high_mid_1);
+            store(vd.elements, _mm_or_si128(result, _mm_srai_epi16(result, 15)));
+        } else {
+            const __m128i in_range = _mm_cmpeq_epi16(high, _mm_srai_epi16(mid, 15));
+            const __m128i saturated = not_(_mm_srai_epi16(high, 15));
+            store(vd.elements, _mm_blendv_epi8(saturated, low, in_range));
+        }
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s32 s = static_cast<s16>(vs.elements[lane]);
+            const s32 t = static_cast<s16>(vte.elements[lane]);
+            const u32 us = vs.elements[lane];
+            const u32 ut = vte.elements[lane];
+
+            s64 value;
+            if constexpr (product == Product::Fraction) {
+                value = s64(s * t) * 2;
+            } else if constexpr (product == Product::Low) {
+                value = (us * ut) >> 16;
+            } else if constexpr (product == Product::Mid) {
+                value = s * s32(ut);
+            } else if constexpr (product == Product::MidN) {
+                value = s32(us) * t;
+            } else {
+                value = s64(s * t) << 16;
+            }
+
+            if constexpr (accumulate) {
+                value += accumulator(lane);
+            }
+            if constexpr (round) {
+                value += 0x8000;
+            }
+
+            set_accumulator(lane, value);
+        }
+
+        for (u32 lane = 0; lane < 8; lane++) {
+            vd.elements[lane] = clamp_accumulator(lane, clamp);
+        }
+    }
+}
+
+void RSPVectorUnit::vrnd(const u32 instruction, const bool positive) {
+    const u32 vs_index = get_vs(instruction);
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    for (u32 lane = 0; lane < 8; lane++) {
+        s64 value = static_cast<s16>(vte.elements[lane]);
+        // VS is not a register here, its lowest bit selects whether to round the middle or low bits.
+        if (vs_index & 1) {
+            value <<= 16;
+        }
+
+        const s64 acc = accumulator(lane);
+        if ((acc >= 0) == positive) {
+            set_accumulator(lane, acc + value);
+        }
+        vd.elements[lane] = clamp_accumulator(lane, Clamp::SignedMid);
+    }
+}
+
+void RSPVectorUnit::vmulq(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    Vector result;
+    for (u32 lane = 0; lane < 8; lane++) {
+        s32 value = s32(static_cast<s16>(vs.elements[lane])) * static_cast<s16>(vte.elements[lane]);
+        if (value < 0) {
+            value += 31;
+        }
+
+        m_accumulator_high.elements[lane] = static_cast<u16>(value >> 16);
+        m_accumulator_mid.elements[lane] = static_cast<u16>(value);
+        m_accumulator_low.elements[lane] = 0;
+        result.elements[lane] = clamp_s16(value >> 1) & ~15;
+    }
+    vd = result;
+}
+
+void RSPVectorUnit::vmacq(const u32 instruction) {
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    for (u32 lane = 0; lane < 8; lane++) {
+        s32 value = static_cast<s32>((u32(m_accumulator_high.elements[lane]) << 16) | m_accumulator_mid.elements[lane]);
+        if (value < 0 && !Common::is_bit_enabled<5>(value)) {
+            value += 32;
+        } else if (value >= 32 && !Common::is_bit_enabled<5>(value)) {
+            value -= 32;
+        }
+
+        m_accumulator_high.elements[lane] = static_cast<u16>(value >> 16);
+        m_accumulator_mid.elements[lane] = static_cast<u16>(value);
+        vd.elements[lane] = clamp_s16(value >> 1) & ~15;
+    }
+}
+
+void RSPVectorUnit::vadd(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i carry = load(m_vco_carry.elements);
+
+        // Widened to 32 bits so that the carry-in saturates along with the sum.
+        const __m128i sum_0 = _mm_sub_epi32(_mm_add_epi32(_mm_cvtepi16_epi32(s), _mm_cvtepi16_epi32(t)), _mm_cvtepi16_epi32(carry));
+        const __m128i sum_1 = _mm_sub_epi32(_mm_add_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(s, 8)), _mm_cvtepi16_epi32(_mm_srli_si128(t, 8))), _mm_cvtepi16_epi32(_mm_srli_si128(carry, 8)));
+
+        store(m_accumulator_low.elements, _mm_sub_epi16(_mm_add_epi16(s, t), carry));
+        store(vd.elements, _mm_packs_epi32(sum_0, sum_1));
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s32 sum = s32(static_cast<s16>(vs.elements[lane])) + static_cast<s16>(vte.elements[lane]) + (m_vco_carry.elements[lane] & 1);
+            m_accumulator_low.elements[lane] = static_cast<u16>(sum);
+            vd.elements[lane] = clamp_s16(sum);
+        }
+    }
+
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+}
+
+void RSPVectorUnit::vsub(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i carry = load(m_vco_carry.elements);
+
+        const __m128i difference_0 = _mm_add_epi32(_mm_sub_epi32(_mm_cvtepi16_epi32(s), _mm_cvtepi16_epi32(t)), _mm_cvtepi16_epi32(carry));
+        const __m128i difference_1 = _mm_add_epi32(_mm_sub_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(s, 8)), _mm_cvtepi16_epi32(_mm_srli_si128(t, 8))), _mm_cvtepi16_epi32(_mm_srli_si128(carry, 8)));
+
+        store(m_accumulator_low.elements, _mm_add_epi16(_mm_sub_epi16(s, t), carry));
+        store(vd.elements, _mm_packs_epi32(difference_0, difference_1));
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s32 difference = s32(static_cast<s16>(vs.elements[lane])) - static_cast<s16>(vte.elements[lane]) - (m_vco_carry.elements[lane] & 1);
+            m_accumulator_low.elements[lane] = static_cast<u16>(difference);
+            vd.elements[lane] = clamp_s16(difference);
+        }
+    }
+
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+}
+
+void RSPVectorUnit::vabs(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+
+        const __m128i result = _mm_sign_epi16(t, s);
+        // Negating -32768 wraps in the accumulator, but saturates in VD.
+        const __m128i overflow = _mm_and_si128(_mm_srai_epi16(s, 15), _mm_cmpeq_epi16(t, _mm_set1_epi16(static_cast<s16>(0x8000))));
+
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, _mm_xor_si128(result, overflow));
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s16 s = static_cast<s16>(vs.elements[lane]);
+            const s16 t = static_cast<s16>(vte.elements[lane]);
+
+            s32 result = 0;
+            if (s > 0) {
+                result = t;
+            } else if (s < 0) {
+                result = -s32(t);
+            }
+
+            m_accumulator_low.elements[lane] = static_cast<u16>(result);
+            vd.elements[lane] = clamp_s16(result);
+        }
+    }
+}
+
+void RSPVectorUnit::vaddc(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i sum = _mm_add_epi16(s, load(vte.elements));
+
+        store(m_vco_carry.elements, carry_out(s, sum));
+        store(m_accumulator_low.elements, sum);
+        store(vd.elements, sum);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const u32 sum = u32(vs.elements[lane]) + vte.elements[lane];
+            m_vco_carry.elements[lane] = (sum >> 16) ? 0xFFFF : 0;
+            m_accumulator_low.elements[lane] = static_cast<u16>(sum);
+            vd.elements[lane] = static_cast<u16>(sum);
+        }
+    }
+
+    m_vco_not_equal = {};
+}
+
+void RSPVectorUnit::vsubc(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i difference = _mm_sub_epi16(s, t);
+        const __m128i borrow = not_(_mm_cmpeq_epi16(_mm_max_epu16(s, t), s));
+
+        store(m_vco_carry.elements, borrow);
+        store(m_vco_not_equal.elements, not_(_mm_cmpeq_epi16(s, t)));
+        store(m_accumulator_low.elements, difference);
+        store(vd.elements, difference);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const u32 difference = u32(vs.elements[lane]) - vte.elements[lane];
+            m_vco_carry.elements[lane] = (difference >> 16) ? 0xFFFF : 0;
+            m_vco_not_equal.elements[lane] = static_cast<u16>(difference) ? 0xFFFF : 0;
+            m_accumulator_low.elements[lane] = static_cast<u16>(difference);
+            vd.elements[lane] = static_cast<u16>(difference);
+        }
+    }
+}
+
+void RSPVectorUnit::vsar(const u32 instruction) {
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    switch (get_element(instruction)) {
+        case 8:
+            vd = m_accumulator_high;
+            return;
+        case 9:
+            vd = m_accumulator_mid;
+            return;
+        case 10:
+            vd = m_accumulator_low;
+            return;
+        default:
+            vd = {};
+            return;
+    }
+}
+
+template <RSPVectorUnit::Comparison comparison>
+void RSPVectorUnit::compare(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i carry = load(m_vco_carry.elements);
+        const __m128i not_equal = load(m_vco_not_equal.elements);
+        const __m128i equal = _mm_cmpeq_epi16(s, t);
+
+        __m128i result;
+        if constexpr (comparison == Comparison::LessThan) {
+            result = _mm_or_si128(_mm_cmplt_epi16(s, t), _mm_and_si128(equal, _mm_and_si128(carry, not_equal)));
+        } else if constexpr (comparison == Comparison::Equal) {
+            result = _mm_andnot_si128(not_equal, equal);
+        } else if constexpr (comparison == Comparison::NotEqual) {
+            result = _mm_or_si128(not_(equal), not_equal);
+        } else {
+            result = _mm_or_si128(_mm_cmpgt_epi16(s, t), _mm_andnot_si128(_mm_and_si128(carry, not_equal), equal));
+        }
+
+        const __m128i selected = _mm_blendv_epi8(t, s, result);
+        store(m_vcc_compare.elements, result);
+        store(m_accumulator_low.elements, selected);
+        store(vd.elements, selected);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s16 s = static_cast<s16>(vs.elements[lane]);
+            const s16 t = static_cast<s16>(vte.elements[lane]);
+            const bool carry = m_vco_carry.elements[lane];
+            const bool not_equal = m_vco_not_equal.elements[lane];
+
+            bool result;
+            if constexpr (comparison == Comparison::LessThan) {
+                result = s < t || (s == t && carry && not_equal);
+            } else if constexpr (comparison == Comparison::Equal) {
+                result = s == t && !not_equal;
+            } else if constexpr (comparison == Comparison::NotEqual) {
+                result = s != t || not_equal;
+            } else {
+                result = s > t || (s == t && !(carry && not_equal));
+            }
+
+            m_vcc_compare.elements[lane] = result ? 0xFFFF : 0;
+            m_accumulator_low.elements[lane] = result ? vs.elements[lane] : vte.elements[lane];
+        }
+        vd = m_accumulator_low;
+    }
+
+    m_vcc_clip = {};
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+}
+
+void RSPVectorUnit::vcl(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i carry = load(m_vco_carry.elements);
+        const __m128i not_equal = load(m_vco_not_equal.elements);
+        const __m128i extension = load(m_vce.elements);
+        __m128i compare = load(m_vcc_compare.elements);
+        __m128i clip = load(m_vcc_clip.elements);
+
+        // Lanes that were equal after VCH get their flags recomputed from the unsigned sum or difference.
+        const __m128i sum = _mm_add_epi16(s, t);
+        const __m128i sum_carry = carry_out(s, sum);
+        const __m128i sum_zero = _mm_cmpeq_epi16(sum, _mm_setzero_si128());
+        const __m128i new_compare = _mm_blendv_epi8(_mm_andnot_si128(sum_carry, sum_zero), _mm_or_si128(sum_zero, not_(sum_carry)), extension);
+        compare = _mm_blendv_epi8(compare, new_compare, _mm_andnot_si128(not_equal, carry));
+
+        const __m128i greater_or_equal = _mm_cmpeq_epi16(_mm_max_epu16(s, t), s);
+        clip = _mm_blendv_epi8(clip, greater_or_equal, not_(_mm_or_si128(carry, not_equal)));
+
+        const __m128i negated_t = _mm_sub_epi16(_mm_setzero_si128(), t);
+        const __m128i result = _mm_blendv_epi8(_mm_blendv_epi8(s, t, clip), _mm_blendv_epi8(s, negated_t, compare), carry);
+
+        store(m_vcc_compare.elements, compare);
+        store(m_vcc_clip.elements, clip);
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, result);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const u16 s = vs.elements[lane];
+            const u16 t = vte.elements[lane];
+            const u16 negated_t = static_cast<u16>(-t);
+
+            u16 result;
+            if (m_vco_carry.elements[lane]) {
+                if (!m_vco_not_equal.elements[lane]) {
+                    const u32 sum = u32(s) + t;
+                    const bool zero = static_cast<u16>(sum) == 0;
+                    const bool carry = sum > 0xFFFF;
+                    const bool compare = m_vce.elements[lane] ? (zero || !carry) : (zero && !carry);
+                    m_vcc_compare.elements[lane] = compare ? 0xFFFF : 0;
+                }
+                result = m_vcc_compare.elements[lane] ? negated_t : s;
+            } else {
+                if (!m_vco_not_equal.elements[lane]) {
+                    m_vcc_clip.elements[lane] = s >= t ? 0xFFFF : 0;
+                }
+                result = m_vcc_clip.elements[lane] ? t : s;
+            }
+
+            m_accumulator_low.elements[lane] = result;
+        }
+        vd = m_accumulator_low;
+    }
+
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+    m_vce = {};
+}
+
+void RSPVectorUnit::vch(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+        const __m128i zero = _mm_setzero_si128();
+
+        // Lanes with differing signs compare VS against -VT, the others against VT.
+        const __m128i signs_differ = _mm_srai_epi16(_mm_xor_si128(s, t), 15);
+        const __m128i sum = _mm_add_epi16(s, t);
+        const __m128i difference = _mm_sub_epi16(s, t);
+        const __m128i t_negative = _mm_srai_epi16(t, 15);
+
+        const __m128i sum_not_positive = _mm_cmpgt_epi16(_mm_set1_epi16(1), sum);
+        const __m128i difference_not_negative = not_(_mm_srai_epi16(difference, 15));
+        const __m128i sum_minus_one = _mm_and_si128(signs_differ, _mm_cmpeq_epi16(sum, all_ones()));
+
+        const __m128i compare = _mm_blendv_epi8(t_negative, sum_not_positive, signs_differ);
+        const __m128i clip = _mm_blendv_epi8(difference_not_negative, t_negative, signs_differ);
+        const __m128i result_zero = _mm_cmpeq_epi16(_mm_blendv_epi8(difference, sum, signs_differ), zero);
+        const __m128i not_equal = not_(_mm_or_si128(result_zero, sum_minus_one));
+
+        const __m128i negated_t = _mm_sub_epi16(zero, t);
+        const __m128i result = _mm_blendv_epi8(_mm_blendv_epi8(s, t, clip), _mm_blendv_epi8(s, negated_t, compare), signs_differ);
+
+        store(m_vcc_compare.elements, compare);
+        store(m_vcc_clip.elements, clip);
+        store(m_vco_carry.elements, signs_differ);
+        store(m_vco_not_equal.elements, not_equal);
+        store(m_vce.elements, sum_minus_one);
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, result);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s16 s = static_cast<s16>(vs.elements[lane]);
+            const s16 t = static_cast<s16>(vte.elements[lane]);
+
+            bool compare;
+            bool clip;
+            bool carry;
+            bool extension;
+            s16 result;
+            u16 selected;
+            if ((s ^ t) < 0) {
+                result = static_cast<s16>(s + t);
+                compare = result <= 0;
+                clip = t < 0;
+                carry = true;
+                extension = result == -1;
+                selected = compare ? static_cast<u16>(-t) : static_cast<u16>(s);
+            } else {
+                result = static_cast<s16>(s - t);
+                compare = t < 0;
+                clip = result >= 0;
+                carry = false;
+                extension = false;
+                selected = clip ? static_cast<u16>(t) : static_cast<u16>(s);
+            }
+            const bool not_equal = result != 0 && static_cast<u16>(s) != static_cast<u16>(~t);
+
+            m_vcc_compare.elements[lane] = compare ? 0xFFFF : 0;
+            m_vcc_clip.elements[lane] = clip ? 0xFFFF : 0;
+            m_vco_carry.elements[lane] = carry ? 0xFFFF : 0;
+            m_vco_not_equal.elements[lane] = not_equal ? 0xFFFF : 0;
+            m_vce.elements[lane] = extension ? 0xFFFF : 0;
+            m_accumulator_low.elements[lane] = selected;
+        }
+        vd = m_accumulator_low;
+    }
+}
+
+void RSPVectorUnit::vcr(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+
+        // Like VCH, but against the one's complement of VT.
+        const __m128i signs_differ = _mm_srai_epi16(_mm_xor_si128(s, t), 15);
+        const __m128i t_negative = _mm_srai_epi16(t, 15);
+        const __m128i sum_negative = _mm_srai_epi16(_mm_add_epi16(s, t), 15);
+        const __m128i difference_not_negative = not_(_mm_srai_epi16(_mm_sub_epi16(s, t), 15));
+
+        const __m128i compare = _mm_blendv_epi8(t_negative, sum_negative, signs_differ);
+        const __m128i clip = _mm_blendv_epi8(difference_not_negative, t_negative, signs_differ);
+        const __m128i result = _mm_blendv_epi8(_mm_blendv_epi8(s, t, clip), _mm_blendv_epi8(s, not_(t), compare), signs_differ);
+
+        store(m_vcc_compare.elements, compare);
+        store(m_vcc_clip.elements, clip);
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, result);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const s16 s = static_cast<s16>(vs.elements[lane]);
+            const s16 t = static_cast<s16>(vte.elements[lane]);
+
+            bool compare;
+            bool clip;
+            u16 selected;
+            if ((s ^ t) < 0) {
+                clip = t < 0;
+                compare = s + t + 1 <= 0;
+                selected = compare ? static_cast<u16>(~t) : static_cast<u16>(s);
+            } else {
+                compare = t < 0;
+                clip = s - t >= 0;
+                selected = clip ? static_cast<u16>(t) : static_cast<u16>(s);
+            }
+
+            m_vcc_compare.elements[lane] = compare ? 0xFFFF : 0;
+            m_vcc_clip.elements[lane] = clip ? 0xFFFF : 0;
+            m_accumulator_low.elements[lane] = selected;
+        }
+        vd = m_accumulator_low;
+    }
+
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+    m_vce = {};
+}
+
+void RSPVectorUnit::vmrg(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i result = _mm_blendv_epi8(load(vte.elements), load(vs.elements), load(m_vcc_compare.elements));
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, result);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            m_accumulator_low.elements[lane] = m_vcc_compare.elements[lane] ? vs.elements[lane] : vte.elements[lane];
+        }
+        vd = m_accumulator_low;
+    }
+
+    m_vco_carry = {};
+    m_vco_not_equal = {};
+}
+
+template <RSPVectorUnit::Logical operation>
+void RSPVectorUnit::logical(const u32 instruction) {
+    const Vector& vs = m_vprs[get_vs(instruction)];
+    const Vector vte = selected_vt(instruction);
+    Vector& vd = m_vprs[get_vd(instruction)];
+
+    if (m_sse41) {
+#ifdef RSP_VU_SSE41
+        const __m128i s = load(vs.elements);
+        const __m128i t = load(vte.elements);
+
+        __m128i result;
+        if constexpr (operation == Logical::And || operation == Logical::Nand) {
+            result = _mm_and_si128(s, t);
+        } else if constexpr (operation == Logical::Or || operation == Logical::Nor) {
+            result = _mm_or_si128(s, t);
+        } else {
+            result = _mm_xor_si128(s, t);
+        }
+        if constexpr (operation == Logical::Nand || operation == Logical::Nor || operation == Logical::Nxor) {
+            result = not_(result);
+        }
+
+        store(m_accumulator_low.elements, result);
+        store(vd.elements, result);
+#endif
+    } else {
+        for (u32 lane = 0; lane < 8; lane++) {
+            const u16 s = vs.elements[lane];
+            const u16 t = vte.elements[lane];
+
+            u16 result;
+            if constexpr (operation == Logical::And || operation == Logical::Nand) {
+                result = s & t;
+            } else if constexpr (operation == Logical::Or || operation == Logical::Nor) {
+                result = s | t;
+            } else {
+                result = s ^ t;
+            }
+            if constexpr (operation == Logical::Nand || operation == Logical::Nor || operation == Logical::Nxor) {
+                result = ~result;
+            }
+
+            m_accumulator_low.elements[lane] = result;
+        }
+        vd = m_accumulator_low;
+    }
+}
+
+void RSPVectorUnit::vmov(const u32 instruction) {
+    const Vector vte = selected_vt(instruction);
+    // VS holds the destination element.
+    const u32 lane = get_vs(instruction) & 7;
+
+    m_vprs[get_vd(instruction)].elements[lane] = vte.elements[lane];
+    m_accumulator_low = vte;
+}
+
+void RSPVectorUnit::reciprocal(const u32 instruction, const bool square_root, const bool low) {
+    const Vector vte = selected_vt(instruction);
+    const u16 element = m_vprs[get_vt(instruction)].elements[get_element(instruction) & 7];
+
+    // The low variants take the upper half of their input from a preceding VRCPH/VRSQH.
+    s32 input;
+    if (low && m_div_in_loaded) {
+        input = static_cast<s32>((u32(m_div_in) << 16) | element);
+    } else {
+        input = static_cast<s16>(element);
+    }
+
+    const s32 mask = input >> 31;
+    s32 data = input ^ mask;
+    if (input > -32768) {
+        data -= mask;
+    }
+
+    s32 result;
+    if (data == 0) {
+        result = 0x7FFFFFFF;
+    } else if (input == -32768) {
+        result = static_cast<s32>(0xFFFF0000);
+    } else {
+        const u32 shift = std::countl_zero(static_cast<u32>(data));
+        const u32 index = static_cast<u32>(((u64(static_cast<u32>(data)) << shift) & 0x7FC00000) >> 22);
+        if (square_root) {
+            result = m_inverse_square_roots[(index & 0x1FE) | (shift & 1)];
+            result = (0x10000 | result) << 14;
+            result = (result >> ((31 - shift) >> 1)) ^ mask;
+        } else {
+            result = m_reciprocals[index];
+            result = (0x10000 | result) << 14;
+            result = (result >> (31 - shift)) ^ mask;
+        }
+    }
+
+    m_div_in_loaded = false;
+    m_div_out = static_cast<u16>(result >> 16);
+    m_accumulator_low = vte;
+    m_vprs[get_vd(instruction)].elements[get_vs(instruction) & 7] = static_cast<u16>(result);
+}
+
+void RSPVectorUnit::reciprocal_high(const u32 instruction) {
+    const Vector vte = selected_vt(instruction);
+
+    m_div_in_loaded = true;
+    m_div_in = m_vprs[get_vt(instruction)].elements[get_element(instruction) & 7];
+    m_accumulator_low = vte;
+    m_vprs[get_vd(instruction)].elements[get_vs(instruction) & 7] = m_div_out;
+}
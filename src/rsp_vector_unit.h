@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include "common/defines.h"
+#include "common/types.h"
+
+class RSP;
+
+namespace JIT {
+class RSPRecompiler;
+}
+
+// The RSP's vector unit (COP2): 32 registers of eight 16-bit lanes, a 48-bit accumulator per lane and the VCO, VCC
+// and VCE flags.
+//
+// Computational instructions run as SSE4.1 kernels when the host supports them. The scalar versions are kept as a
+// reference, and can be forced with FOURIXTYS_RSP_SCALAR_VU; tests/rsp_vector_unit_test.cpp checks that the two agree.
+class RSPVectorUnit {
+public:
+    explicit RSPVectorUnit(RSP& rsp);
+
+    void execute_instruction(u32 instruction);
+    void lwc2(u32 instruction);
+    void swc2(u32 instruction);
+
+private:
+    friend class JIT::RSPRecompiler;
+    friend struct RSPVectorUnitTest;
+
+    RSP& m_rsp;
+    // Whether computational instructions run as SSE4.1 kernels, rather than as the scalar reference.
+    bool m_sse41;
+
+    // Lane 0 is element 0, which comes first in DMEM and in RSP byte numbering.
+    struct alignas(16) Vector {
+        std::array<u16, 8> elements {};
+
+        ALWAYS_INLINE u8 byte(const u32 index) const {
+            return static_cast<u8>(elements[(index & 15) >> 1] >> ((~index & 1) * 8));
+        }
+
+        ALWAYS_INLINE void set_byte(const u32 index, const u8 value) {
+            u16& element = elements[(index & 15) >> 1];
+            const u32 shift = (~index & 1) * 8;
+            element = static_cast<u16>((element & ~(0xFF << shift)) | (value << shift));
+        }
+    };
+
+    std::array<Vector, 32> m_vprs {};
+
+    // Bits 47:32, 31:16 and 15:0 of each lane's accumulator.
+    Vector m_accumulator_high {};
+    Vector m_accumulator_mid {};
+    Vector m_accumulator_low {};
+
+    // Flags are kept as lane masks (0x0000 or 0xFFFF), which is what the kernels work with.
+    Vector m_vco_carry {};
+    Vector m_vco_not_equal {};
+    Vector m_vcc_compare {};
+    Vector m_vcc_clip {};
+    Vector m_vce {};
+
+    // State shared by the reciprocal and square root instructions.
+    u16 m_div_in {};
+    u16 m_div_out {};
+    bool m_div_in_loaded {};
+
+    static const std::array<u16, 512> m_reciprocals;
+    static const std::array<u16, 512> m_inverse_square_roots;
+    // PSHUFB masks applying each element selector.
+    alignas(16) static const std::array<std::array<u8, 16>, 16> m_element_shuffles;
+
+    ALWAYS_INLINE static u32 get_vd(const u32 instruction) { return (instruction >> 6) & 0x1F; }
+    ALWAYS_INLINE static u32 get_vs(const u32 instruction) { return (instruction >> 11) & 0x1F; }
+    ALWAYS_INLINE static u32 get_vt(const u32 instruction) { return (instruction >> 16) & 0x1F; }
+    ALWAYS_INLINE static u32 get_element(const u32 instruction) { return (instruction >> 21) & 0xF; }
+
+    // Returns VT with the instruction's element selector applied.
+    Vector selected_vt(u32 instruction) const;
+
+    u8 read_dmem(u32 address) const;
+    void write_dmem(u32 address, u8 value);
+
+    // Products of the multiply instructions, before they reach the accumulator.
+    enum class Product {
+        // Signed x signed, doubled (VMULF, VMULU, VMACF, VMACU).
+        Fraction,
+        // Unsigned x unsigned, shifted right by 16 (VMUDL, VMADL).
+        Low,
+        // Signed VS x unsigned VT (VMUDM, VMADM).
+        Mid,
+        // Unsigned VS x signed VT (VMUDN, VMADN).
+        MidN,
+        // Signed x signed, shifted left by 16 (VMUDH, VMADH).
+        High,
+    };
+
+    // How the accumulator is clamped into VD.
+    enum class Clamp {
+        // Bits 31:16 as a signed value.
+        SignedMid,
+        // Bits 31:16 as an unsigned value (VMULU, VMACU).
+        UnsignedMid,
+        // Bits 15:0, saturated to 0x0000/0xFFFF when bits 47:16 overflow.
+        UnsignedLow,
+    };
+
+    // The whole 48-bit accumulator of a lane, sign-extended, for the scalar paths.
+    s64 accumulator(u32 lane) const;
+    void set_accumulator(u32 lane, s64 value);
+    u16 clamp_accumulator(u32 lane, Clamp clamp) const;
+
+    u16 pack_flags(const Vector& low, const Vector& high) const;
+    void unpack_flags(u16 value, Vector& low, Vector& high);
+
+    void mfc2(u32 instruction);
+    void mtc2(u32 instruction);
+    void cfc2(u32 instruction);
+    void ctc2(u32 instruction);
+
+    template <Product product, bool accumulate, bool round, Clamp clamp>
+    void multiply(u32 instruction);
+
+    void vrnd(u32 instruction, bool positive);
+    void vmulq(u32 instruction);
+    void vmacq(u32 instruction);
+
+    void vadd(u32 instruction);
+    void vsub(u32 instruction);
+    void vabs(u32 instruction);
+    void vaddc(u32 instruction);
+    void vsubc(u32 instruction);
+    void vsar(u32 instruction);
+
+    enum class Comparison {
+        LessThan,
+        Equal,
+        NotEqual,
+        GreaterOrEqual,
+    };
+    template <Comparison comparison>
+    void compare(u32 instruction);
+
+    void vcl(u32 instruction);
+    void vch(u32 instruction);
+    void vcr(u32 instruction);
+    void vmrg(u32 instruction);
+
+    enum class Logical {
+        And,
+        Nand,
+        Or,
+        Nor,
+        Xor,
+        Nxor,
+    };
+    template <Logical operation>
+    void logical(u32 instruction);
+
+    void vmov(u32 instruction);
+    // Shared by VRCP(L) and VRSQ(L).
+    void reciprocal(u32 instruction, bool square_root, bool low);
+    // Shared by VRCPH and VRSQH.
+    void reciprocal_high(u32 instruction);
+};
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include "scheduler.h"
+
+// std::*_heap builds a max-heap, so order events "greater first" to keep the earliest on top.
+// Events with equal timestamps are ordered by type to keep dispatch deterministic.
+static bool event_comes_after(const Scheduler::Event& a, const Scheduler::Event& b) {
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp > b.timestamp;
+    }
+
+    return a.type > b.type;
+}
+
+void Scheduler::schedule(const EventType type, const u64 cycles_from_now) {
+    schedule_at(type, m_timestamp + cycles_from_now);
+}
+
+void Scheduler::schedule_at(const EventType type, const u64 timestamp) {
+    cancel(type);
+
+    m_events.push_back({timestamp, type});
+    std::push_heap(m_events.begin(), m_events.end(), event_comes_after);
+    update_next_event_timestamp();
+}
+
+void Scheduler::cancel(const EventType type) {
+    const auto erased = std::erase_if(m_events, [type](const Event& event) { return event.type == type; });
+    if (erased == 0) {
+        return;
+    }
+
+    std::make_heap(m_events.begin(), m_events.end(), event_comes_after);
+    update_next_event_timestamp();
+}
+
+bool Scheduler::is_scheduled(const EventType type) const {
+    return std::ranges::any_of(m_events, [type](const Event& event) { return event.type == type; });
+}
+
+std::optional<Scheduler::Event> Scheduler::pop_pending_event() {
+    if (!has_pending_events()) {
+        return std::nullopt;
+    }
+
+    std::pop_heap(m_events.begin(), m_events.end(), event_comes_after);
+    const Event event = m_events.back();
+    m_events.pop_back();
+    update_next_event_timestamp();
+
+    return event;
+}
+
+void Scheduler::update_next_event_timestamp() {
+    if (m_events.empty()) {
+        m_next_event_timestamp = std::numeric_limits<u64>::max();
+        return;
+    }
+
+    m_next_event_timestamp = m_events.front().timestamp;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <limits>
+#include <optional>
+#include <vector>
+#include "common/types.h"
+
+class Scheduler {
+public:
+    enum class EventType {
+        VIHalfline,
+        Frame,
+        PIDMAComplete,
+        SIDMAComplete,
+        COP0Compare,
+        RDPSyncFull,
+    };
+
+    struct Event {
+        u64 timestamp;
+        EventType type;
+    };
+
+    [[nodiscard]] u64 timestamp() const { return m_timestamp; }
+    void add_cycles(const u64 cycles) { m_timestamp += cycles; }
+
+    [[nodiscard]] u64 next_event_timestamp() const { return m_next_event_timestamp; }
+    [[nodiscard]] u64 cycles_until_next_event() const {
+        return (m_timestamp < m_next_event_timestamp) ? (m_next_event_timestamp - m_timestamp) : 0;
+    }
+    [[nodiscard]] bool has_pending_events() const { return m_timestamp >= m_next_event_timestamp; }
+
+    void schedule(EventType type, u64 cycles_from_now);
+    void schedule_at(EventType type, u64 timestamp);
+    void cancel(EventType type);
+    [[nodiscard]] bool is_scheduled(EventType type) const;
+
+    // Removes and returns the earliest event if it is due.
+    std::optional<Event> pop_pending_event();
+
+private:
+    // Master cycle counter, in VR4300 cycles.
+    u64 m_timestamp {};
+    u64 m_next_event_timestamp { std::numeric_limits<u64>::max() };
+
+    // Min-heap ordered by timestamp. Events of the same type never coexist.
+    std::vector<Event> m_events {};
+
+    void update_next_event_timestamp();
+};
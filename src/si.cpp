@@ -1,12 +1,15 @@
-#include "si.h"
+#include "common/bits.h"
 #include "mmu.h"
+#include "scheduler.h"
+#include "si.h"
 
 void SI::transfer_64_bytes_from_pif_ram(const u32 source_address) {
     for (std::size_t i = 0; i < 64; i += sizeof(u32)) {
         m_mmu.write32(m_dram_address + i, m_mmu.read32(source_address + i));
     }
 
-    m_mmu.mi().request_interrupt(MI::InterruptFlags::SI);
+    Common::enable_bits<0>(m_status);
+    m_scheduler.schedule(Scheduler::EventType::SIDMAComplete, 0);
 }
 
 void SI::transfer_64_bytes_to_pif_ram(const u32 destination_address) {
@@ -14,5 +17,11 @@ void SI::transfer_64_bytes_to_pif_ram(const u32 destination_address) {
         m_mmu.write32(destination_address + i, m_mmu.read32(m_dram_address + i));
     }
 
+    Common::enable_bits<0>(m_status);
+    m_scheduler.schedule(Scheduler::EventType::SIDMAComplete, 0);
+}
+
+void SI::finish_dma_transfer() {
+    Common::disable_bits<0>(m_status);
     m_mmu.mi().request_interrupt(MI::InterruptFlags::SI);
 }
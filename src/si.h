@@ -3,10 +3,11 @@
 #include "common/types.h"
 
 class MMU;
+class Scheduler;
 
 class SI {
 public:
-    explicit SI(MMU& mmu) : m_mmu(mmu) {}
+    SI(MMU& mmu, Scheduler& scheduler) : m_mmu(mmu), m_scheduler(scheduler) {}
 
     u32 dram_address() const { return m_dram_address; }
     void set_dram_address(u32 address) { m_dram_address = address; }
@@ -16,8 +17,11 @@ public:
     void transfer_64_bytes_from_pif_ram(u32 source_address);
     void transfer_64_bytes_to_pif_ram(u32 destination_address);
 
+    void finish_dma_transfer();
+
 private:
     MMU& m_mmu;
+    Scheduler& m_scheduler;
 
     u32 m_dram_address {};
     u32 m_status {};
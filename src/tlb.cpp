@@ -0,0 +1,76 @@
+#include "common/bits.h"
+#include "tlb.h"
+
+// EntryHi bits 12:8 always read as zero.
+static constexpr u64 ENTRY_HI_ZERO_MASK = 0x1F00;
+
+void TLB::write_entry(const u32 index, const u32 page_mask, const u64 entry_hi, const u64 entry_lo0, const u64 entry_lo1) {
+    Entry& entry = m_entries.at(index);
+    entry.page_mask = page_mask;
+    entry.entry_hi = entry_hi & ~(u64(page_mask) | ENTRY_HI_ZERO_MASK);
+    // An entry is only global if both of its pages are.
+    entry.global = Common::is_bit_enabled<0>(entry_lo0) && Common::is_bit_enabled<0>(entry_lo1);
+    entry.entry_lo0 = entry_lo0 & ~u64(1);
+    entry.entry_lo1 = entry_lo1 & ~u64(1);
+
+    // Any cached page may have come from the entry that just got replaced.
+    m_cache.fill({});
+}
+
+bool TLB::matches(const Entry& entry, const u32 virtual_address, const u8 asid) const {
+    // Only the 32-bit addressing modes are supported, so the region bits and upper VPN2 bits are ignored.
+    const u32 vpn2_mask = ~(entry.page_mask | 0x1FFF);
+    if (((virtual_address ^ static_cast<u32>(entry.entry_hi)) & vpn2_mask) != 0) {
+        return false;
+    }
+
+    return entry.global || Common::bit_range<7, 0>(entry.entry_hi) == asid;
+}
+
+std::optional<u32> TLB::probe(const u64 entry_hi) const {
+    const u32 virtual_address = static_cast<u32>(entry_hi);
+    const u8 asid = Common::bit_range<7, 0>(entry_hi);
+    for (u32 i = 0; i < EntryCount; i++) {
+        if (matches(m_entries[i], virtual_address, asid)) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+TLB::Translation TLB::translate_slow(const u32 virtual_address, const u8 asid, const bool write) {
+    for (const Entry& entry : m_entries) {
+        if (!matches(entry, virtual_address, asid)) {
+            continue;
+        }
+
+        // The bit right above the page offset selects between the even and the odd page.
+        const u32 offset_mask = (entry.page_mask >> 1) | PageMask;
+        const u64 entry_lo = (virtual_address & (offset_mask + 1)) ? entry.entry_lo1 : entry.entry_lo0;
+        if (!Common::is_bit_enabled<1>(entry_lo)) {
+            return { Status::Invalid, 0 };
+        }
+
+        const bool dirty = Common::is_bit_enabled<2>(entry_lo);
+        if (write && !dirty) {
+            return { Status::Modified, 0 };
+        }
+
+        // The RCP only decodes 29 bits of physical address, like KSEG0 and KSEG1.
+        const u32 pfn = Common::bit_range<25, 6>(entry_lo);
+        const u32 physical_address = (((pfn << PageShift) & ~offset_mask) | (virtual_address & offset_mask)) & 0x1FFFFFFF;
+
+        const u32 virtual_page = virtual_address >> PageShift;
+        m_cache[virtual_page % CacheSize] = {
+            .virtual_page = virtual_page,
+            .physical_page = physical_address & ~PageMask,
+            .asid = asid,
+            .writable = dirty,
+        };
+
+        return { Status::Hit, physical_address };
+    }
+
+    return { Status::Miss, 0 };
+}
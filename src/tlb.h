@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include "common/defines.h"
+#include "common/types.h"
+
+// The VR4300's 32-entry joint TLB, which maps KUSEG, KSSEG and KSEG3.
+//
+// Every entry maps an even/odd pair of pages. Successful translations are remembered per 4 KiB page in a small
+// direct-mapped cache, so that only the first access to a page has to search the entries.
+class TLB {
+public:
+    static constexpr std::size_t EntryCount = 32;
+
+    struct Entry {
+        u32 page_mask {};
+        // VPN2 and ASID, the G bit is kept separately.
+        u64 entry_hi {};
+        u64 entry_lo0 {};
+        u64 entry_lo1 {};
+        bool global {};
+    };
+
+    enum class Status {
+        Hit,
+        // No entry matches the address.
+        Miss,
+        // The matching page is not valid.
+        Invalid,
+        // A store to a page that is not dirty.
+        Modified,
+    };
+
+    struct Translation {
+        Status status;
+        u32 physical_address;
+    };
+
+    ALWAYS_INLINE Translation translate(const u32 virtual_address, const u8 asid, const bool write) {
+        const u32 virtual_page = virtual_address >> PageShift;
+        const CachedPage& cached = m_cache[virtual_page % CacheSize];
+        if (cached.virtual_page == virtual_page && cached.asid == asid && (cached.writable || !write)) [[likely]] {
+            return { Status::Hit, cached.physical_page | (virtual_address & PageMask) };
+        }
+
+        return translate_slow(virtual_address, asid, write);
+    }
+
+    const Entry& entry(u32 index) const { return m_entries.at(index); }
+    void write_entry(u32 index, u32 page_mask, u64 entry_hi, u64 entry_lo0, u64 entry_lo1);
+    // Returns the index of the entry matching EntryHi, as TLBP does.
+    std::optional<u32> probe(u64 entry_hi) const;
+
+private:
+    std::array<Entry, EntryCount> m_entries {};
+
+    static constexpr u32 PageShift = 12;
+    static constexpr u32 PageMask = (1 << PageShift) - 1;
+    static constexpr std::size_t CacheSize = 256;
+    // Never matches a page, as virtual page numbers only have 20 bits.
+    static constexpr u32 NoPage = 0xFFFFFFFF;
+
+    struct CachedPage {
+        u32 virtual_page { NoPage };
+        u32 physical_page {};
+        u8 asid {};
+        bool writable {};
+    };
+    std::array<CachedPage, CacheSize> m_cache {};
+
+    bool matches(const Entry& entry, u32 virtual_address, u8 asid) const;
+    Translation translate_slow(u32 virtual_address, u8 asid, bool write);
+};
@@ -22,6 +22,9 @@ public:
 
     [[nodiscard]] u32 current_line() const { return m_current_line; }
 
+    [[nodiscard]] u32 hstart() const { return m_hstart; }
+    void set_hstart(const u32 value) { m_hstart = value; }
+
     [[nodiscard]] u32 vstart() const { return m_vstart; }
     void set_vstart(const u32 value) { m_vstart = value; }
 
@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "common/bits.h"
+#include "common/byteswap.h"
+#include "vi.h"
+#include "vi_scanout.h"
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define VI_SCANOUT_X64
+#endif
+
+namespace {
+
+// Pixels are kept as 0xCCBBGGRR while filtering, C being the 3-bit coverage, and come out as 0xAABBGGRR.
+ALWAYS_INLINE s32 channel(const u32 pixel, const u32 shift) {
+    return static_cast<s32>((pixel >> shift) & 0xFF);
+}
+
+ALWAYS_INLINE u32 coverage(const u32 pixel) {
+    return pixel >> 24;
+}
+
+ALWAYS_INLINE u32 pack(const s32 r, const s32 g, const s32 b, const u32 coverage) {
+    return static_cast<u32>(r) | (static_cast<u32>(g) << 8) | (static_cast<u32>(b) << 16) | (coverage << 24);
+}
+
+constexpr u32 OpaqueAlpha = 0xFF000000;
+
+// 16-bit framebuffers only hold the top coverage bit next to the color. The other two live in RDRAM's hidden bits,
+// which are not kept, and are taken as set.
+ALWAYS_INLINE u32 decode_rgba16(const u16 value) {
+    const s32 r = (value >> 11) & 0x1F;
+    const s32 g = (value >> 6) & 0x1F;
+    const s32 b = (value >> 1) & 0x1F;
+    return pack(r << 3, g << 3, b << 3, (value & 1) ? 7 : 3);
+}
+
+ALWAYS_INLINE u32 decode_rgba32(const u32 value) {
+    return pack(value >> 24, (value >> 16) & 0xFF, (value >> 8) & 0xFF, (value & 0xFF) >> 5);
+}
+
+// Blends two pixels channel by channel, by a fraction in 1/32s.
+ALWAYS_INLINE u32 lerp_pixel(const u32 a, const u32 b, const u32 fraction) {
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8) {
+        const u32 value = (((a >> shift) & 0xFF) * (32 - fraction) + ((b >> shift) & 0xFF) * fraction + 16) >> 5;
+        result |= value << shift;
+    }
+    return result;
+}
+
+void blend_lines(const u32* first, const u32* second, const u32 fraction, u32* blended, const u32 count) {
+    u32 i = 0;
+#ifdef VI_SCANOUT_X64
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i first_weight = _mm_set1_epi16(static_cast<s16>(32 - fraction));
+    const __m128i second_weight = _mm_set1_epi16(static_cast<s16>(fraction));
+    const __m128i round = _mm_set1_epi16(16);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), first_weight), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), second_weight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), first_weight), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), second_weight));
+        low = _mm_srli_epi16(_mm_add_epi16(low, round), 5);
+        high = _mm_srli_epi16(_mm_add_epi16(high, round), 5);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(blended + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++) {
+        blended[i] = lerp_pixel(first[i], second[i], fraction);
+    }
+}
+
+// Samples a line at output_width points, offset + x * scale in 2.10 pixels, filling in opaque alpha.
+void resample_line(const u32* line, const u32 line_width, const u32 offset, const u32 scale, const bool interpolate,
+                   u32* output, const u32 output_width) {
+    const auto sample = [&](const u32 x, u32& left, u32& right, u32& fraction) {
+        const u32 position = offset + x * scale;
+        const u32 index = std::min(position >> 10, line_width - 1);
+        left = line[index];
+        right = line[std::min(index + 1, line_width - 1)];
+        fraction = interpolate ? ((position >> 5) & 0x1F) : 0;
+    };
+
+    u32 x = 0;
+#ifdef VI_SCANOUT_X64
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(16);
+    const __m128i thirty_two = _mm_set1_epi16(32);
+    const __m128i alpha = _mm_set1_epi32(static_cast<s32>(OpaqueAlpha));
+    for (; x + 4 <= output_width; x += 4) {
+        std::array<u32, 4> left, right, fraction;
+        for (u32 lane = 0; lane < 4; lane++) {
+            sample(x + lane, left[lane], right[lane], fraction[lane]);
+        }
+
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left.data()));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right.data()));
+        // Each pixel's fraction, repeated over its four channels.
+        const __m128i low_fraction = _mm_set_epi16(fraction[1], fraction[1], fraction[1], fraction[1], fraction[0], fraction[0], fraction[0], fraction[0]);
+        const __m128i high_fraction = _mm_set_epi16(fraction[3], fraction[3], fraction[3], fraction[3], fraction[2], fraction[2], fraction[2], fraction[2]);
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(thirty_two, low_fraction)),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), low_fraction));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(thirty_two, high_fraction)),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), high_fraction));
+        low = _mm_srli_epi16(_mm_add_epi16(low, round), 5);
+        high = _mm_srli_epi16(_mm_add_epi16(high, round), 5);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), _mm_or_si128(_mm_packus_epi16(low, high), alpha));
+    }
+#endif
+    for (; x < output_width; x++) {
+        u32 left, right, fraction;
+        sample(x, left, right, fraction);
+        output[x] = lerp_pixel(left, right, fraction) | OpaqueAlpha;
+    }
+}
+
+// Pulls a partially covered pixel towards its fully covered neighbours, by how much of it is uncovered. Of the pixel
+// and those neighbours, the second brightest and second darkest make up the background.
+u32 anti_alias_pixel(const u32* source, const u32 width, const u32 height, const u32 x, const u32 y) {
+    static constexpr std::array<std::array<s32, 2>, 6> Neighbours = { {
+        { -1, -1 }, { 1, -1 }, { -2, 0 }, { 2, 0 }, { -1, 1 }, { 1, 1 },
+    } };
+
+    const u32 center = source[y * width + x];
+    std::array<u32, 7> full_pixels { center };
+    u32 full_count = 1;
+    for (const auto& [dx, dy] : Neighbours) {
+        const s32 nx = static_cast<s32>(x) + dx;
+        const s32 ny = static_cast<s32>(y) + dy;
+        if (nx < 0 || ny < 0 || nx >= static_cast<s32>(width) || ny >= static_cast<s32>(height)) {
+            continue;
+        }
+
+        const u32 neighbour = source[ny * width + nx];
+        if (coverage(neighbour) == 7) {
+            full_pixels[full_count++] = neighbour;
+        }
+    }
+
+    const s32 uncovered = static_cast<s32>(7 - coverage(center));
+    std::array<s32, 3> result {};
+    for (u32 c = 0; c < 3; c++) {
+        // Insertion sort, as there are at most seven.
+        std::array<s32, 7> values {};
+        for (u32 i = 0; i < full_count; i++) {
+            const s32 value = channel(full_pixels[i], c * 8);
+            u32 j = i;
+            for (; j > 0 && values[j - 1] > value; j--) {
+                values[j] = values[j - 1];
+            }
+            values[j] = value;
+        }
+
+        const s32 value = channel(center, c * 8);
+        const s32 penumbra = (full_count == 1) ? 2 * value : values[1] + values[full_count - 2];
+        result[c] = std::clamp(value + (((penumbra - 2 * value) * uncovered + 4) >> 3), 0, 255);
+    }
+
+    return pack(result[0], result[1], result[2], coverage(center));
+}
+
+// Undoes the RDP's dithering on a fully covered pixel, nudging each channel by its neighbours that are one 5-bit
+// step above or below it.
+u32 dedither_pixel(const u32* source, const u32 width, const u32 height, const u32 x, const u32 y) {
+    const u32 center = source[y * width + x];
+    std::array<s32, 3> result {};
+    for (u32 c = 0; c < 3; c++) {
+        const s32 value = channel(center, c * 8);
+        s32 adjustment = 0;
+        for (s32 dy = -1; dy <= 1; dy++) {
+            for (s32 dx = -1; dx <= 1; dx++) {
+                const u32 nx = static_cast<u32>(std::clamp(static_cast<s32>(x) + dx, 0, static_cast<s32>(width) - 1));
+                const u32 ny = static_cast<u32>(std::clamp(static_cast<s32>(y) + dy, 0, static_cast<s32>(height) - 1));
+                const s32 difference = (channel(source[ny * width + nx], c * 8) >> 3) - (value >> 3);
+                if (difference == 1) {
+                    adjustment++;
+                } else if (difference == -1) {
+                    adjustment--;
+                }
+            }
+        }
+        result[c] = std::clamp(value + adjustment, 0, 255);
+    }
+
+    return pack(result[0], result[1], result[2], coverage(center));
+}
+
+ALWAYS_INLINE s32 median(const s32 a, const s32 b, const s32 c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// sqrt(x), from 8 bits in, or 14 bits when gamma is dithered.
+const std::array<u8, 256> GammaTable = [] {
+    std::array<u8, 256> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        table[i] = static_cast<u8>(std::lround(std::sqrt(i / 255.0) * 255.0));
+    }
+    return table;
+}();
+
+const std::array<u8, 0x4000> DitheredGammaTable = [] {
+    std::array<u8, 0x4000> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        table[i] = static_cast<u8>(std::sqrt(i / 16383.0) * 255.0);
+    }
+    return table;
+}();
+
+}
+
+VIScanout::VIScanout() {
+    for (Snapshot& snapshot : m_snapshots) {
+        m_free_snapshots.push(&snapshot);
+    }
+    m_presenter = std::thread(&VIScanout::presenter_loop, this);
+}
+
+VIScanout::~VIScanout() {
+    m_captured_snapshots.push(nullptr);
+    m_presenter.join();
+}
+
+bool VIScanout::compute_geometry(const Registers& registers, Geometry& geometry) {
+    // Blank, or reserved.
+    const u32 type = Common::bit_range<1, 0>(registers.control);
+    if (type < 2) {
+        return false;
+    }
+
+    const u32 width = Common::bit_range<11, 0>(registers.width);
+    const u32 h_start = Common::bit_range<25, 16>(registers.h_start);
+    const u32 h_end = Common::bit_range<9, 0>(registers.h_start);
+    const u32 v_start = Common::bit_range<25, 16>(registers.v_start);
+    const u32 v_end = Common::bit_range<9, 0>(registers.v_start);
+    if (width == 0 || h_end <= h_start || v_end < v_start + 2) {
+        return false;
+    }
+
+    geometry.output_width = h_end - h_start;
+    // V_START is in half-lines.
+    geometry.output_height = (v_end - v_start) / 2;
+    geometry.bytes_per_pixel = (type == 3) ? 4 : 2;
+
+    const u32 y_offset = Common::bit_range<27, 16>(registers.y_scale);
+    const u32 y_scale = Common::bit_range<11, 0>(registers.y_scale);
+    const u32 first_line = y_offset >> 10;
+    const u32 last_line = (y_offset + (geometry.output_height - 1) * y_scale) >> 10;
+    // There is no point in taking more than all of RDRAM.
+    const u32 max_line_count = 0x400000 / (width * geometry.bytes_per_pixel) + 3;
+    geometry.first_line = static_cast<s32>(first_line) - 1;
+    geometry.line_count = std::min(last_line - first_line + 4, max_line_count);
+    return true;
+}
+
+void VIScanout::capture(const VI& vi, const std::array<u8, 0x400000>& rdram) {
+    const Registers registers { vi.control(), vi.origin(), vi.width(), vi.hstart(), vi.vstart(), vi.xscale(), vi.yscale() };
+    Geometry geometry;
+    if (!compute_geometry(registers, geometry)) {
+        return;
+    }
+
+    // The presenter is behind, and the frame is dropped.
+    const std::optional<Snapshot*> free_snapshot = m_free_snapshots.try_pop();
+    if (!free_snapshot) {
+        return;
+    }
+
+    Snapshot& snapshot = **free_snapshot;
+    snapshot.registers = registers;
+    snapshot.geometry = geometry;
+
+    // Lines outside of RDRAM read as black.
+    const s64 pitch = Common::bit_range<11, 0>(registers.width) * geometry.bytes_per_pixel;
+    snapshot.lines.resize(geometry.line_count * pitch);
+    const s64 begin = Common::bit_range<23, 0>(registers.origin) + geometry.first_line * pitch;
+    const s64 size = static_cast<s64>(snapshot.lines.size());
+    const s64 copy_offset = std::clamp<s64>(-begin, 0, size);
+    const s64 copy_size = std::clamp<s64>(static_cast<s64>(rdram.size()) - (begin + copy_offset), 0, size - copy_offset);
+
+    std::fill(snapshot.lines.begin(), snapshot.lines.begin() + copy_offset, 0);
+    // 16-bit pixels are put in host order on the way, with SIMD.
+    if (geometry.bytes_per_pixel == 2) {
+        Common::copy_from_big_endian16(snapshot.lines.data() + copy_offset, rdram.data() + begin + copy_offset, copy_size / 2);
+    } else {
+        std::memcpy(snapshot.lines.data() + copy_offset, rdram.data() + begin + copy_offset, copy_size);
+    }
+    std::fill(snapshot.lines.begin() + copy_offset + copy_size, snapshot.lines.end(), 0);
+
+    m_captured_snapshots.push(&snapshot);
+}
+
+const VIScanout::Frame* VIScanout::take_frame() {
+    return m_frames.update() ? &m_frames.front() : nullptr;
+}
+
+void VIScanout::presenter_loop() {
+    while (Snapshot* snapshot = m_captured_snapshots.pop()) {
+        present(*snapshot, m_frames.back());
+        m_free_snapshots.push(snapshot);
+        m_frames.publish();
+    }
+}
+
+void VIScanout::present(const Snapshot& snapshot, Frame& frame) {
+    const u32 width = Common::bit_range<11, 0>(snapshot.registers.width);
+    decode(snapshot);
+    filter(snapshot.registers, width, snapshot.geometry.line_count);
+    resample(snapshot.registers, snapshot.geometry, frame);
+    apply_gamma(snapshot.registers, frame);
+}
+
+void VIScanout::decode(const Snapshot& snapshot) {
+    const u32 pixel_count = static_cast<u32>(snapshot.lines.size() / snapshot.geometry.bytes_per_pixel);
+    m_source.resize(pixel_count);
+
+    const u8* lines = snapshot.lines.data();
+    if (snapshot.geometry.bytes_per_pixel == 2) {
+        for (u32 i = 0; i < pixel_count; i++) {
+            u16 value;
+            std::memcpy(&value, lines + i * 2, sizeof(value));
+            m_source[i] = decode_rgba16(value);
+        }
+    } else {
+        for (u32 i = 0; i < pixel_count; i++) {
+            m_source[i] = decode_rgba32(Common::read_big_endian<u32>(lines + i * 4));
+        }
+    }
+}
+
+void VIScanout::filter(const Registers& registers, const u32 width, const u32 height) {
+    const bool anti_alias = Common::bit_range<9, 8>(registers.control) < 2;
+    const bool dedither = Common::is_bit_enabled<16>(registers.control);
+    const bool divot = Common::is_bit_enabled<4>(registers.control);
+
+    m_filtered.assign(m_source.begin(), m_source.end());
+
+    if (anti_alias || dedither) {
+        for (u32 y = 0; y < height; y++) {
+            for (u32 x = 0; x < width; x++) {
+                const u32 pixel = m_source[y * width + x];
+                if (coverage(pixel) != 7) {
+                    if (anti_alias) {
+                        m_filtered[y * width + x] = anti_alias_pixel(m_source.data(), width, height, x, y);
+                    }
+                } else if (dedither) {
+                    m_filtered[y * width + x] = dedither_pixel(m_source.data(), width, height, x, y);
+                }
+            }
+        }
+    }
+
+    // Takes the median of each pixel and its horizontal neighbours where any of them is on an edge, to get rid of
+    // single pixel specks left over by anti-aliasing.
+    if (divot && width >= 3) {
+        m_blended_line.resize(width);
+        for (u32 y = 0; y < height; y++) {
+            u32* line = &m_filtered[y * width];
+            std::copy(line, line + width, m_blended_line.begin());
+            for (u32 x = 1; x + 1 < width; x++) {
+                const u32 left = m_blended_line[x - 1];
+                const u32 center = m_blended_line[x];
+                const u32 right = m_blended_line[x + 1];
+                if (coverage(left) == 7 && coverage(center) == 7 && coverage(right) == 7) {
+                    continue;
+                }
+
+                line[x] = pack(median(channel(left, 0), channel(center, 0), channel(right, 0)),
+                               median(channel(left, 8), channel(center, 8), channel(right, 8)),
+                               median(channel(left, 16), channel(center, 16), channel(right, 16)), coverage(center));
+            }
+        }
+    }
+}
+
+void VIScanout::resample(const Registers& registers, const Geometry& geometry, Frame& frame) {
+    const u32 width = Common::bit_range<11, 0>(registers.width);
+    // Pixels are replicated rather than interpolated when resampling is off.
+    const bool interpolate = Common::bit_range<9, 8>(registers.control) != 3;
+    const u32 x_offset = Common::bit_range<27, 16>(registers.x_scale);
+    const u32 x_scale = Common::bit_range<11, 0>(registers.x_scale);
+    const u32 y_offset = Common::bit_range<27, 16>(registers.y_scale);
+    const u32 y_scale = Common::bit_range<11, 0>(registers.y_scale);
+
+    frame.width = geometry.output_width;
+    frame.height = geometry.output_height;
+    frame.pixels.resize(frame.width * frame.height);
+    m_blended_line.resize(width);
+
+    for (u32 y = 0; y < frame.height; y++) {
+        const u32 position = y_offset + y * y_scale;
+        const s32 line = std::min(static_cast<s32>(position >> 10) - geometry.first_line, static_cast<s32>(geometry.line_count) - 1);
+        const s32 next_line = std::min(line + 1, static_cast<s32>(geometry.line_count) - 1);
+        const u32 fraction = interpolate ? ((position >> 5) & 0x1F) : 0;
+
+        blend_lines(&m_filtered[line * width], &m_filtered[next_line * width], fraction, m_blended_line.data(), width);
+        resample_line(m_blended_line.data(), width, x_offset, x_scale, interpolate, &frame.pixels[y * frame.width], frame.width);
+    }
+}
+
+void VIScanout::apply_gamma(const Registers& registers, Frame& frame) {
+    if (!Common::is_bit_enabled<3>(registers.control)) {
+        return;
+    }
+
+    // Dithering adds six bits of noise below each channel before taking the square root.
+    if (Common::is_bit_enabled<2>(registers.control)) {
+        for (u32& pixel : frame.pixels) {
+            m_noise ^= m_noise << 13;
+            m_noise ^= m_noise >> 17;
+            m_noise ^= m_noise << 5;
+            pixel = OpaqueAlpha | pack(DitheredGammaTable[(channel(pixel, 0) << 6) | (m_noise & 0x3F)],
+                                       DitheredGammaTable[(channel(pixel, 8) << 6) | ((m_noise >> 6) & 0x3F)],
+                                       DitheredGammaTable[(channel(pixel, 16) << 6) | ((m_noise >> 12) & 0x3F)], 0);
+        }
+        return;
+    }
+
+    for (u32& pixel : frame.pixels) {
+        pixel = OpaqueAlpha | pack(GammaTable[channel(pixel, 0)], GammaTable[channel(pixel, 8)], GammaTable[channel(pixel, 16)], 0);
+    }
+}
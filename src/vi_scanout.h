@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <thread>
+#include <vector>
+#include "common/spsc_queue.h"
+#include "common/triple_buffer.h"
+#include "common/types.h"
+
+class VI;
+
+// The VI's output stage.
+//
+// At every vblank, the VI registers and the lines of RDRAM they point at are snapshotted on the emulation thread. A
+// presenter thread then turns each snapshot into a finished frame the way the VI does: partially covered pixels are
+// anti-aliased (or fully covered ones dedithered), the divot filter runs, the image is resampled to the output
+// resolution by X_SCALE, Y_SCALE and H_START/V_START, and gamma is applied. Snapshots are dropped rather than waited
+// for if the presenter falls behind, so emulation never blocks on presentation.
+class VIScanout {
+public:
+    struct Frame {
+        u32 width {};
+        u32 height {};
+        // Packed as 0xAABBGGRR, that is bytes R, G, B, A in memory order on little-endian hosts.
+        std::vector<u32> pixels;
+    };
+
+    VIScanout();
+    ~VIScanout();
+
+    VIScanout(const VIScanout&) = delete;
+    VIScanout& operator=(const VIScanout&) = delete;
+
+    void capture(const VI& vi, const std::array<u8, 0x400000>& rdram);
+
+    // Returns the latest finished frame, if one came out since the last call, through a triple buffer. It stays valid
+    // until the next call, which must come from the same thread.
+    const Frame* take_frame();
+
+private:
+    struct Registers {
+        u32 control;
+        u32 origin;
+        u32 width;
+        u32 h_start;
+        u32 v_start;
+        u32 x_scale;
+        u32 y_scale;
+    };
+
+    // Where the output comes from, as worked out from the registers.
+    struct Geometry {
+        u32 output_width;
+        u32 output_height;
+        u32 bytes_per_pixel;
+        // The framebuffer lines snapshotted, including one above and two below the sampled ones, for the filters and
+        // interpolation.
+        s32 first_line;
+        u32 line_count;
+    };
+
+    struct Snapshot {
+        Registers registers;
+        Geometry geometry;
+        // 16-bit pixels are in host order, 32-bit ones as they are in RDRAM.
+        std::vector<u8> lines;
+    };
+
+    static constexpr std::size_t SnapshotCount = 3;
+
+    // Snapshots go to the presenter through one ring and come back through the other. A null snapshot stops the
+    // presenter.
+    std::array<Snapshot, SnapshotCount> m_snapshots {};
+    Common::SPSCQueue<Snapshot*, 4> m_captured_snapshots;
+    Common::SPSCQueue<Snapshot*, 4> m_free_snapshots;
+
+    // Only touched by the presenter.
+    std::vector<u32> m_source;
+    std::vector<u32> m_filtered;
+    std::vector<u32> m_blended_line;
+    u32 m_noise { 1 };
+
+    Common::TripleBuffer<Frame> m_frames;
+
+    std::thread m_presenter;
+
+    static bool compute_geometry(const Registers& registers, Geometry& geometry);
+
+    void presenter_loop();
+    void present(const Snapshot& snapshot, Frame& frame);
+    void decode(const Snapshot& snapshot);
+    void filter(const Registers& registers, u32 width, u32 height);
+    void resample(const Registers& registers, const Geometry& geometry, Frame& frame);
+    void apply_gamma(const Registers& registers, Frame& frame);
+};
@@ -1,13 +1,43 @@
+#include <algorithm>
 #include <fmt/core.h>
+#include <utility>
+#include "jit/vr4300_recompiler.h"
 #include "vr4300.h"
 #include "n64.h"
 
 #define LTRACE_VR4300(disasm_fmt, ...) // if (m_enable_trace_logging) fmt::print("trace: {:016X}: {:08X}  " disasm_fmt "\n", u64(s32(m_pc)), instruction, ##__VA_ARGS__)
 
-VR4300::VR4300(N64& system) : m_system(system), m_cop1(*this) {
+// Upper bound on block length, so straight-line code does not get decoded far ahead of execution.
+static constexpr std::size_t MaxBlockInstructions = 256;
+// Blocks never cross one of these, as the next TLB page can map anywhere, or nowhere.
+static constexpr u32 MinTLBPageSize = 0x1000;
+
+static ALWAYS_INLINE bool is_uncached_address(const u64 address) {
+    return Common::bit_range<31, 29>(address) == 0b101;
+}
+
+// Anything outside of KSEG0 and KSEG1 goes through the TLB.
+static ALWAYS_INLINE bool is_mapped_address(const u64 address) {
+    return Common::bit_range<31, 30>(address) != 0b10;
+}
+
+VR4300::VR4300(N64& system, const CPUBackend backend, const CacheEmulation cache_emulation)
+    : m_system(system), m_cop0(system.scheduler()), m_cop1(*this), m_cache_emulation(cache_emulation) {
+    if (backend == CPUBackend::JIT && cache_emulation == CacheEmulation::Enabled) {
+        LWARN("Cache emulation is only supported by the interpreter, the JIT will not be used");
+    } else if (backend == CPUBackend::JIT) {
+#ifdef FOURIXTYS_JIT_X64
+        m_recompiler = std::make_unique<JIT::VR4300Recompiler>(*this);
+#else
+        UNIMPLEMENTED_MSG("The JIT backend is not available on this platform");
+#endif
+    }
+
     simulate_pif_routine();
 }
 
+VR4300::~VR4300() = default;
+
 void VR4300::simulate_pif_routine() {
     // copied from MAME
     m_gprs[ 1] = 0x0000000000000001;
@@ -53,6 +83,14 @@ void VR4300::simulate_pif_routine() {
         m_system.mmu().write8(destination_address + i, m_system.mmu().read8(source_address + i));
     }
 
+    // The PIF also sets the bus timings of cartridge domain 1 up from the first word of the ROM header, which
+    // libultra reads back. The values go to BSD_DOM1_LAT, PWD, PGS and RLS.
+    const u32 header = m_system.mmu().read32(source_address);
+    m_system.mmu().write32(0xA4600014, Common::bit_range<7, 0>(header));
+    m_system.mmu().write32(0xA4600018, Common::bit_range<15, 8>(header));
+    m_system.mmu().write32(0xA460001C, Common::bit_range<19, 16>(header));
+    m_system.mmu().write32(0xA4600020, Common::bit_range<21, 20>(header));
+
     m_pc = 0xA4000040;
     m_next_pc = m_pc + 4;
 }
@@ -89,7 +127,6 @@ void VR4300::throw_exception(const ExceptionCodes code) {
         case ExceptionCodes::TLBMissLoad:
         case ExceptionCodes::TLBMissStore:
         case ExceptionCodes::TLBModification:
-            UNIMPLEMENTED();
         case ExceptionCodes::AddressErrorLoad:
         case ExceptionCodes::AddressErrorStore:
         case ExceptionCodes::Syscall:
@@ -110,636 +147,727 @@ void VR4300::throw_exception(const ExceptionCodes code) {
     }
 }
 
-template <VR4300::ExceptionCodes code>
-void VR4300::throw_address_error_exception(const u64 bad_address) {
-    static_assert(code == ExceptionCodes::AddressErrorLoad || code == ExceptionCodes::AddressErrorStore);
-
+void VR4300::set_bad_address(const u64 bad_address) {
     m_cop0.bad_vaddr = bad_address;
     m_cop0.context.flags.bad_vpn_2 = Common::bit_range<31, 13>(bad_address);
     m_cop0.xcontext.flags.bad_vpn_2 = Common::bit_range<39, 13>(bad_address);
     m_cop0.xcontext.flags.r = Common::bit_range<63, 62>(bad_address);
-    throw_exception(code);
 }
 
-void VR4300::step() {
-    // Always reset the zero register, just in case
-    m_gprs[0] = 0;
+template <VR4300::ExceptionCodes code>
+void VR4300::throw_address_error_exception(const u64 bad_address) {
+    static_assert(code == ExceptionCodes::AddressErrorLoad || code == ExceptionCodes::AddressErrorStore);
 
-    const u32 instruction = m_system.mmu().read32(m_pc);
-    decode_and_execute_instruction(instruction);
+    set_bad_address(bad_address);
+    throw_exception(code);
+}
 
-    if (m_in_delay_slot) {
-        m_in_delay_slot = false;
-    }
+void VR4300::throw_tlb_exception(const ExceptionCodes code, const u64 bad_address, const bool refill) {
+    set_bad_address(bad_address);
 
-    if (m_entering_delay_slot) {
-        m_in_delay_slot = true;
-        m_entering_delay_slot = false;
-    }
+    // EntryHi gets the VPN2 of the address, ready for the handler to write an entry, while the ASID stays as is.
+    m_cop0.entry_hi = (static_cast<u32>(bad_address) & ~0x1FFFu) | Common::bit_range<7, 0>(m_cop0.entry_hi);
 
-    if (!m_about_to_branch) {
-        m_pc = m_next_pc;
-        m_next_pc += 4;
-    } else {
-        m_pc += 4;
-        m_about_to_branch = false;
+    // Refills that happen while another exception is being handled go through the general vector.
+    const bool use_refill_vector = refill && !m_cop0.status.flags.exl;
+    throw_exception(code);
+    if (use_refill_vector) {
+        m_next_pc = 0xFFFFFFFF80000000;
     }
 }
 
-void VR4300::decode_and_execute_instruction(u32 instruction) {
-    const auto op = Common::bit_range<31, 26>(instruction);
-
-    switch (op) {
-        case 0b000000:
-            decode_and_execute_special_instruction(instruction);
-            return;
-
-        case 0b000001:
-            decode_and_execute_regimm_instruction(instruction);
-            return;
-
-        case 0b010000:
-            decode_and_execute_cop0_instruction(instruction);
-            return;
-
-        case 0b010001:
-            decode_and_execute_cop1_instruction(instruction);
-            return;
-
-        case 0b010010:
-            cop2(instruction);
-            return;
-
-        case 0b000010:
-            j(instruction);
-            return;
-
-        case 0b000011:
-            jal(instruction);
-            return;
-
-        case 0b000100:
-            beq(instruction);
-            return;
-
-        case 0b000101:
-            bne(instruction);
-            return;
-
-        case 0b000110:
-            blez(instruction);
-            return;
-
-        case 0b000111:
-            bgtz(instruction);
-            return;
+ALWAYS_INLINE std::optional<u32> VR4300::translate_address(const u64 address, const bool write) {
+    // KSEG0 and KSEG1 are mapped directly, and already understood by the MMU.
+    const u32 virtual_address = static_cast<u32>(address);
+    if (!is_mapped_address(address)) [[likely]] {
+        return virtual_address;
+    }
 
-        case 0b001000:
-            addi(instruction);
-            return;
+    return translate_mapped_address(address, write);
+}
 
-        case 0b001001:
-            addiu(instruction);
-            return;
+std::optional<u32> VR4300::translate_mapped_address(const u64 address, const bool write) {
+    const u32 virtual_address = static_cast<u32>(address);
 
-        case 0b001010:
-            slti(instruction);
-            return;
+    // While ERL is set, KUSEG bypasses the TLB.
+    if (m_cop0.status.flags.erl && virtual_address < 0x80000000) [[unlikely]] {
+        return virtual_address;
+    }
 
-        case 0b001011:
-            sltiu(instruction);
-            return;
+    const TLB::Translation translation = m_tlb.translate(virtual_address, Common::bit_range<7, 0>(m_cop0.entry_hi), write);
+    switch (translation.status) {
+        case TLB::Status::Hit:
+            return translation.physical_address;
+        case TLB::Status::Miss:
+            throw_tlb_exception(write ? ExceptionCodes::TLBMissStore : ExceptionCodes::TLBMissLoad, address, true);
+            return std::nullopt;
+        case TLB::Status::Invalid:
+            throw_tlb_exception(write ? ExceptionCodes::TLBMissStore : ExceptionCodes::TLBMissLoad, address, false);
+            return std::nullopt;
+        case TLB::Status::Modified:
+            throw_tlb_exception(ExceptionCodes::TLBModification, address, false);
+            return std::nullopt;
+        default:
+            UNREACHABLE_MSG("Unreachable TLB status {}", Common::underlying(translation.status));
+    }
+}
 
-        case 0b001100:
-            andi(instruction);
-            return;
+u32 VR4300::physical_address_of(const u64 address) {
+    const u32 virtual_address = static_cast<u32>(address);
+    if (!is_mapped_address(address) || (m_cop0.status.flags.erl && virtual_address < 0x80000000)) {
+        return virtual_address & 0x1FFFFFFF;
+    }
 
-        case 0b001101:
-            ori(instruction);
-            return;
+    return m_tlb.translate(virtual_address, Common::bit_range<7, 0>(m_cop0.entry_hi), false).physical_address;
+}
 
-        case 0b001110:
-            xori(instruction);
-            return;
+void VR4300::access_instruction_cache(const u64 pc) {
+    const u32 virtual_address = static_cast<u32>(pc);
+    if (m_icache.access(virtual_address, physical_address_of(pc), false).miss) {
+        stall(InstructionCacheFillStallCycles);
+    }
+}
 
-        case 0b001111:
-            lui(instruction);
-            return;
+void VR4300::access_data_cache(const u64 address, const u32 physical_address, const bool write) {
+    const auto [miss, writeback] = m_dcache.access(static_cast<u32>(address), physical_address, write);
+    if (writeback) {
+        stall(DataCacheWritebackStallCycles);
+    }
+    if (miss) {
+        stall(DataCacheFillStallCycles);
+    }
+}
 
-        case 0b010100:
-            beql(instruction);
-            return;
+template <typename T>
+std::optional<T> VR4300::load(const u64 address) {
+    const auto mmu_address = translate_address(address, false);
+    if (!mmu_address) [[unlikely]] {
+        return std::nullopt;
+    }
 
-        case 0b010101:
-            bnel(instruction);
-            return;
+    if (is_uncached_address(address)) {
+        stall(UncachedDataAccessStallCycles);
+    } else if (m_cache_emulation == CacheEmulation::Enabled) [[unlikely]] {
+        access_data_cache(address, *mmu_address & 0x1FFFFFFF, false);
+    }
 
-        case 0b010111:
-            bgtzl(instruction);
-            return;
+    if constexpr (Common::TypeIsSame<T, u8>) {
+        return m_system.mmu().read8(*mmu_address);
+    } else if constexpr (Common::TypeIsSame<T, u16>) {
+        return m_system.mmu().read16(*mmu_address);
+    } else if constexpr (Common::TypeIsSame<T, u32>) {
+        return m_system.mmu().read32(*mmu_address);
+    } else if constexpr (Common::TypeIsSame<T, u64>) {
+        return m_system.mmu().read64(*mmu_address);
+    } else {
+        UNREACHABLE();
+    }
+}
 
-        case 0b011000:
-            daddi(instruction);
-            return;
+template <typename T>
+void VR4300::store(const u64 address, const T value) {
+    const auto mmu_address = translate_address(address, true);
+    if (!mmu_address) [[unlikely]] {
+        return;
+    }
 
-        case 0b011001:
-            daddiu(instruction);
-            return;
+    if (is_uncached_address(address)) {
+        stall(UncachedDataAccessStallCycles);
+    } else if (m_cache_emulation == CacheEmulation::Enabled) [[unlikely]] {
+        access_data_cache(address, *mmu_address & 0x1FFFFFFF, true);
+    }
 
-        case 0b011010:
-            ldl(instruction);
-            return;
+    if constexpr (Common::TypeIsSame<T, u8>) {
+        m_system.mmu().write8(*mmu_address, value);
+    } else if constexpr (Common::TypeIsSame<T, u16>) {
+        m_system.mmu().write16(*mmu_address, value);
+    } else if constexpr (Common::TypeIsSame<T, u32>) {
+        m_system.mmu().write32(*mmu_address, value);
+    } else if constexpr (Common::TypeIsSame<T, u64>) {
+        m_system.mmu().write64(*mmu_address, value);
+    } else {
+        UNREACHABLE();
+    }
+}
 
-        case 0b011011:
-            ldr(instruction);
-            return;
+ALWAYS_INLINE u32 VR4300::execute(const DecodedInstruction& decoded) {
+    // Always reset the zero register, just in case
+    m_gprs[0] = 0;
 
-        case 0b011111:
-            reserved(instruction);
-            return;
+    m_stall_cycles = 0;
+    if (is_uncached_address(m_pc)) {
+        stall(UncachedInstructionFetchStallCycles);
+    } else if (m_cache_emulation == CacheEmulation::Enabled) [[unlikely]] {
+        access_instruction_cache(m_pc);
+    }
 
-        case 0b100000:
-            lb(instruction);
-            return;
+    (this->*decoded.handler)(decoded);
 
-        case 0b100001:
-            lh(instruction);
-            return;
+    if (m_in_delay_slot) {
+        m_in_delay_slot = false;
+    }
 
-        case 0b100010:
-            lwl(instruction);
-            return;
+    if (m_entering_delay_slot) {
+        m_in_delay_slot = true;
+        m_entering_delay_slot = false;
+    }
 
-        case 0b100011:
-            lw(instruction);
-            return;
+    if (!m_about_to_branch) {
+        m_pc = m_next_pc;
+        m_next_pc += 4;
+    } else {
+        m_pc += 4;
+        m_about_to_branch = false;
+    }
 
-        case 0b100100:
-            lbu(instruction);
-            return;
+    return 1 + m_stall_cycles;
+}
 
-        case 0b100101:
-            lhu(instruction);
-            return;
+u32 VR4300::step() {
+    const auto mmu_address = translate_address(m_pc, false);
+    if (!mmu_address) [[unlikely]] {
+        // The fetch threw a TLB exception, so nothing gets executed before the exception vector.
+        m_pc = m_next_pc;
+        m_next_pc = m_pc + 4;
+        m_in_delay_slot = false;
+        return 1;
+    }
 
-        case 0b100110:
-            lwr(instruction);
-            return;
+    return execute(decode(m_system.mmu().read32(*mmu_address)));
+}
 
-        case 0b100111:
-            lwu(instruction);
-            return;
+u64 VR4300::run(const u64 budget) {
+    auto& scheduler = m_system.scheduler();
+    const u64 start_timestamp = scheduler.timestamp();
+    const u64 end_timestamp = start_timestamp + budget;
+    m_run_end_timestamp = end_timestamp;
 
-        case 0b101000:
-            sb(instruction);
-            return;
+    // The next event is re-read every time, as instructions can schedule new events (e.g. DMAs).
+    const auto out_of_cycles = [&] {
+        return scheduler.timestamp() >= std::min(end_timestamp, scheduler.next_event_timestamp());
+    };
 
-        case 0b101001:
-            sh(instruction);
-            return;
+    while (!out_of_cycles()) {
+        if (m_code_modified) {
+            flush_dirty_code_pages();
+        }
 
-        case 0b101010:
-            swl(instruction);
-            return;
+        if (m_cop0.has_unmasked_interrupt() && m_cop0.should_service_interrupt()) [[unlikely]] {
+            throw_exception(ExceptionCodes::Interrupt);
+        }
 
-        case 0b101011:
-            sw(instruction);
-            return;
+        const Block* block = lookup_block(m_pc);
+        if (!block) {
+            scheduler.add_cycles(step());
+            continue;
+        }
 
-        case 0b101100:
-            sdl(instruction);
-            return;
+        // Recompiled code assumes it is entered outside of any branch, with the PC moving sequentially.
+        const bool sequential = !m_about_to_branch && !m_entering_delay_slot && !m_in_delay_slot && m_next_pc == m_pc + 4;
+        if (block->jit_code && sequential && !is_mapped_address(m_pc)) {
+            const u64 deadline = std::min(end_timestamp, scheduler.next_event_timestamp());
+            scheduler.add_cycles(block->jit_code(this, deadline - scheduler.timestamp()));
+            continue;
+        }
 
-        case 0b101101:
-            sdr(instruction);
-            return;
+        for (const DecodedInstruction& decoded : block->instructions) {
+            const u64 sequential_pc = m_pc + 4;
+            scheduler.add_cycles(execute(decoded));
 
-        case 0b101110:
-            swr(instruction);
-            return;
+            // Leave the block on taken branches and exceptions, code writes, due events and interrupts that can be taken.
+            if (m_pc != sequential_pc || m_code_modified || out_of_cycles() ||
+                (m_cop0.has_unmasked_interrupt() && m_cop0.should_service_interrupt())) [[unlikely]] {
+                break;
+            }
+        }
+    }
 
-        case 0b101111:
-            cache(instruction);
-            return;
+    return scheduler.timestamp() - start_timestamp;
+}
 
-        case 0b110000:
-            ll(instruction);
-            return;
+u64 VR4300::execute_for_recompiler(const DecodedInstruction& decoded, const u64 pc, const bool in_delay_slot, const u64 pending_cycles) {
+    auto& scheduler = m_system.scheduler();
+    scheduler.add_cycles(pending_cycles);
 
-        case 0b110001:
-            lwc1(instruction);
-            return;
+    // In a delay slot, the recompiled branch has already stored its destination in m_next_pc.
+    m_pc = pc;
+    if (in_delay_slot) {
+        m_in_delay_slot = true;
+    } else {
+        m_next_pc = pc + 4;
+    }
 
-        case 0b110101:
-            ldc1(instruction);
-            return;
+    const u64 expected_pc = m_next_pc;
+    scheduler.add_cycles(execute(decoded));
 
-        case 0b110111:
-            ld(instruction);
-            return;
+    // The same exit conditions as the block loop in run(), plus branches in delay slots, which are left to run().
+    if (m_pc != expected_pc || m_in_delay_slot || m_code_modified ||
+        (m_cop0.has_unmasked_interrupt() && m_cop0.should_service_interrupt())) {
+        return 0;
+    }
 
-        case 0b111000:
-            sc(instruction);
-            return;
+    const u64 deadline = std::min(m_run_end_timestamp, scheduler.next_event_timestamp());
+    return (scheduler.timestamp() < deadline) ? (deadline - scheduler.timestamp()) : 0;
+}
 
-        case 0b111001:
-            swc1(instruction);
-            return;
+// Jumps and branches, which end a block after their delay slot.
+static bool has_delay_slot(const u32 instruction) {
+    switch (Common::bit_range<31, 26>(instruction)) {
+        case 0b000000: {
+            const auto op = Common::bit_range<5, 0>(instruction);
+            return op == 0b001000 || op == 0b001001;
+        }
 
-        case 0b111101:
-            sdc1(instruction);
-            return;
+        case 0b000001:
+        case 0b000010 ... 0b000111:
+        case 0b010100 ... 0b010111:
+            return true;
 
-        case 0b111111:
-            sd(instruction);
-            return;
+        case 0b010001:
+            return Common::bit_range<25, 21>(instruction) == 0b01000;
 
         default:
-            UNIMPLEMENTED_MSG("Unrecognized VR4300 op {:06b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, instruction, m_pc);
+            return false;
     }
 }
 
-void VR4300::decode_and_execute_special_instruction(u32 instruction) {
-    const auto op = Common::bit_range<5, 0>(instruction);
-
-    switch (op) {
-        case 0b000000:
-            sll(instruction);
-            return;
-
-        case 0b000010:
-            srl(instruction);
-            return;
-
-        case 0b000011:
-            sra(instruction);
-            return;
-
-        case 0b000100:
-            sllv(instruction);
-            return;
-
-        case 0b000110:
-            srlv(instruction);
-            return;
-
-        case 0b000111:
-            srav(instruction);
-            return;
-
-        case 0b001000:
-            jr(instruction);
-            return;
-
-        case 0b001001:
-            jalr(instruction);
-            return;
-
-        case 0b001100:
-            syscall(instruction);
-            return;
-
-        case 0b001101:
-            break_(instruction);
-            return;
-
-        case 0b001111:
-            sync(instruction);
-            return;
-
-        case 0b010000:
-            mfhi(instruction);
-            return;
-
-        case 0b010001:
-            mthi(instruction);
-            return;
-
-        case 0b010010:
-            mflo(instruction);
-            return;
-
-        case 0b010011:
-            mtlo(instruction);
-            return;
-
-        case 0b010100:
-            dsllv(instruction);
-            return;
-
-        case 0b010110:
-            dsrlv(instruction);
-            return;
-
-        case 0b010111:
-            dsrav(instruction);
-            return;
-
-        case 0b011000:
-            mult(instruction);
-            return;
-
-        case 0b011001:
-            multu(instruction);
-            return;
-
-        case 0b011010:
-            div(instruction);
-            return;
-
-        case 0b011011:
-            divu(instruction);
-            return;
-
-        case 0b011100:
-            dmult(instruction);
-            return;
-
-        case 0b011101:
-            dmultu(instruction);
-            return;
-
-        case 0b011110:
-            ddiv(instruction);
-            return;
-
-        case 0b011111:
-            ddivu(instruction);
-            return;
-
-        case 0b100000:
-            add(instruction);
-            return;
-
-        case 0b100001:
-            addu(instruction);
-            return;
-
-        case 0b100010:
-            sub(instruction);
-            return;
-
-        case 0b100011:
-            subu(instruction);
-            return;
-
-        case 0b100100:
-            and_(instruction);
-            return;
-
-        case 0b100101:
-            or_(instruction);
-            return;
-
-        case 0b100110:
-            xor_(instruction);
-            return;
-
-        case 0b100111:
-            nor(instruction);
-            return;
-
-        case 0b101010:
-            slt(instruction);
-            return;
-
-        case 0b101011:
-            sltu(instruction);
-            return;
+static bool is_eret(const u32 instruction) {
+    return instruction == 0x42000018;
+}
 
-        case 0b101100:
-            dadd(instruction);
-            return;
+const VR4300::Block* VR4300::lookup_block(const u64 pc) {
+    // Blocks are cached by physical address. Code that cannot be translated without an exception goes through step().
+    const u32 address = static_cast<u32>(pc);
+    u32 physical_address = address & 0x1FFFFFFF;
+    if (is_mapped_address(pc)) {
+        if (m_cop0.status.flags.erl) {
+            return nullptr;
+        }
 
-        case 0b101101:
-            daddu(instruction);
-            return;
+        const TLB::Translation translation = m_tlb.translate(address, Common::bit_range<7, 0>(m_cop0.entry_hi), false);
+        if (translation.status != TLB::Status::Hit) {
+            return nullptr;
+        }
 
-        case 0b101110:
-            dsub(instruction);
-            return;
+        physical_address = translation.physical_address;
+    }
 
-        case 0b101111:
-            dsubu(instruction);
-            return;
+    if (physical_address >= m_system.mmu().rdram().size()) {
+        return nullptr;
+    }
 
-        case 0b110100:
-            teq(instruction);
-            return;
+    if (const auto it = m_blocks.find(physical_address); it != m_blocks.end()) {
+        return &it->second;
+    }
 
-        case 0b110110:
-            tne(instruction);
-            return;
+    return &compile_block(physical_address);
+}
 
-        case 0b111000:
-            dsll(instruction);
-            return;
+const VR4300::Block& VR4300::compile_block(const u32 physical_address) {
+    // Dropping everything is the only way to reclaim code space, so do it before the new block takes any.
+    if (m_recompiler && m_recompiler->needs_flush()) [[unlikely]] {
+        clear_block_cache();
+    }
 
-        case 0b111010:
-            dsrl(instruction);
-            return;
+    Block& block = m_blocks[physical_address];
+    const u32 rdram_size = m_system.mmu().rdram().size();
 
-        case 0b111011:
-            dsra(instruction);
-            return;
+    u32 address = physical_address;
+    bool in_delay_slot = false;
+    bool ends_before_delay_slot = false;
+    while (address < rdram_size) {
+        const u32 instruction = m_system.mmu().read32(address);
+        block.instructions.push_back(decode(instruction));
+        address += 4;
 
-        case 0b111100:
-            dsll32(instruction);
-            return;
+        if (in_delay_slot || is_eret(instruction)) {
+            block.ends_in_delay_slot = in_delay_slot;
+            break;
+        }
 
-        case 0b111110:
-            dsrl32(instruction);
-            return;
+        in_delay_slot = has_delay_slot(instruction);
 
-        case 0b111111:
-            dsra32(instruction);
-            return;
+        // Blocks are shared by mapped and unmapped aliases of the same code, so all of them stop at a page boundary.
+        // A branch whose delay slot is on the next page is left to the next block, unless it is all there is.
+        if ((address & (MinTLBPageSize - 1)) == 0) {
+            if (in_delay_slot && block.instructions.size() > 1) {
+                block.instructions.pop_back();
+                address -= 4;
+            } else {
+                ends_before_delay_slot = in_delay_slot;
+            }
+            break;
+        }
 
-        default:
-            UNIMPLEMENTED_MSG("unrecognized VR4300 SPECIAL op {:06b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, instruction, m_pc);
+        if (!in_delay_slot && block.instructions.size() >= MaxBlockInstructions) {
+            break;
+        }
     }
-}
-
-void VR4300::decode_and_execute_regimm_instruction(u32 instruction) {
-    const auto op = Common::bit_range<20, 16>(instruction);
-
-    switch (op) {
-        case 0b00000:
-            bltz(instruction);
-            return;
-
-        case 0b00001:
-            bgez(instruction);
-            return;
-
-        case 0b00010:
-            bltzl(instruction);
-            return;
 
-        case 0b00011:
-            bgezl(instruction);
-            return;
-
-        case 0b10001:
-            bgezal(instruction);
-            return;
+    // Recompiled branches take their delay slot along, so a branch cut off from it is only ever interpreted.
+    if (m_recompiler && !ends_before_delay_slot) {
+        block.jit_code = m_recompiler->compile(physical_address, block);
+    }
 
-        default:
-            UNIMPLEMENTED_MSG("unrecognized VR4300 REGIMM op {:05b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, instruction, m_pc);
+    const u32 first_page = physical_address >> CodePageShift;
+    const u32 last_page = (address - 1) >> CodePageShift;
+    for (u32 page = first_page; page <= last_page; page++) {
+        m_code_pages[page] = true;
+        m_code_page_blocks[page].push_back(physical_address);
+        m_system.mmu().set_rdram_page_write_protected(page << CodePageShift, true);
     }
-}
 
-void VR4300::decode_and_execute_cop0_instruction(u32 instruction) {
-    if (Common::is_bit_enabled<25>(instruction)) {
-        const auto op = Common::bit_range<5, 0>(instruction);
-        switch (op) {
-            case 0b000010:
-                tlbwi(instruction);
-                return;
+    return block;
+}
 
-            case 0b011000:
-                eret(instruction);
-                return;
+void VR4300::mark_code_page_dirty(const u32 page) {
+    // Blocks are only dropped once the CPU is between blocks, as the current one may be the one being written.
+    m_code_pages[page] = false;
+    m_system.mmu().set_rdram_page_write_protected(page << CodePageShift, false);
+    m_dirty_code_pages.push_back(page);
+    m_code_modified = true;
+}
 
-            default:
-                UNIMPLEMENTED_MSG("unrecognized COP0 CO op {:06b} (instr={:08X}, pc={:016X})", op, instruction, m_pc);
+void VR4300::flush_dirty_code_pages() {
+    for (const u32 page : m_dirty_code_pages) {
+        // Taken out first, as dropping a block edits the lists of every page it spans.
+        const std::vector<u32> addresses = std::exchange(m_code_page_blocks[page], {});
+        for (const u32 address : addresses) {
+            drop_block(address);
         }
     }
 
-    const auto op = Common::bit_range<25, 21>(instruction);
-
-    switch (op) {
-        case 0b00000:
-            mfc0(instruction);
-            return;
-
-        case 0b00001:
-            dmfc0(instruction);
-            return;
-
-        case 0b00100:
-            mtc0(instruction);
-            return;
-
-        case 0b00101:
-            dmtc0(instruction);
-            return;
-
-        default:
-            UNIMPLEMENTED_MSG("unrecognized COP0 op {:05b} (instr={:08X}, pc={:016X})", op, instruction, m_pc);
-    }
+    m_dirty_code_pages.clear();
+    m_code_modified = false;
 }
 
-void VR4300::decode_and_execute_cop1_instruction(u32 instruction) {
-    if (!Common::is_bit_enabled<25>(instruction)) {
-        const auto ct_op = Common::bit_range<25, 21>(instruction);
-        switch (ct_op) {
-            case 0b00000:
-                mfc1(instruction);
-                return;
+void VR4300::drop_block(const u32 physical_address) {
+    const auto it = m_blocks.find(physical_address);
+    if (it == m_blocks.end()) {
+        return;
+    }
 
-            case 0b00001:
-                dmfc1(instruction);
-                return;
+    // Blocks spanning two pages are listed under both, and must not be left behind in the other one.
+    const u32 end = physical_address + static_cast<u32>(it->second.instructions.size()) * 4;
+    for (u32 page = physical_address >> CodePageShift; page <= (end - 1) >> CodePageShift; page++) {
+        std::erase(m_code_page_blocks[page], physical_address);
+    }
+
+    m_blocks.erase(it);
+    if (m_recompiler) {
+        m_recompiler->invalidate(physical_address);
+    }
+}
+
+bool VR4300::sees_rdram_rdp_protection() const {
+    return !m_recompiler || m_recompiler->uses_fastmem();
+}
+
+void VR4300::clear_block_cache() {
+    m_blocks.clear();
+    m_code_pages.fill(false);
+    m_system.mmu().unprotect_rdram();
+    for (auto& blocks : m_code_page_blocks) {
+        blocks.clear();
+    }
+
+    if (m_recompiler) {
+        m_recompiler->clear();
+    }
+}
+
+const std::array<VR4300::InstructionHandler, 64> VR4300::m_primary_handlers = [] {
+    std::array<InstructionHandler, 64> handlers {};
+    handlers.fill(&VR4300::unrecognized_instruction);
+
+    handlers[0b000010] = &VR4300::j;
+    handlers[0b000011] = &VR4300::jal;
+    handlers[0b000100] = &VR4300::beq;
+    handlers[0b000101] = &VR4300::bne;
+    handlers[0b000110] = &VR4300::blez;
+    handlers[0b000111] = &VR4300::bgtz;
+    handlers[0b001000] = &VR4300::addi;
+    handlers[0b001001] = &VR4300::addiu;
+    handlers[0b001010] = &VR4300::slti;
+    handlers[0b001011] = &VR4300::sltiu;
+    handlers[0b001100] = &VR4300::andi;
+    handlers[0b001101] = &VR4300::ori;
+    handlers[0b001110] = &VR4300::xori;
+    handlers[0b001111] = &VR4300::lui;
+    handlers[0b010010] = &VR4300::cop2;
+    handlers[0b010100] = &VR4300::beql;
+    handlers[0b010101] = &VR4300::bnel;
+    handlers[0b010111] = &VR4300::bgtzl;
+    handlers[0b011000] = &VR4300::daddi;
+    handlers[0b011001] = &VR4300::daddiu;
+    handlers[0b011010] = &VR4300::ldl;
+    handlers[0b011011] = &VR4300::ldr;
+    handlers[0b011111] = &VR4300::reserved;
+    handlers[0b100000] = &VR4300::lb;
+    handlers[0b100001] = &VR4300::lh;
+    handlers[0b100010] = &VR4300::lwl;
+    handlers[0b100011] = &VR4300::lw;
+    handlers[0b100100] = &VR4300::lbu;
+    handlers[0b100101] = &VR4300::lhu;
+    handlers[0b100110] = &VR4300::lwr;
+    handlers[0b100111] = &VR4300::lwu;
+    handlers[0b101000] = &VR4300::sb;
+    handlers[0b101001] = &VR4300::sh;
+    handlers[0b101010] = &VR4300::swl;
+    handlers[0b101011] = &VR4300::sw;
+    handlers[0b101100] = &VR4300::sdl;
+    handlers[0b101101] = &VR4300::sdr;
+    handlers[0b101110] = &VR4300::swr;
+    handlers[0b101111] = &VR4300::cache;
+    handlers[0b110000] = &VR4300::ll;
+    handlers[0b110001] = &VR4300::lwc1;
+    handlers[0b110101] = &VR4300::ldc1;
+    handlers[0b110111] = &VR4300::ld;
+    handlers[0b111000] = &VR4300::sc;
+    handlers[0b111001] = &VR4300::swc1;
+    handlers[0b111101] = &VR4300::sdc1;
+    handlers[0b111111] = &VR4300::sd;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 64> VR4300::m_special_handlers = [] {
+    std::array<InstructionHandler, 64> handlers {};
+    handlers.fill(&VR4300::unrecognized_special_instruction);
+
+    handlers[0b000000] = &VR4300::sll;
+    handlers[0b000010] = &VR4300::srl;
+    handlers[0b000011] = &VR4300::sra;
+    handlers[0b000100] = &VR4300::sllv;
+    handlers[0b000110] = &VR4300::srlv;
+    handlers[0b000111] = &VR4300::srav;
+    handlers[0b001000] = &VR4300::jr;
+    handlers[0b001001] = &VR4300::jalr;
+    handlers[0b001100] = &VR4300::syscall;
+    handlers[0b001101] = &VR4300::break_;
+    handlers[0b001111] = &VR4300::sync;
+    handlers[0b010000] = &VR4300::mfhi;
+    handlers[0b010001] = &VR4300::mthi;
+    handlers[0b010010] = &VR4300::mflo;
+    handlers[0b010011] = &VR4300::mtlo;
+    handlers[0b010100] = &VR4300::dsllv;
+    handlers[0b010110] = &VR4300::dsrlv;
+    handlers[0b010111] = &VR4300::dsrav;
+    handlers[0b011000] = &VR4300::mult;
+    handlers[0b011001] = &VR4300::multu;
+    handlers[0b011010] = &VR4300::div;
+    handlers[0b011011] = &VR4300::divu;
+    handlers[0b011100] = &VR4300::dmult;
+    handlers[0b011101] = &VR4300::dmultu;
+    handlers[0b011110] = &VR4300::ddiv;
+    handlers[0b011111] = &VR4300::ddivu;
+    handlers[0b100000] = &VR4300::add;
+    handlers[0b100001] = &VR4300::addu;
+    handlers[0b100010] = &VR4300::sub;
+    handlers[0b100011] = &VR4300::subu;
+    handlers[0b100100] = &VR4300::and_;
+    handlers[0b100101] = &VR4300::or_;
+    handlers[0b100110] = &VR4300::xor_;
+    handlers[0b100111] = &VR4300::nor;
+    handlers[0b101010] = &VR4300::slt;
+    handlers[0b101011] = &VR4300::sltu;
+    handlers[0b101100] = &VR4300::dadd;
+    handlers[0b101101] = &VR4300::daddu;
+    handlers[0b101110] = &VR4300::dsub;
+    handlers[0b101111] = &VR4300::dsubu;
+    handlers[0b110100] = &VR4300::teq;
+    handlers[0b110110] = &VR4300::tne;
+    handlers[0b111000] = &VR4300::dsll;
+    handlers[0b111010] = &VR4300::dsrl;
+    handlers[0b111011] = &VR4300::dsra;
+    handlers[0b111100] = &VR4300::dsll32;
+    handlers[0b111110] = &VR4300::dsrl32;
+    handlers[0b111111] = &VR4300::dsra32;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 32> VR4300::m_regimm_handlers = [] {
+    std::array<InstructionHandler, 32> handlers {};
+    handlers.fill(&VR4300::unrecognized_regimm_instruction);
+
+    handlers[0b00000] = &VR4300::bltz;
+    handlers[0b00001] = &VR4300::bgez;
+    handlers[0b00010] = &VR4300::bltzl;
+    handlers[0b00011] = &VR4300::bgezl;
+    handlers[0b10001] = &VR4300::bgezal;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 32> VR4300::m_cop0_handlers = [] {
+    std::array<InstructionHandler, 32> handlers {};
+    handlers.fill(&VR4300::unrecognized_cop0_instruction);
+
+    handlers[0b00000] = &VR4300::mfc0;
+    handlers[0b00001] = &VR4300::dmfc0;
+    handlers[0b00100] = &VR4300::mtc0;
+    handlers[0b00101] = &VR4300::dmtc0;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 64> VR4300::m_cop0_co_handlers = [] {
+    std::array<InstructionHandler, 64> handlers {};
+    handlers.fill(&VR4300::unrecognized_cop0_co_instruction);
+
+    handlers[0b000001] = &VR4300::tlbr;
+    handlers[0b000010] = &VR4300::tlbwi;
+    handlers[0b000110] = &VR4300::tlbwr;
+    handlers[0b001000] = &VR4300::tlbp;
+    handlers[0b011000] = &VR4300::eret;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 32> VR4300::m_cop1_handlers = [] {
+    std::array<InstructionHandler, 32> handlers {};
+    handlers.fill(&VR4300::unrecognized_cop1_instruction);
+
+    handlers[0b00000] = &VR4300::mfc1;
+    handlers[0b00001] = &VR4300::dmfc1;
+    handlers[0b00010] = &VR4300::cfc1;
+    handlers[0b00100] = &VR4300::mtc1;
+    handlers[0b00101] = &VR4300::dmtc1;
+    handlers[0b00110] = &VR4300::ctc1;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 32> VR4300::m_cop1_bc_handlers = [] {
+    std::array<InstructionHandler, 32> handlers {};
+    handlers.fill(&VR4300::unrecognized_cop1_bc_instruction);
+
+    handlers[0b00000] = &VR4300::cop1_op<&COP1::bc1f>;
+    handlers[0b00001] = &VR4300::cop1_op<&COP1::bc1t>;
+    handlers[0b00010] = &VR4300::cop1_op<&COP1::bc1fl>;
+    handlers[0b00011] = &VR4300::cop1_op<&COP1::bc1tl>;
+
+    return handlers;
+}();
+
+const std::array<VR4300::InstructionHandler, 64> VR4300::m_cop1_fpu_handlers = [] {
+    std::array<InstructionHandler, 64> handlers {};
+    handlers.fill(&VR4300::unrecognized_cop1_fpu_instruction);
+
+    handlers[0b000000] = &VR4300::cop1_op<&COP1::add>;
+    handlers[0b000001] = &VR4300::cop1_op<&COP1::sub>;
+    handlers[0b000010] = &VR4300::cop1_op<&COP1::mul>;
+    handlers[0b000011] = &VR4300::cop1_op<&COP1::div>;
+    handlers[0b000110] = &VR4300::cop1_op<&COP1::mov>;
+    handlers[0b001101] = &VR4300::cop1_op<&COP1::trunc_w>;
+    handlers[0b100000] = &VR4300::cop1_op<&COP1::cvt_s>;
+    handlers[0b100001] = &VR4300::cop1_op<&COP1::cvt_d>;
+    for (u32 op = 0b110000; op <= 0b111111; op++) {
+        handlers[op] = &VR4300::cop1_op<&COP1::c>;
+    }
+
+    return handlers;
+}();
+
+VR4300::DecodedInstruction VR4300::decode(const u32 instruction) {
+    return {
+        .handler = decode_handler(instruction),
+        .instruction = instruction,
+        .rs = get_rs(instruction),
+        .rt = get_rt(instruction),
+        .rd = get_rd(instruction),
+        .sa = static_cast<u8>(Common::bit_range<10, 6>(instruction)),
+        .immediate = static_cast<s16>(Common::bit_range<15, 0>(instruction)),
+    };
+}
+
+VR4300::InstructionHandler VR4300::decode_handler(const u32 instruction) {
+    const auto op = Common::bit_range<31, 26>(instruction);
 
-            case 0b00010:
-                cfc1(instruction);
-                return;
+    switch (op) {
+        case 0b000000:
+            return m_special_handlers[Common::bit_range<5, 0>(instruction)];
 
-            case 0b00100:
-                mtc1(instruction);
-                return;
+        case 0b000001:
+            return m_regimm_handlers[Common::bit_range<20, 16>(instruction)];
 
-            case 0b00101:
-                dmtc1(instruction);
-                return;
+        case 0b010000:
+            if (Common::is_bit_enabled<25>(instruction)) {
+                return m_cop0_co_handlers[Common::bit_range<5, 0>(instruction)];
+            }
 
-            case 0b00110:
-                ctc1(instruction);
-                return;
+            return m_cop0_handlers[Common::bit_range<25, 21>(instruction)];
 
-            case 0b01000: {
-                const auto bc_op = Common::bit_range<20, 16>(instruction);
-                switch (bc_op) {
-                    case 0b00000:
-                        m_cop1.bc1f(instruction);
-                        return;
-                    case 0b00001:
-                        m_cop1.bc1t(instruction);
-                        return;
-                    case 0b00010:
-                        m_cop1.bc1fl(instruction);
-                        return;
-                    case 0b00011:
-                        m_cop1.bc1tl(instruction);
-                        return;
-
-                    default:
-                        UNIMPLEMENTED_MSG("unrecognized FPU BC op {:05b} (instr={:08X}, pc={:016X})", bc_op, instruction, m_pc);
-                }
+        case 0b010001:
+            if (Common::is_bit_enabled<25>(instruction)) {
+                return m_cop1_fpu_handlers[Common::bit_range<5, 0>(instruction)];
             }
 
-            default:
-                UNIMPLEMENTED_MSG("unrecognized FPU CT op {:05b} (instr={:08X}, pc={:016X})", ct_op, instruction, m_pc);
-        }
-    }
+            if (Common::bit_range<25, 21>(instruction) == 0b01000) {
+                return m_cop1_bc_handlers[Common::bit_range<20, 16>(instruction)];
+            }
 
-    const auto op = Common::bit_range<5, 0>(instruction);
-    switch (op) {
-        case 0b000000:
-            m_cop1.add(instruction);
-            return;
+            return m_cop1_handlers[Common::bit_range<25, 21>(instruction)];
 
-        case 0b000001:
-            m_cop1.sub(instruction);
-            return;
+        default:
+            return m_primary_handlers[op];
+    }
+}
 
-        case 0b000010:
-            m_cop1.mul(instruction);
-            return;
+void VR4300::unrecognized_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<31, 26>(decoded.instruction);
+    UNIMPLEMENTED_MSG("Unrecognized VR4300 op {:06b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, decoded.instruction, m_pc);
+}
 
-        case 0b000011:
-            m_cop1.div(instruction);
-            return;
+void VR4300::unrecognized_special_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<5, 0>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized VR4300 SPECIAL op {:06b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, decoded.instruction, m_pc);
+}
 
-        case 0b000110:
-            m_cop1.mov(instruction);
-            return;
+void VR4300::unrecognized_regimm_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<20, 16>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized VR4300 REGIMM op {:05b} ({}, {}) (instr={:08X}, pc={:016X})", op, op >> 3, op & 7, decoded.instruction, m_pc);
+}
 
-        case 0b001101:
-            m_cop1.trunc_w(instruction);
-            return;
+void VR4300::unrecognized_cop0_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<25, 21>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized COP0 op {:05b} (instr={:08X}, pc={:016X})", op, decoded.instruction, m_pc);
+}
 
-        case 0b100000:
-            m_cop1.cvt_s(instruction);
-            return;
+void VR4300::unrecognized_cop0_co_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<5, 0>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized COP0 CO op {:06b} (instr={:08X}, pc={:016X})", op, decoded.instruction, m_pc);
+}
 
-        case 0b100001:
-            m_cop1.cvt_d(instruction);
-            return;
+void VR4300::unrecognized_cop1_instruction(const DecodedInstruction& decoded) {
+    const auto ct_op = Common::bit_range<25, 21>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized FPU CT op {:05b} (instr={:08X}, pc={:016X})", ct_op, decoded.instruction, m_pc);
+}
 
-        case 0b110000 ... 0b111111:
-            m_cop1.c(instruction);
-            return;
+void VR4300::unrecognized_cop1_bc_instruction(const DecodedInstruction& decoded) {
+    const auto bc_op = Common::bit_range<20, 16>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized FPU BC op {:05b} (instr={:08X}, pc={:016X})", bc_op, decoded.instruction, m_pc);
+}
 
-        default:
-            UNIMPLEMENTED_MSG("unrecognized FPU op {:06b} (instr={:08X}, pc={:016X})", op, instruction, m_pc);
-    }
+void VR4300::unrecognized_cop1_fpu_instruction(const DecodedInstruction& decoded) {
+    const auto op = Common::bit_range<5, 0>(decoded.instruction);
+    UNIMPLEMENTED_MSG("unrecognized FPU op {:06b} (instr={:08X}, pc={:016X})", op, decoded.instruction, m_pc);
 }
 
-void VR4300::cop2(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::cop2(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("cop2 ${}, ${}", rt, rd);
 
     m_cop0.cause.flags.ce = 2;
     throw_exception(ExceptionCodes::CoprocessorUnusable);
 }
 
-void VR4300::add(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::add(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("add ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     s32 result = 0;
@@ -751,14 +879,14 @@ void VR4300::add(const u32 instruction) {
     m_gprs[rd] = result;
 }
 
-void VR4300::addi(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::addi(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("addi ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
     s32 result = 0;
-    if (__builtin_sadd_overflow(m_gprs[rs], static_cast<s16>(imm), &result)) [[unlikely]] {
+    if (__builtin_sadd_overflow(m_gprs[rs], static_cast<s32>(imm), &result)) [[unlikely]] {
         throw_exception(ExceptionCodes::ArithmeticOverflow);
         return;
     }
@@ -766,46 +894,46 @@ void VR4300::addi(const u32 instruction) {
     m_gprs[rt] = result;
 }
 
-void VR4300::addiu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::addiu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("addiu ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
-    m_gprs[rt] = static_cast<s32>(m_gprs[rs] + s16(imm));
+    m_gprs[rt] = static_cast<s32>(m_gprs[rs] + imm);
 }
 
-void VR4300::addu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::addu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("addu ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rs] + m_gprs[rt]);
 }
 
-void VR4300::and_(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::and_(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("and ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = m_gprs[rs] & m_gprs[rt];
 }
 
-void VR4300::andi(u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::andi(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const u16 imm = static_cast<u16>(decoded.immediate);
     LTRACE_VR4300("andi ${}, ${}, 0x{:04X}", reg_name(rs), reg_name(rt), imm);
 
     m_gprs[rt] = m_gprs[rs] & imm;
 }
 
-void VR4300::beq(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::beq(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("beq ${}, ${}, 0x{:04X}", reg_name(rs), reg_name(rt), new_pc);
 
@@ -817,10 +945,10 @@ void VR4300::beq(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::beql(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::beql(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("beql ${}, ${}, 0x{:04X}", reg_name(rs), reg_name(rt), new_pc);
 
@@ -833,9 +961,9 @@ void VR4300::beql(const u32 instruction) {
     }
 }
 
-void VR4300::bgez(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bgez(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bgez ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -847,9 +975,9 @@ void VR4300::bgez(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::bgezal(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bgezal(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bgezal ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -862,9 +990,9 @@ void VR4300::bgezal(const u32 instruction) {
     m_gprs[31] = m_pc + 8;
 }
 
-void VR4300::bgezl(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bgezl(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bgezl ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -877,9 +1005,9 @@ void VR4300::bgezl(const u32 instruction) {
     }
 }
 
-void VR4300::bgtz(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bgtz(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bgtz ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -891,9 +1019,9 @@ void VR4300::bgtz(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::bgtzl(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bgtzl(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bgtzl ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -906,9 +1034,9 @@ void VR4300::bgtzl(const u32 instruction) {
     }
 }
 
-void VR4300::blez(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::blez(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("blez ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -920,9 +1048,9 @@ void VR4300::blez(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::bltz(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bltz(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bltz ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -934,9 +1062,9 @@ void VR4300::bltz(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::bltzl(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bltzl(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bltzl ${}, 0x{:04X}", reg_name(rs), new_pc);
 
@@ -949,10 +1077,10 @@ void VR4300::bltzl(const u32 instruction) {
     }
 }
 
-void VR4300::bne(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bne(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bne ${}, ${}, 0x{:04X}", reg_name(rs), reg_name(rt), new_pc);
 
@@ -964,10 +1092,10 @@ void VR4300::bne(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::bnel(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    [[maybe_unused]] const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::bnel(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    [[maybe_unused]] const s64 offset = decoded.immediate;
     const u64 new_pc = m_pc + 4 + (offset << 2);
     LTRACE_VR4300("bnel ${}, ${}, 0x{:04X}", reg_name(rs), reg_name(rt), new_pc);
 
@@ -980,25 +1108,125 @@ void VR4300::bnel(const u32 instruction) {
     }
 }
 
-void VR4300::break_(const u32 instruction) {
-    [[maybe_unused]] const auto code = Common::bit_range<25, 6>(instruction);
+void VR4300::break_(const DecodedInstruction& decoded) {
+    [[maybe_unused]] const auto code = Common::bit_range<25, 6>(decoded.instruction);
     LTRACE_VR4300("break (0x{:X})", code);
 
     throw_exception(ExceptionCodes::Breakpoint);
 }
 
-void VR4300::cache(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto op = Common::bit_range<20, 16>(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::cache(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto op = Common::bit_range<20, 16>(decoded.instruction);
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("cache {}, 0x{:04X}(${})", op, offset, reg_name(base));
 
-    // LWARN("CACHE is stubbed");
+    // Without cache emulation, there are no lines to operate on.
+    if (m_cache_emulation == CacheEmulation::Disabled) {
+        return;
+    }
+
+    const u64 address = m_gprs[base] + offset;
+    const auto mmu_address = translate_address(address, false);
+    if (!mmu_address) {
+        return;
+    }
+
+    const u32 virtual_address = static_cast<u32>(address);
+    const u32 physical_address = *mmu_address & 0x1FFFFFFF;
+
+    // TagLo holds physical address bits 31:12 in PTagLo and the line state in PState.
+    const auto load_tag = [&](const auto& line) {
+        m_cop0.tag_lo = (line.tag << 8) | (u32(line.valid) << 7) | (u32(line.dirty) << 6);
+    };
+    const auto store_tag = [&](auto& line) {
+        line.tag = Common::bit_range<27, 8>(m_cop0.tag_lo);
+        line.valid = Common::is_bit_enabled<7>(m_cop0.tag_lo);
+        line.dirty = Common::is_bit_enabled<6>(m_cop0.tag_lo);
+    };
+    const auto write_back = [&](auto& line) {
+        if (line.valid && line.dirty) {
+            stall(DataCacheWritebackStallCycles);
+            line.dirty = false;
+        }
+    };
+
+    if (Common::bit_range<1, 0>(op) == 0) {
+        auto& line = m_icache.line_at(virtual_address);
+        switch (Common::bit_range<4, 2>(op)) {
+            case 0: // Index_Invalidate
+                line.valid = false;
+                return;
+            case 1: // Index_Load_Tag
+                load_tag(line);
+                return;
+            case 2: // Index_Store_Tag
+                store_tag(line);
+                return;
+            case 4: // Hit_Invalidate
+                if (m_icache.hits(line, physical_address)) {
+                    line.valid = false;
+                }
+                return;
+            case 5: // Fill
+                line = { physical_address >> 12, true, false };
+                stall(InstructionCacheFillStallCycles);
+                return;
+            case 6: // Hit_Write_Back
+                return;
+            default:
+                LWARN("Unrecognized instruction cache operation {}", Common::bit_range<4, 2>(op));
+                return;
+        }
+    }
+
+    if (Common::bit_range<1, 0>(op) == 1) {
+        auto& line = m_dcache.line_at(virtual_address);
+        switch (Common::bit_range<4, 2>(op)) {
+            case 0: // Index_Write_Back_Invalidate
+                write_back(line);
+                line.valid = false;
+                return;
+            case 1: // Index_Load_Tag
+                load_tag(line);
+                return;
+            case 2: // Index_Store_Tag
+                store_tag(line);
+                return;
+            case 3: // Create_Dirty_Exclusive
+                if (!m_dcache.hits(line, physical_address)) {
+                    write_back(line);
+                }
+                line = { physical_address >> 12, true, true };
+                return;
+            case 4: // Hit_Invalidate
+                if (m_dcache.hits(line, physical_address)) {
+                    line.valid = false;
+                }
+                return;
+            case 5: // Hit_Write_Back_Invalidate
+                if (m_dcache.hits(line, physical_address)) {
+                    write_back(line);
+                    line.valid = false;
+                }
+                return;
+            case 6: // Hit_Write_Back
+                if (m_dcache.hits(line, physical_address)) {
+                    write_back(line);
+                }
+                return;
+            default:
+                LWARN("Unrecognized data cache operation {}", Common::bit_range<4, 2>(op));
+                return;
+        }
+    }
+
+    // The VR4300 has no secondary cache.
 }
 
-void VR4300::cfc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::cfc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("cfc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     if (fs == 31) {
@@ -1008,9 +1236,9 @@ void VR4300::cfc1(const u32 instruction) {
     }
 }
 
-void VR4300::ctc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::ctc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("ctc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     if (fs == 31) {
@@ -1023,10 +1251,10 @@ void VR4300::ctc1(const u32 instruction) {
     }
 }
 
-void VR4300::dadd(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dadd(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dadd ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     s64 result = 0;
@@ -1038,14 +1266,14 @@ void VR4300::dadd(const u32 instruction) {
     m_gprs[rd] = result;
 }
 
-void VR4300::daddi(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::daddi(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("daddi ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
     s64 result = 0;
-    if (__builtin_saddl_overflow(m_gprs[rs], static_cast<s16>(imm), &result)) [[unlikely]] {
+    if (__builtin_saddl_overflow(m_gprs[rs], imm, &result)) [[unlikely]] {
         throw_exception(ExceptionCodes::ArithmeticOverflow);
         return;
     }
@@ -1053,28 +1281,29 @@ void VR4300::daddi(const u32 instruction) {
     m_gprs[rt] = result;
 }
 
-void VR4300::daddiu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::daddiu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("daddiu ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
-    m_gprs[rt] = m_gprs[rs] + s16(imm);
+    m_gprs[rt] = m_gprs[rs] + imm;
 }
 
-void VR4300::daddu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::daddu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("daddu ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = m_gprs[rs] + m_gprs[rt];
 }
 
-void VR4300::ddiv(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+void VR4300::ddiv(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("ddiv ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DoublewordDivideStallCycles);
 
     const s64 numerator = m_gprs[rs];
     const s64 denominator = m_gprs[rt];
@@ -1094,10 +1323,11 @@ void VR4300::ddiv(const u32 instruction) {
     }
 }
 
-void VR4300::ddivu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+void VR4300::ddivu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("ddivu ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DoublewordDivideStallCycles);
 
     const u64 numerator = m_gprs[rs];
     const u64 denominator = m_gprs[rt];
@@ -1111,10 +1341,11 @@ void VR4300::ddivu(const u32 instruction) {
     }
 }
 
-void VR4300::div(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+void VR4300::div(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("div ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DivideStallCycles);
 
     const s32 numerator = m_gprs[rs];
     const s32 denominator = m_gprs[rt];
@@ -1134,10 +1365,11 @@ void VR4300::div(const u32 instruction) {
     }
 }
 
-void VR4300::divu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+void VR4300::divu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("divu ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DivideStallCycles);
 
     const s32 numerator = m_gprs[rs];
     const s32 denominator = m_gprs[rt];
@@ -1151,147 +1383,149 @@ void VR4300::divu(const u32 instruction) {
     }
 }
 
-void VR4300::dmfc0(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dmfc0(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dmfc0 ${}, ${}", reg_name(rt), m_cop0.get_reg_name(rd));
 
     m_gprs[rt] = m_cop0.get_reg(rd);
 }
 
-void VR4300::dmfc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::dmfc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("dmfc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     m_gprs[rt] = m_cop1.get_reg(fs).as_u64;
 }
 
-void VR4300::dmtc0(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dmtc0(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dmtc0 ${}, ${}", reg_name(rt), m_cop0.get_reg_name(rd));
 
     m_cop0.set_reg(rd, m_gprs[rt]);
 }
 
-void VR4300::dmtc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::dmtc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("dmtc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     m_cop1.set_reg(fs, m_gprs[rt]);
 }
 
-void VR4300::dmult(const u32 instruction) {
+void VR4300::dmult(const DecodedInstruction& decoded) {
     // FIXME: edge cases
 
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("dmult ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DoublewordMultiplyStallCycles);
 
     const s128 result = static_cast<s128>(static_cast<s64>(m_gprs[rs])) * static_cast<s128>(static_cast<s64>(m_gprs[rt]));
     m_hi = static_cast<s64>(Common::bit_range<127, 64>(result));
     m_lo = static_cast<s64>(Common::bit_range<63, 0>(result));
 }
 
-void VR4300::dmultu(const u32 instruction) {
+void VR4300::dmultu(const DecodedInstruction& decoded) {
     // FIXME: edge cases
 
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("dmultu ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(DoublewordMultiplyStallCycles);
 
     const u128 result = static_cast<u128>(m_gprs[rs]) * static_cast<u128>(m_gprs[rt]);
     m_hi = static_cast<s64>(Common::bit_range<127, 64>(result));
     m_lo = static_cast<s64>(Common::bit_range<63, 0>(result));
 }
 
-void VR4300::dsll(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsll(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsll ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = m_gprs[rt] << sa;
 }
 
-void VR4300::dsllv(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dsllv(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dsllv ${}, ${}, ${}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = m_gprs[rt] << Common::lowest_bits(m_gprs[rs], 6);
 }
 
-void VR4300::dsll32(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsll32(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsll32 ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = m_gprs[rt] << (32 + sa);
 }
 
-void VR4300::dsra(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsra(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsra ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = static_cast<s64>(m_gprs[rt]) >> sa;
 }
 
-void VR4300::dsrav(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dsrav(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dsrav ${}, ${}, ${}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = static_cast<s64>(m_gprs[rt]) >> Common::lowest_bits(m_gprs[rs], 6);
 }
 
-void VR4300::dsra32(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsra32(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsra32 ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = static_cast<s64>(m_gprs[rt]) >> (32 + sa);
 }
 
-void VR4300::dsrl(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsrl(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsrl ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = m_gprs[rt] >> sa;
 }
 
-void VR4300::dsrlv(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dsrlv(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dsrlv ${}, ${}, ${}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = m_gprs[rt] >> Common::lowest_bits(m_gprs[rs], 6);
 }
 
-void VR4300::dsrl32(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::dsrl32(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("dsrl32 ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = m_gprs[rt] >> (32 + sa);
 }
 
-void VR4300::dsub(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dsub(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dsub ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     s64 result = 0;
@@ -1303,16 +1537,16 @@ void VR4300::dsub(const u32 instruction) {
     m_gprs[rd] = result;
 }
 
-void VR4300::dsubu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::dsubu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("dsubu ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = m_gprs[rs] - m_gprs[rt];
 }
 
-void VR4300::eret(const u32 instruction) {
+void VR4300::eret(const DecodedInstruction& decoded) {
     LTRACE_VR4300("eret");
 
     if (m_cop0.status.flags.erl) {
@@ -1325,8 +1559,8 @@ void VR4300::eret(const u32 instruction) {
     // FIXME: Clear the LL bit to zero.
 }
 
-void VR4300::j(const u32 instruction) {
-    const auto target = Common::bit_range<25, 0>(instruction);
+void VR4300::j(const DecodedInstruction& decoded) {
+    const auto target = Common::bit_range<25, 0>(decoded.instruction);
     const u32 destination = (m_pc & 0xF0000000) | (target << 2);
     LTRACE_VR4300("j 0x{:08X}", destination);
 
@@ -1339,8 +1573,8 @@ void VR4300::j(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::jal(const u32 instruction) {
-    const auto target = Common::bit_range<25, 0>(instruction);
+void VR4300::jal(const DecodedInstruction& decoded) {
+    const auto target = Common::bit_range<25, 0>(decoded.instruction);
     const u32 destination = (m_pc & 0xF0000000) | (target << 2);
     LTRACE_VR4300("jal 0x{:08X}", destination);
 
@@ -1351,9 +1585,9 @@ void VR4300::jal(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::jalr(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::jalr(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("jalr ${}, ${}", reg_name(rd), reg_name(rs));
 
     m_next_pc = m_gprs[rs];
@@ -1362,8 +1596,8 @@ void VR4300::jalr(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::jr(const u32 instruction) {
-    const auto rs = get_rs(instruction);
+void VR4300::jr(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
     LTRACE_VR4300("jr ${}", reg_name(rs));
 
     if ((m_gprs[rs] & 0b11) != 0) [[unlikely]] {
@@ -1377,45 +1611,55 @@ void VR4300::jr(const u32 instruction) {
     m_entering_delay_slot = true;
 }
 
-void VR4300::lb(const u32 instruction) {
+void VR4300::lb(const DecodedInstruction& decoded) {
     // TODO: exceptions
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lb ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
-    m_gprs[rt] = static_cast<s8>(m_system.mmu().read8(address));
+    const auto value = load<u8>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = static_cast<s8>(*value);
 }
 
-void VR4300::lbu(const u32 instruction) {
+void VR4300::lbu(const DecodedInstruction& decoded) {
     // TODO: exceptions
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lbu ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
-    m_gprs[rt] = m_system.mmu().read8(address);
+    const auto value = load<u8>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = *value;
 }
 
-void VR4300::ld(const u32 instruction) {
+void VR4300::ld(const DecodedInstruction& decoded) {
     // FIXME: exceptions
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("ld ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + s16(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1425,16 +1669,26 @@ void VR4300::ld(const u32 instruction) {
         return;
     }
 
-    m_gprs[rt] = m_system.mmu().read64(address);
+    const auto value = load<u64>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = *value;
 }
 
-void VR4300::ldc1(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto ft = m_cop1.get_ft(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::ldc1(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto ft = m_cop1.get_ft(decoded.instruction);
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("ldc1 ${}, 0x{:04X}(${})", m_cop1.reg_name(ft), offset, reg_name(base));
 
-    const u64 doubleword = m_system.mmu().read64(m_gprs[base] + offset);
+    const auto loaded = load<u64>(m_gprs[base] + offset);
+    if (!loaded) {
+        return;
+    }
+
+    const u64 doubleword = *loaded;
 
     if (m_cop0.status.flags.fr) {
         m_cop1.set_reg(ft, doubleword);
@@ -1453,45 +1707,55 @@ void VR4300::ldc1(const u32 instruction) {
     }
 }
 
-void VR4300::ldl(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::ldl(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("ldl ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + (offset & ~0x7);
     const u8 bits = (offset & 0x7) * 8;
 
-    u64 value = m_system.mmu().read64(address) << bits;
+    const auto doubleword = load<u64>(address);
+    if (!doubleword) {
+        return;
+    }
+
+    u64 value = *doubleword << bits;
     value |= Common::lowest_bits(m_gprs[rt], bits);
 
     m_gprs[rt] = value;
 }
 
-void VR4300::ldr(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::ldr(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("ldr ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + (offset & ~0x7);
     const u8 bits = (7 - (offset & 0x7)) * 8;
 
+    const auto doubleword = load<u64>(address);
+    if (!doubleword) {
+        return;
+    }
+
     u64 value = Common::highest_bits(m_gprs[rt], bits);
-    value |= m_system.mmu().read64(address) >> bits;
+    value |= *doubleword >> bits;
 
     m_gprs[rt] = value;
 }
 
-void VR4300::lh(const u32 instruction) {
+void VR4300::lh(const DecodedInstruction& decoded) {
     // TODO: exceptions
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lh ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1501,18 +1765,23 @@ void VR4300::lh(const u32 instruction) {
         return;
     }
 
-    m_gprs[rt] = static_cast<s16>(m_system.mmu().read16(address));
+    const auto value = load<u16>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = static_cast<s16>(*value);
 }
 
-void VR4300::lhu(const u32 instruction) {
+void VR4300::lhu(const DecodedInstruction& decoded) {
     // TODO: exceptions
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lhu ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1522,36 +1791,46 @@ void VR4300::lhu(const u32 instruction) {
         return;
     }
 
-    m_gprs[rt] = m_system.mmu().read16(address);
+    const auto value = load<u16>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = *value;
 }
 
-void VR4300::ll(const u32 instruction) {
+void VR4300::ll(const DecodedInstruction& decoded) {
     // FIXME: This is just a copy-paste of LW. This instruction needs to be actually implemented.
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("ll ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u32 address = m_gprs[base] + s16(offset);
-    m_gprs[rt] = static_cast<s32>(m_system.mmu().read32(address));
+    const u32 address = m_gprs[base] + offset;
+    const auto value = load<u32>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = static_cast<s32>(*value);
 }
 
-void VR4300::lui(u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::lui(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const u16 imm = static_cast<u16>(decoded.immediate);
     LTRACE_VR4300("lui ${}, 0x{:04X}", reg_name(rt), imm);
 
     m_gprs[rt] = static_cast<s32>(imm << 16);
 }
 
-void VR4300::lw(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::lw(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lw ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + s16(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // Throw an exception if the address is not sign-extended.
     if ((Common::is_bit_enabled<31>(address) && Common::bit_range<63, 32>(address) != 0xFFFFFFFF) ||
@@ -1566,16 +1845,26 @@ void VR4300::lw(const u32 instruction) {
         return;
     }
 
-    m_gprs[rt] = static_cast<s32>(m_system.mmu().read32(address));
+    const auto value = load<u32>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = static_cast<s32>(*value);
 }
 
-void VR4300::lwc1(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto ft = m_cop1.get_ft(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::lwc1(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto ft = m_cop1.get_ft(decoded.instruction);
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lwc1 ${}, 0x{:04X}(${})", m_cop1.reg_name(ft), offset, reg_name(base));
 
-    const u32 word = m_system.mmu().read32(m_gprs[base] + offset);
+    const auto loaded = load<u32>(m_gprs[base] + offset);
+    if (!loaded) {
+        return;
+    }
+
+    const u32 word = *loaded;
 
     if (m_cop0.status.flags.fr) {
         m_cop1.set_reg(ft, word);
@@ -1592,10 +1881,10 @@ void VR4300::lwc1(const u32 instruction) {
     }
 }
 
-void VR4300::lwl(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::lwl(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lwl ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     // Read from the next word if the offset's low 3 bits are greater than 4
@@ -1605,17 +1894,22 @@ void VR4300::lwl(const u32 instruction) {
     }
     const u8 bits = (offset & 0x7) * 8;
 
-    s32 value = m_system.mmu().read32(address);
+    const auto word = load<u32>(address);
+    if (!word) {
+        return;
+    }
+
+    s32 value = *word;
     value <<= bits;
     value |= Common::lowest_bits(m_gprs[rt], bits);
 
     m_gprs[rt] = value;
 }
 
-void VR4300::lwr(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::lwr(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lwr ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     // Read from the next word if the offset's low 3 bits are greater than 4
@@ -1625,20 +1919,25 @@ void VR4300::lwr(const u32 instruction) {
     }
     const u8 bits = (7 - (offset & 0x7)) * 8;
 
-    u32 value = m_system.mmu().read32(address);
+    const auto word = load<u32>(address);
+    if (!word) {
+        return;
+    }
+
+    u32 value = *word;
     value >>= bits;
     value |= Common::highest_bits(m_gprs[rt], bits);
 
     m_gprs[rt] = static_cast<s32>(value);
 }
 
-void VR4300::lwu(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::lwu(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("lwu ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + s16(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1648,20 +1947,25 @@ void VR4300::lwu(const u32 instruction) {
         return;
     }
 
-    m_gprs[rt] = m_system.mmu().read32(address);
+    const auto value = load<u32>(address);
+    if (!value) {
+        return;
+    }
+
+    m_gprs[rt] = *value;
 }
 
-void VR4300::mfc0(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::mfc0(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mfc0 ${}, ${}", reg_name(rt), m_cop0.get_reg_name(rd));
 
     m_gprs[rt] = m_cop0.get_reg(rd);
 }
 
-void VR4300::mfc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::mfc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("mfc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     if (m_cop0.status.flags.fr) {
@@ -1675,31 +1979,31 @@ void VR4300::mfc1(const u32 instruction) {
     }
 }
 
-void VR4300::mfhi(const u32 instruction) {
-    const auto rd = get_rd(instruction);
+void VR4300::mfhi(const DecodedInstruction& decoded) {
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mfhi ${}", reg_name(rd));
 
     m_gprs[rd] = m_hi;
 }
 
-void VR4300::mflo(const u32 instruction) {
-    const auto rd = get_rd(instruction);
+void VR4300::mflo(const DecodedInstruction& decoded) {
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mflo ${}", reg_name(rd));
 
     m_gprs[rd] = m_lo;
 }
 
-void VR4300::mtc0(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::mtc0(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mtc0 ${}, ${}", reg_name(rt), m_cop0.get_reg_name(rd));
 
     m_cop0.set_reg(rd, m_gprs[rt]);
 }
 
-void VR4300::mtc1(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto fs = m_cop1.get_fs(instruction);
+void VR4300::mtc1(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto fs = m_cop1.get_fs(decoded.instruction);
     LTRACE_VR4300("mtc1 ${}, ${}", reg_name(rt), m_cop1.reg_name(fs));
 
     if (m_cop0.status.flags.fr) {
@@ -1719,38 +2023,40 @@ void VR4300::mtc1(const u32 instruction) {
     }
 }
 
-void VR4300::mthi(const u32 instruction) {
-    const auto rd = get_rd(instruction);
+void VR4300::mthi(const DecodedInstruction& decoded) {
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mthi ${}", reg_name(rd));
 
     m_hi = m_gprs[rd];
 }
 
-void VR4300::mtlo(const u32 instruction) {
-    const auto rd = get_rd(instruction);
+void VR4300::mtlo(const DecodedInstruction& decoded) {
+    const auto rd = decoded.rd;
     LTRACE_VR4300("mtlo ${}", reg_name(rd));
 
     m_lo = m_gprs[rd];
 }
 
-void VR4300::mult(const u32 instruction) {
+void VR4300::mult(const DecodedInstruction& decoded) {
     // FIXME: edge cases
 
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("mult ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(MultiplyStallCycles);
 
     const s64 result = m_gprs[rs] * m_gprs[rt];
     m_hi = static_cast<s32>(Common::bit_range<63, 32>(result));
     m_lo = static_cast<s32>(Common::bit_range<31, 0>(result));
 }
 
-void VR4300::multu(const u32 instruction) {
+void VR4300::multu(const DecodedInstruction& decoded) {
     // FIXME: edge cases
 
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
     LTRACE_VR4300("multu ${}, ${}", reg_name(rs), reg_name(rt));
+    stall(MultiplyStallCycles);
 
     const u64 result = m_gprs[rs] * m_gprs[rt];
     m_hi = static_cast<s32>(Common::bit_range<63, 32>(result));
@@ -1761,65 +2067,65 @@ void VR4300::nop(const u32 instruction) {
     LTRACE_VR4300("nop");
 }
 
-void VR4300::nor(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::nor(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("nor ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = ~(m_gprs[rs] | m_gprs[rt]);
 }
 
-void VR4300::or_(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::or_(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("or ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = m_gprs[rs] | m_gprs[rt];
 }
 
-void VR4300::ori(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::ori(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const u16 imm = static_cast<u16>(decoded.immediate);
     LTRACE_VR4300("ori ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
     m_gprs[rt] = m_gprs[rs] | imm;
 }
 
-void VR4300::sb(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sb(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sb ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
-    m_system.mmu().write8(address, m_gprs[rt]);
+    store<u8>(address, m_gprs[rt]);
 }
 
-void VR4300::sc(const u32 instruction) {
+void VR4300::sc(const DecodedInstruction& decoded) {
     // FIXME: This is just a copy-paste of SW. This instruction needs to be actually implemented.
 
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sc ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u32 address = m_gprs[base] + static_cast<s16>(offset);
-    m_system.mmu().write32(address, m_gprs[rt]);
+    const u32 address = m_gprs[base] + offset;
+    store<u32>(address, m_gprs[rt]);
 }
 
-void VR4300::sd(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sd(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sd ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1829,65 +2135,75 @@ void VR4300::sd(const u32 instruction) {
         return;
     }
 
-    m_system.mmu().write64(address, m_gprs[rt]);
+    store<u64>(address, m_gprs[rt]);
 }
 
-void VR4300::sdc1(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto ft = m_cop1.get_ft(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sdc1(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto ft = m_cop1.get_ft(decoded.instruction);
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sdc1 ${}, 0x{:04X}(${})", m_cop1.reg_name(ft), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + offset;
 
     if (m_cop0.status.flags.fr) {
-        m_system.mmu().write64(address, m_cop1.get_reg(ft).as_u64);
+        store<u64>(address, m_cop1.get_reg(ft).as_u64);
     } else {
         ASSERT(ft % 2 == 0);
 
         u64 doubleword = m_cop1.get_reg(ft + 1).as_u32;
         doubleword |= static_cast<u64>(m_cop1.get_reg(ft).as_u32) << 32;
-        m_system.mmu().write64(address, doubleword);
+        store<u64>(address, doubleword);
     }
 }
 
-void VR4300::sdl(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sdl(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sdl ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + (offset & ~0x7);
     const u8 bits = (offset & 0x7) * 8;
 
-    u64 value = Common::highest_bits(m_system.mmu().read64(address), bits);
+    const auto doubleword = load<u64>(address);
+    if (!doubleword) {
+        return;
+    }
+
+    u64 value = Common::highest_bits(*doubleword, bits);
     value |= (m_gprs[rt] >> bits);
 
-    m_system.mmu().write64(address, value);
+    store<u64>(address, value);
 }
 
-void VR4300::sdr(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sdr(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sdr ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + (offset & ~0x7);
     const u8 bits = (7 - (offset & 0x7)) * 8;
 
-    u64 value = Common::lowest_bits(m_system.mmu().read64(address), bits);
+    const auto doubleword = load<u64>(address);
+    if (!doubleword) {
+        return;
+    }
+
+    u64 value = Common::lowest_bits(*doubleword, bits);
     value |= (m_gprs[rt] << bits);
 
-    m_system.mmu().write64(address, value);
+    store<u64>(address, value);
 }
 
-void VR4300::sh(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sh(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sh ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + static_cast<s16>(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // FIXME: Do we throw an exception is the address is not sign-extended?
 
@@ -1897,108 +2213,108 @@ void VR4300::sh(const u32 instruction) {
         return;
     }
 
-    m_system.mmu().write16(address, m_gprs[rt]);
+    store<u16>(address, m_gprs[rt]);
 }
 
-void VR4300::sll(const u32 instruction) {
-    if (instruction == 0) {
-        nop(instruction);
+void VR4300::sll(const DecodedInstruction& decoded) {
+    if (decoded.instruction == 0) {
+        nop(decoded.instruction);
         return;
     }
 
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("sll ${}, ${}, {}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rt] << sa);
 }
 
-void VR4300::sllv(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::sllv(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("sllv ${}, ${}, {}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rt] << Common::lowest_bits(m_gprs[rs], 5));
 }
 
-void VR4300::slt(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::slt(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("slt ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = (s64(m_gprs[rs]) < s64(m_gprs[rt]));
 }
 
-void VR4300::slti(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::slti(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("slti ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
     m_gprs[rt] = (static_cast<s64>(m_gprs[rs]) < imm);
 }
 
-void VR4300::sltiu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::sltiu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 imm = decoded.immediate;
     LTRACE_VR4300("sltiu ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
-    m_gprs[rt] = (m_gprs[rs] < static_cast<u64>(static_cast<s64>(imm)));
+    m_gprs[rt] = (m_gprs[rs] < static_cast<u64>(imm));
 }
 
-void VR4300::sltu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::sltu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("sltu ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = (m_gprs[rs] < m_gprs[rt]);
 }
 
-void VR4300::sra(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::sra(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("sra ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rt] >> sa);
 }
 
-void VR4300::srav(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::srav(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("srav ${}, ${}, {}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rt] >> Common::lowest_bits(m_gprs[rs], 5));
 }
 
-void VR4300::srl(const u32 instruction) {
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
-    const auto sa = Common::bit_range<10, 6>(instruction);
+void VR4300::srl(const DecodedInstruction& decoded) {
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
+    const auto sa = decoded.sa;
     LTRACE_VR4300("srl ${}, ${}, ${}", reg_name(rd), reg_name(rt), sa);
 
     m_gprs[rd] = static_cast<s32>(static_cast<u32>(m_gprs[rt]) >> sa);
 }
 
-void VR4300::srlv(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::srlv(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("srlv ${}, ${}, {}", reg_name(rd), reg_name(rt), reg_name(rs));
 
     m_gprs[rd] = static_cast<s32>(static_cast<u32>(m_gprs[rt]) >> Common::lowest_bits(m_gprs[rs], 5));
 }
 
-void VR4300::sub(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::sub(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("sub ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     s32 result = 0;
@@ -2010,22 +2326,22 @@ void VR4300::sub(const u32 instruction) {
     m_gprs[rd] = result;
 }
 
-void VR4300::subu(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::subu(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("subu ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = static_cast<s32>(m_gprs[rs] - m_gprs[rt]);
 }
 
-void VR4300::sw(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::sw(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("sw ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
-    const u64 address = m_gprs[base] + s16(offset);
+    const u64 address = m_gprs[base] + offset;
 
     // Throw an exception if the address is not sign-extended.
     if ((Common::is_bit_enabled<31>(address) && Common::bit_range<63, 32>(address) != 0xFFFFFFFF) ||
@@ -2040,32 +2356,32 @@ void VR4300::sw(const u32 instruction) {
         return;
     }
 
-    m_system.mmu().write32(address, m_gprs[rt]);
+    store<u32>(address, m_gprs[rt]);
 }
 
-void VR4300::swc1(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto ft = m_cop1.get_ft(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::swc1(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto ft = m_cop1.get_ft(decoded.instruction);
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("swc1 ${}, 0x{:04X}(${})", m_cop1.reg_name(ft), offset, reg_name(base));
 
     const u64 address = m_gprs[base] + offset;
 
     if (m_cop0.status.flags.fr) {
-        m_system.mmu().write32(address, m_cop1.get_reg(ft).as_u32);
+        store<u32>(address, m_cop1.get_reg(ft).as_u32);
     } else {
         if (ft % 2 == 0) {
-            m_system.mmu().write32(address, m_cop1.get_reg(ft).as_u32);
+            store<u32>(address, m_cop1.get_reg(ft).as_u32);
         } else {
-            m_system.mmu().write32(address, m_cop1.get_reg(ft - 1).as_u32);
+            store<u32>(address, m_cop1.get_reg(ft - 1).as_u32);
         }
     }
 }
 
-void VR4300::swl(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::swl(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("swl ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     // Read from the next word if the offset's low 3 bits are greater than 4
@@ -2075,17 +2391,22 @@ void VR4300::swl(const u32 instruction) {
     }
     const u8 bits = (offset & 0x3) * 8;
 
+    const auto word = load<u32>(address);
+    if (!word) {
+        return;
+    }
+
     u32 value = m_gprs[rt];
     value >>= bits;
-    value |= Common::highest_bits(m_system.mmu().read32(address), bits);
+    value |= Common::highest_bits(*word, bits);
 
-    m_system.mmu().write32(address, value);
+    store<u32>(address, value);
 }
 
-void VR4300::swr(const u32 instruction) {
-    const auto base = Common::bit_range<25, 21>(instruction);
-    const auto rt = get_rt(instruction);
-    const s16 offset = Common::bit_range<15, 0>(instruction);
+void VR4300::swr(const DecodedInstruction& decoded) {
+    const auto base = decoded.rs;
+    const auto rt = decoded.rt;
+    const s64 offset = decoded.immediate;
     LTRACE_VR4300("swr ${}, 0x{:04X}(${})", reg_name(rt), offset, reg_name(base));
 
     // Read from the next word if the offset's low 3 bits are greater than 4
@@ -2095,29 +2416,34 @@ void VR4300::swr(const u32 instruction) {
     }
     const u8 bits = (3 - (offset & 0x3)) * 8;
 
+    const auto word = load<u32>(address);
+    if (!word) {
+        return;
+    }
+
     u32 value = m_gprs[rt];
     value <<= bits;
-    value |= Common::lowest_bits(m_system.mmu().read32(address), bits);
+    value |= Common::lowest_bits(*word, bits);
 
-    m_system.mmu().write32(address, value);
+    store<u32>(address, value);
 }
 
-void VR4300::sync(const u32 instruction) {
+void VR4300::sync(const DecodedInstruction& decoded) {
     // No-op on the VR4300. Defined to maintain compatibility with the VR4400.
     LTRACE_VR4300("sync");
 }
 
-void VR4300::syscall(const u32 instruction) {
-    [[maybe_unused]] const auto code = Common::bit_range<25, 6>(instruction);
+void VR4300::syscall(const DecodedInstruction& decoded) {
+    [[maybe_unused]] const auto code = Common::bit_range<25, 6>(decoded.instruction);
     LTRACE_VR4300("syscall (0x{:X})", code);
 
     throw_exception(ExceptionCodes::Syscall);
 }
 
-void VR4300::teq(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto code = Common::bit_range<15, 6>(instruction);
+void VR4300::teq(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto code = Common::bit_range<15, 6>(decoded.instruction);
     LTRACE_VR4300("teq ${}, ${} ({})", reg_name(rs), reg_name(rt), code);
 
     if (m_gprs[rs] == m_gprs[rt]) {
@@ -2125,10 +2451,10 @@ void VR4300::teq(const u32 instruction) {
     }
 }
 
-void VR4300::tne(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto code = Common::bit_range<15, 6>(instruction);
+void VR4300::tne(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto code = Common::bit_range<15, 6>(decoded.instruction);
     LTRACE_VR4300("tne ${}, ${} ({})", reg_name(rs), reg_name(rt), code);
 
     if (m_gprs[rs] != m_gprs[rt]) {
@@ -2136,31 +2462,58 @@ void VR4300::tne(const u32 instruction) {
     }
 }
 
-void VR4300::tlbwi(const u32 instruction) {
+void VR4300::tlbp([[maybe_unused]] const DecodedInstruction& decoded) {
+    LTRACE_VR4300("tlbp");
+
+    if (const auto index = m_tlb.probe(m_cop0.entry_hi)) {
+        m_cop0.index = *index;
+    } else {
+        // Sets the probe failure bit, leaving the index undefined.
+        m_cop0.index = 1u << 31;
+    }
+}
+
+void VR4300::tlbr([[maybe_unused]] const DecodedInstruction& decoded) {
+    LTRACE_VR4300("tlbr");
+
+    const TLB::Entry& entry = m_tlb.entry(Common::bit_range<4, 0>(m_cop0.index));
+    m_cop0.page_mask = entry.page_mask;
+    m_cop0.entry_hi = entry.entry_hi;
+    m_cop0.entry_lo0 = entry.entry_lo0 | entry.global;
+    m_cop0.entry_lo1 = entry.entry_lo1 | entry.global;
+}
+
+void VR4300::tlbwi(const DecodedInstruction& decoded) {
     LTRACE_VR4300("tlbwi");
 
-    LWARN("TLBWI is stubbed");
+    m_tlb.write_entry(Common::bit_range<4, 0>(m_cop0.index), m_cop0.page_mask, m_cop0.entry_hi, m_cop0.entry_lo0, m_cop0.entry_lo1);
+}
+
+void VR4300::tlbwr([[maybe_unused]] const DecodedInstruction& decoded) {
+    LTRACE_VR4300("tlbwr");
+
+    m_tlb.write_entry(Common::bit_range<4, 0>(m_cop0.random()), m_cop0.page_mask, m_cop0.entry_hi, m_cop0.entry_lo0, m_cop0.entry_lo1);
 }
 
-void VR4300::xor_(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const auto rd = get_rd(instruction);
+void VR4300::xor_(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const auto rd = decoded.rd;
     LTRACE_VR4300("xor ${}, ${}, ${}", reg_name(rd), reg_name(rs), reg_name(rt));
 
     m_gprs[rd] = m_gprs[rs] ^ m_gprs[rt];
 }
 
-void VR4300::xori(const u32 instruction) {
-    const auto rs = get_rs(instruction);
-    const auto rt = get_rt(instruction);
-    const u16 imm = Common::bit_range<15, 0>(instruction);
+void VR4300::xori(const DecodedInstruction& decoded) {
+    const auto rs = decoded.rs;
+    const auto rt = decoded.rt;
+    const u16 imm = static_cast<u16>(decoded.immediate);
     LTRACE_VR4300("xori ${}, ${}, 0x{:04X}", reg_name(rt), reg_name(rs), imm);
 
     m_gprs[rt] = m_gprs[rs] ^ imm;
 }
 
-void VR4300::reserved([[maybe_unused]] const u32 instruction) {
+void VR4300::reserved([[maybe_unused]] const DecodedInstruction& decoded) {
     LTRACE_VR4300("[reserved]");
 
     throw_exception(ExceptionCodes::ReservedInstruction);
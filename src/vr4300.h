@@ -1,20 +1,43 @@
 #pragma once
 
 #include <array>
+#include <memory>
+#include <optional>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "common/bits.h"
 #include "common/defines.h"
 #include "common/types.h"
 #include "cop0.h"
 #include "cop1.h"
+#include "tlb.h"
+#include "vr4300_cache.h"
 
 using namespace std::string_view_literals;
 
 class N64;
 
+namespace JIT {
+class VR4300Recompiler;
+}
+
+enum class CPUBackend {
+    Interpreter,
+    JIT,
+};
+
+// Whether memory timing goes through a model of the instruction and data caches, rather than assuming every cached
+// access hits. Only the interpreter supports it.
+enum class CacheEmulation {
+    Disabled,
+    Enabled,
+};
+
 class VR4300 {
 public:
-    explicit VR4300(N64& system);
+    VR4300(N64& system, CPUBackend backend, CacheEmulation cache_emulation);
+    ~VR4300();
 
     enum class ExceptionCodes {
         Interrupt = 0,
@@ -38,8 +61,12 @@ public:
     void throw_exception(ExceptionCodes code);
     template <ExceptionCodes code>
     void throw_address_error_exception(u64 bad_address);
+    // Refills of a missing entry have a vector of their own, unlike invalid or clean pages.
+    void throw_tlb_exception(ExceptionCodes code, u64 bad_address, bool refill);
 
-    void step();
+    // Executes instructions until the budget is spent or the next scheduled event is due.
+    // Returns the number of PCycles actually executed, which may overshoot the budget by one instruction.
+    u64 run(u64 budget);
 
     COP0& cop0() { return m_cop0; }
     const COP0& cop0() const { return m_cop0; }
@@ -49,12 +76,38 @@ public:
 
     u64 pc() const { return m_pc; }
 
+    // Must be called on every write to RDRAM, so that cached blocks holding the written code get dropped.
+    ALWAYS_INLINE void invalidate_code(const u32 physical_address) {
+        const u32 page = physical_address >> CodePageShift;
+        if (m_code_pages[page]) [[unlikely]] {
+            mark_code_page_dirty(page);
+        }
+    }
+
+    // The same, for a bulk write to [begin, end).
+    void invalidate_code(const u32 begin, const u32 end) {
+        for (u32 page = begin >> CodePageShift; page <= (end - 1) >> CodePageShift; page++) {
+            if (m_code_pages[page]) [[unlikely]] {
+                mark_code_page_dirty(page);
+            }
+        }
+    }
+
+    // Whether every RDRAM access honors the pages the RDP protects (see MMU::set_rdram_rdp_protected()).
+    bool sees_rdram_rdp_protection() const;
+
 private:
     friend class COP1;
+    friend class JIT::VR4300Recompiler;
 
     N64& m_system;
     COP0 m_cop0;
     COP1 m_cop1;
+    TLB m_tlb;
+
+    const CacheEmulation m_cache_emulation;
+    InstructionCache m_icache {};
+    DataCache m_dcache {};
 
     bool m_enable_trace_logging { false };
 
@@ -81,14 +134,51 @@ private:
         return m_reg_names.at(reg_id);
     }
 
+    // Every instruction spends one PCycle in the pipeline. These are the additional stalls, also in PCycles.
+    static constexpr u32 MultiplyStallCycles = 4;
+    static constexpr u32 DoublewordMultiplyStallCycles = 7;
+    static constexpr u32 DivideStallCycles = 36;
+    static constexpr u32 DoublewordDivideStallCycles = 68;
+
+    // Approximate cost of going out to the SysAD bus for an uncached (KSEG1) access.
+    // Cached accesses are assumed to always hit.
+    static constexpr u32 UncachedInstructionFetchStallCycles = 32;
+    static constexpr u32 UncachedDataAccessStallCycles = 32;
+
+    // Approximate costs of cache line transfers, only used with cache emulation.
+    static constexpr u32 InstructionCacheFillStallCycles = 48;
+    static constexpr u32 DataCacheFillStallCycles = 40;
+    static constexpr u32 DataCacheWritebackStallCycles = 40;
+
     u64 m_pc { 0 };
     u64 m_next_pc { 0 };
+    u32 m_stall_cycles { 0 };
     bool m_about_to_branch { false };
     bool m_entering_delay_slot { false };
     bool m_in_delay_slot { false };
 
     void simulate_pif_routine();
 
+    ALWAYS_INLINE void stall(const u32 cycles) { m_stall_cycles += cycles; }
+
+    void set_bad_address(u64 bad_address);
+
+    // Returns the address to access through the MMU, which is physical for TLB-mapped segments.
+    // Returns nothing if a TLB exception was thrown instead.
+    std::optional<u32> translate_address(u64 address, bool write);
+    std::optional<u32> translate_mapped_address(u64 address, bool write);
+    // Only for addresses that are known to translate, such as the PC of an instruction that was fetched.
+    u32 physical_address_of(u64 address);
+
+    void access_instruction_cache(u64 pc);
+    void access_data_cache(u64 address, u32 physical_address, bool write);
+
+    // Loads return nothing if the access threw an exception, in which case the destination must be left alone.
+    template <typename T>
+    std::optional<T> load(u64 address);
+    template <typename T>
+    void store(u64 address, T value);
+
     ALWAYS_INLINE static u8 get_rs(const u32 instruction) {
         return Common::bit_range<25, 21>(instruction);
     }
@@ -101,124 +191,207 @@ private:
         return Common::bit_range<15, 11>(instruction);
     }
 
-    void decode_and_execute_instruction(u32 instruction);
-    void decode_and_execute_special_instruction(u32 instruction);
-    void decode_and_execute_regimm_instruction(u32 instruction);
-    void decode_and_execute_cop0_instruction(u32 instruction);
-    void decode_and_execute_cop1_instruction(u32 instruction);
-    void cop2(u32 instruction);
-
-    void add(u32 instruction);
-    void addi(u32 instruction);
-    void addiu(u32 instruction);
-    void addu(u32 instruction);
-    void and_(u32 instruction);
-    void andi(u32 instruction);
-    void beq(u32 instruction);
-    void beql(u32 instruction);
-    void bgez(u32 instruction);
-    void bgezal(u32 instruction);
-    void bgezl(u32 instruction);
-    void bgtz(u32 instruction);
-    void bgtzl(u32 instruction);
-    void blez(u32 instruction);
-    void bltz(u32 instruction);
-    void bltzl(u32 instruction);
-    void bne(u32 instruction);
-    void bnel(u32 instruction);
-    void break_(u32 instruction);
-    void cache(u32 instruction);
-    void cfc1(u32 instruction);
-    void ctc1(u32 instruction);
-    void dadd(u32 instruction);
-    void daddi(u32 instruction);
-    void daddiu(u32 instruction);
-    void daddu(u32 instruction);
-    void ddiv(u32 instruction);
-    void ddivu(u32 instruction);
-    void div(u32 instruction);
-    void divu(u32 instruction);
-    void dmfc0(u32 instruction);
-    void dmfc1(u32 instruction);
-    void dmtc0(u32 instruction);
-    void dmtc1(u32 instruction);
-    void dmult(u32 instruction);
-    void dmultu(u32 instruction);
-    void dsll(u32 instruction);
-    void dsllv(u32 instruction);
-    void dsll32(u32 instruction);
-    void dsra(u32 instruction);
-    void dsrav(u32 instruction);
-    void dsra32(u32 instruction);
-    void dsrl(u32 instruction);
-    void dsrlv(u32 instruction);
-    void dsrl32(u32 instruction);
-    void dsub(u32 instruction);
-    void dsubu(u32 instruction);
-    void eret(u32 instruction);
-    void j(u32 instruction);
-    void jal(u32 instruction);
-    void jalr(u32 instruction);
-    void jr(u32 instruction);
-    void lb(u32 instruction);
-    void lbu(u32 instruction);
-    void ld(u32 instruction);
-    void ldc1(u32 instruction);
-    void ldl(u32 instruction);
-    void ldr(u32 instruction);
-    void lh(u32 instruction);
-    void lhu(u32 instruction);
-    void ll(u32 instruction);
-    void lui(u32 instruction);
-    void lw(u32 instruction);
-    void lwc1(u32 instruction);
-    void lwl(u32 instruction);
-    void lwr(u32 instruction);
-    void lwu(u32 instruction);
-    void mfc0(u32 instruction);
-    void mfc1(u32 instruction);
-    void mfhi(u32 instruction);
-    void mflo(u32 instruction);
-    void mtc0(u32 instruction);
-    void mtc1(u32 instruction);
-    void mthi(u32 instruction);
-    void mtlo(u32 instruction);
-    void mult(u32 instruction);
-    void multu(u32 instruction);
+    struct DecodedInstruction;
+    using InstructionHandler = void (VR4300::*)(const DecodedInstruction&);
+
+    // An instruction word resolved to the handler that executes it, so dispatch is a single indirect call. The
+    // operand fields are extracted once here, rather than by the handler every time a cached block runs it.
+    struct DecodedInstruction {
+        InstructionHandler handler;
+        u32 instruction;
+        u8 rs;
+        u8 rt;
+        u8 rd;
+        u8 sa;
+        // Sign-extended. Instructions that zero-extend it take the low 16 bits back.
+        s64 immediate;
+    };
+
+    // Flat dispatch tables, indexed by the opcode field(s) of each encoding group.
+    static const std::array<InstructionHandler, 64> m_primary_handlers;
+    static const std::array<InstructionHandler, 64> m_special_handlers;
+    static const std::array<InstructionHandler, 32> m_regimm_handlers;
+    static const std::array<InstructionHandler, 32> m_cop0_handlers;
+    static const std::array<InstructionHandler, 64> m_cop0_co_handlers;
+    static const std::array<InstructionHandler, 32> m_cop1_handlers;
+    static const std::array<InstructionHandler, 32> m_cop1_bc_handlers;
+    static const std::array<InstructionHandler, 64> m_cop1_fpu_handlers;
+
+    static DecodedInstruction decode(u32 instruction);
+    static InstructionHandler decode_handler(u32 instruction);
+
+    // Both return the number of PCycles spent executing the instruction.
+    // step() fetches and decodes the instruction at the PC, bypassing the block cache.
+    u32 step();
+    u32 execute(const DecodedInstruction& decoded);
+
+    // Code in RDRAM is tracked in 4KiB pages, so writes only need a single byte test.
+    static constexpr u32 CodePageShift = 12;
+    static constexpr u32 CodePageCount = 0x800000 >> CodePageShift;
+
+    // Recompiled code runs until the budget is spent or it has to hand control back, and returns the
+    // PCycles it spent that have not been added to the scheduler yet. The PC is always left up to date.
+    using JitFunction = u64 (*)(VR4300* cpu, u64 budget);
+
+    // A run of pre-decoded instructions, ending after the first branch and its delay slot.
+    struct Block {
+        std::vector<DecodedInstruction> instructions;
+        bool ends_in_delay_slot { false };
+        JitFunction jit_code { nullptr };
+    };
+
+    // Blocks are keyed by physical address, so KSEG0 and KSEG1 aliases share them.
+    std::unordered_map<u32, Block> m_blocks {};
+    // One byte per page, so that recompiled stores can test it directly.
+    std::array<bool, CodePageCount> m_code_pages {};
+    std::array<std::vector<u32>, CodePageCount> m_code_page_blocks {};
+    std::vector<u32> m_dirty_code_pages {};
+    bool m_code_modified { false };
+
+    const Block* lookup_block(u64 pc);
+    const Block& compile_block(u32 physical_address);
+    void drop_block(u32 physical_address);
+    void mark_code_page_dirty(u32 page);
+    void flush_dirty_code_pages();
+    void clear_block_cache();
+
+    // Only present when running on the JIT backend.
+    std::unique_ptr<JIT::VR4300Recompiler> m_recompiler;
+    u64 m_run_end_timestamp {};
+
+    // Runs one instruction on behalf of recompiled code, after adding the PCycles it has spent so far.
+    // Returns the PCycles left until the next deadline, or 0 if the recompiled code has to return.
+    u64 execute_for_recompiler(const DecodedInstruction& decoded, u64 pc, bool in_delay_slot, u64 pending_cycles);
+
+    template <void (COP1::*Handler)(u32)>
+    void cop1_op(const DecodedInstruction& decoded) {
+        (m_cop1.*Handler)(decoded.instruction);
+    }
+
+    void unrecognized_instruction(const DecodedInstruction& decoded);
+    void unrecognized_special_instruction(const DecodedInstruction& decoded);
+    void unrecognized_regimm_instruction(const DecodedInstruction& decoded);
+    void unrecognized_cop0_instruction(const DecodedInstruction& decoded);
+    void unrecognized_cop0_co_instruction(const DecodedInstruction& decoded);
+    void unrecognized_cop1_instruction(const DecodedInstruction& decoded);
+    void unrecognized_cop1_bc_instruction(const DecodedInstruction& decoded);
+    void unrecognized_cop1_fpu_instruction(const DecodedInstruction& decoded);
+    void cop2(const DecodedInstruction& decoded);
+
+    void add(const DecodedInstruction& decoded);
+    void addi(const DecodedInstruction& decoded);
+    void addiu(const DecodedInstruction& decoded);
+    void addu(const DecodedInstruction& decoded);
+    void and_(const DecodedInstruction& decoded);
+    void andi(const DecodedInstruction& decoded);
+    void beq(const DecodedInstruction& decoded);
+    void beql(const DecodedInstruction& decoded);
+    void bgez(const DecodedInstruction& decoded);
+    void bgezal(const DecodedInstruction& decoded);
+    void bgezl(const DecodedInstruction& decoded);
+    void bgtz(const DecodedInstruction& decoded);
+    void bgtzl(const DecodedInstruction& decoded);
+    void blez(const DecodedInstruction& decoded);
+    void bltz(const DecodedInstruction& decoded);
+    void bltzl(const DecodedInstruction& decoded);
+    void bne(const DecodedInstruction& decoded);
+    void bnel(const DecodedInstruction& decoded);
+    void break_(const DecodedInstruction& decoded);
+    void cache(const DecodedInstruction& decoded);
+    void cfc1(const DecodedInstruction& decoded);
+    void ctc1(const DecodedInstruction& decoded);
+    void dadd(const DecodedInstruction& decoded);
+    void daddi(const DecodedInstruction& decoded);
+    void daddiu(const DecodedInstruction& decoded);
+    void daddu(const DecodedInstruction& decoded);
+    void ddiv(const DecodedInstruction& decoded);
+    void ddivu(const DecodedInstruction& decoded);
+    void div(const DecodedInstruction& decoded);
+    void divu(const DecodedInstruction& decoded);
+    void dmfc0(const DecodedInstruction& decoded);
+    void dmfc1(const DecodedInstruction& decoded);
+    void dmtc0(const DecodedInstruction& decoded);
+    void dmtc1(const DecodedInstruction& decoded);
+    void dmult(const DecodedInstruction& decoded);
+    void dmultu(const DecodedInstruction& decoded);
+    void dsll(const DecodedInstruction& decoded);
+    void dsllv(const DecodedInstruction& decoded);
+    void dsll32(const DecodedInstruction& decoded);
+    void dsra(const DecodedInstruction& decoded);
+    void dsrav(const DecodedInstruction& decoded);
+    void dsra32(const DecodedInstruction& decoded);
+    void dsrl(const DecodedInstruction& decoded);
+    void dsrlv(const DecodedInstruction& decoded);
+    void dsrl32(const DecodedInstruction& decoded);
+    void dsub(const DecodedInstruction& decoded);
+    void dsubu(const DecodedInstruction& decoded);
+    void eret(const DecodedInstruction& decoded);
+    void j(const DecodedInstruction& decoded);
+    void jal(const DecodedInstruction& decoded);
+    void jalr(const DecodedInstruction& decoded);
+    void jr(const DecodedInstruction& decoded);
+    void lb(const DecodedInstruction& decoded);
+    void lbu(const DecodedInstruction& decoded);
+    void ld(const DecodedInstruction& decoded);
+    void ldc1(const DecodedInstruction& decoded);
+    void ldl(const DecodedInstruction& decoded);
+    void ldr(const DecodedInstruction& decoded);
+    void lh(const DecodedInstruction& decoded);
+    void lhu(const DecodedInstruction& decoded);
+    void ll(const DecodedInstruction& decoded);
+    void lui(const DecodedInstruction& decoded);
+    void lw(const DecodedInstruction& decoded);
+    void lwc1(const DecodedInstruction& decoded);
+    void lwl(const DecodedInstruction& decoded);
+    void lwr(const DecodedInstruction& decoded);
+    void lwu(const DecodedInstruction& decoded);
+    void mfc0(const DecodedInstruction& decoded);
+    void mfc1(const DecodedInstruction& decoded);
+    void mfhi(const DecodedInstruction& decoded);
+    void mflo(const DecodedInstruction& decoded);
+    void mtc0(const DecodedInstruction& decoded);
+    void mtc1(const DecodedInstruction& decoded);
+    void mthi(const DecodedInstruction& decoded);
+    void mtlo(const DecodedInstruction& decoded);
+    void mult(const DecodedInstruction& decoded);
+    void multu(const DecodedInstruction& decoded);
     void nop(u32 instruction);
-    void nor(u32 instruction);
-    void or_(u32 instruction);
-    void ori(u32 instruction);
-    void sb(u32 instruction);
-    void sc(u32 instruction);
-    void sd(u32 instruction);
-    void sdc1(u32 instruction);
-    void sdl(u32 instruction);
-    void sdr(u32 instruction);
-    void sh(u32 instruction);
-    void sll(u32 instruction);
-    void sllv(u32 instruction);
-    void slt(u32 instruction);
-    void slti(u32 instruction);
-    void sltiu(u32 instruction);
-    void sltu(u32 instruction);
-    void sra(u32 instruction);
-    void srav(u32 instruction);
-    void srl(u32 instruction);
-    void srlv(u32 instruction);
-    void sub(u32 instruction);
-    void subu(u32 instruction);
-    void sw(u32 instruction);
-    void swc1(u32 instruction);
-    void swl(u32 instruction);
-    void swr(u32 instruction);
-    void sync(u32 instruction);
-    void syscall(u32 instruction);
-    void teq(u32 instruction);
-    void tne(u32 instruction);
-    void tlbwi(u32 instruction);
-    void xor_(u32 instruction);
-    void xori(u32 instruction);
-
-    void reserved(u32 instruction);
+    void nor(const DecodedInstruction& decoded);
+    void or_(const DecodedInstruction& decoded);
+    void ori(const DecodedInstruction& decoded);
+    void sb(const DecodedInstruction& decoded);
+    void sc(const DecodedInstruction& decoded);
+    void sd(const DecodedInstruction& decoded);
+    void sdc1(const DecodedInstruction& decoded);
+    void sdl(const DecodedInstruction& decoded);
+    void sdr(const DecodedInstruction& decoded);
+    void sh(const DecodedInstruction& decoded);
+    void sll(const DecodedInstruction& decoded);
+    void sllv(const DecodedInstruction& decoded);
+    void slt(const DecodedInstruction& decoded);
+    void slti(const DecodedInstruction& decoded);
+    void sltiu(const DecodedInstruction& decoded);
+    void sltu(const DecodedInstruction& decoded);
+    void sra(const DecodedInstruction& decoded);
+    void srav(const DecodedInstruction& decoded);
+    void srl(const DecodedInstruction& decoded);
+    void srlv(const DecodedInstruction& decoded);
+    void sub(const DecodedInstruction& decoded);
+    void subu(const DecodedInstruction& decoded);
+    void sw(const DecodedInstruction& decoded);
+    void swc1(const DecodedInstruction& decoded);
+    void swl(const DecodedInstruction& decoded);
+    void swr(const DecodedInstruction& decoded);
+    void sync(const DecodedInstruction& decoded);
+    void syscall(const DecodedInstruction& decoded);
+    void teq(const DecodedInstruction& decoded);
+    void tne(const DecodedInstruction& decoded);
+    void tlbp(const DecodedInstruction& decoded);
+    void tlbr(const DecodedInstruction& decoded);
+    void tlbwi(const DecodedInstruction& decoded);
+    void tlbwr(const DecodedInstruction& decoded);
+    void xor_(const DecodedInstruction& decoded);
+    void xori(const DecodedInstruction& decoded);
+
+    void reserved(const DecodedInstruction& decoded);
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include "common/defines.h"
+#include "common/types.h"
+
+// One of the VR4300's direct-mapped primary caches, which are indexed by virtual and tagged by physical address.
+//
+// Only the tags and line states are modelled, for timing. The data itself never leaves memory, so the emulated
+// system stays coherent with DMA even when software forgets to write lines back.
+template <u32 CacheSize, u32 LineSize>
+class VR4300Cache {
+public:
+    struct Line {
+        // Physical address bits 31:12.
+        u32 tag {};
+        bool valid {};
+        bool dirty {};
+    };
+
+    struct AccessResult {
+        bool miss;
+        // Whether a dirty line had to be written back to make room.
+        bool writeback;
+    };
+
+    ALWAYS_INLINE AccessResult access(const u32 virtual_address, const u32 physical_address, const bool write) {
+        Line& line = line_at(virtual_address);
+        AccessResult result { false, false };
+        if (!hits(line, physical_address)) {
+            result = { true, line.valid && line.dirty };
+            line = { physical_address >> TagShift, true, false };
+        }
+
+        if (write) {
+            line.dirty = true;
+        }
+
+        return result;
+    }
+
+    ALWAYS_INLINE Line& line_at(const u32 virtual_address) {
+        return m_lines[(virtual_address / LineSize) % LineCount];
+    }
+
+    static ALWAYS_INLINE bool hits(const Line& line, const u32 physical_address) {
+        return line.valid && line.tag == (physical_address >> TagShift);
+    }
+
+private:
+    static constexpr u32 LineCount = CacheSize / LineSize;
+    static constexpr u32 TagShift = 12;
+
+    std::array<Line, LineCount> m_lines {};
+};
+
+using InstructionCache = VR4300Cache<16 * 1024, 32>;
+using DataCache = VR4300Cache<8 * 1024, 16>;
@@ -0,0 +1,193 @@
+#include <fmt/core.h>
+#include <random>
+#include "rdp_kernels.h"
+
+// Feeds the same random inputs through the scalar RDP kernels and every SIMD set the host supports, and checks that
+// they agree bit for bit.
+
+using ColorBatch = RDPKernels::ColorBatch;
+using CoordinateBatch = RDPKernels::CoordinateBatch;
+using Lanes = RDPKernels::Lanes;
+
+static constexpr u32 Iterations = 20000;
+
+static std::mt19937 s_random(0x64646464);
+
+static s32 random_int(const s32 min, const s32 max) {
+    return std::uniform_int_distribution<s32>(min, max)(s_random);
+}
+
+static void randomize(Lanes& lanes, const s32 min, const s32 max) {
+    for (s32& lane : lanes) {
+        lane = random_int(min, max);
+    }
+}
+
+static void randomize(ColorBatch& batch, const s32 min, const s32 max) {
+    randomize(batch.r, min, max);
+    randomize(batch.g, min, max);
+    randomize(batch.b, min, max);
+    randomize(batch.a, min, max);
+}
+
+static RDPKernels::Operand operand(const ColorBatch& batch) {
+    return { batch.r.data(), batch.g.data(), batch.b.data(), batch.a.data() };
+}
+
+// Only the lanes within the pixel count are defined.
+static bool same_lanes(const Lanes& expected, const Lanes& actual, const u32 count) {
+    for (u32 lane = 0; lane < count; lane++) {
+        if (expected[lane] != actual[lane]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_colors(const ColorBatch& expected, const ColorBatch& actual, const u32 count, const bool alpha = true) {
+    return same_lanes(expected.r, actual.r, count) && same_lanes(expected.g, actual.g, count) &&
+           same_lanes(expected.b, actual.b, count) && (!alpha || same_lanes(expected.a, actual.a, count));
+}
+
+static RDPRasterizer::Tile random_tile() {
+    RDPRasterizer::Tile tile {};
+    tile.format = static_cast<RDPRasterizer::ImageFormat>(random_int(0, 4));
+    tile.size = static_cast<RDPRasterizer::ImageSize>(random_int(0, 3));
+    tile.line = random_int(0, 0x1FF);
+    tile.tmem_address = random_int(0, 0x1FF);
+    tile.palette = random_int(0, 15);
+    tile.clamp_s = random_int(0, 1);
+    tile.mirror_s = random_int(0, 1);
+    tile.clamp_t = random_int(0, 1);
+    tile.mirror_t = random_int(0, 1);
+    tile.mask_s = random_int(0, 10);
+    tile.mask_t = random_int(0, 10);
+    tile.sl = random_int(0, 0xFFF);
+    tile.tl = random_int(0, 0xFFF);
+    tile.sh = random_int(0, 0xFFF);
+    tile.th = random_int(0, 0xFFF);
+    return tile;
+}
+
+static bool test_fetch_texels(const RDPKernels& kernels) {
+    std::array<u8, 0x1000> tmem;
+    for (u8& byte : tmem) {
+        byte = random_int(0, 0xFF);
+    }
+
+    for (u32 i = 0; i < Iterations; i++) {
+        RDPRasterizer::State state {};
+        state.tmem = &tmem;
+        // TLUT enable and TLUT type.
+        state.other_modes_high = random_int(0, 3) << 14;
+        const RDPRasterizer::Tile tile = random_tile();
+
+        CoordinateBatch coordinates;
+        randomize(coordinates.s, -0x800, 0x7FF);
+        randomize(coordinates.t, -0x800, 0x7FF);
+        const u32 count = random_int(1, RDPKernels::BatchSize);
+
+        ColorBatch expected {};
+        ColorBatch actual {};
+        RDPKernels::scalar().fetch_texels(state, tile, coordinates, expected, count);
+        kernels.fetch_texels(state, tile, coordinates, actual, count);
+        if (!same_colors(expected, actual, count)) {
+            fmt::print("fetch_texels differs (format {}, size {}, TLUT mode {})\n", static_cast<int>(tile.format),
+                       static_cast<int>(tile.size), state.other_modes_high >> 14);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_filter_texels(const RDPKernels& kernels) {
+    for (u32 i = 0; i < Iterations; i++) {
+        ColorBatch t00, t10, t01, t11;
+        randomize(t00, 0, 0xFF);
+        randomize(t10, 0, 0xFF);
+        randomize(t01, 0, 0xFF);
+        randomize(t11, 0, 0xFF);
+        CoordinateBatch fractions;
+        randomize(fractions.s, 0, 0x1F);
+        randomize(fractions.t, 0, 0x1F);
+        const u32 count = random_int(1, RDPKernels::BatchSize);
+
+        ColorBatch expected {};
+        ColorBatch actual {};
+        RDPKernels::scalar().filter_texels(t00, t10, t01, t11, fractions, expected, count);
+        kernels.filter_texels(t00, t10, t01, t11, fractions, actual, count);
+        if (!same_colors(expected, actual, count)) {
+            fmt::print("filter_texels differs\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_combine(const RDPKernels& kernels) {
+    for (u32 i = 0; i < Iterations; i++) {
+        // Combiner inputs are 9-bit signed, and the multiplier goes up to 256.
+        ColorBatch sub_a, sub_b, multiply, add;
+        randomize(sub_a, -0x100, 0xFF);
+        randomize(sub_b, -0x100, 0xFF);
+        randomize(multiply, -0x100, 0x100);
+        randomize(add, -0x100, 0xFF);
+        const RDPKernels::CombineOperands operands { operand(sub_a), operand(sub_b), operand(multiply), operand(add) };
+        const u32 count = random_int(1, RDPKernels::BatchSize);
+
+        ColorBatch expected {};
+        ColorBatch actual {};
+        RDPKernels::scalar().combine(operands, expected, count);
+        kernels.combine(operands, actual, count);
+        if (!same_colors(expected, actual, count)) {
+            fmt::print("combine differs\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_blend(const RDPKernels& kernels) {
+    for (u32 i = 0; i < Iterations; i++) {
+        ColorBatch p, m;
+        randomize(p, 0, 0xFF);
+        randomize(m, 0, 0xFF);
+        Lanes a, b;
+        randomize(a, 0, 0xFF);
+        randomize(b, 0, 0xFF);
+        const RDPKernels::BlendOperands operands { operand(p), operand(m), a.data(), b.data() };
+        const u32 count = random_int(1, RDPKernels::BatchSize);
+
+        // Alpha is left as it was.
+        ColorBatch expected {};
+        ColorBatch actual {};
+        RDPKernels::scalar().blend(operands, expected, count);
+        kernels.blend(operands, actual, count);
+        if (!same_colors(expected, actual, count, false)) {
+            fmt::print("blend differs\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    const std::array<std::pair<const char*, const RDPKernels*>, 2> sets = { {
+        { "SSE4.1", RDPKernels::sse41() },
+        { "AVX2", RDPKernels::avx2() },
+    } };
+
+    bool passed = true;
+    for (const auto& [name, kernels] : sets) {
+        if (!kernels) {
+            fmt::print("{}: not supported by the host, skipped\n", name);
+            continue;
+        }
+
+        const bool set_passed = test_fetch_texels(*kernels) && test_filter_texels(*kernels) && test_combine(*kernels) && test_blend(*kernels);
+        fmt::print("{}: {}\n", name, set_passed ? "matches the scalar kernels" : "FAILED");
+        passed = passed && set_passed;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <random>
+#include "n64.h"
+
+// Runs the same random vector instructions, on the same random registers, accumulators and flags, through the scalar
+// reference and the SSE4.1 kernels of the RSP vector unit, and checks that they end up in the same state.
+
+static constexpr u32 Iterations = 50000;
+static constexpr u32 InstructionsPerIteration = 4;
+
+// Every computational instruction, by function field.
+static constexpr std::array<u32, 45> Functions = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x13, 0x14, 0x15, 0x1D, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+    0x2A, 0x2B, 0x2C, 0x2D, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x3F,
+};
+
+static std::mt19937 s_random(0x52535055);
+
+static u32 random_int(const u32 min, const u32 max) {
+    return std::uniform_int_distribution<u32>(min, max)(s_random);
+}
+
+struct RSPVectorUnitTest {
+    using Vector = RSPVectorUnit::Vector;
+
+    static u16 random_element() {
+        // Edge values are where saturation and carries go wrong.
+        static constexpr std::array<u16, 6> EdgeValues = { 0x0000, 0x0001, 0x7FFF, 0x8000, 0x8001, 0xFFFF };
+        if (random_int(0, 3) == 0) {
+            return EdgeValues[random_int(0, EdgeValues.size() - 1)];
+        }
+        return static_cast<u16>(random_int(0, 0xFFFF));
+    }
+
+    static void randomize(Vector& vector) {
+        for (u16& element : vector.elements) {
+            element = random_element();
+        }
+    }
+
+    static void randomize_flags(Vector& flags) {
+        for (u16& element : flags.elements) {
+            element = random_int(0, 1) ? 0xFFFF : 0;
+        }
+    }
+
+    static void randomize(RSPVectorUnit& vu) {
+        for (Vector& vpr : vu.m_vprs) {
+            randomize(vpr);
+        }
+        randomize(vu.m_accumulator_high);
+        randomize(vu.m_accumulator_mid);
+        randomize(vu.m_accumulator_low);
+        randomize_flags(vu.m_vco_carry);
+        randomize_flags(vu.m_vco_not_equal);
+        randomize_flags(vu.m_vcc_compare);
+        randomize_flags(vu.m_vcc_clip);
+        randomize_flags(vu.m_vce);
+        vu.m_div_in = random_element();
+        vu.m_div_out = random_element();
+        vu.m_div_in_loaded = random_int(0, 1);
+    }
+
+    static void copy_state(const RSPVectorUnit& from, RSPVectorUnit& to) {
+        to.m_vprs = from.m_vprs;
+        to.m_accumulator_high = from.m_accumulator_high;
+        to.m_accumulator_mid = from.m_accumulator_mid;
+        to.m_accumulator_low = from.m_accumulator_low;
+        to.m_vco_carry = from.m_vco_carry;
+        to.m_vco_not_equal = from.m_vco_not_equal;
+        to.m_vcc_compare = from.m_vcc_compare;
+        to.m_vcc_clip = from.m_vcc_clip;
+        to.m_vce = from.m_vce;
+        to.m_div_in = from.m_div_in;
+        to.m_div_out = from.m_div_out;
+        to.m_div_in_loaded = from.m_div_in_loaded;
+    }
+
+    static bool same(const Vector& a, const Vector& b) {
+        return a.elements == b.elements;
+    }
+
+    static bool same_state(const RSPVectorUnit& a, const RSPVectorUnit& b) {
+        for (u32 i = 0; i < a.m_vprs.size(); i++) {
+            if (!same(a.m_vprs[i], b.m_vprs[i])) {
+                return false;
+            }
+        }
+        return same(a.m_accumulator_high, b.m_accumulator_high) && same(a.m_accumulator_mid, b.m_accumulator_mid) &&
+               same(a.m_accumulator_low, b.m_accumulator_low) && same(a.m_vco_carry, b.m_vco_carry) &&
+               same(a.m_vco_not_equal, b.m_vco_not_equal) && same(a.m_vcc_compare, b.m_vcc_compare) &&
+               same(a.m_vcc_clip, b.m_vcc_clip) && same(a.m_vce, b.m_vce) && a.m_div_in == b.m_div_in &&
+               a.m_div_out == b.m_div_out && a.m_div_in_loaded == b.m_div_in_loaded;
+    }
+
+    static int run(RSP& rsp) {
+        RSPVectorUnit scalar(rsp);
+        RSPVectorUnit sse41(rsp);
+        scalar.m_sse41 = false;
+        if (!sse41.m_sse41) {
+            fmt::print("SSE4.1 kernels not built, skipped\n");
+            return 0;
+        }
+
+        for (u32 i = 0; i < Iterations; i++) {
+            randomize(scalar);
+            copy_state(scalar, sse41);
+
+            for (u32 j = 0; j < InstructionsPerIteration; j++) {
+                const u32 instruction = 0x4A000000 | (random_int(0, 15) << 21) | (random_int(0, 31) << 16) |
+                                        (random_int(0, 31) << 11) | (random_int(0, 31) << 6) |
+                                        Functions[random_int(0, Functions.size() - 1)];
+                scalar.execute_instruction(instruction);
+                sse41.execute_instruction(instruction);
+                if (!same_state(scalar, sse41)) {
+                    fmt::print("SSE4.1 kernels differ from the scalar ones after {:08X}\n", instruction);
+                    return 1;
+                }
+            }
+        }
+
+        fmt::print("SSE4.1 kernels match the scalar ones\n");
+        return 0;
+    }
+};
+
+int main() {
+    // The vector unit needs an RSP, which needs a whole system, which needs a PIF and a cartridge to start.
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / fmt::format("fourixtys_rsp_vector_unit_test_{}", random_int(0, 0xFFFFFF));
+    std::filesystem::create_directories(directory);
+    {
+        std::ofstream(directory / "pif.bin", std::ios::binary) << std::string(PifSize, '\0');
+        std::string rom(0x2000, '\0');
+        rom.replace(0, 4, "\x80\x37\x12\x40", 4);
+        std::ofstream(directory / "rom.z64", std::ios::binary) << rom;
+    }
+
+    int result;
+    {
+        PIF pif(directory / "pif.bin");
+        GamePak gamepak(directory / "rom.z64");
+        N64 n64(pif, gamepak, CPUBackend::Interpreter, CacheEmulation::Disabled, TaskEmulation::LowLevel, 1);
+        result = RSPVectorUnitTest::run(n64.rsp());
+    }
+
+    std::filesystem::remove_all(directory);
+    return result;
+}